@@ -6,12 +6,17 @@ CONFIG += c++20
 
 DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# The SBC synthesis kernels must not be fused into FMA so scalar and SIMD output stay bit-exact
+!msvc: QMAKE_CXXFLAGS += -ffp-contract=off
+
 RC_ICONS = icon.ico
 
 # Windows-specific libraries
 win32 {
     QMAKE_CXXFLAGS += /await:strict /std:c++20 # Enable coroutines
     LIBS += -lUser32 -lOle32
+    LIBS += -lPsapi  # working set for the startup log
+    LIBS += -lAvrt  # MMCSS for the audio render thread
     LIBS += -lwindowsapp -lruntimeobject  # WinRT libs
     DEFINES += WINVER=0x0A00 _WIN32_WINNT=0x0A00  # Win10+
 
@@ -30,27 +35,105 @@ CONFIG(debug, debug|release) {
     DEFINES += RELEASE_BUILD
 }
 
+# Span tracing (spantrace.h, `--trace-spans`): qmake CONFIG+=tracing
+tracing {
+    DEFINES += PHONEAUDIOLINK_TRACING
+}
+
+# Heap allocation counts in the benchmarks: qmake CONFIG+=count_allocations
+# Replaces the global operator new, so keep it out of shipping builds
+count_allocations {
+    DEFINES += PHONEAUDIOLINK_COUNT_ALLOCATIONS
+}
+
 
 SOURCES += \
+    a2dpmediapipeline.cpp \
     animatedbutton.cpp \
+    asyncfilewriter.cpp \
+    audiorenderer.cpp \
     audiosessionmanager.cpp \
+    benchmark.cpp \
+    binarylog.cpp \
     bluetootha2dpsink.cpp \
+    btsnoopcapture.cpp \
+    btsnoopreplaybackend.cpp \
+    configstore.cpp \
+    connectionstats.cpp \
+    controlclient.cpp \
+    controlserver.cpp \
+    devicecache.cpp \
+    devicelistmodel.cpp \
+    devicemenu.cpp \
+    deviceregistry.cpp \
+    flightrecorder.cpp \
+    headless.cpp \
+    jitterbuffer.cpp \
+    linkcontroller.cpp \
+    lossconcealer.cpp \
     main.cpp \
+    mediapacket.cpp \
     phoneaudiolink.cpp \
+    processstats.cpp \
     releasenotesdialog.cpp \
+    samplerateconverter.cpp \
+    sbcdecoder.cpp \
+    sbcframe.cpp \
+    sbcsynthesis.cpp \
+    simulatedsinkbackend.cpp \
+    singleinstance.cpp \
+    spantrace.cpp \
     startuphelp.cpp \
+    startuptrace.cpp \
     updatechecker.cpp \
-    updatenotificationbar.cpp
+    updatenotificationbar.cpp \
+    winrtsinkbackend.cpp
 
 HEADERS += \
+    a2dpmediapipeline.h \
+    a2dpsinkbackend.h \
     animatedbutton.h \
+    asyncfilewriter.h \
+    asynctask.h \
+    audiorenderer.h \
     audiosessionmanager.h \
+    benchmark.h \
+    binarylog.h \
     bluetootha2dpsink.h \
+    btsnoopcapture.h \
+    btsnoopreplaybackend.h \
+    configstore.h \
+    connectionstats.h \
+    controlclient.h \
+    controlserver.h \
+    devicecache.h \
+    devicelistmodel.h \
+    devicemenu.h \
+    deviceregistry.h \
+    eventbatcher.h \
+    flightrecorder.h \
+    headless.h \
+    jitterbuffer.h \
+    linkcontroller.h \
+    lossconcealer.h \
+    mediapacket.h \
+    mpscqueue.h \
     phoneaudiolink.h \
+    processstats.h \
     releasenotesdialog.h \
+    samplerateconverter.h \
+    sbcdecoder.h \
+    sbcframe.h \
+    sbcsynthesis.h \
+    simulatedsinkbackend.h \
+    singleinstance.h \
+    spantrace.h \
+    spscring.h \
     startuphelp.h \
+    startuptrace.h \
     updatechecker.h \
-    updatenotificationbar.h
+    updatenotificationbar.h \
+    winrtsinkbackend.h
 
 FORMS += \
     phoneaudiolink.ui
@@ -66,10 +149,12 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 RESOURCES += \
-    resources.qrc
+    resources.qrc \
+    testvectors.qrc     # SBC reference vectors for `--benchmark sbc` (testvectors/sbc/generate.py)
 
 DISTFILES += \
-    README.md
+    README.md \
+    testvectors/sbc/generate.py
 
 # Verify MSVC compiler on Windows
 win32 {
@@ -0,0 +1,200 @@
+#include "a2dpmediapipeline.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+// Longest the decode thread sleeps before checking for new packets
+constexpr int64_t MaxIdleUs = 1000;
+
+} // namespace
+
+A2DPMediaPipeline::A2DPMediaPipeline(SbcKernel kernel)
+    : m_decoder(kernel)
+{
+}
+
+A2DPMediaPipeline::~A2DPMediaPipeline()
+{
+    stop();
+}
+
+void A2DPMediaPipeline::setJitterConfig(const JitterEstimator::Config &config)
+{
+    m_jitterConfig = config;
+}
+
+void A2DPMediaPipeline::start()
+{
+    if (m_decodeThread)
+        return;
+
+    // No consumer is running, so this thread may drain what the last stream left behind
+    m_jitterBuffer.setConfig(m_jitterConfig);
+    m_jitterBuffer.clear();
+
+    m_decodeRunning.store(true, std::memory_order_release);
+    m_decodeThread = QThread::create([this]() { decodeLoop(); });
+    m_decodeThread->start(QThread::HighestPriority);
+}
+
+void A2DPMediaPipeline::stop()
+{
+    if (!m_decodeThread)
+        return;
+
+    m_decodeRunning.store(false, std::memory_order_release);
+    m_decodeThread->wait();
+    delete m_decodeThread;
+    m_decodeThread = nullptr;
+}
+
+bool A2DPMediaPipeline::isRunning() const
+{
+    return m_decodeRunning.load(std::memory_order_acquire);
+}
+
+void A2DPMediaPipeline::setPcmSink(A2DPPcmSink *sink)
+{
+    m_pcmSink.store(sink, std::memory_order_release);
+}
+
+void A2DPMediaPipeline::reset()
+{
+    m_resetRequested.store(true, std::memory_order_release);
+    m_jitterBuffer.reset();
+}
+
+A2DPMediaPipeline::Statistics A2DPMediaPipeline::statistics() const
+{
+    Statistics stats;
+    stats.packetsReceived = m_packetsReceived.load(std::memory_order_relaxed);
+    stats.packetsMalformed = m_packetsMalformed.load(std::memory_order_relaxed);
+    stats.packetsFragmented = m_packetsFragmented.load(std::memory_order_relaxed);
+    stats.framesDecoded = m_framesDecoded.load(std::memory_order_relaxed);
+    stats.framesCorrupt = m_framesCorrupt.load(std::memory_order_relaxed);
+    stats.packetsLost = m_packetsLost.load(std::memory_order_relaxed);
+    stats.packetsOutOfOrder = m_packetsOutOfOrder.load(std::memory_order_relaxed);
+    stats.framesConcealed = m_framesConcealed.load(std::memory_order_relaxed);
+    return stats;
+}
+
+JitterBuffer::Statistics A2DPMediaPipeline::jitterStatistics() const
+{
+    return m_jitterBuffer.statistics();
+}
+
+void A2DPMediaPipeline::mediaPacketReceived(const uint8_t *data, size_t size, int64_t arrivalUs)
+{
+    if (m_decodeRunning.load(std::memory_order_acquire))
+        m_jitterBuffer.push(data, size, arrivalUs);
+    else
+        decodePacket(data, size);
+}
+
+void A2DPMediaPipeline::decodeLoop()
+{
+    while (m_decodeRunning.load(std::memory_order_acquire)) {
+        const int64_t nowUs = JitterBuffer::steadyMicros();
+        const JitterBuffer::Packet *packet = m_jitterBuffer.front();
+        if (packet && packet->deadlineUs <= nowUs) {
+            decodePacket(packet->data, packet->size);
+            m_jitterBuffer.pop();
+            continue;
+        }
+
+        const int64_t waitUs = packet ? std::min(packet->deadlineUs - nowUs, MaxIdleUs) : MaxIdleUs;
+        std::this_thread::sleep_for(std::chrono::microseconds(waitUs));
+    }
+}
+
+void A2DPMediaPipeline::decodePacket(const uint8_t *data, size_t size)
+{
+    if (m_resetRequested.exchange(false, std::memory_order_acq_rel)) {
+        m_decoder.reset();
+        m_concealer.reset();
+        m_sequenceValid = false;
+        m_framesPerPacket = 0;
+    }
+
+    m_packetsReceived.fetch_add(1, std::memory_order_relaxed);
+
+    const MediaPacket::Status status = m_packet.parse({ data, size });
+    if (!m_packet.hasRtpHeader()) {
+        m_packetsMalformed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    A2DPPcmSink *sink = m_pcmSink.load(std::memory_order_acquire);
+
+    // Sequence gaps are lost packets: fill them in before this packet's audio
+    const uint16_t sequence = m_packet.sequence();
+    if (m_sequenceValid) {
+        const int gap = int16_t(uint16_t(sequence - m_expectedSequence));
+        if (gap < 0) {
+            // Already played past it
+            m_packetsOutOfOrder.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (gap > 0) {
+            m_packetsLost.fetch_add(uint64_t(gap), std::memory_order_relaxed);
+            if (gap <= MaxConcealedPackets)
+                concealFrames(gap * m_framesPerPacket, sink);
+        }
+    }
+    m_sequenceValid = true;
+    m_expectedSequence = uint16_t(sequence + 1);
+
+    if (status == MediaPacket::Status::Fragmented) {
+        // Not reassembled; the frame is gone once its last fragment has been seen
+        m_packetsFragmented.fetch_add(1, std::memory_order_relaxed);
+        if (m_packet.isLastFragment())
+            concealFrames(1, sink);
+        return;
+    }
+    if (status != MediaPacket::Status::Ok)
+        m_packetsMalformed.fetch_add(1, std::memory_order_relaxed);
+    if (m_packet.declaredFrames() > 0)
+        m_framesPerPacket = m_packet.declaredFrames();
+
+    for (const SbcFrameView &frame : m_packet.frames()) {
+        if (m_decoder.decode(frame, m_pcm) != SbcDecoder::Result::Ok) {
+            // The length is still known from the header, so only this frame is lost
+            m_framesCorrupt.fetch_add(1, std::memory_order_relaxed);
+            concealFrames(1, sink);
+            continue;
+        }
+        m_framesDecoded.fetch_add(1, std::memory_order_relaxed);
+
+        const SbcFrameHeader &header = m_decoder.header();
+        m_concealer.decoded(m_pcm, header.samplesPerChannel(), header.channels());
+        if (sink)
+            sink->pcmDecoded(m_pcm, header.samplesPerChannel(), header.channels(), header.sampleRate);
+    }
+
+    // The rest of the packet cannot be framed; conceal what it should have held
+    const int unframed = m_packet.declaredFrames() - int(m_packet.frames().size());
+    if (unframed > 0) {
+        m_framesCorrupt.fetch_add(uint64_t(unframed), std::memory_order_relaxed);
+        concealFrames(unframed, sink);
+    }
+}
+
+void A2DPMediaPipeline::concealFrames(int frames, A2DPPcmSink *sink)
+{
+    // Nothing to imitate before the first good frame
+    if (!m_decoder.hasHeader())
+        return;
+
+    const SbcFrameHeader &header = m_decoder.header();
+    for (int i = 0; i < frames; i++) {
+        m_concealer.conceal(m_pcm, header.samplesPerChannel(), header.channels());
+        m_framesConcealed.fetch_add(1, std::memory_order_relaxed);
+        if (sink)
+            sink->pcmDecoded(m_pcm, header.samplesPerChannel(), header.channels(), header.sampleRate);
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef A2DPMEDIAPIPELINE_H
+#define A2DPMEDIAPIPELINE_H
+
+#include "a2dpsinkbackend.h"
+#include "jitterbuffer.h"
+#include "lossconcealer.h"
+#include "mediapacket.h"
+#include "sbcdecoder.h"
+
+#include <cstdint>
+#include <atomic>
+
+class QThread;
+
+// Receives decoded PCM from A2DPMediaPipeline, on the transport thread
+class A2DPPcmSink
+{
+public:
+    virtual ~A2DPPcmSink() = default;
+    virtual void pcmDecoded(const int16_t *samples, int frames, int channels, int sampleRate) = 0;
+};
+
+// In-process A2DP media path: RTP and A2DP payload parsing in place (MediaPacket) followed by SBC
+// decoding straight from the packet buffer. While started, packets pass through a jitter buffer
+// and are decoded on a dedicated thread at their playout deadline; otherwise they are decoded on
+// the backend's transport thread as they arrive. Statistics may be read from any thread.
+class A2DPMediaPipeline : public A2DPMediaSink
+{
+public:
+    struct Statistics {
+        uint64_t packetsReceived = 0;
+        uint64_t packetsMalformed = 0;
+        uint64_t packetsFragmented = 0;     // frames split across packets, not reassembled
+        uint64_t framesDecoded = 0;
+        uint64_t framesCorrupt = 0;
+        uint64_t packetsLost = 0;           // gaps in the RTP sequence numbers
+        uint64_t packetsOutOfOrder = 0;     // late or duplicate, discarded
+        uint64_t framesConcealed = 0;       // SBC frames replaced by loss concealment
+    };
+
+    // Longer sequence gaps are treated as a stream restart and not concealed
+    static constexpr int MaxConcealedPackets = 32;
+
+    explicit A2DPMediaPipeline(SbcKernel kernel = SbcSynthesis::bestKernel());
+    ~A2DPMediaPipeline() override;
+
+    void setPcmSink(A2DPPcmSink *sink);
+
+    // Jitter buffer tuning (underrun budget, depth limits); applies from the next start()
+    void setJitterConfig(const JitterEstimator::Config &config);
+
+    // Starts/stops the jitter buffer and decode thread (call from the owning thread)
+    void start();
+    void stop();
+    bool isRunning() const;
+
+    void mediaPacketReceived(const uint8_t *data, size_t size, int64_t arrivalUs) override;
+
+    // Drops decoder history before the next packet (safe to call from any thread)
+    void reset();
+
+    Statistics statistics() const;
+
+    // Chosen playout depth and arrival jitter percentiles
+    JitterBuffer::Statistics jitterStatistics() const;
+
+    SbcKernel kernel() const { return m_decoder.kernel(); }
+
+private:
+    void decodePacket(const uint8_t *data, size_t size);
+    void concealFrames(int frames, A2DPPcmSink *sink);
+    void decodeLoop();
+
+    SbcDecoder m_decoder;
+    JitterBuffer m_jitterBuffer;
+    JitterEstimator::Config m_jitterConfig;
+    QThread *m_decodeThread = nullptr;
+    std::atomic<bool> m_decodeRunning{false};
+    std::atomic<A2DPPcmSink*> m_pcmSink{nullptr};
+    std::atomic<bool> m_resetRequested{false};
+
+    // Decode thread only
+    MediaPacket m_packet;
+    PacketLossConcealer m_concealer;
+    bool m_sequenceValid = false;
+    uint16_t m_expectedSequence = 0;
+    int m_framesPerPacket = 0;
+
+    std::atomic<uint64_t> m_packetsReceived{0};
+    std::atomic<uint64_t> m_packetsMalformed{0};
+    std::atomic<uint64_t> m_packetsFragmented{0};
+    std::atomic<uint64_t> m_framesDecoded{0};
+    std::atomic<uint64_t> m_framesCorrupt{0};
+    std::atomic<uint64_t> m_packetsLost{0};
+    std::atomic<uint64_t> m_packetsOutOfOrder{0};
+    std::atomic<uint64_t> m_framesConcealed{0};
+
+    alignas(16) int16_t m_pcm[Sbc::MaxSamplesPerFrame];
+};
+
+#endif // A2DPMEDIAPIPELINE_H
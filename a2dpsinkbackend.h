@@ -0,0 +1,89 @@
+#ifndef A2DPSINKBACKEND_H
+#define A2DPSINKBACKEND_H
+
+#include <QList>
+#include <QObject>
+#include <QString>
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+// Receives raw A2DP media packets (RTP header + media payload) from a backend.
+// Called on the backend's transport thread, never on the GUI thread. arrivalUs is on the
+// steady clock in microseconds (JitterBuffer::steadyMicros()).
+class A2DPMediaSink
+{
+public:
+    virtual ~A2DPMediaSink() = default;
+    virtual void mediaPacketReceived(const uint8_t *data, size_t size, int64_t arrivalUs) = 0;
+};
+
+// Steps of a connect, in the order they happen. Backends report each one through
+// connectMilestone() with the steady clock time (microseconds) it happened at.
+enum class ConnectMilestone {
+    EnableCalled,       // enableSink() requested (recorded by BluetoothA2DPSink)
+    ConnectionCreated,  // AudioPlaybackConnection::TryCreateFromId returned
+    SinkStarted,        // StartAsync completed
+    ConnectionOpened,   // OpenAsync completed successfully
+    StreamOpened,       // first StateChanged(Opened), audio is flowing
+    Count
+};
+
+// A device a backend can connect to, as found by its discovery
+struct A2DPDevice
+{
+    QString deviceId;
+    QString name;
+};
+
+// Platform side of BluetoothA2DPSink: discovery, connection lifecycle and media controls.
+// Backends emit their signals on the thread that owns them (the GUI thread).
+class A2DPSinkBackend : public QObject
+{
+    Q_OBJECT
+public:
+    explicit A2DPSinkBackend(QObject *parent = nullptr) : QObject(parent) {}
+    ~A2DPSinkBackend() override = default;
+
+    // Human readable backend name, for logging
+    virtual QString name() const = 0;
+
+    // Whether this backend is responsible for the given device ID
+    virtual bool handlesDeviceId(const QString &deviceId) const { Q_UNUSED(deviceId); return true; }
+
+    // Whether the media stream is delivered to the media sink (and must be played in-process)
+    // rather than rendered by the platform
+    virtual bool providesMediaStream() const { return false; }
+
+    virtual void startDeviceDiscovery() = 0;
+    virtual void stopDeviceDiscovery() = 0;
+    virtual bool enableSink(const QString &deviceId) = 0;
+    virtual bool openConnection() = 0;
+    virtual void releaseConnection() = 0;
+    virtual bool isStreaming() const = 0;
+
+    virtual void sendPlayPause() = 0;
+    virtual void sendNext() = 0;
+    virtual void sendPrevious() = 0;
+    virtual void sendStop() = 0;
+
+    // Backends that see the raw media stream hand every packet to this sink
+    void setMediaSink(A2DPMediaSink *sink) { m_mediaSink.store(sink, std::memory_order_release); }
+
+signals:
+    // Devices found since the last emission; backends batch what arrives close together
+    void devicesDiscovered(const QList<A2DPDevice> &devices);
+    void discoveryCompleted();
+    void sinkEnabled();
+    void connectionOpened();
+    void connectionClosed();
+    void connectionError(const QString &error);
+    void stateChanged(const QString &state);
+    void connectMilestone(ConnectMilestone milestone, qint64 steadyUs);
+
+protected:
+    std::atomic<A2DPMediaSink*> m_mediaSink{nullptr};
+};
+
+#endif // A2DPSINKBACKEND_H
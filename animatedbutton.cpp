@@ -1,8 +1,12 @@
 #include "animatedbutton.h"
 
 AnimatedButton::AnimatedButton(QWidget *parent)
-    : QPushButton(parent), m_progress(0.0)
+    : QPushButton(parent), m_progress(0.0), m_hovered(false)
 {
+}
+
+//the 512px icons are decoded on first paint, so a window that stays hidden never loads them
+void AnimatedButton::loadPixmaps() {
     if(QGuiApplication::styleHints()->colorScheme() == Qt::ColorScheme::Light) {
         m_playPixmap = QPixmap(":/icons/Iconparts/play-512.png");
         m_pausePixmap = QPixmap(":/icons/Iconparts/pause-512.png");
@@ -23,6 +27,7 @@ void AnimatedButton::setProgress(qreal p) {
 
 void AnimatedButton::paintEvent(QPaintEvent *event) {
     Q_UNUSED(event);
+    if(m_playPixmap.isNull() && m_pausePixmap.isNull()) loadPixmaps();
     QPainter painter(this);
 
     //set up a style option and let Qt draw the button background (with hover highlight)
@@ -27,6 +27,8 @@ protected:
     void enterEvent(QEnterEvent *event) override;
     void leaveEvent(QEvent *event) override;
 private:
+    void loadPixmaps();
+
     qreal m_progress;
     bool m_hovered;
     QPixmap m_playPixmap;
@@ -0,0 +1,57 @@
+#include "asyncfilewriter.h"
+
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QDebug>
+
+AsyncFileWriter::AsyncFileWriter(QObject *parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(1);
+    m_pool.setExpiryTimeout(5000);  // no idle thread kept around between the rare writes
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+    flush();
+}
+
+void AsyncFileWriter::write(const QString &path, const QByteArray &data)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_pending.contains(path))
+        m_order.append(path);
+    m_pending.insert(path, data);
+    if (m_draining)
+        return;
+    m_draining = true;
+    m_pool.start([this]() { drain(); });
+}
+
+void AsyncFileWriter::flush()
+{
+    m_pool.waitForDone();
+}
+
+void AsyncFileWriter::drain()
+{
+    for (;;) {
+        QString path;
+        QByteArray data;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_order.isEmpty()) {
+                m_draining = false;
+                return;
+            }
+            path = m_order.takeFirst();
+            data = m_pending.take(path);
+        }
+
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+            qWarning() << "Cannot write" << path << ":" << file.errorString();
+            emit writeFailed(path, file.errorString());
+        }
+    }
+}
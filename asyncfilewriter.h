@@ -0,0 +1,41 @@
+#ifndef ASYNCFILEWRITER_H
+#define ASYNCFILEWRITER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+// Writes files on a worker thread, atomically (QSaveFile: temporary file, then rename), so a slow
+// or network-redirected disk never blocks the caller and a crash mid-write leaves the previous
+// file intact. Writes to the same path are coalesced: only the latest data queued before the
+// worker gets to it is written. Writes happen in one worker thread, in queue order.
+class AsyncFileWriter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AsyncFileWriter(QObject *parent = nullptr);
+    ~AsyncFileWriter() override;   // flushes
+
+    void write(const QString &path, const QByteArray &data);
+
+    // Blocks until everything queued so far is on disk
+    void flush();
+
+signals:
+    // Emitted on the worker thread; connections to objects on other threads are queued
+    void writeFailed(const QString &path, const QString &error);
+
+private:
+    void drain();
+
+    QThreadPool m_pool;
+    QMutex m_mutex;
+    QHash<QString, QByteArray> m_pending;   // guarded by m_mutex
+    QList<QString> m_order;                 // paths in the order they were first queued
+    bool m_draining = false;                // a drain() is queued or running
+};
+
+#endif // ASYNCFILEWRITER_H
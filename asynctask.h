@@ -0,0 +1,173 @@
+#ifndef ASYNCTASK_H
+#define ASYNCTASK_H
+
+#include <QMetaObject>
+#include <QObject>
+#include <QPointer>
+#include <QDebug>
+
+#include <atomic>
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+
+// Coroutines driven by the Qt event loop, for backend operations that complete on foreign threads
+// (WinRT async operations, or a fake in the benchmark).
+//
+//     AsyncTask Backend::enableAsync(CancellationToken token)
+//     {
+//         const Outcome outcome = co_await AsyncCompletion<Outcome>(this, token, startOperation);
+//         // Runs on this object's thread, and only if the token is still valid
+//     }
+//
+// Each co_await of an AsyncCompletion costs exactly one queued event to the context object's
+// thread. A completion whose token was cancelled in the meantime (a newer connect attempt, a
+// release) never resumes: its coroutine frame is destroyed instead, without a hop if the
+// cancellation is already visible on the completing thread. The same happens when the context
+// object is deleted before the completion is delivered.
+
+// A snapshot of a CancellationSource's generation; cancelled once the source moves past it
+class CancellationToken
+{
+public:
+    // Never cancelled
+    CancellationToken() = default;
+
+    bool isCancelled() const { return m_state && m_state->load(std::memory_order_acquire) != m_generation; }
+    quint64 generation() const { return m_generation; }
+
+private:
+    friend class CancellationSource;
+    CancellationToken(std::shared_ptr<const std::atomic<quint64>> state, quint64 generation)
+        : m_state(std::move(state))
+        , m_generation(generation)
+    {}
+
+    std::shared_ptr<const std::atomic<quint64>> m_state;
+    quint64 m_generation = 0;
+};
+
+// A generation counter: token() hands out the current generation, cancel() invalidates every
+// token handed out so far. Tokens may be checked from any thread.
+class CancellationSource
+{
+public:
+    CancellationSource() : m_state(std::make_shared<std::atomic<quint64>>(0)) {}
+    ~CancellationSource() { cancel(); }
+
+    CancellationSource(const CancellationSource &) = delete;
+    CancellationSource &operator=(const CancellationSource &) = delete;
+
+    CancellationToken token() const { return CancellationToken(m_state, m_state->load(std::memory_order_acquire)); }
+    void cancel() { m_state->fetch_add(1, std::memory_order_acq_rel); }
+
+private:
+    std::shared_ptr<std::atomic<quint64>> m_state;
+};
+
+// Return type of a coroutine that runs detached: it starts eagerly, and its frame is freed when
+// it finishes or when an AsyncCompletion it waits on is discarded.
+class AsyncTask
+{
+public:
+    struct promise_type
+    {
+        promise_type() { s_running.fetch_add(1, std::memory_order_relaxed); }
+        ~promise_type() { s_running.fetch_sub(1, std::memory_order_relaxed); }
+
+        AsyncTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { qWarning() << "Unhandled exception in an AsyncTask"; }
+    };
+
+    // Coroutine frames alive right now, suspended or running
+    static int running() { return s_running.load(std::memory_order_relaxed); }
+
+private:
+    static inline std::atomic<int> s_running{ 0 };
+};
+
+// Awaits an operation that reports its result through a callback, called once from any thread.
+// The coroutine resumes on the context object's thread with that result. If the callback is never
+// called (the operation was dropped), the coroutine frame is destroyed along with it.
+template <typename T>
+class AsyncCompletion
+{
+public:
+    using Callback = std::function<void(T)>;
+    using Start = std::function<void(Callback)>;
+
+    AsyncCompletion(QObject *context, CancellationToken token, Start start)
+        : m_context(context)
+        , m_start(std::move(start))
+        , m_state(std::make_shared<State>(std::move(token)))
+    {}
+
+    AsyncCompletion(const AsyncCompletion &) = delete;
+    AsyncCompletion &operator=(const AsyncCompletion &) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        m_state->handle = handle;
+        m_state->result = &m_result;
+
+        // The operation may complete, and the frame holding this awaiter go away, before start()
+        // returns; nothing below touches a member after it. The awaiter holds no reference to the
+        // state either, so the callback (and the event it posts) own the frame.
+        const QPointer<QObject> context = m_context;
+        Callback done = [context, state = std::move(m_state)](T value) {
+            // Otherwise the last reference goes with this callback, destroying the frame
+            if (state->token.isCancelled() || !context)
+                return;
+            state->value = std::move(value);
+            QMetaObject::invokeMethod(context.data(), [state]() { state->resume(); }, Qt::QueuedConnection);
+        };
+        Start start = std::move(m_start);
+        start(std::move(done));
+    }
+
+    T await_resume() { return std::move(*m_result); }
+
+private:
+    struct State
+    {
+        explicit State(CancellationToken cancellation) : token(std::move(cancellation)) {}
+
+        // Whoever drops the last reference to a frame that was never resumed destroys it
+        ~State()
+        {
+            if (handle)
+                handle.destroy();
+        }
+
+        // On the context object's thread
+        void resume()
+        {
+            const std::coroutine_handle<> frame = std::exchange(handle, {});
+            if (token.isCancelled()) {
+                frame.destroy();
+                return;
+            }
+            *result = std::move(value);
+            frame.resume();
+        }
+
+        CancellationToken token;
+        std::coroutine_handle<> handle;
+        std::optional<T> value;             // written on the completing thread
+        std::optional<T> *result = nullptr; // the awaiter's, in the coroutine frame
+    };
+
+    QObject *m_context;
+    Start m_start;
+    std::shared_ptr<State> m_state;
+    std::optional<T> m_result;
+};
+
+#endif // ASYNCTASK_H
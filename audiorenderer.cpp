@@ -0,0 +1,396 @@
+#include "audiorenderer.h"
+
+#include <QElapsedTimer>
+#include <QMediaDevices>
+#include <QAudioDevice>
+#include <QAudioFormat>
+#include <QAudioSink>
+#include <QIODevice>
+#include <QThread>
+#include <QTimer>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <avrt.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+
+constexpr int FrameBytes = AudioBlock::Channels * sizeof(int16_t);
+
+// Housekeeping period of the render thread (output (re)configuration and the null clock)
+constexpr int ServiceIntervalMs = 5;
+
+// Output buffer requested from the audio device
+constexpr int OutputBufferMs = 20;
+
+// Output rate when there is no device to ask
+constexpr int DefaultOutputRate = 48000;
+
+// Largest output/input rate ratio the conversion buffer is sized for (e.g. 16 kHz to 96 kHz)
+constexpr int MaxConversionRatio = 6;
+
+// Longest filter of any resampler quality
+constexpr int MaxFilterTaps = 64;
+
+ResamplerQuality resamplerQuality(const QString &name)
+{
+    if (name == "low")
+        return ResamplerQuality::Low;
+    if (name == "high")
+        return ResamplerQuality::High;
+    return ResamplerQuality::Medium;
+}
+
+} // namespace
+
+// Pull-mode source for QAudioSink that reads straight out of the renderer's ring.
+// Only ever touched on the render thread.
+class RingDevice : public QIODevice
+{
+public:
+    explicit RingDevice(AudioRenderer *renderer) : m_renderer(renderer) {}
+
+    // Sample rate of the oldest queued block, or 0 if nothing is queued
+    int pendingSampleRate()
+    {
+        const AudioBlock *block = m_renderer->m_ring.front();
+        return block ? block->sampleRate : 0;
+    }
+
+    void setSampleRate(int sampleRate)
+    {
+        m_sampleRate = sampleRate;
+        m_offset = 0;
+        m_prefilling = true;
+        m_rateChanged = false;
+    }
+
+    // Set once the stream reaches a block with a different sample rate
+    bool rateChanged() const { return m_rateChanged; }
+
+    bool isSequential() const override { return true; }
+
+    // Always report data so the sink keeps pulling; gaps are filled with silence
+    qint64 bytesAvailable() const override
+    {
+        return QIODevice::bytesAvailable() + qint64(AudioBlockRing::capacity()) * AudioBlock::MaxFrames * FrameBytes;
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    AudioRenderer *m_renderer;
+    int m_sampleRate = 0;
+    int m_offset = 0;           // frames of the head block already played
+    bool m_prefilling = true;
+    bool m_rateChanged = false;
+};
+
+qint64 RingDevice::readData(char *data, qint64 maxSize)
+{
+    AudioBlockRing &ring = m_renderer->m_ring;
+    int16_t *out = reinterpret_cast<int16_t*>(data);
+    const qint64 wanted = maxSize / FrameBytes;
+    qint64 written = 0;
+
+    if (m_prefilling && ring.size() >= size_t(AudioRenderer::PrefillBlocks))
+        m_prefilling = false;
+
+    while (!m_prefilling && !m_rateChanged && written < wanted) {
+        const AudioBlock *block = ring.front();
+        if (!block) {
+            // Ran dry: play silence and rebuild the cushion before resuming
+            m_renderer->m_underruns.fetch_add(1, std::memory_order_relaxed);
+            m_prefilling = true;
+            break;
+        }
+        if (block->sampleRate != m_sampleRate) {
+            m_rateChanged = true;
+            break;
+        }
+
+        const int count = int(std::min<qint64>(block->frames - m_offset, wanted - written));
+        std::memcpy(out + written * AudioBlock::Channels,
+                    block->samples + m_offset * AudioBlock::Channels,
+                    size_t(count) * FrameBytes);
+        written += count;
+        m_offset += count;
+
+        if (m_offset >= block->frames) {
+            m_renderer->m_framesPlayed.fetch_add(uint64_t(block->frames), std::memory_order_relaxed);
+            ring.pop();
+            m_offset = 0;
+        }
+    }
+
+    std::fill(out + written * AudioBlock::Channels, out + wanted * AudioBlock::Channels, int16_t(0));
+    return wanted * FrameBytes;
+}
+
+// Owns the output device. Everything it creates lives on (and is destroyed on) this thread.
+class AudioRenderThread : public QThread
+{
+public:
+    explicit AudioRenderThread(AudioRenderer *renderer) : QThread(renderer), m_renderer(renderer) {}
+
+protected:
+    void run() override;
+
+private:
+    AudioRenderer *m_renderer;
+};
+
+void AudioRenderThread::run()
+{
+#ifdef Q_OS_WIN
+    // Let the multimedia class scheduler boost this thread alongside other pro audio work
+    DWORD taskIndex = 0;
+    HANDLE mmcssTask = AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
+    if (!mmcssTask)
+        qWarning() << "AudioRenderer: MMCSS registration failed, error" << GetLastError();
+#endif
+
+    RingDevice device(m_renderer);
+    device.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    bool nullOutput = qEnvironmentVariable(AudioRenderer::OutputEnvironmentVariable) == "null"
+                      || QMediaDevices::defaultAudioOutput().isNull();
+
+    std::unique_ptr<QAudioSink> sink;
+    std::vector<char> scratch;
+    QElapsedTimer nullClock;
+    qint64 nullFramesConsumed = 0;
+    int sampleRate = 0;
+
+    QTimer service;
+    service.setTimerType(Qt::PreciseTimer);
+    service.setInterval(ServiceIntervalMs);
+    QObject::connect(&service, &QTimer::timeout, [&]() {
+        // Open the output once the first block arrives, reopen it when the stream changes rate
+        if (sampleRate == 0 || device.rateChanged()) {
+            const int pendingRate = device.pendingSampleRate();
+            if (pendingRate == 0)
+                return;
+
+            sink.reset();
+            sampleRate = pendingRate;
+            device.setSampleRate(sampleRate);
+
+            if (!nullOutput) {
+                QAudioFormat format;
+                format.setSampleRate(sampleRate);
+                format.setChannelCount(AudioBlock::Channels);
+                format.setSampleFormat(QAudioFormat::Int16);
+
+                sink = std::make_unique<QAudioSink>(QMediaDevices::defaultAudioOutput(), format);
+                sink->setBufferSize(qsizetype(sampleRate) * FrameBytes * OutputBufferMs / 1000);
+                sink->start(&device);
+                if (sink->error() != QAudio::NoError) {
+                    qWarning() << "AudioRenderer: cannot open audio output, error" << sink->error()
+                               << "- falling back to the null output";
+                    sink.reset();
+                    nullOutput = true;
+                }
+            }
+
+            if (nullOutput) {
+                scratch.resize(size_t(sampleRate / 10) * FrameBytes);
+                nullFramesConsumed = 0;
+                nullClock.start();
+            }
+
+            qDebug() << "AudioRenderer: output" << (nullOutput ? "null" : "device") << "at" << sampleRate << "Hz";
+        }
+
+        // Null output: consume the ring at the stream's real-time rate
+        if (nullOutput && sampleRate > 0) {
+            const qint64 due = qint64(nullClock.nsecsElapsed() / 1e9 * sampleRate) - nullFramesConsumed;
+            const qint64 frames = std::min<qint64>(due, qint64(scratch.size()) / FrameBytes);
+            if (frames > 0) {
+                device.read(scratch.data(), frames * FrameBytes);
+                nullFramesConsumed += frames;
+            }
+        }
+    });
+    service.start();
+
+    exec();
+
+    service.stop();
+    if (sink)
+        sink->stop();
+    sink.reset();
+    device.close();
+
+#ifdef Q_OS_WIN
+    if (mmcssTask)
+        AvRevertMmThreadCharacteristics(mmcssTask);
+#endif
+}
+
+AudioRenderer::AudioRenderer(QObject *parent)
+    : QObject(parent)
+    , m_thread(new AudioRenderThread(this))
+    , m_resample(qEnvironmentVariable(ResamplerEnvironmentVariable) != "off")
+    , m_converter(resamplerQuality(qEnvironmentVariable(ResamplerEnvironmentVariable)))
+    , m_converted(size_t((AudioBlock::MaxFrames + MaxFilterTaps) * MaxConversionRatio + 2) * AudioBlock::Channels)
+{
+}
+
+AudioRenderer::~AudioRenderer()
+{
+    stop();
+}
+
+void AudioRenderer::start()
+{
+    if (m_thread->isRunning())
+        return;
+
+    // Drop blocks left over from the previous stream. The render thread is stopped, so this
+    // thread is the only consumer, and the producer ignores the ring until m_running is set.
+    while (m_ring.front())
+        m_ring.pop();
+    m_writeBlock = nullptr;
+
+    // Render at the device's own rate so the platform mixer never resamples a second time
+    const QAudioDevice device = QMediaDevices::defaultAudioOutput();
+    m_outputRate = device.isNull() ? 0 : device.preferredFormat().sampleRate();
+    if (m_outputRate <= 0 || qEnvironmentVariable(OutputEnvironmentVariable) == "null")
+        m_outputRate = DefaultOutputRate;
+
+    m_driftController.reset();
+    m_framesQueued.store(0, std::memory_order_relaxed);
+    m_framesPlayed.store(0, std::memory_order_relaxed);
+    m_driftPpm.store(0.0, std::memory_order_relaxed);
+    if (m_converter.inputRate() > 0)
+        m_converter.reset();
+
+    m_running.store(true, std::memory_order_release);
+    m_thread->start(QThread::TimeCriticalPriority);
+    qDebug() << "AudioRenderer: render thread started, output" << m_outputRate << "Hz, resampler"
+             << (m_resample ? SampleRateConverter::qualityName(m_converter.quality()) : "off");
+}
+
+void AudioRenderer::stop()
+{
+    if (!m_thread->isRunning())
+        return;
+
+    m_running.store(false, std::memory_order_release);
+
+    // The decoder has stopped by now, so the producer side is idle; the stream's tail is the
+    // only block that goes out short
+    if (m_writeBlock)
+        commitBlock();
+
+    m_thread->quit();
+    m_thread->wait();
+    qDebug() << "AudioRenderer: render thread stopped";
+}
+
+bool AudioRenderer::isRunning() const
+{
+    return m_running.load(std::memory_order_acquire);
+}
+
+void AudioRenderer::pcmDecoded(const int16_t *samples, int frames, int channels, int sampleRate)
+{
+    if (!m_running.load(std::memory_order_acquire))
+        return;
+
+    frames = (std::min)(frames, AudioBlock::MaxFrames);
+    const int16_t *stereo = samples;
+    if (channels != AudioBlock::Channels) {
+        // Mono: duplicate into both output channels
+        for (int i = 0; i < frames; i++)
+            m_stereo[2 * i] = m_stereo[2 * i + 1] = samples[i];
+        stereo = m_stereo;
+    }
+
+    if (!m_resample) {
+        queueFrames(stereo, frames, sampleRate);
+        return;
+    }
+
+    // Rebuilds the filter only when the stream starts or changes rate
+    if (m_converter.inputRate() != sampleRate || m_converter.outputRate() != m_outputRate) {
+        m_converter.configure(sampleRate, m_outputRate);
+        m_driftController.reset();
+    }
+
+    // Frames queued but not yet played; only this thread adds to m_framesQueued
+    const uint64_t queued = m_framesQueued.load(std::memory_order_relaxed);
+    const uint64_t played = m_framesPlayed.load(std::memory_order_relaxed);
+    const double ppm = m_driftController.update(double(queued - played), double(frames) / sampleRate);
+    m_converter.setDriftCorrection(ppm);
+    m_driftPpm.store(ppm, std::memory_order_relaxed);
+
+    const int converted = m_converter.process(stereo, frames, m_converted.data(),
+                                              int(m_converted.size() / AudioBlock::Channels));
+    queueFrames(m_converted.data(), converted, m_outputRate);
+}
+
+void AudioRenderer::queueFrames(const int16_t *samples, int frames, int sampleRate)
+{
+    // A block plays at one rate, so a rate change hands over the partly filled block first
+    if (m_writeBlock && m_writeBlock->sampleRate != sampleRate)
+        commitBlock();
+
+    // Fill the ring's write slot in place and publish it only once it is full; the resampler's
+    // output rarely matches the block size, and the rest carries over to the next call
+    while (frames > 0) {
+        if (!m_writeBlock) {
+            m_writeBlock = m_ring.beginWrite();
+            if (!m_writeBlock) {
+                m_overruns.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            m_writeBlock->frames = 0;
+            m_writeBlock->sampleRate = sampleRate;
+        }
+
+        const int count = (std::min)(frames, AudioBlock::MaxFrames - m_writeBlock->frames);
+        std::memcpy(m_writeBlock->samples + m_writeBlock->frames * AudioBlock::Channels, samples,
+                    size_t(count) * FrameBytes);
+        m_writeBlock->frames += count;
+        samples += count * AudioBlock::Channels;
+        frames -= count;
+
+        if (m_writeBlock->frames == AudioBlock::MaxFrames)
+            commitBlock();
+    }
+}
+
+void AudioRenderer::commitBlock()
+{
+    const int frames = m_writeBlock->frames;
+    m_writeBlock = nullptr;
+    if (frames == 0)
+        return;
+
+    m_ring.commitWrite();
+    m_blocksQueued.fetch_add(1, std::memory_order_relaxed);
+    m_framesQueued.fetch_add(uint64_t(frames), std::memory_order_relaxed);
+}
+
+AudioRenderer::Statistics AudioRenderer::statistics() const
+{
+    Statistics statistics;
+    statistics.blocksQueued = m_blocksQueued.load(std::memory_order_relaxed);
+    statistics.underruns = m_underruns.load(std::memory_order_relaxed);
+    statistics.overruns = m_overruns.load(std::memory_order_relaxed);
+    statistics.bufferedBlocks = m_ring.size();
+    statistics.outputRate = m_outputRate;
+    statistics.driftPpm = m_driftPpm.load(std::memory_order_relaxed);
+    return statistics;
+}
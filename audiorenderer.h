@@ -0,0 +1,103 @@
+#ifndef AUDIORENDERER_H
+#define AUDIORENDERER_H
+
+#include "a2dpmediapipeline.h"
+#include "samplerateconverter.h"
+#include "spscring.h"
+
+#include <QObject>
+
+#include <cstdint>
+#include <atomic>
+#include <vector>
+
+// Fixed-size block of interleaved stereo PCM handed from the decoder to the render thread.
+// Blocks are filled to MaxFrames (the largest SBC frame, 16 blocks x 8 subbands) before they are
+// queued, whatever the decoder or resampler hands over at a time; only the last one of a stream
+// can be short.
+struct AudioBlock
+{
+    static constexpr int MaxFrames = Sbc::MaxBlocks * Sbc::MaxSubbands;
+    static constexpr int Channels = 2;
+
+    int frames;
+    int sampleRate;
+    int16_t samples[MaxFrames * Channels];
+};
+
+// About 190 ms of 44.1 kHz audio in 128 frame blocks
+using AudioBlockRing = SpscRing<AudioBlock, 64>;
+
+class AudioRenderThread;
+
+// Plays decoded PCM on a dedicated high priority render thread. pcmDecoded() is the producer
+// side of a wait-free ring and runs on the transport/decoder thread; the render thread is the
+// only consumer. Neither side takes locks or allocates while streaming, so a stalled GUI thread
+// cannot cause glitches.
+//
+// On the producer side a SampleRateConverter converts the stream to the output device's rate,
+// with a ClockDriftController nudging the ratio so the ring's fill level (and with it the
+// latency) stays put even though the phone's and the PC's clocks drift apart.
+class AudioRenderer : public QObject, public A2DPPcmSink
+{
+    Q_OBJECT
+public:
+    struct Statistics {
+        uint64_t blocksQueued = 0;   // blocks accepted from the decoder
+        uint64_t underruns = 0;      // times the render thread ran dry mid-stream
+        uint64_t overruns = 0;       // blocks dropped because the ring was full
+        size_t bufferedBlocks = 0;   // blocks currently waiting in the ring
+        int outputRate = 0;          // rate blocks are rendered at
+        double driftPpm = 0.0;       // current clock drift correction
+    };
+
+    // Blocks buffered before playback starts (and restarts after an underrun)
+    static constexpr int PrefillBlocks = 4;
+
+    // Set to "null" to consume audio at real-time pace without opening an output device
+    static constexpr const char *OutputEnvironmentVariable = "PHONEAUDIOLINK_AUDIO_OUTPUT";
+
+    // Resampler quality: low, medium (default), high, or off to render at the stream's own rate
+    static constexpr const char *ResamplerEnvironmentVariable = "PHONEAUDIOLINK_RESAMPLER";
+
+    explicit AudioRenderer(QObject *parent = nullptr);
+    ~AudioRenderer() override;
+
+    void start();
+    void stop();
+    bool isRunning() const;
+
+    void pcmDecoded(const int16_t *samples, int frames, int channels, int sampleRate) override;
+
+    Statistics statistics() const;
+
+private:
+    friend class AudioRenderThread;
+    friend class RingDevice;
+
+    void queueFrames(const int16_t *samples, int frames, int sampleRate);
+    void commitBlock();
+
+    AudioBlockRing m_ring;
+    AudioRenderThread *m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<uint64_t> m_blocksQueued{0};
+    std::atomic<uint64_t> m_underruns{0};
+    std::atomic<uint64_t> m_overruns{0};
+
+    // Producer side
+    bool m_resample;
+    int m_outputRate = 0;
+    SampleRateConverter m_converter;
+    ClockDriftController m_driftController;
+    int16_t m_stereo[AudioBlock::MaxFrames * AudioBlock::Channels];
+    std::vector<int16_t> m_converted;
+    AudioBlock *m_writeBlock = nullptr; // ring slot being filled, published once it holds MaxFrames
+
+    // Output frames queued by the producer / taken by the render thread
+    std::atomic<uint64_t> m_framesQueued{0};
+    std::atomic<uint64_t> m_framesPlayed{0};
+    std::atomic<double> m_driftPpm{0.0};
+};
+
+#endif // AUDIORENDERER_H
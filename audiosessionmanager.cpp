@@ -1,9 +1,13 @@
 #include "audiosessionmanager.h"
+#include "binarylog.h"
+#include "spantrace.h"
 
 #include <QCoreApplication>
-#include <combaseapi.h>
 #include <QDebug>
 
+#ifdef Q_OS_WIN
+#include <combaseapi.h>
+
 AudioSessionManager::AudioSessionManager(QObject *parent)
     : QObject(parent), m_sessionManager(nullptr), m_sessionControl(nullptr)
 {
@@ -35,6 +39,7 @@ void AudioSessionManager::cleanup()
 
 bool AudioSessionManager::findPhoneAudioSession()
 {
+    TRACE_SCOPE("session", "findPhoneAudioSession");
     HRESULT hr;
 
     IMMDeviceEnumerator *deviceEnumerator = nullptr;
@@ -47,7 +52,7 @@ bool AudioSessionManager::findPhoneAudioSession()
     }
 
     DWORD currentProcessId = GetCurrentProcessId();
-    qDebug() << "Current process ID:" << currentProcessId;
+    LOG_DEBUG("Current process ID: %1", currentProcessId);
 
     // Try both capture (recording) and render (playback) devices
     // A2DP Sink appears as capture since audio comes FROM the phone
@@ -55,7 +60,7 @@ bool AudioSessionManager::findPhoneAudioSession()
 
     for (int flowIdx = 0; flowIdx < 2; flowIdx++) {
         EDataFlow dataFlow = dataFlows[flowIdx];
-        qDebug() << "Searching" << (dataFlow == eCapture ? "CAPTURE" : "RENDER") << "devices...";
+        LOG_DEBUG("Searching %1 devices...", dataFlow == eCapture ? "CAPTURE" : "RENDER");
 
         IMMDevice *device = nullptr;
         hr = deviceEnumerator->GetDefaultAudioEndpoint(dataFlow, eConsole, &device);
@@ -87,7 +92,7 @@ bool AudioSessionManager::findPhoneAudioSession()
 
         int sessionCount = 0;
         sessionEnumerator->GetCount(&sessionCount);
-        qDebug() << "Found" << sessionCount << "sessions";
+        LOG_DEBUG("Found %1 sessions", sessionCount);
 
         for (int i = 0; i < sessionCount; i++) {
             IAudioSessionControl *sessionControl = nullptr;
@@ -108,7 +113,7 @@ bool AudioSessionManager::findPhoneAudioSession()
                     QString name = displayName ? QString::fromWCharArray(displayName) : QString("(no name)");
                     CoTaskMemFree(displayName);
 
-                    qDebug() << "  Session" << i << "- PID:" << processId << "Name:" << name;
+                    LOG_DEBUG("  Session %1 - PID: %2 Name: %3", i, processId, name);
 
                     // Match by process ID OR by name containing "Microphone" or "A2DP"
                     if (processId == currentProcessId ||
@@ -116,7 +121,7 @@ bool AudioSessionManager::findPhoneAudioSession()
                         name.contains("A2DP", Qt::CaseInsensitive) ||
                         name.contains("Phone Audio Link", Qt::CaseInsensitive)) {
 
-                        qDebug() << "*** MATCHED session:" << name;
+                        LOG_INFO("Matched audio session: %1", name);
                         m_sessionControl = sessionControl2;
                         m_sessionManager = sessionManager;
                         sessionEnumerator->Release();
@@ -139,6 +144,7 @@ bool AudioSessionManager::findPhoneAudioSession()
 
 bool AudioSessionManager::setSessionProperties(const QString &displayName, const QString &iconPath)
 {
+    TRACE_SCOPE("session", "setSessionProperties");
     // if (!m_sessionControl) {
     //     if (!findPhoneAudioSession()) {
     //         return false;
@@ -211,3 +217,25 @@ bool AudioSessionManager::setSessionProperties(const QString &displayName, const
     qDebug() << "Successfully set audio session properties!";
     return true;
 }
+#else
+// The volume mixer session only exists on Windows
+AudioSessionManager::AudioSessionManager(QObject *parent)
+    : QObject(parent)
+{
+}
+
+AudioSessionManager::~AudioSessionManager()
+{
+}
+
+void AudioSessionManager::cleanup()
+{
+}
+
+bool AudioSessionManager::setSessionProperties(const QString &displayName, const QString &iconPath)
+{
+    Q_UNUSED(displayName);
+    Q_UNUSED(iconPath);
+    return false;
+}
+#endif
@@ -3,10 +3,13 @@
 
 #include <QObject>
 #include <QString>
-#include <windows.h>
-#include <mmdeviceapi.h>
-#include <audiopolicy.h>
-#include <audioclient.h>
+
+#ifdef Q_OS_WIN
+    #include <windows.h>
+    #include <mmdeviceapi.h>
+    #include <audiopolicy.h>
+    #include <audioclient.h>
+#endif
 
 class AudioSessionManager : public QObject
 {
@@ -19,10 +22,12 @@ public:
     void cleanup();
 
 private:
+#ifdef Q_OS_WIN
     bool findPhoneAudioSession();
 
     IAudioSessionManager2 *m_sessionManager;
     IAudioSessionControl2 *m_sessionControl;
+#endif
 };
 
 #endif // AUDIOSESSIONMANAGER_H
@@ -0,0 +1,2016 @@
+#include "benchmark.h"
+#include "a2dpmediapipeline.h"
+#include "asynctask.h"
+#include "binarylog.h"
+#include "bluetootha2dpsink.h"
+#include "btsnoopcapture.h"
+#include "deviceregistry.h"
+#include "eventbatcher.h"
+#include "flightrecorder.h"
+#include "jitterbuffer.h"
+#include "lossconcealer.h"
+#include "mediapacket.h"
+#include "mpscqueue.h"
+#include "phoneaudiolink.h"
+#include "samplerateconverter.h"
+#include "sbcdecoder.h"
+#include "simulatedsinkbackend.h"
+#include "ui_phoneaudiolink.h"
+
+#include <QApplication>
+#include <QComboBox>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QMenu>
+#include <QTextStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Allocation counting for the discovery, log and flight benchmarks. Replacing the global operator
+// new applies to the whole program, so it is only built with `qmake CONFIG+=count_allocations`;
+// other builds report no counts and skip the checks that need them.
+#ifdef PHONEAUDIOLINK_COUNT_ALLOCATIONS
+constexpr bool AllocationsCounted = true;
+#else
+constexpr bool AllocationsCounted = false;
+#endif
+
+std::atomic<bool> countAllocations{ false };
+std::atomic<quint64> allocations{ 0 };
+
+QString allocationCount(double count, int fieldWidth = 0, int precision = 0)
+{
+    if (!AllocationsCounted)
+        return QString("-").rightJustified(fieldWidth);
+    return QString("%1").arg(count, fieldWidth, 'f', precision);
+}
+
+} // namespace
+
+#ifdef PHONEAUDIOLINK_COUNT_ALLOCATIONS
+namespace {
+
+void *allocate(std::size_t size)
+{
+    if (countAllocations.load(std::memory_order_relaxed))
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, std::size_t) noexcept { std::free(memory); }
+#endif
+
+namespace {
+
+QTextStream &out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+// Value following `option` on the command line, or fallback if it is absent
+QString optionValue(const QStringList &arguments, const QString &option, const QString &fallback = QString())
+{
+    const int index = arguments.indexOf(option);
+    if (index < 0 || index + 1 >= arguments.size())
+        return fallback;
+    return arguments.at(index + 1);
+}
+
+const char *channelModeName(SbcChannelMode mode)
+{
+    switch (mode) {
+    case SbcChannelMode::Mono:        return "mono";
+    case SbcChannelMode::DualChannel: return "dual";
+    case SbcChannelMode::Stereo:      return "stereo";
+    case SbcChannelMode::JointStereo: return "joint";
+    }
+    return "?";
+}
+
+// Decodes a buffer of concatenated SBC frames, appending the PCM to pcm. Returns frames decoded.
+int decodeAll(SbcDecoder &decoder, const std::vector<uint8_t> &stream, std::vector<int16_t> *pcm)
+{
+    int16_t frame[Sbc::MaxSamplesPerFrame];
+    size_t offset = 0;
+    int frames = 0;
+    while (offset < stream.size()) {
+        size_t consumed = 0;
+        if (decoder.decode(stream.data() + offset, stream.size() - offset, frame, &consumed) != SbcDecoder::Result::Ok)
+            break;
+        offset += consumed;
+        frames++;
+        if (pcm) {
+            const SbcFrameHeader &header = decoder.header();
+            pcm->insert(pcm->end(), frame, frame + header.samplesPerChannel() * header.channels());
+        }
+    }
+    return frames;
+}
+
+// Compares decoder output against a reference PCM file (16-bit little endian, interleaved)
+int checkReference(const QString &sbcPath, const QString &pcmPath, int tolerance)
+{
+    const QString name = QFileInfo(sbcPath).completeBaseName();
+    QFile sbcFile(sbcPath);
+    QFile pcmFile(pcmPath);
+    if (!sbcFile.open(QIODevice::ReadOnly) || !pcmFile.open(QIODevice::ReadOnly)) {
+        out() << "Cannot open reference vectors " << sbcPath << " / " << pcmPath << Qt::endl;
+        return 1;
+    }
+
+    const QByteArray sbcData = sbcFile.readAll();
+    const QByteArray pcmData = pcmFile.readAll();
+    const std::vector<uint8_t> stream(sbcData.begin(), sbcData.end());
+
+    int status = 0;
+    for (SbcKernel kernel : { SbcKernel::Scalar, SbcKernel::Sse2, SbcKernel::Avx2 }) {
+        if (!SbcSynthesis::isSupported(kernel))
+            continue;
+
+        SbcDecoder decoder(kernel);
+        std::vector<int16_t> pcm;
+        const int frames = decodeAll(decoder, stream, &pcm);
+
+        const qsizetype expected = pcmData.size() / 2;
+        int maxDifference = 0;
+        qsizetype mismatches = 0;
+        for (qsizetype i = 0; i < std::min<qsizetype>(expected, qsizetype(pcm.size())); i++) {
+            const int16_t reference = int16_t(quint8(pcmData[2 * i]) | (quint8(pcmData[2 * i + 1]) << 8));
+            const int difference = std::abs(int(pcm[size_t(i)]) - int(reference));
+            maxDifference = std::max(maxDifference, difference);
+            if (difference > tolerance)
+                mismatches++;
+        }
+
+        const bool lengthMatches = expected == qsizetype(pcm.size());
+        const bool ok = lengthMatches && mismatches == 0;
+        out() << "sbc reference  " << name << "  " << SbcSynthesis::kernelName(kernel) << "  frames " << frames
+              << "  samples " << pcm.size() << "/" << expected
+              << "  max diff " << maxDifference << "  mismatches " << mismatches
+              << (ok ? "  PASS" : "  FAIL") << Qt::endl;
+        if (!ok)
+            status = 1;
+    }
+    return status;
+}
+
+// SBC decode throughput per kernel (frames/sec on one core) for every subband count and
+// channel mode, plus a bit-exactness check of each SIMD kernel against the scalar one. Every
+// kernel is then checked against the built-in reference vectors (testvectors/sbc: mono, dual,
+// stereo and joint stereo, 4 and 8 subbands, SNR and loudness allocation), whose PCM comes from
+// an independent spec decoder, and against --reference vectors if given.
+// Options: --frames N, --reference <file.sbc> <file.pcm>, --tolerance N (default 1)
+int benchmarkSbc(const QStringList &arguments)
+{
+    const int frameCount = std::max(1, optionValue(arguments, "--frames", "20000").toInt());
+    int status = 0;
+
+    for (int subbands : { 4, 8 }) {
+        for (SbcChannelMode mode : { SbcChannelMode::Mono, SbcChannelMode::DualChannel,
+                                     SbcChannelMode::Stereo, SbcChannelMode::JointStereo }) {
+            SbcFrameHeader header;
+            header.subbands = subbands;
+            header.channelMode = mode;
+            const bool shared = mode == SbcChannelMode::Stereo || mode == SbcChannelMode::JointStereo;
+            header.bitpool = shared ? (subbands == 8 ? 53 : 26) : (subbands == 8 ? 31 : 15);
+
+            uint32_t rng = 0x5bd1e995u;
+            std::vector<uint8_t> stream(size_t(header.frameLength()) * frameCount);
+            for (int i = 0; i < frameCount; i++)
+                Sbc::writeNoiseFrame(stream.data() + size_t(i) * header.frameLength(), header, rng, 12);
+
+            std::vector<int16_t> scalarPcm;
+            for (SbcKernel kernel : { SbcKernel::Scalar, SbcKernel::Sse2, SbcKernel::Avx2 }) {
+                if (!SbcSynthesis::isSupported(kernel))
+                    continue;
+
+                // Untimed pass for the bit-exactness check, timed pass without the PCM copy
+                SbcDecoder verifier(kernel);
+                std::vector<int16_t> pcm;
+                decodeAll(verifier, stream, &pcm);
+
+                SbcDecoder decoder(kernel);
+                QElapsedTimer timer;
+                timer.start();
+                const int frames = decodeAll(decoder, stream, nullptr);
+                const double seconds = std::max<qint64>(1, timer.nsecsElapsed()) / 1e9;
+
+                const double framesPerSecond = frames / seconds;
+                const double realtime = framesPerSecond * header.samplesPerChannel() / header.sampleRate;
+
+                QString exactness = "reference";
+                if (kernel == SbcKernel::Scalar) {
+                    scalarPcm = std::move(pcm);
+                }
+                else if (pcm == scalarPcm) {
+                    exactness = "bit-exact";
+                }
+                else {
+                    exactness = "MISMATCH";
+                    status = 1;
+                }
+
+                out() << QString("sbc  %1 subbands  %2  %3  %4 frames/s  %5x realtime  %6")
+                             .arg(subbands)
+                             .arg(QString::fromLatin1(channelModeName(mode)), -6)
+                             .arg(QString::fromLatin1(SbcSynthesis::kernelName(kernel)), -6)
+                             .arg(qRound64(framesPerSecond), 9)
+                             .arg(qRound64(realtime), 6)
+                             .arg(exactness)
+                      << Qt::endl;
+            }
+        }
+    }
+
+    // The reference PCM is computed in double precision; the float filterbank rounds within 1
+    const int tolerance = optionValue(arguments, "--tolerance", "1").toInt();
+    const QDir vectors(":/testvectors/sbc");
+    const QStringList streams = vectors.entryList({ "*.sbc" }, QDir::Files, QDir::Name);
+    if (streams.isEmpty()) {
+        out() << "sbc reference  no built-in vectors" << Qt::endl;
+        status = 1;
+    }
+    for (const QString &stream : streams) {
+        const QString base = vectors.filePath(QFileInfo(stream).completeBaseName());
+        status |= checkReference(base + ".sbc", base + ".pcm", tolerance);
+    }
+
+    const int referenceIndex = arguments.indexOf("--reference");
+    if (referenceIndex >= 0 && referenceIndex + 2 < arguments.size())
+        status |= checkReference(arguments.at(referenceIndex + 1), arguments.at(referenceIndex + 2), tolerance);
+
+    return status;
+}
+
+// One packet of an arrival-time trace; both times in microseconds
+struct TracePacket
+{
+    int64_t arrivalUs;
+    int64_t mediaUs;
+};
+
+// Synthetic arrival traces for 5-frame 44.1 kHz SBC packets (14.5 ms of audio each):
+//   clean    - up to 2 ms of random delay
+//   wifi     - up to 3 ms, plus 1% chance per packet of a 20-80 ms coexistence stall
+//   throttle - up to 1 ms, plus a 45 ms CPU stall every 2 s
+// Packets behind a stall arrive in a burst when it ends (L2CAP never reorders).
+std::vector<TracePacket> syntheticTrace(const QString &profile, int packets)
+{
+    const double intervalUs = 5 * 128 * 1e6 / 44100;
+    uint32_t rng = 0x1234567u;
+    auto next = [&rng]() {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    };
+
+    std::vector<TracePacket> trace;
+    trace.reserve(size_t(packets));
+    int64_t lastArrivalUs = 0;
+    int64_t stallEndUs = -1;
+    for (int i = 0; i < packets; i++) {
+        const int64_t mediaUs = int64_t(i * intervalUs);
+        int64_t arrivalUs = mediaUs;
+
+        if (profile == "clean") {
+            arrivalUs += next() % 2001;
+        }
+        else if (profile == "wifi") {
+            arrivalUs += next() % 3001;
+            if (arrivalUs > stallEndUs && next() % 100 == 0)
+                stallEndUs = arrivalUs + 20000 + next() % 60001;
+            if (arrivalUs < stallEndUs)
+                arrivalUs = stallEndUs + next() % 500;
+        }
+        else {
+            arrivalUs += next() % 1001;
+            const int64_t phaseUs = arrivalUs % 2000000;
+            if (phaseUs < 45000)
+                arrivalUs += 45000 - phaseUs;
+        }
+
+        arrivalUs = std::max(arrivalUs, lastArrivalUs);
+        lastArrivalUs = arrivalUs;
+        trace.push_back({ arrivalUs, mediaUs });
+    }
+    return trace;
+}
+
+// Text trace: one "arrival_us media_us" pair per line, '#' starts a comment
+bool loadTrace(const QString &path, std::vector<TracePacket> &trace)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    while (!file.atEnd()) {
+        const QString line = QString::fromUtf8(file.readLine()).section('#', 0, 0).trimmed();
+        const QStringList fields = line.split(' ', Qt::SkipEmptyParts);
+        if (fields.size() >= 2)
+            trace.push_back({ fields.at(0).toLongLong(), fields.at(1).toLongLong() });
+    }
+    return !trace.empty();
+}
+
+bool saveTrace(const QString &path, const std::vector<TracePacket> &trace)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+
+    QTextStream stream(&file);
+    stream << "# arrival_us media_us" << Qt::endl;
+    for (const TracePacket &packet : trace)
+        stream << packet.arrivalUs << ' ' << packet.mediaUs << '\n';
+    return true;
+}
+
+// Replays a trace through the jitter estimator. Fails if more packets were late than twice
+// the underrun budget.
+int replayTrace(const QString &name, const std::vector<TracePacket> &trace, const JitterEstimator::Config &config)
+{
+    JitterEstimator estimator(config);
+    double depthSum = 0.0;
+    for (const TracePacket &packet : trace) {
+        estimator.addPacket(packet.arrivalUs, packet.mediaUs);
+        depthSum += double(estimator.targetDepthUs());
+    }
+
+    const double lateFraction = double(estimator.latePackets()) / double(trace.size());
+    const bool ok = lateFraction <= 2.0 * config.underrunBudget;
+    out() << QString("jitter  %1  packets %2  depth %3 ms (mean %4 ms)  jitter p50/p95/p99 %5/%6/%7 ms  late %8% (budget %9%)  %10")
+                 .arg(name, -8)
+                 .arg(trace.size())
+                 .arg(estimator.targetDepthUs() / 1000.0, 0, 'f', 1)
+                 .arg(depthSum / double(trace.size()) / 1000.0, 0, 'f', 1)
+                 .arg(estimator.jitterP50Us() / 1000.0, 0, 'f', 1)
+                 .arg(estimator.jitterP95Us() / 1000.0, 0, 'f', 1)
+                 .arg(estimator.jitterP99Us() / 1000.0, 0, 'f', 1)
+                 .arg(lateFraction * 100.0, 0, 'f', 2)
+                 .arg(config.underrunBudget * 100.0, 0, 'f', 2)
+                 .arg(ok ? "PASS" : "FAIL")
+          << Qt::endl;
+    return ok ? 0 : 1;
+}
+
+// Jitter buffer target depth and late-packet rate on recorded or synthetic arrival traces.
+// Options: --trace <file>, --profile clean|wifi|throttle|all, --packets N, --budget F,
+//          --write-trace <file> (saves the synthetic trace of a single --profile)
+int benchmarkJitter(const QStringList &arguments)
+{
+    JitterEstimator::Config config;
+    config.underrunBudget = optionValue(arguments, "--budget", QString::number(config.underrunBudget)).toDouble();
+
+    const QString tracePath = optionValue(arguments, "--trace");
+    if (!tracePath.isEmpty()) {
+        std::vector<TracePacket> trace;
+        if (!loadTrace(tracePath, trace)) {
+            out() << "Cannot read arrival trace " << tracePath << Qt::endl;
+            return 1;
+        }
+        return replayTrace("trace", trace, config);
+    }
+
+    const int packets = std::max(1, optionValue(arguments, "--packets", "20000").toInt());
+    const QString profile = optionValue(arguments, "--profile", "all");
+    const QString writePath = optionValue(arguments, "--write-trace");
+
+    int status = 0;
+    for (const QString name : { "clean", "wifi", "throttle" }) {
+        if (profile != "all" && profile != name)
+            continue;
+
+        const std::vector<TracePacket> trace = syntheticTrace(name, packets);
+        if (!writePath.isEmpty() && profile == name && !saveTrace(writePath, trace)) {
+            out() << "Cannot write arrival trace " << writePath << Qt::endl;
+            status = 1;
+        }
+        status |= replayTrace(name, trace, config);
+    }
+    return status;
+}
+
+// Converts a stereo stream in decoder-sized blocks, appending the output to pcm
+void convertAll(SampleRateConverter &converter, const std::vector<int16_t> &input, std::vector<int16_t> *pcm)
+{
+    constexpr int BlockFrames = 128;
+    std::vector<int16_t> block(size_t(converter.maxOutputFrames(BlockFrames)) * 2);
+    const int frames = int(input.size() / 2);
+    for (int offset = 0; offset < frames; offset += BlockFrames) {
+        const int produced = converter.process(input.data() + 2 * offset, std::min(BlockFrames, frames - offset),
+                                               block.data(), converter.maxOutputFrames(BlockFrames));
+        if (pcm)
+            pcm->insert(pcm->end(), block.begin(), block.begin() + 2 * produced);
+    }
+}
+
+// Simulates a device pulling 20 ms periods at its own clock while the phone's clock runs
+// driftPpm fast, and returns the correction the controller settled on
+double simulateDrift(double driftPpm, double seconds)
+{
+    const double inputRate = 44100.0;
+    const double outputRate = 48000.0;
+    const double blockFrames = 128.0;
+    const double blockSeconds = blockFrames / inputRate / (1.0 + driftPpm * 1e-6);
+
+    ClockDriftController controller;
+    double fill = 4 * blockFrames;
+    double correction = 0.0;
+    double nextPullSeconds = 0.0;
+    for (double time = 0.0; time < seconds; time += blockSeconds) {
+        fill += blockFrames * outputRate / inputRate / (1.0 + correction * 1e-6);
+        for (; nextPullSeconds <= time; nextPullSeconds += 0.02)
+            fill -= outputRate * 0.02;
+        correction = controller.update(fill, blockFrames / inputRate);
+    }
+    return correction;
+}
+
+// Sample-rate converter cost (ns per output frame) per quality tier and kernel for 44.1 kHz to
+// 48 kHz, SIMD agreement with the scalar kernel, and drift tracking of the PI controller.
+// Options: --seconds N (audio converted per run)
+int benchmarkAsrc(const QStringList &arguments)
+{
+    const int seconds = std::max(1, optionValue(arguments, "--seconds", "10").toInt());
+    const int inputRate = 44100;
+    const int outputRate = 48000;
+
+    // Full-scale-ish two-tone test signal, different per channel
+    std::vector<int16_t> input(size_t(inputRate) * seconds * 2);
+    for (size_t i = 0; i < input.size() / 2; i++) {
+        const double t = double(i) / inputRate;
+        input[2 * i] = int16_t(std::lrint(12000.0 * std::sin(2 * 3.14159265358979 * 1000.0 * t)
+                                          + 8000.0 * std::sin(2 * 3.14159265358979 * 15000.0 * t)));
+        input[2 * i + 1] = int16_t(std::lrint(16000.0 * std::sin(2 * 3.14159265358979 * 440.0 * t)));
+    }
+
+    int status = 0;
+    for (ResamplerQuality quality : { ResamplerQuality::Low, ResamplerQuality::Medium, ResamplerQuality::High }) {
+        std::vector<int16_t> scalarPcm;
+        for (SbcKernel kernel : { SbcKernel::Scalar, SbcKernel::Sse2, SbcKernel::Avx2 }) {
+            if (!SbcSynthesis::isSupported(kernel))
+                continue;
+
+            SampleRateConverter converter(quality, kernel);
+            converter.configure(inputRate, outputRate);
+            std::vector<int16_t> pcm;
+            pcm.reserve(size_t(outputRate) * seconds * 2 + 1024);
+
+            QElapsedTimer timer;
+            timer.start();
+            convertAll(converter, input, &pcm);
+            const qint64 nanoseconds = std::max<qint64>(1, timer.nsecsElapsed());
+
+            const double frames = double(pcm.size() / 2);
+            const double realtime = frames / outputRate / (nanoseconds / 1e9);
+
+            // Lanes sum in a different order, so SIMD may differ from scalar by rounding only
+            QString agreement = "reference";
+            if (kernel == SbcKernel::Scalar) {
+                scalarPcm = pcm;
+            }
+            else {
+                int maxDifference = pcm.size() == scalarPcm.size() ? 0 : 65536;
+                for (size_t i = 0; i < std::min(pcm.size(), scalarPcm.size()); i++)
+                    maxDifference = std::max(maxDifference, std::abs(int(pcm[i]) - int(scalarPcm[i])));
+                agreement = QString("max diff %1").arg(maxDifference);
+                if (maxDifference > 1) {
+                    agreement += "  MISMATCH";
+                    status = 1;
+                }
+            }
+
+            out() << QString("asrc  %1  %2 taps  %3  %4 ns/sample  %5x realtime  %6")
+                         .arg(QString::fromLatin1(SampleRateConverter::qualityName(quality)), -6)
+                         .arg(converter.taps(), 2)
+                         .arg(QString::fromLatin1(SbcSynthesis::kernelName(kernel)), -6)
+                         .arg(nanoseconds / frames, 6, 'f', 1)
+                         .arg(qRound64(realtime), 5)
+                         .arg(agreement)
+                  << Qt::endl;
+        }
+    }
+
+    // The controller must settle within a few ppm of the simulated clock offset
+    for (double drift : { -200.0, -50.0, 0.0, 50.0, 200.0 }) {
+        const double correction = simulateDrift(drift, 600.0);
+        const bool ok = std::abs(correction - drift) < 10.0;
+        out() << QString("asrc  drift %1 ppm  correction %2 ppm after 600 s  %3")
+                     .arg(drift, 5, 'f', 0)
+                     .arg(correction, 7, 'f', 1)
+                     .arg(ok ? "PASS" : "FAIL")
+              << Qt::endl;
+        if (!ok)
+            status = 1;
+    }
+    return status;
+}
+
+// Counts what the media pipeline hands on
+class CountingPcmSink : public A2DPPcmSink
+{
+public:
+    void pcmDecoded(const int16_t *, int frames, int, int) override { this->frames += uint64_t(frames); }
+
+    uint64_t frames = 0;
+};
+
+// RTP packet carrying framesPerPacket SBC noise frames, as the phone simulator sends them
+std::vector<uint8_t> makeMediaPacket(uint16_t sequence, uint32_t timestamp, int framesPerPacket, uint32_t &rng)
+{
+    constexpr int RtpHeaderSize = 12;
+    const SbcFrameHeader header;
+    std::vector<uint8_t> packet(RtpHeaderSize + 1 + size_t(header.frameLength()) * framesPerPacket);
+    packet[0] = 0x80;
+    packet[1] = 96;
+    packet[2] = uint8_t(sequence >> 8);
+    packet[3] = uint8_t(sequence);
+    for (int i = 0; i < 4; i++)
+        packet[4 + i] = uint8_t(timestamp >> (24 - 8 * i));
+    packet[11] = 1;     // SSRC
+    packet[RtpHeaderSize] = uint8_t(framesPerPacket);
+    for (int f = 0; f < framesPerPacket; f++)
+        Sbc::writeNoiseFrame(packet.data() + RtpHeaderSize + 1 + size_t(f) * header.frameLength(), header, rng);
+    return packet;
+}
+
+// Which of count packets to drop: isolated losses at lossPercent, or bursts of burstLength
+// spaced so that about lossPercent of packets go missing. The first and last always arrive.
+std::vector<bool> lossPattern(int count, int lossPercent, int burstLength, uint32_t seed)
+{
+    std::vector<bool> lost(size_t(count), false);
+    uint32_t rng = seed;
+    for (int i = 1; i < count - 1; i++) {
+        rng = rng * 1664525u + 1013904223u;
+        if ((rng >> 8) % (100u * uint32_t(burstLength)) >= uint32_t(lossPercent))
+            continue;
+        for (int j = i; j < std::min(count - 1, i + burstLength); j++)
+            lost[size_t(j)] = true;
+        i += burstLength;
+    }
+    return lost;
+}
+
+// Replays a stream with packets removed through the media pipeline. Every missing frame must be
+// concealed so the sink still receives the full stream's worth of PCM.
+bool replayLoss(const QString &name, int packets, int lossPercent, int burstLength)
+{
+    constexpr int FramesPerPacket = 5;
+    const SbcFrameHeader header;
+    const std::vector<bool> lost = lossPattern(packets, lossPercent, burstLength, 0x5eed0000u + uint32_t(burstLength));
+
+    A2DPMediaPipeline pipeline;
+    CountingPcmSink sink;
+    pipeline.setPcmSink(&sink);
+
+    uint32_t rng = 12345;
+    uint64_t dropped = 0;
+    const uint16_t firstSequence = 65000;   // crosses the 16 bit wrap
+    for (int i = 0; i < packets; i++) {
+        const std::vector<uint8_t> packet = makeMediaPacket(uint16_t(firstSequence + i), uint32_t(i) * 640u, FramesPerPacket, rng);
+        if (lost[size_t(i)]) {
+            dropped++;
+            continue;
+        }
+        pipeline.mediaPacketReceived(packet.data(), packet.size(), JitterBuffer::steadyMicros());
+    }
+
+    const A2DPMediaPipeline::Statistics stats = pipeline.statistics();
+    const uint64_t expectedFrames = uint64_t(packets) * FramesPerPacket * header.samplesPerChannel();
+    const bool ok = sink.frames == expectedFrames && stats.packetsLost == dropped
+                    && stats.framesConcealed == dropped * FramesPerPacket;
+    out() << QString("plc  %1  %2 packets lost  %3 detected  %4 frames concealed  %5/%6 pcm frames  %7")
+                 .arg(name, -9)
+                 .arg(dropped, 4)
+                 .arg(stats.packetsLost, 4)
+                 .arg(stats.framesConcealed, 5)
+                 .arg(sink.frames)
+                 .arg(expectedFrames)
+                 .arg(ok ? "PASS" : "FAIL")
+          << Qt::endl;
+    return ok;
+}
+
+// Concealment quality on a tonal stereo signal: SNR over the replaced frames (silence fill
+// scores 0 dB) and the slowest single conceal() call, which includes the period search
+void measureConcealment(int burstLength)
+{
+    constexpr int Frames = 128;
+    constexpr int Blocks = 2000;
+    std::vector<int16_t> signal(size_t(Frames) * Blocks * 2);
+    for (size_t i = 0; i < signal.size() / 2; i++) {
+        const double t = double(i) / 44100.0;
+        signal[2 * i] = int16_t(std::lrint(8000.0 * std::sin(2 * 3.14159265358979 * 220.0 * t)
+                                           + 4000.0 * std::sin(2 * 3.14159265358979 * 660.0 * t + 0.3)));
+        signal[2 * i + 1] = int16_t(std::lrint(6000.0 * std::sin(2 * 3.14159265358979 * 330.0 * t)));
+    }
+
+    const std::vector<bool> lost = lossPattern(Blocks, 2, burstLength, 0x7ea1u);
+    PacketLossConcealer concealer;
+    int16_t block[Frames * 2];
+    double signalEnergy = 0.0;
+    double errorEnergy = 0.0;
+    int concealed = 0;
+    qint64 worstNs = 0;
+    QElapsedTimer timer;
+    for (int b = 0; b < Blocks; b++) {
+        const int16_t *original = signal.data() + size_t(b) * Frames * 2;
+        if (!lost[size_t(b)]) {
+            std::copy(original, original + Frames * 2, block);
+            concealer.decoded(block, Frames, 2);
+            continue;
+        }
+        timer.start();
+        concealer.conceal(block, Frames, 2);
+        worstNs = std::max(worstNs, timer.nsecsElapsed());
+        concealed++;
+        for (int i = 0; i < Frames * 2; i++) {
+            signalEnergy += double(original[i]) * original[i];
+            errorEnergy += double(block[i] - original[i]) * (block[i] - original[i]);
+        }
+    }
+
+    const double snr = errorEnergy > 0.0 ? 10.0 * std::log10(signalEnergy / errorEnergy) : 99.0;
+    out() << QString("plc  tone burst %1  %2 blocks concealed  snr %3 dB  worst %4 us per call")
+                 .arg(burstLength, 2)
+                 .arg(concealed, 4)
+                 .arg(snr, 5, 'f', 1)
+                 .arg(worstNs / 1000.0, 6, 'f', 1)
+          << Qt::endl;
+}
+
+// Packet loss concealment: sequence gap detection and frame accounting through the media
+// pipeline for random and burst loss, then substitution quality and cost on a tonal signal.
+// Options: --packets N (per loss pattern)
+int benchmarkPlc(const QStringList &arguments)
+{
+    const int packets = std::max(100, optionValue(arguments, "--packets", "5000").toInt());
+
+    int status = 0;
+    if (!replayLoss("random 1%", packets, 1, 1))
+        status = 1;
+    if (!replayLoss("random 5%", packets, 5, 1))
+        status = 1;
+    if (!replayLoss("burst 3", packets, 2, 3))
+        status = 1;
+    if (!replayLoss("burst 10", packets, 2, 10))
+        status = 1;
+
+    for (int burstLength : { 1, 3, 10 })
+        measureConcealment(burstLength);
+    return status;
+}
+
+// Malformed-input corpus entry: a packet and what the parser must make of it
+struct CorpusCase
+{
+    const char *name;
+    std::vector<uint8_t> packet;
+    MediaPacket::Status status;
+    int frames;             // frame views expected
+    int corruptFrames;
+};
+
+// Hand-built packets covering every rejection path, plus well-formed edge cases
+std::vector<CorpusCase> malformedCorpus()
+{
+    using Status = MediaPacket::Status;
+    uint32_t rng = 0xc0ffee;
+    const std::vector<uint8_t> valid = makeMediaPacket(100, 0, 3, rng);
+    const size_t payload = MediaPacket::RtpHeaderSize;
+    const size_t frameLength = size_t(SbcFrameHeader().frameLength());
+
+    std::vector<CorpusCase> corpus;
+    auto add = [&](const char *name, std::vector<uint8_t> packet, Status status, int frames, int corrupt = 0) {
+        corpus.push_back({ name, std::move(packet), status, frames, corrupt });
+    };
+
+    add("valid", valid, Status::Ok, 3);
+    add("empty", {}, Status::Truncated, 0);
+    add("short-rtp", std::vector<uint8_t>(valid.begin(), valid.begin() + 11), Status::Truncated, 0);
+    add("rtp-only", std::vector<uint8_t>(valid.begin(), valid.begin() + 12), Status::Truncated, 0);
+
+    std::vector<uint8_t> packet = valid;
+    packet[0] = 0x40;
+    add("version-1", packet, Status::BadVersion, 0);
+
+    packet = valid;
+    packet[0] = 0x8f;   // 15 CSRCs, more than the packet holds
+    packet.resize(40);
+    add("csrc-overrun", packet, Status::Truncated, 0);
+
+    packet = valid;
+    packet[0] |= 0x10;
+    packet.insert(packet.begin() + payload, { 0xbe, 0xde, 0x00, 0x01, 1, 2, 3, 4 });
+    add("extension", packet, Status::Ok, 3);
+
+    packet = valid;
+    packet[0] |= 0x10;
+    packet.insert(packet.begin() + payload, { 0xbe, 0xde, 0xff, 0xff });
+    add("extension-overrun", packet, Status::BadExtension, 0);
+
+    packet = valid;
+    packet[0] |= 0x10;
+    packet.resize(payload + 2);
+    add("extension-truncated", packet, Status::BadExtension, 0);
+
+    packet = valid;
+    packet[0] |= 0x20;
+    packet.insert(packet.end(), { 0, 0, 3 });
+    add("padding", packet, Status::Ok, 3);
+
+    packet = valid;
+    packet[0] |= 0x20;
+    packet.back() = 0;
+    add("padding-zero", packet, Status::BadPadding, 0);
+
+    packet = valid;
+    packet[0] |= 0x20;
+    packet.back() = 0xff;
+    packet.resize(payload + 8);
+    packet.back() = 0xff;
+    add("padding-overrun", packet, Status::BadPadding, 0);
+
+    packet = valid;
+    packet[payload] = 0x80 | 0x40 | 3;
+    add("fragment-start", packet, Status::Fragmented, 0);
+
+    packet = valid;
+    packet[payload] = 0x80 | 0x20 | 1;
+    add("fragment-last", packet, Status::Fragmented, 0);
+
+    packet = valid;
+    packet[payload] = 0;
+    add("zero-frames", packet, Status::NoFrames, 0);
+
+    packet = valid;
+    packet[payload + 1] = 0x00;
+    add("bad-sync", packet, Status::BadFrameHeader, 0);
+
+    packet = valid;
+    packet[payload + 1 + frameLength + 2] = 1;  // bitpool below the minimum
+    add("bad-bitpool", packet, Status::BadFrameHeader, 1);
+
+    packet = valid;
+    packet.resize(packet.size() - 1);
+    add("frame-truncated", packet, Status::Truncated, 2);
+
+    packet = valid;
+    packet.resize(payload + 1 + 2);
+    add("frame-header-truncated", packet, Status::Truncated, 0);
+
+    packet = valid;
+    packet[payload] = 5;
+    add("frames-missing", packet, Status::Truncated, 3);
+
+    packet = valid;
+    packet[payload + 1 + frameLength + 3] ^= 0x5a;
+    add("crc-mismatch", packet, Status::Ok, 3, 1);
+
+    packet = valid;
+    packet.insert(packet.end(), 7, 0xaa);
+    add("trailing-bytes", packet, Status::Ok, 3);
+
+    return corpus;
+}
+
+bool checkCorpusCase(const CorpusCase &test)
+{
+    MediaPacket parser;
+    const MediaPacket::Status status = parser.parse(test.packet);
+    const bool ok = status == test.status && int(parser.frames().size()) == test.frames
+                    && parser.corruptFrames() == test.corruptFrames;
+    if (!ok) {
+        out() << QString("packet  corpus %1: got %2 with %3 frames (%4 corrupt), expected %5 with %6 (%7)  FAIL")
+                     .arg(QString::fromLatin1(test.name))
+                     .arg(QString::fromLatin1(MediaPacket::statusName(status)))
+                     .arg(parser.frames().size())
+                     .arg(parser.corruptFrames())
+                     .arg(QString::fromLatin1(MediaPacket::statusName(test.status)))
+                     .arg(test.frames)
+                     .arg(test.corruptFrames)
+              << Qt::endl;
+    }
+    return ok;
+}
+
+// Every frame view must lie inside the packet, whatever the input
+bool framesInBounds(const MediaPacket &parser, const std::vector<uint8_t> &packet)
+{
+    for (const SbcFrameView &frame : parser.frames()) {
+        if (frame.data.data() < packet.data() || frame.data.data() + frame.data.size() > packet.data() + packet.size())
+            return false;
+    }
+    return true;
+}
+
+// Media packet parser throughput (packets/sec with and without CRC checks), the malformed-input
+// corpus, and random corruptions of valid packets that must never produce out-of-bounds views.
+// Options: --packets N, --mutations N, --corpus <dir> (parse every file in it),
+//          --write-corpus <dir> (saves the built-in corpus as .bin files)
+int benchmarkPacket(const QStringList &arguments)
+{
+    const int packetCount = std::max(1, optionValue(arguments, "--packets", "200000").toInt());
+    const int mutations = std::max(0, optionValue(arguments, "--mutations", "200000").toInt());
+    int status = 0;
+
+    // Throughput over a pool of packets with 1 to 10 frames, parsed in place from one buffer
+    uint32_t rng = 0x1234567u;
+    std::vector<std::vector<uint8_t>> pool;
+    for (int i = 0; i < 64; i++)
+        pool.push_back(makeMediaPacket(uint16_t(i), uint32_t(i) * 1280u, 1 + i % 10, rng));
+
+    for (bool checkCrc : { true, false }) {
+        MediaPacket parser;
+        uint64_t frames = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < packetCount; i++) {
+            parser.parse(pool[size_t(i) % pool.size()], checkCrc);
+            frames += parser.frames().size();
+        }
+        const double seconds = std::max<qint64>(1, timer.nsecsElapsed()) / 1e9;
+        out() << QString("packet  parse %1  %2 packets/s  %3 frames/s")
+                     .arg(checkCrc ? "with crc " : "no crc   ")
+                     .arg(qRound64(packetCount / seconds), 10)
+                     .arg(qRound64(frames / seconds), 10)
+              << Qt::endl;
+    }
+
+    const std::vector<CorpusCase> corpus = malformedCorpus();
+    int corpusPassed = 0;
+    for (const CorpusCase &test : corpus) {
+        if (checkCorpusCase(test))
+            corpusPassed++;
+    }
+    out() << QString("packet  corpus %1/%2 cases  %3")
+                 .arg(corpusPassed)
+                 .arg(corpus.size())
+                 .arg(corpusPassed == int(corpus.size()) ? "PASS" : "FAIL")
+          << Qt::endl;
+    if (corpusPassed != int(corpus.size()))
+        status = 1;
+
+    // Random byte flips and truncations of valid packets
+    int outOfBounds = 0;
+    int rejected = 0;
+    MediaPacket parser;
+    for (int i = 0; i < mutations; i++) {
+        rng = rng * 1664525u + 1013904223u;
+        std::vector<uint8_t> packet = pool[(rng >> 8) % pool.size()];
+        const int flips = 1 + int((rng >> 4) % 4);
+        for (int f = 0; f < flips; f++) {
+            rng = rng * 1664525u + 1013904223u;
+            packet[(rng >> 8) % packet.size()] ^= uint8_t(1u << ((rng >> 3) % 8));
+        }
+        rng = rng * 1664525u + 1013904223u;
+        if ((rng >> 8) % 4 == 0)
+            packet.resize((rng >> 10) % (packet.size() + 1));
+
+        if (parser.parse(packet) != MediaPacket::Status::Ok)
+            rejected++;
+        if (!framesInBounds(parser, packet))
+            outOfBounds++;
+    }
+    out() << QString("packet  mutations %1  rejected %2  out-of-bounds views %3  %4")
+                 .arg(mutations)
+                 .arg(rejected)
+                 .arg(outOfBounds)
+                 .arg(outOfBounds == 0 ? "PASS" : "FAIL")
+          << Qt::endl;
+    if (outOfBounds)
+        status = 1;
+
+    const QString writeDirectory = optionValue(arguments, "--write-corpus");
+    if (!writeDirectory.isEmpty()) {
+        QDir().mkpath(writeDirectory);
+        for (const CorpusCase &test : corpus) {
+            QFile file(QDir(writeDirectory).filePath(QString::fromLatin1(test.name) + ".bin"));
+            if (!file.open(QIODevice::WriteOnly)) {
+                out() << "packet  cannot write " << file.fileName() << Qt::endl;
+                return 1;
+            }
+            file.write(reinterpret_cast<const char *>(test.packet.data()), qint64(test.packet.size()));
+        }
+    }
+
+    // External corpus (e.g. packets captured from a misbehaving phone): report what each parses as
+    const QString corpusDirectory = optionValue(arguments, "--corpus");
+    if (!corpusDirectory.isEmpty()) {
+        const QDir directory(corpusDirectory);
+        for (const QString &name : directory.entryList(QDir::Files, QDir::Name)) {
+            QFile file(directory.filePath(name));
+            if (!file.open(QIODevice::ReadOnly))
+                continue;
+            const QByteArray bytes = file.readAll();
+            const std::vector<uint8_t> packet(bytes.begin(), bytes.end());
+            const MediaPacket::Status result = parser.parse(packet);
+            const bool inBounds = framesInBounds(parser, packet);
+            out() << QString("packet  %1  %2  %3 frames (%4 corrupt)%5")
+                         .arg(name, -28)
+                         .arg(QString::fromLatin1(MediaPacket::statusName(result)), -16)
+                         .arg(parser.frames().size())
+                         .arg(parser.corruptFrames())
+                         .arg(inBounds ? "" : "  OUT OF BOUNDS")
+                  << Qt::endl;
+            if (!inBounds)
+                status = 1;
+        }
+    }
+    return status;
+}
+
+void appendBigEndian32(QByteArray &bytes, uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+        bytes.append(char(value >> shift));
+}
+
+// Writes an H4 btsnoop capture of packets on one media channel, split into ACL fragments of at
+// most aclMtu bytes, with an HCI event and a signalling channel frame mixed in as noise
+bool writeSyntheticCapture(const QString &path, const std::vector<std::vector<uint8_t>> &packets, int aclMtu)
+{
+    constexpr uint16_t Handle = 0x000b;
+    constexpr uint16_t MediaChannel = 0x0041;
+    constexpr uint16_t SignallingChannel = 0x0040;
+    constexpr int64_t EpochUs = 0x00dcddb30f2f8000;     // btsnoop timestamps count from year 0
+
+    QByteArray bytes("btsnoop", 8);
+    appendBigEndian32(bytes, 1);
+    appendBigEndian32(bytes, 1002);
+
+    auto addRecord = [&](const QByteArray &hci, uint32_t flags, int64_t timestampUs) {
+        appendBigEndian32(bytes, uint32_t(hci.size()));
+        appendBigEndian32(bytes, uint32_t(hci.size()));
+        appendBigEndian32(bytes, flags);
+        appendBigEndian32(bytes, 0);
+        appendBigEndian32(bytes, uint32_t(uint64_t(EpochUs + timestampUs) >> 32));
+        appendBigEndian32(bytes, uint32_t(EpochUs + timestampUs));
+        bytes.append(hci);
+    };
+    auto addL2capFrame = [&](uint16_t channel, const uint8_t *data, size_t size, int64_t timestampUs) {
+        QByteArray frame;
+        frame.append(char(size & 0xff)).append(char(size >> 8));
+        frame.append(char(channel & 0xff)).append(char(channel >> 8));
+        frame.append(reinterpret_cast<const char *>(data), qsizetype(size));
+        for (qsizetype offset = 0; offset < frame.size(); offset += aclMtu) {
+            const qsizetype chunk = std::min<qsizetype>(aclMtu, frame.size() - offset);
+            const uint16_t handleFlags = Handle | (offset == 0 ? 0x2000 : 0x1000);
+            QByteArray acl;
+            acl.append(char(0x02));
+            acl.append(char(handleFlags & 0xff)).append(char(handleFlags >> 8));
+            acl.append(char(chunk & 0xff)).append(char(chunk >> 8));
+            acl.append(frame.mid(offset, chunk));
+            addRecord(acl, 0x01, timestampUs);
+        }
+    };
+
+    const uint8_t signalling[] = { 0x10, 0x07, 0x04 };     // AVDTP start command
+    addL2capFrame(SignallingChannel, signalling, sizeof(signalling), 0);
+    for (size_t i = 0; i < packets.size(); i++) {
+        const int64_t timestampUs = 1000 + int64_t(i) * 14512;
+        if (i % 50 == 0)
+            addRecord(QByteArray::fromHex("04130501"), 0x03, timestampUs);     // Number Of Completed Packets
+        addL2capFrame(MediaChannel, packets[i].data(), packets[i].size(), timestampUs);
+    }
+
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(bytes) == bytes.size();
+}
+
+// Replays every stream of a capture as fast as possible through a media pipeline decoding on
+// the calling thread, and reports throughput
+void replayCaptureStreams(const BtsnoopCapture &capture, int onlyStream)
+{
+    for (int stream = 0; stream < capture.streams().size(); stream++) {
+        if (onlyStream >= 0 && stream != onlyStream)
+            continue;
+
+        const BtsnoopCapture::Stream &info = capture.streams().at(stream);
+        A2DPMediaPipeline pipeline;
+        CountingPcmSink sink;
+        pipeline.setPcmSink(&sink);
+        const std::atomic<bool> running{true};
+
+        QElapsedTimer timer;
+        timer.start();
+        const quint64 delivered = capture.replay(stream, &pipeline, BtsnoopCapture::Pacing::AsFastAsPossible, running);
+        const double seconds = std::max<qint64>(1, timer.nsecsElapsed()) / 1e9;
+
+        const A2DPMediaPipeline::Statistics stats = pipeline.statistics();
+        const double audioSeconds = info.sampleRate > 0 ? double(sink.frames) / info.sampleRate : 0.0;
+        out() << QString("btsnoop  stream %1  handle 0x%2 cid 0x%3 %4  %5 Hz  %6 packets  %7 packets/s  %8 frames/s  %9x realtime  lost %10 malformed %11 corrupt %12")
+                     .arg(stream + 1)
+                     .arg(info.handle, 4, 16, QChar('0'))
+                     .arg(info.channelId, 4, 16, QChar('0'))
+                     .arg(info.received ? "rx" : "tx")
+                     .arg(info.sampleRate)
+                     .arg(delivered)
+                     .arg(qRound64(delivered / seconds))
+                     .arg(qRound64(stats.framesDecoded / seconds))
+                     .arg(qRound64(audioSeconds / seconds))
+                     .arg(stats.packetsLost)
+                     .arg(stats.packetsMalformed)
+                     .arg(stats.framesCorrupt)
+              << Qt::endl;
+    }
+}
+
+// btsnoop capture extraction and as-fast-as-possible decode of the media streams in it. Without
+// --file, a synthetic capture with fragmented ACL packets is written, read back and checked
+// packet for packet first.
+// Options: --file <capture> [--stream N], --packets N, --write-capture <file>
+int benchmarkBtsnoop(const QStringList &arguments)
+{
+    const QString path = optionValue(arguments, "--file");
+    if (!path.isEmpty()) {
+        BtsnoopCapture capture;
+        if (!capture.open(path)) {
+            out() << "btsnoop  " << capture.errorString() << Qt::endl;
+            return 1;
+        }
+        out() << QString("btsnoop  %1  %2 media streams  %3 records skipped")
+                     .arg(path)
+                     .arg(capture.streams().size())
+                     .arg(capture.recordsSkipped())
+              << Qt::endl;
+        replayCaptureStreams(capture, optionValue(arguments, "--stream", "0").toInt() - 1);
+        return 0;
+    }
+
+    const int packetCount = std::max(1, optionValue(arguments, "--packets", "5000").toInt());
+    uint32_t rng = 0xb75e00u;
+    std::vector<std::vector<uint8_t>> packets;
+    for (int i = 0; i < packetCount; i++)
+        packets.push_back(makeMediaPacket(uint16_t(i), uint32_t(i) * 640u, 5, rng));
+
+    QTemporaryDir directory;
+    const QString writePath = optionValue(arguments, "--write-capture");
+    const QString capturePath = writePath.isEmpty() ? directory.filePath("synthetic.btsnoop") : writePath;
+    if (!writeSyntheticCapture(capturePath, packets, 339)) {
+        out() << "btsnoop  cannot write " << capturePath << Qt::endl;
+        return 1;
+    }
+
+    BtsnoopCapture capture;
+    QElapsedTimer timer;
+    timer.start();
+    if (!capture.open(capturePath)) {
+        out() << "btsnoop  " << capture.errorString() << Qt::endl;
+        return 1;
+    }
+    const double openSeconds = std::max<qint64>(1, timer.nsecsElapsed()) / 1e9;
+
+    // One media stream, identical packets, original spacing
+    bool ok = capture.streams().size() == 1 && capture.packets(0).size() == packets.size();
+    for (size_t i = 0; ok && i < packets.size(); i++) {
+        const BtsnoopCapture::Packet &packet = capture.packets(0)[i];
+        ok = packet.size == packets[i].size() && std::memcmp(packet.data, packets[i].data(), packet.size) == 0
+             && packet.timestampUs == 1000 + int64_t(i) * 14512;
+    }
+    out() << QString("btsnoop  synthetic capture  %1 packets in %2 ACL fragments each  indexed in %3 ms  %4")
+                 .arg(packets.size())
+                 .arg((packets.front().size() + 4 + 338) / 339)
+                 .arg(openSeconds * 1000.0, 0, 'f', 1)
+                 .arg(ok ? "PASS" : "FAIL")
+          << Qt::endl;
+    if (!ok)
+        return 1;
+
+    replayCaptureStreams(capture, -1);
+    return 0;
+}
+
+// Synthetic discovery results: phones and AV devices with sequential addresses, every tenth one
+// named "iPhone", and a BTHENUM style WinRT device ID for every other device
+struct SyntheticDevice
+{
+    QBluetoothDeviceInfo info;
+    QString deviceId;
+};
+
+std::vector<SyntheticDevice> syntheticDevices(int count)
+{
+    std::vector<SyntheticDevice> devices;
+    devices.reserve(size_t(count));
+    for (int i = 0; i < count; i++) {
+        const quint64 address = 0x001a7d000000ULL + quint64(i);
+        const QString name = i % 10 == 0 ? QString("iPhone") : QString("Phone %1").arg(i);
+        const quint32 classOfDevice = i % 3 == 2 ? 0x240404 : 0x5a020c;   // headphones or smartphone
+        SyntheticDevice device{ QBluetoothDeviceInfo(QBluetoothAddress(address), name, classOfDevice), QString() };
+        if (i % 2 == 0) {
+            device.deviceId = QString("\\\\?\\BTHENUM#{0000110a-0000-1000-8000-00805f9b34fb}_LOCALMFG&0002#7&2b1d3c4&0&%1_C00000000"
+                                      "#{6994ad04-93ef-11d0-a3cc-00a0c9223196}")
+                                  .arg(address, 12, 16, QChar('0'))
+                                  .toUpper();
+        }
+        devices.push_back(device);
+    }
+    return devices;
+}
+
+struct IngestResult
+{
+    double firstUs = 0;         // per device, first discovery
+    double refreshUs = 0;       // per device, rediscovering the same devices
+    double firstAllocations = 0;
+    double refreshAllocations = 0;
+    bool correct = false;
+};
+
+} // namespace
+
+// Friend of LinkController and PhoneAudioLink. Feeds synthetic discovery results through the
+// real discovery path of a window that was never started (no discovery, auto-connect or control
+// API), with its settings and device cache in a temporary directory. The path covers
+// LinkController::appendDevice and onDevicesDiscovered, the registry and cache, PhoneAudioLink::showDevice,
+// the combo box, and applyTrayContext with the tray's Connect and Connect on Launch menus. Half of the
+// WinRT IDs arrive (as one batch) before their Qt discovery result, half after.
+class DiscoveryBenchmark
+{
+public:
+    static IngestResult ingest(const std::vector<SyntheticDevice> &synthetic)
+    {
+        QTemporaryDir directory;
+        PhoneAudioLink window(directory.path());
+        LinkController *link = window.link;
+
+        // Every device listed whatever its class, and the last one ticked under Connect on Launch
+        link->setMaximizeBluetoothCompatability(true);
+        link->setConnectAutomatically(true);
+        link->setSavedDeviceAddress(synthetic.back().info.address());
+
+        const size_t half = synthetic.size() / 2;
+        QList<A2DPDevice> early, late;
+        for (size_t i = 0; i < synthetic.size(); i++) {
+            if (!synthetic[i].deviceId.isEmpty())
+                (i < half ? early : late).append({ synthetic[i].deviceId, synthetic[i].info.name() });
+        }
+
+        auto pass = [&](double &usPerDevice, double &allocationsPerDevice) {
+            allocations.store(0, std::memory_order_relaxed);
+            countAllocations.store(true, std::memory_order_relaxed);
+            QElapsedTimer timer;
+            timer.start();
+            link->onDevicesDiscovered(early);
+            for (const SyntheticDevice &device : synthetic)
+                link->appendDevice(device.info);
+            link->onDevicesDiscovered(late);
+            window.applyTrayContext();
+            const qint64 elapsed = timer.nsecsElapsed();
+            countAllocations.store(false, std::memory_order_relaxed);
+            usPerDevice = elapsed / 1000.0 / double(synthetic.size());
+            allocationsPerDevice = double(allocations.load(std::memory_order_relaxed)) / double(synthetic.size());
+        };
+
+        IngestResult result;
+        pass(result.firstUs, result.firstAllocations);
+        pass(result.refreshUs, result.refreshAllocations);
+
+        // Every device listed once, in every view, and every ID on the device its address names
+        QMenu *connectMenu = nullptr;
+        QMenu *autoConnectMenu = nullptr;
+        for (QMenu *menu : window.trayMenu->findChildren<QMenu *>()) {
+            if (menu->title() == "Connect")
+                connectMenu = menu;
+            else if (menu->title() == "Connect on Launch")
+                autoConnectMenu = menu;
+        }
+        const qsizetype count = qsizetype(synthetic.size());
+        const DeviceRegistry &registry = link->devices();
+        const QComboBox *comboBox = window.ui->deviceComboBox;
+        result.correct = registry.size() == count && window.deviceModel->rowCount() == count && comboBox->count() == count
+                         && connectMenu && connectMenu->actions().size() == count
+                         && autoConnectMenu && autoConnectMenu->actions().size() == count
+                         && autoConnectMenu->actions().constLast()->isChecked();
+        for (size_t i = 0; result.correct && i < synthetic.size(); i++) {
+            const DeviceRegistry::Device *device = registry.find(synthetic[i].info.address());
+            result.correct = device && device->deviceId == synthetic[i].deviceId
+                             && comboBox->itemData(window.deviceModel->row(device->key)).toULongLong() == device->key;
+        }
+        return result;
+    }
+};
+
+namespace {
+
+// Device discovery ingestion: time and heap allocations per device for growing numbers of
+// nearby devices. Fails if the cost per device grows with the device count.
+// Options: --devices N,N,...
+int benchmarkDiscovery(const QStringList &arguments)
+{
+    if (!qobject_cast<QApplication *>(QCoreApplication::instance())) {
+        out() << "discovery  needs widgets; run it on its own or with `all`" << Qt::endl;
+        return 1;
+    }
+
+    QList<int> counts;
+    for (const QString &count : optionValue(arguments, "--devices", "10,100,500,2000").split(',', Qt::SkipEmptyParts))
+        counts.append(std::max(2, count.toInt()));
+    std::sort(counts.begin(), counts.end());
+
+    bool ok = true;
+    IngestResult reference;
+    int referenceCount = 0;
+    IngestResult largest;
+    for (int count : std::as_const(counts)) {
+        const IngestResult result = DiscoveryBenchmark::ingest(syntheticDevices(count));
+        out() << QString("discovery  %1 devices  first %2 us/device  %3 allocs/device  refresh %4 us/device  %5 allocs/device  %6")
+                     .arg(count, 5)
+                     .arg(result.firstUs, 7, 'f', 2)
+                     .arg(allocationCount(result.firstAllocations, 6, 1))
+                     .arg(result.refreshUs, 7, 'f', 2)
+                     .arg(allocationCount(result.refreshAllocations, 6, 1))
+                     .arg(result.correct ? "PASS" : "FAIL")
+              << Qt::endl;
+        ok = ok && result.correct;
+
+        // Small counts are dominated by fixed costs; compare against the first count of 100 or more
+        if (referenceCount == 0 && count >= 100) {
+            reference = result;
+            referenceCount = count;
+        }
+        largest = result;
+    }
+
+    if (referenceCount != 0 && counts.last() > referenceCount) {
+        const double timeGrowth = largest.firstUs / std::max(reference.firstUs, 1e-3);
+        const double allocationGrowth = largest.firstAllocations / std::max(reference.firstAllocations, 1e-3);
+        const bool linear = timeGrowth <= 4.0 && (!AllocationsCounted || allocationGrowth <= 2.0);
+        out() << QString("discovery  %1 -> %2 devices  cost per device x%3 time  x%4 allocations  %5")
+                     .arg(referenceCount)
+                     .arg(counts.last())
+                     .arg(timeGrowth, 0, 'f', 2)
+                     .arg(allocationCount(allocationGrowth, 0, 2))
+                     .arg(linear ? "LINEAR" : "SUPERLINEAR")
+              << Qt::endl;
+        ok = ok && linear;
+    }
+    return ok ? 0 : 1;
+}
+
+// Runs the event loop until the sink streams or fails, or a second passes; returns the state
+BluetoothA2DPSink::ConnectionState settle(BluetoothA2DPSink &sink)
+{
+    using State = BluetoothA2DPSink::ConnectionState;
+    if (sink.connectionState() == State::Streaming || sink.connectionState() == State::Failed)
+        return sink.connectionState();
+
+    QEventLoop loop;
+    QTimer::singleShot(1000, &loop, &QEventLoop::quit);
+    QObject::connect(&sink, &BluetoothA2DPSink::connectionStateChanged, &loop, [&loop](State state) {
+        if (state == State::Streaming || state == State::Failed)
+            loop.quit();
+    });
+    loop.exec();
+    return sink.connectionState();
+}
+
+// Device IDs the simulator hands out, collected through its discovery
+QStringList simulatedDevices(BluetoothA2DPSink &sink)
+{
+    QStringList devices;
+    QEventLoop loop;
+    QTimer::singleShot(1000, &loop, &QEventLoop::quit);
+    QObject::connect(&sink, &BluetoothA2DPSink::devicesDiscovered, &loop, [&devices](const QList<A2DPDevice> &found) {
+        for (const A2DPDevice &device : found)
+            devices.append(device.deviceId);
+    });
+    QObject::connect(&sink, &BluetoothA2DPSink::discoveryCompleted, &loop, &QEventLoop::quit);
+    sink.startDeviceDiscovery();
+    loop.exec();
+    return devices;
+}
+
+// One connect scenario against the simulator: `step` issues cycle i's connects and returns the
+// device that should end up streaming, or an empty string if failing is also acceptable
+struct ConnectCycles
+{
+    int passed = 0;
+    int streamed = 0;
+    int failed = 0;
+    QString stuck;  // state and device of the first cycle that neither streamed nor failed as expected
+};
+
+template<typename Step>
+ConnectCycles runConnectCycles(BluetoothA2DPSink &sink, int cycles, Step step)
+{
+    using State = BluetoothA2DPSink::ConnectionState;
+    ConnectCycles result;
+    for (int cycle = 0; cycle < cycles; cycle++) {
+        bool accepted = true;
+        const QString expected = step(cycle, accepted);
+        const State state = settle(sink);
+        const bool streaming = state == State::Streaming && sink.currentDeviceId() == expected;
+        const bool failed = expected.isEmpty() && state == State::Failed;
+        if (!accepted || !(streaming || failed)) {
+            result.stuck = QString("cycle %1 %2 at %3").arg(cycle)
+                               .arg(accepted ? "ended" : "refused")
+                               .arg(BluetoothA2DPSink::connectionStateName(state));
+            break;
+        }
+        result.passed++;
+        (state == State::Streaming ? result.streamed : result.failed)++;
+    }
+    sink.releaseConnection();
+    return result;
+}
+
+// Connect cycles through BluetoothA2DPSink's state machine with the phone simulator: switching
+// devices while streaming, retrying after failed opens, and a second connect while the first is
+// still enabling. Every cycle has to reach Streaming (or Failed, where the simulator injects a
+// failure) on the device asked for last.
+// Options: --cycles N
+int benchmarkConnect(const QStringList &arguments)
+{
+    const int cycles = std::max(2, optionValue(arguments, "--cycles", "1000").toInt());
+    qputenv(AudioRenderer::OutputEnvironmentVariable, "null");
+
+    SimulatedSinkBackend::Config config;
+    config.deviceCount = 2;
+    config.discoveryDelayMs = 0;
+    config.enableDelayMs = 0;
+    config.openDelayMs = 0;
+
+    bool ok = true;
+    const auto report = [&ok, cycles](const QString &name, const ConnectCycles &result, const QElapsedTimer &timer,
+                                      bool correct) {
+        out() << QString("connect  %1  %2/%3 cycles  streamed %4  failed %5  %6 ms/cycle  %7")
+                     .arg(name, -8)
+                     .arg(result.passed)
+                     .arg(cycles)
+                     .arg(result.streamed)
+                     .arg(result.failed)
+                     .arg(double(timer.elapsed()) / std::max(1, result.passed), 0, 'f', 2)
+                     .arg(correct ? "PASS" : "FAIL")
+              << Qt::endl;
+        if (!result.stuck.isEmpty())
+            out() << "  " << result.stuck << Qt::endl;
+        ok = ok && correct;
+    };
+
+    // Each connect switches to the other phone while the first one streams
+    {
+        BluetoothA2DPSink sink(new SimulatedSinkBackend(config));
+        const QStringList devices = simulatedDevices(sink);
+        QElapsedTimer timer;
+        timer.start();
+        const ConnectCycles result = runConnectCycles(sink, cycles, [&](int cycle, bool &accepted) {
+            const QString device = devices.value(cycle % 2);
+            accepted = sink.connectDevice(device);
+            return device;
+        });
+        report("switch", result, timer, devices.size() == 2 && result.passed == cycles);
+    }
+
+    // Half the opens fail; the next connect retries from the failed (or streaming) state
+    {
+        SimulatedSinkBackend::Config failing = config;
+        failing.openFailureRate = 0.5;
+        BluetoothA2DPSink sink(new SimulatedSinkBackend(failing));
+        const QStringList devices = simulatedDevices(sink);
+        QElapsedTimer timer;
+        timer.start();
+        const ConnectCycles result = runConnectCycles(sink, cycles, [&](int, bool &accepted) {
+            accepted = sink.connectDevice(devices.value(0));
+            return QString();
+        });
+        report("retry", result, timer, result.passed == cycles && result.streamed > 0 && result.failed > 0);
+    }
+
+    // Two connects back to back: the second supersedes the first while it is still enabling
+    {
+        BluetoothA2DPSink sink(new SimulatedSinkBackend(config));
+        const QStringList devices = simulatedDevices(sink);
+        QElapsedTimer timer;
+        timer.start();
+        const ConnectCycles result = runConnectCycles(sink, cycles, [&](int cycle, bool &accepted) {
+            const QString device = devices.value((cycle + 1) % 2);
+            accepted = sink.connectDevice(devices.value(cycle % 2)) && sink.connectDevice(device);
+            return device;
+        });
+        report("double", result, timer, devices.size() == 2 && result.passed == cycles);
+    }
+    return ok ? 0 : 1;
+}
+
+// Stand-in for a WinRT async operation: completes on its own thread after a delay, with the
+// steady clock time of completion
+class FakeOperations
+{
+public:
+    ~FakeOperations() { join(); }
+
+    AsyncCompletion<qint64>::Start after(int delayUs)
+    {
+        return [this, delayUs](AsyncCompletion<qint64>::Callback done) {
+            m_threads.emplace_back([delayUs, done]() {
+                std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+                done(JitterBuffer::steadyMicros());
+            });
+        };
+    }
+
+    void join()
+    {
+        for (std::thread &thread : m_threads)
+            thread.join();
+        m_threads.clear();
+    }
+
+private:
+    std::vector<std::thread> m_threads;
+};
+
+// The owning object; counts the queued calls (thread hops) delivered to it
+class HopCounter : public QObject
+{
+public:
+    int hops = 0;
+
+    bool event(QEvent *event) override
+    {
+        if (event->type() == QEvent::MetaCall)
+            hops++;
+        return QObject::event(event);
+    }
+};
+
+AsyncTask connectAttempt(QObject *context, CancellationToken token, FakeOperations &operations, int delayUs,
+                         int attempt, QList<int> &completed)
+{
+    co_await AsyncCompletion<qint64>(context, token, operations.after(delayUs));
+    completed.append(attempt);
+}
+
+AsyncTask sequentialOperations(QObject *context, FakeOperations &operations, int count,
+                               std::vector<qint64> &latenciesUs, bool &onOwnerThread, QEventLoop &loop)
+{
+    for (int i = 0; i < count; i++) {
+        const qint64 completedUs = co_await AsyncCompletion<qint64>(context, CancellationToken(), operations.after(50));
+        latenciesUs.push_back(JitterBuffer::steadyMicros() - completedUs);
+        onOwnerThread = onOwnerThread && QThread::currentThread() == context->thread();
+    }
+    loop.quit();
+}
+
+// The coroutine tasks the WinRT backend runs its enables and opens on, driven by fake operations
+// that complete on other threads: overlapping connect attempts where only the newest may finish,
+// resume latency and hops per operation, and frames freed when the owner is deleted.
+// Options: --attempts N, --operations N
+int benchmarkTasks(const QStringList &arguments)
+{
+    const int attempts = std::max(2, optionValue(arguments, "--attempts", "1000").toInt());
+    const int operationCount = std::max(1, optionValue(arguments, "--operations", "1000").toInt());
+    bool ok = true;
+
+    // Rapid clicks: every attempt supersedes the previous one, completions arrive in random order
+    {
+        HopCounter context;
+        FakeOperations operations;
+        CancellationSource source;
+        QList<int> completed;
+        std::mt19937 random(1);
+        for (int attempt = 0; attempt < attempts; attempt++) {
+            source.cancel();
+            connectAttempt(&context, source.token(), operations, int(random() % 2000), attempt, completed);
+        }
+        operations.join();
+        QCoreApplication::sendPostedEvents();
+
+        const bool correct = completed == QList<int>{ attempts - 1 } && AsyncTask::running() == 0;
+        out() << QString("tasks  supersede  %1 attempts  completed %2  hops %3  frames left %4  %5")
+                     .arg(attempts)
+                     .arg(completed.size())
+                     .arg(context.hops)
+                     .arg(AsyncTask::running())
+                     .arg(correct ? "PASS" : "FAIL")
+              << Qt::endl;
+        ok = ok && correct;
+    }
+
+    // Operations one after the other: each await costs one hop back to the owner's thread
+    {
+        HopCounter context;
+        FakeOperations operations;
+        QEventLoop loop;
+        std::vector<qint64> latenciesUs;
+        bool onOwnerThread = true;
+        QTimer::singleShot(30000, &loop, &QEventLoop::quit);
+        sequentialOperations(&context, operations, operationCount, latenciesUs, onOwnerThread, loop);
+        if (int(latenciesUs.size()) < operationCount)
+            loop.exec();
+        operations.join();
+
+        std::sort(latenciesUs.begin(), latenciesUs.end());
+        const auto percentile = [&latenciesUs](double p) {
+            return latenciesUs.empty() ? qint64(0) : latenciesUs[size_t(p * (latenciesUs.size() - 1))];
+        };
+        const bool correct = int(latenciesUs.size()) == operationCount && context.hops == operationCount && onOwnerThread;
+        out() << QString("tasks  resume  %1 operations  hops/op %2  resume latency p50/p99/max %3/%4/%5 us  owner thread %6  %7")
+                     .arg(operationCount)
+                     .arg(double(context.hops) / operationCount, 0, 'f', 2)
+                     .arg(percentile(0.5))
+                     .arg(percentile(0.99))
+                     .arg(percentile(1.0))
+                     .arg(onOwnerThread ? "yes" : "no")
+                     .arg(correct ? "PASS" : "FAIL")
+              << Qt::endl;
+        ok = ok && correct;
+    }
+
+    // The owner goes away while operations are in flight: nothing resumes, nothing leaks
+    {
+        HopCounter *context = new HopCounter;
+        FakeOperations operations;
+        QList<int> completed;
+        for (int attempt = 0; attempt < attempts; attempt++)
+            connectAttempt(context, CancellationToken(), operations, int(attempt % 500), attempt, completed);
+        QThread::msleep(1);
+        delete context;
+        operations.join();
+        QCoreApplication::sendPostedEvents();
+
+        const bool correct = completed.isEmpty() && AsyncTask::running() == 0;
+        out() << QString("tasks  owner deleted  %1 in flight  completed %2  frames left %3  %4")
+                     .arg(attempts)
+                     .arg(completed.size())
+                     .arg(AsyncTask::running())
+                     .arg(correct ? "PASS" : "FAIL")
+              << Qt::endl;
+        ok = ok && correct;
+    }
+    return ok ? 0 : 1;
+}
+
+// An item from one of several producer threads, numbered per producer
+struct ProducedItem
+{
+    int producer = 0;
+    int sequence = 0;
+};
+
+// Checks that each producer's items arrived complete and in order; `next` holds the next
+// expected sequence number per producer
+bool acceptItem(const ProducedItem &item, std::vector<int> &next)
+{
+    if (item.sequence != next[item.producer])
+        return false;
+    next[item.producer]++;
+    return true;
+}
+
+// Cross-thread event delivery: the lock-free multi-producer queue on its own, then batched
+// delivery to this thread once per frame as the DeviceWatcher callbacks use it, then short
+// bursts racing an immediate flush. Fails if an item is lost, duplicated or reordered within its
+// producer, or if the last items of a burst are left queued with no flush scheduled.
+// Options: --producers N, --items N (per producer), --bursts N
+int benchmarkBatching(const QStringList &arguments)
+{
+    const int producers = std::clamp(optionValue(arguments, "--producers", "4").toInt(), 1, 64);
+    const int items = std::max(1, optionValue(arguments, "--items", "200000").toInt());
+    const int bursts = std::max(1, optionValue(arguments, "--bursts", "2000").toInt());
+    bool ok = true;
+
+    // Raw queue: producers push as fast as they can while one consumer drains
+    {
+        MpscQueue<ProducedItem> queue;
+        std::atomic<int> started{ 0 };
+        std::vector<std::thread> threads;
+        for (int producer = 0; producer < producers; producer++) {
+            threads.emplace_back([&queue, &started, producer, items, producers]() {
+                started.fetch_add(1);
+                while (started.load() < producers) {}
+                for (int sequence = 0; sequence < items; sequence++)
+                    queue.push({ producer, sequence });
+            });
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        std::vector<int> next(producers, 0);
+        bool ordered = true;
+        size_t maxDepth = 0;
+        const qint64 total = qint64(producers) * items;
+        for (qint64 received = 0; received < total;) {
+            maxDepth = std::max(maxDepth, queue.size());
+            if (std::optional<ProducedItem> item = queue.pop()) {
+                ordered = acceptItem(*item, next) && ordered;
+                received++;
+            }
+        }
+        const double seconds = timer.nsecsElapsed() / 1e9;
+        for (std::thread &thread : threads)
+            thread.join();
+
+        const bool correct = ordered && !queue.pop();
+        out() << QString("batching  queue  %1 producers x %2 items  %3 M items/s  max depth %4  %5")
+                     .arg(producers)
+                     .arg(items)
+                     .arg(total / seconds / 1e6, 0, 'f', 2)
+                     .arg(maxDepth)
+                     .arg(correct ? "PASS" : "FAIL")
+              << Qt::endl;
+        ok = ok && correct;
+    }
+
+    // Batched delivery: a storm of callbacks costs this thread one event per frame
+    {
+        QObject owner;
+        QEventLoop loop;
+        std::vector<int> next(producers, 0);
+        bool ordered = true;
+        qint64 delivered = 0;
+        const qint64 total = qint64(producers) * std::min(items, 20000);
+        std::vector<qint64> latenciesUs;
+        EventBatcher<ProducedItem> *batcherPointer = nullptr;
+        EventBatcher<ProducedItem> batcher(&owner, [&](const QList<ProducedItem> &batch) {
+            for (const ProducedItem &item : batch)
+                ordered = acceptItem(item, next) && ordered;
+            delivered += batch.size();
+            latenciesUs.push_back(batcherPointer->stats().lastLatencyUs);
+            if (delivered == total)
+                loop.quit();
+        });
+        batcherPointer = &batcher;
+
+        // Spread over a few frames, like an enumeration arriving in bursts
+        const int perProducer = int(total / producers);
+        std::vector<std::thread> threads;
+        for (int producer = 0; producer < producers; producer++) {
+            threads.emplace_back([&batcher, producer, perProducer]() {
+                for (int sequence = 0; sequence < perProducer; sequence++) {
+                    batcher.push({ producer, sequence });
+                    if (sequence % 1000 == 999)
+                        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                }
+            });
+        }
+        QTimer::singleShot(30000, &loop, &QEventLoop::quit);
+        loop.exec();
+        for (std::thread &thread : threads)
+            thread.join();
+
+        std::sort(latenciesUs.begin(), latenciesUs.end());
+        const EventBatcher<ProducedItem>::Stats &stats = batcher.stats();
+        const bool correct = ordered && delivered == total;
+        out() << QString("batching  delivery  %1 events  %2 batches (largest %3)  latency p50/max %4/%5 us  %6")
+                     .arg(total)
+                     .arg(stats.batches)
+                     .arg(stats.maxBatch)
+                     .arg(latenciesUs.empty() ? 0 : latenciesUs[latenciesUs.size() / 2])
+                     .arg(stats.maxLatencyUs)
+                     .arg(correct ? "PASS" : "FAIL")
+              << Qt::endl;
+        ok = ok && correct;
+    }
+
+    // Lost wake-ups: with no interval the flush drains while producers are still pushing. Nothing
+    // is pushed after a burst, so an item the running flush misses without scheduling another one
+    // is never delivered (the final EnumerationCompleted of an enumeration, for example).
+    {
+        QObject owner;
+        QEventLoop loop;
+        QTimer timeout;
+        timeout.setSingleShot(true);
+        QObject::connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+        std::vector<int> next(producers, 0);
+        bool ordered = true;
+        qint64 delivered = 0;
+        qint64 pushed = 0;
+        EventBatcher<ProducedItem> batcher(&owner, [&](const QList<ProducedItem> &batch) {
+            for (const ProducedItem &item : batch)
+                ordered = acceptItem(item, next) && ordered;
+            delivered += batch.size();
+            if (delivered == pushed)
+                loop.quit();
+        }, 0);
+
+        int completed = 0;
+        for (; completed < bursts; completed++) {
+            const int burst = 1 + completed % 8;
+            const int first = next[0];
+            pushed += qint64(producers) * burst;
+            std::vector<std::thread> threads;
+            for (int producer = 0; producer < producers; producer++) {
+                threads.emplace_back([&batcher, producer, first, burst]() {
+                    for (int sequence = first; sequence < first + burst; sequence++)
+                        batcher.push({ producer, sequence });
+                });
+            }
+            timeout.start(1000);
+            loop.exec();
+            timeout.stop();
+            for (std::thread &thread : threads)
+                thread.join();
+            if (delivered != pushed)
+                break;
+        }
+
+        const bool correct = ordered && completed == bursts;
+        out() << QString("batching  wake-up  %1/%2 bursts delivered  %3 of %4 events  %5")
+                     .arg(completed)
+                     .arg(bursts)
+                     .arg(delivered)
+                     .arg(pushed)
+                     .arg(correct ? "PASS" : "FAIL")
+              << Qt::endl;
+        ok = ok && correct;
+    }
+    return ok ? 0 : 1;
+}
+
+// Binary logger: the cost of a call on the logging thread, then a round trip through the writer
+// thread and the decoder. Fails if a call allocates, or if a record that was not reported dropped
+// fails to decode with its arguments intact.
+// Options: --threads N, --records N (per thread)
+int benchmarkLog(const QStringList &arguments)
+{
+    const int threads = std::clamp(optionValue(arguments, "--threads", "4").toInt(), 1, 64);
+    const int records = std::max(1, optionValue(arguments, "--records", "20000").toInt());
+    bool ok = true;
+
+    // Without a session the records only go to this thread's ring, so the timing and the
+    // allocation count are the call alone. The first call registers the format and claims a ring.
+    {
+        constexpr int Calls = 256;
+        const QString device = "Pixel 8 Pro";
+        LOG_INFO("log cost %1 %2 %3", 0, 0.0, device);
+
+        allocations.store(0);
+        countAllocations.store(true);
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 1; i <= Calls; i++)
+            LOG_INFO("log cost %1 %2 %3", i, i * 0.5, device);
+        const qint64 elapsedNs = timer.nsecsElapsed();
+        countAllocations.store(false);
+
+        const bool correct = allocations.load() == 0;
+        out() << QString("log  call  %1 ns/call  %2 allocations  %3")
+                     .arg(double(elapsedNs) / Calls, 0, 'f', 1)
+                     .arg(allocationCount(allocations.load()))
+                     .arg(correct ? "PASS" : "FAIL")
+              << Qt::endl;
+        ok = ok && correct;
+    }
+
+    // Round trip: several threads log in bursts while the writer drains, then everything is decoded
+    QTemporaryDir directory;
+    QElapsedTimer timer;
+    timer.start();
+    std::atomic<qint64> callNs{ 0 };
+    {
+        BinaryLog::Session session(directory.path(), false);
+        std::vector<std::thread> workers;
+        for (int thread = 0; thread < threads; thread++) {
+            workers.emplace_back([thread, records, &callNs]() {
+                QElapsedTimer burst;
+                qint64 spent = 0;
+                for (int i = 0; i < records; i++) {
+                    if (i % 256 == 0)
+                        burst.start();
+                    LOG_INFO("log round trip %1 %2 %3 %4", thread, i, i % 3 == 0, "payload");
+                    if (i % 256 == 255) {
+                        spent += burst.nsecsElapsed();
+                        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                    }
+                }
+                callNs.fetch_add(spent);
+            });
+        }
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+    const double seconds = timer.nsecsElapsed() / 1e9;
+
+    // Oldest rotated file first, the current one last
+    QStringList files = QDir(directory.path()).entryList({ "phoneaudiolink.*.blog" }, QDir::Files, QDir::Name | QDir::Reversed);
+    files.append("phoneaudiolink.blog");
+    QStringList lines;
+    QString error;
+    qint64 bytes = 0;
+    bool decoded = true;
+    for (const QString &file : std::as_const(files)) {
+        decoded = decoded && BinaryLog::decodeFile(directory.filePath(file), &lines, &error) && error.isEmpty();
+        bytes += QFileInfo(directory.filePath(file)).size();
+    }
+    static const QRegularExpression recordPattern("log round trip (\\d+) (\\d+) (true|false) payload$");
+    static const QRegularExpression droppedPattern("^(\\d+) records dropped");
+    std::vector<int> next(threads, 0);
+    qint64 received = 0;
+    qint64 dropped = 0;
+    bool intact = true;
+    for (const QString &line : std::as_const(lines)) {
+        if (const QRegularExpressionMatch match = droppedPattern.match(line); match.hasMatch()) {
+            dropped += match.captured(1).toLongLong();
+            continue;
+        }
+        const QRegularExpressionMatch match = recordPattern.match(line);
+        if (!match.hasMatch())
+            continue;
+        const int thread = match.captured(1).toInt();
+        const int i = match.captured(2).toInt();
+        // Drops leave gaps, but a thread's records never go backwards or change
+        intact = intact && thread < threads && i >= next[thread] && match.captured(3) == (i % 3 == 0 ? "true" : "false");
+        if (thread < threads)
+            next[thread] = i + 1;
+        received++;
+    }
+
+    const qint64 total = qint64(threads) * records;
+    const bool correct = decoded && intact && received + dropped >= total && received <= total;
+    out() << QString("log  round trip  %1 threads x %2 records  %3 ns/call  %4 decoded  %5 dropped  %6 KB in %7 file(s)  %8 s  %9")
+                 .arg(threads)
+                 .arg(records)
+                 .arg(double(callNs.load()) / total, 0, 'f', 1)
+                 .arg(received)
+                 .arg(dropped)
+                 .arg(bytes / 1024)
+                 .arg(files.size())
+                 .arg(seconds, 0, 'f', 2)
+                 .arg(correct ? "PASS" : "FAIL")
+          << Qt::endl;
+    if (!decoded)
+        out() << "  " << error << Qt::endl;
+    return (ok && correct) ? 0 : 1;
+}
+
+// Flight recorder: the cost of recording an event, then several threads recording at once and a
+// dump read back through the viewer. Fails if recording allocates, or if the dump does not hold
+// a full ring of intact events, in order for each thread.
+// Options: --threads N, --events N (per thread)
+int benchmarkFlight(const QStringList &arguments)
+{
+    const int threads = std::clamp(optionValue(arguments, "--threads", "4").toInt(), 1, 64);
+    const int events = std::max(FlightRecorder::Capacity, optionValue(arguments, "--events", "100000").toInt());
+    bool ok = true;
+
+    {
+        constexpr int Calls = 100000;
+        allocations.store(0);
+        countAllocations.store(true);
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < Calls; i++)
+            FlightRecorder::record(FlightRecorder::Buffers, nullptr, i % 40, 40000, i % 8);
+        const qint64 elapsedNs = timer.nsecsElapsed();
+        countAllocations.store(false);
+
+        const bool correct = allocations.load() == 0;
+        out() << QString("flight  record  %1 ns/event  %2 allocations  %3")
+                     .arg(double(elapsedNs) / Calls, 0, 'f', 1)
+                     .arg(allocationCount(allocations.load()))
+                     .arg(correct ? "PASS" : "FAIL")
+              << Qt::endl;
+        ok = ok && correct;
+    }
+
+    QTemporaryDir directory;
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < threads; thread++) {
+        workers.emplace_back([thread, events]() {
+            for (int i = 0; i < events; i++)
+                FlightRecorder::record(FlightRecorder::Loss, nullptr, thread, i, i ^ 0x5a5a);
+        });
+    }
+    for (std::thread &worker : workers)
+        worker.join();
+    const double seconds = timer.nsecsElapsed() / 1e9;
+
+    QStringList files;
+    {
+        FlightRecorder::Session session(directory.path());
+        FlightRecorder::dump("benchmark");
+    }
+    files = QDir(directory.path()).entryList({ "flight-*.flight" }, QDir::Files);
+
+    QStringList lines;
+    QString error;
+    const bool read = files.size() == 1 && FlightRecorder::viewFile(directory.filePath(files.first()), &lines, &error);
+    static const QRegularExpression eventPattern(" Loss +(\\d+) packets lost, (\\d+) frames concealed, (\\d+) underruns");
+    std::vector<int> last(threads, -1);
+    int found = 0;
+    int stale = 0;
+    bool ordered = true;
+    for (const QString &line : std::as_const(lines)) {
+        const QRegularExpressionMatch match = eventPattern.match(line);
+        if (!match.hasMatch())
+            continue;
+        const int thread = match.captured(1).toInt();
+        const int i = match.captured(2).toInt();
+        ordered = ordered && thread < threads && i > last[thread] && match.captured(3).toInt() == (i ^ 0x5a5a);
+        // Left over from an earlier lap where a newer event was dropped for a stalled writer
+        if (i < events - FlightRecorder::Capacity)
+            stale++;
+        if (thread < threads)
+            last[thread] = i;
+        found++;
+    }
+
+    const bool correct = read && ordered && found == FlightRecorder::Capacity
+                         && lines.value(0).startsWith("Flight recorder dump: benchmark");
+    out() << QString("flight  dump  %1 threads x %2 events  %3 M events/s  %4 of %5 in the dump, %6 stale (%7 KB)  %8")
+                 .arg(threads)
+                 .arg(events)
+                 .arg(qint64(threads) * events / seconds / 1e6, 0, 'f', 1)
+                 .arg(found)
+                 .arg(FlightRecorder::Capacity)
+                 .arg(stale)
+                 .arg(files.isEmpty() ? 0 : QFileInfo(directory.filePath(files.first())).size() / 1024)
+                 .arg(correct ? "PASS" : "FAIL")
+          << Qt::endl;
+    if (!read)
+        out() << "  " << (files.size() == 1 ? error : QString("%1 dump files").arg(files.size())) << Qt::endl;
+    return (ok && correct) ? 0 : 1;
+}
+
+struct Entry
+{
+    const char *name;
+    const char *description;
+    int (*function)(const QStringList &arguments);
+};
+
+const Entry Benchmarks[] = {
+    { "sbc", "SBC decode frames/sec per kernel and SIMD bit-exactness", &benchmarkSbc },
+    { "jitter", "Jitter buffer depth and late packets on arrival traces", &benchmarkJitter },
+    { "asrc", "Sample-rate converter ns/sample per quality tier and drift tracking", &benchmarkAsrc },
+    { "plc", "Loss concealment through the media pipeline with injected loss patterns", &benchmarkPlc },
+    { "packet", "Media packet parser packets/sec and malformed-input corpus", &benchmarkPacket },
+    { "btsnoop", "btsnoop capture extraction and as-fast-as-possible stream decode", &benchmarkBtsnoop },
+    { "discovery", "Device discovery ingestion time and allocations for 10 to 2000 devices", &benchmarkDiscovery },
+    { "connect", "Connect cycles through the sink state machine with the phone simulator", &benchmarkConnect },
+    { "tasks", "Coroutine tasks: superseded attempts, resume latency and hops per operation", &benchmarkTasks },
+    { "batching", "Multi-producer queue throughput and per-frame batched delivery of watcher events", &benchmarkBatching },
+    { "log", "Binary logger ns/call and allocations, and a multi-thread round trip through the decoder", &benchmarkLog },
+    { "flight", "Flight recorder ns/event, allocations, and a multi-thread dump read back by the viewer", &benchmarkFlight },
+};
+
+} // namespace
+
+namespace Benchmark {
+
+bool needsWidgets(const QString &name)
+{
+    return name == "discovery" || name == "all";
+}
+
+int run(const QStringList &arguments)
+{
+    const QString name = optionValue(arguments, "--benchmark", "list");
+
+    if (name == "list" || name.startsWith("--")) {
+        out() << "Available benchmarks (PhoneAudioLink --benchmark <name|all> [options]):" << Qt::endl;
+        for (const Entry &entry : Benchmarks)
+            out() << "  " << entry.name << " - " << entry.description << Qt::endl;
+        return 0;
+    }
+
+    int status = 0;
+    bool found = false;
+    for (const Entry &entry : Benchmarks) {
+        if (name == "all" || name == entry.name) {
+            found = true;
+            status |= entry.function(arguments);
+        }
+    }
+
+    if (!found) {
+        out() << "Unknown benchmark: " << name << Qt::endl;
+        return 1;
+    }
+    return status;
+}
+
+} // namespace Benchmark
@@ -0,0 +1,19 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QString>
+#include <QStringList>
+
+// Headless benchmarks, run with `PhoneAudioLink --benchmark <name> [options]`.
+// `--benchmark list` prints the available names. Results go to stdout.
+namespace Benchmark {
+
+// Whether the named benchmark drives widgets and so needs a QApplication (it shows no windows)
+bool needsWidgets(const QString &name);
+
+// Returns the process exit code (non-zero if a benchmark's correctness check failed)
+int run(const QStringList &arguments);
+
+} // namespace Benchmark
+
+#endif // BENCHMARK_H
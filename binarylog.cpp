@@ -0,0 +1,618 @@
+#include "binarylog.h"
+#include "spscring.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace BinaryLog {
+namespace {
+
+// File layout (little endian): the magic, the version, then a wall clock and a steady clock
+// reading taken together when the file was opened, then chunks, each a type byte and its body:
+//   'F' format:  quint16 id, quint8 level, QByteArray file, qint32 line, QByteArray format
+//   'T' thread:  quint8 ring index, QByteArray name (for rings in use when the file was opened)
+//   'R' record:  a Record, raw
+//   'D' dropped: quint8 ring index, quint64 records lost to a full ring
+// Every file starts with all formats and thread names known at that point, so each one decodes
+// on its own after rotation.
+constexpr char Magic[8] = { 'P', 'A', 'L', 'B', 'L', 'O', 'G', '\0' };
+constexpr quint32 FileVersion = 1;
+constexpr char FormatChunk = 'F';
+constexpr char ThreadChunk = 'T';
+constexpr char RecordChunk = 'R';
+constexpr char DroppedChunk = 'D';
+
+constexpr int MaxRings = 255;
+constexpr size_t RingRecords = 512;     // 32 KB per thread
+constexpr qint64 MaxFileBytes = 4 * 1024 * 1024;
+constexpr int KeptFiles = 3;            // besides the current one
+constexpr int DrainIntervalMs = 20;
+
+// Format 0: the first record of every thread that claims a ring
+constexpr quint16 ThreadStartedFormat = 0;
+
+struct Format
+{
+    Level level = Info;
+    QByteArray file;
+    int line = 0;
+    QByteArray text;
+};
+
+QMutex formatMutex;
+
+std::vector<Format> &formats()
+{
+    static std::vector<Format> list{ { Info, QByteArray(__FILE__), __LINE__, QByteArray("Thread started: %1") } };
+    return list;
+}
+
+// One per logging thread. A thread that exits leaves its ring to the next new thread once the
+// writer has drained it, so pool threads coming and going do not use up the indices.
+struct ThreadRing
+{
+    SpscRing<Record, RingRecords> records;
+    std::atomic<quint64> dropped{ 0 };
+    std::atomic<bool> inUse{ true };
+    quint8 index = 0;
+};
+
+std::array<std::atomic<ThreadRing *>, MaxRings> rings{};
+std::atomic<int> ringCount{ 0 };
+QMutex ringMutex;   // claiming only, never while logging
+
+struct RingOwner
+{
+    ThreadRing *ring = nullptr;
+    bool unavailable = false;   // all rings taken; this thread does not log
+
+    ~RingOwner()
+    {
+        if (ring)
+            ring->inUse.store(false, std::memory_order_release);
+    }
+};
+
+thread_local RingOwner ringOwner;
+
+ThreadRing *claimRing()
+{
+    QMutexLocker locker(&ringMutex);
+    const int count = ringCount.load(std::memory_order_relaxed);
+    for (int i = 0; i < count; i++) {
+        ThreadRing *ring = rings[i].load(std::memory_order_relaxed);
+        if (!ring->inUse.load(std::memory_order_acquire) && ring->records.size() == 0) {
+            ring->inUse.store(true, std::memory_order_relaxed);
+            return ring;
+        }
+    }
+    if (count == MaxRings)
+        return nullptr;
+
+    ThreadRing *ring = new ThreadRing;
+    ring->index = quint8(count);
+    rings[count].store(ring, std::memory_order_release);
+    ringCount.store(count + 1, std::memory_order_release);
+    return ring;
+}
+
+QString currentThreadName()
+{
+    if (QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread())
+        return "main";
+    const QString name = QThread::currentThread()->objectName();
+    if (!name.isEmpty())
+        return name;
+    return QString("0x%1").arg(quintptr(QThread::currentThreadId()), 0, 16);
+}
+
+// Replaces %1 to %9 in one pass, so arguments containing placeholders stay as they are
+QString substitute(const QString &format, const QStringList &arguments)
+{
+    QString text;
+    text.reserve(format.size() + 32);
+    for (qsizetype i = 0; i < format.size(); i++) {
+        const QChar c = format.at(i);
+        if (c == '%' && i + 1 < format.size() && format.at(i + 1) >= '1' && format.at(i + 1) <= '9') {
+            const int index = format.at(i + 1).digitValue() - 1;
+            text += index < arguments.size() ? arguments.at(index) : QString("%") + format.at(i + 1);
+            i++;
+            continue;
+        }
+        text += c;
+    }
+    return text;
+}
+
+QString formatRecord(const QByteArray &format, const Record &record)
+{
+    QStringList arguments;
+    int used = 0;
+    for (int i = 0; i < std::min<int>(record.argumentCount, MaxArguments); i++) {
+        const ArgumentType type = ArgumentType((record.types[i / 2] >> (4 * (i % 2))) & 0xf);
+        if (type == String) {
+            const int length = used < PayloadSize ? record.payload[used] : 0;
+            if (used + 1 + length > PayloadSize) {
+                arguments.append("?");
+                continue;
+            }
+            arguments.append(QString::fromUtf8(reinterpret_cast<const char *>(record.payload + used + 1), length));
+            used += 1 + length;
+            continue;
+        }
+        if (type == Missing || used + 8 > PayloadSize) {
+            arguments.append("?");
+            continue;
+        }
+        quint64 bits;
+        std::memcpy(&bits, record.payload + used, sizeof(bits));
+        used += sizeof(bits);
+        switch (type) {
+        case Int:
+            arguments.append(QString::number(qint64(bits)));
+            break;
+        case UInt:
+            arguments.append(QString::number(bits));
+            break;
+        case Double: {
+            double number;
+            std::memcpy(&number, &bits, sizeof(number));
+            arguments.append(QString::number(number));
+            break;
+        }
+        case Bool:
+            arguments.append(bits ? "true" : "false");
+            break;
+        default:
+            arguments.append("?");
+            break;
+        }
+    }
+    return substitute(QString::fromUtf8(format), arguments);
+}
+
+char levelLetter(Level level)
+{
+    switch (level) {
+    case Debug:   return 'D';
+    case Info:    return 'I';
+    case Warning: return 'W';
+    }
+    return '?';
+}
+
+QString formatLine(qint64 wallNs, const Format &format, const QString &thread, const QString &text)
+{
+    return QString("%1 %2 [%3] %4:%5  %6")
+        .arg(QDateTime::fromMSecsSinceEpoch(wallNs / 1000000).toString("yyyy-MM-dd HH:mm:ss.zzz"))
+        .arg(levelLetter(format.level))
+        .arg(thread)
+        .arg(QFileInfo(QString::fromUtf8(format.file)).fileName())
+        .arg(format.line)
+        .arg(text);
+}
+
+class Writer
+{
+public:
+    Writer(const QString &directory, bool echo)
+        : m_directory(directory)
+        , m_echo(echo)
+    {
+        QDir().mkpath(m_directory);
+        // The previous run's log moves to .1.blog; it is the one a bug report needs
+        if (QFileInfo(path(0)).size() > 0)
+            shiftFiles();
+        openFile();
+        m_thread = QThread::create([this]() { run(); });
+        m_thread->setObjectName("BinaryLog writer");
+        m_thread->start(QThread::LowPriority);
+    }
+
+    ~Writer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_one();
+        m_thread->wait();
+        delete m_thread;
+    }
+
+private:
+    QString path(int generation) const
+    {
+        return m_directory + (generation == 0 ? QString("/phoneaudiolink.blog")
+                                              : QString("/phoneaudiolink.%1.blog").arg(generation));
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stopping) {
+            lock.unlock();
+            drain();
+            lock.lock();
+            m_wake.wait_for(lock, std::chrono::milliseconds(DrainIntervalMs), [this]() { return m_stopping; });
+        }
+        lock.unlock();
+        drain();
+    }
+
+    void openFile()
+    {
+        m_file.setFileName(path(0));
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            std::fprintf(stderr, "Cannot open log file %s\n", qPrintable(m_file.fileName()));
+            return;
+        }
+        m_stream.setDevice(&m_file);
+        m_stream.setByteOrder(QDataStream::LittleEndian);
+        m_stream.writeRawData(Magic, sizeof(Magic));
+        m_stream << FileVersion << QDateTime::currentMSecsSinceEpoch() * 1000000 << steadyNanoseconds();
+
+        m_formatsWritten = 0;
+        writeFormats();
+        for (int i = 0; i < MaxRings; i++) {
+            if (!m_threadNames[i].isEmpty()) {
+                m_stream.writeRawData(&ThreadChunk, 1);
+                m_stream << quint8(i) << m_threadNames[i];
+            }
+        }
+    }
+
+    // phoneaudiolink.blog becomes .1.blog and so on, dropping the oldest
+    void shiftFiles()
+    {
+        QFile::remove(path(KeptFiles));
+        for (int generation = KeptFiles - 1; generation >= 0; generation--)
+            QFile::rename(path(generation), path(generation + 1));
+    }
+
+    void rotate()
+    {
+        m_stream.setDevice(nullptr);
+        m_file.close();
+        shiftFiles();
+        openFile();
+    }
+
+    // Definitions for the formats registered since the last call
+    void writeFormats()
+    {
+        QMutexLocker locker(&formatMutex);
+        const std::vector<Format> &list = formats();
+        for (; m_formatsWritten < list.size(); m_formatsWritten++) {
+            const Format &format = list[m_formatsWritten];
+            m_stream.writeRawData(&FormatChunk, 1);
+            m_stream << quint16(m_formatsWritten) << quint8(format.level) << format.file << qint32(format.line) << format.text;
+            m_formats.resize(std::max(m_formats.size(), m_formatsWritten + 1));
+            m_formats[m_formatsWritten] = format;
+        }
+    }
+
+    void drain()
+    {
+        bool wrote = false;
+        const int count = ringCount.load(std::memory_order_acquire);
+        for (int i = 0; i < count; i++) {
+            ThreadRing *ring = rings[i].load(std::memory_order_acquire);
+            while (const Record *record = ring->records.front()) {
+                writeRecord(*record);
+                ring->records.pop();
+                wrote = true;
+            }
+            if (const quint64 dropped = ring->dropped.exchange(0, std::memory_order_relaxed)) {
+                if (m_file.isOpen()) {
+                    m_stream.writeRawData(&DroppedChunk, 1);
+                    m_stream << quint8(i) << dropped;
+                }
+                std::fprintf(stderr, "Log: %llu records dropped on thread %s\n",
+                             static_cast<unsigned long long>(dropped), m_threadNames[i].constData());
+                wrote = true;
+            }
+        }
+        if (wrote && m_file.isOpen()) {
+            m_file.flush();
+            if (m_file.size() >= MaxFileBytes)
+                rotate();
+        }
+    }
+
+    void writeRecord(const Record &record)
+    {
+        if (record.format >= m_formats.size())
+            writeFormats();
+        if (record.format >= m_formats.size())
+            return;     // cannot happen: a format is registered before its first record
+
+        if (record.format == ThreadStartedFormat) {
+            m_threadNames[record.thread] = formatRecord("%1", record).toUtf8();
+            if (m_file.isOpen()) {
+                m_stream.writeRawData(&ThreadChunk, 1);
+                m_stream << record.thread << m_threadNames[record.thread];
+            }
+        }
+        if (m_file.isOpen()) {
+            m_stream.writeRawData(&RecordChunk, 1);
+            m_stream.writeRawData(reinterpret_cast<const char *>(&record), sizeof(record));
+        }
+
+        if (m_echo) {
+            const qint64 wallNs = QDateTime::currentMSecsSinceEpoch() * 1000000 - (steadyNanoseconds() - record.timestampNs);
+            const Format &format = m_formats[record.format];
+            std::fprintf(stderr, "%s\n",
+                         formatLine(wallNs, format, QString::fromUtf8(m_threadNames[record.thread]),
+                                    formatRecord(format.text, record)).toLocal8Bit().constData());
+        }
+    }
+
+    QString m_directory;
+    bool m_echo;
+    QFile m_file;
+    QDataStream m_stream;
+    size_t m_formatsWritten = 0;
+    std::vector<Format> m_formats;          // writer thread's copy
+    QByteArray m_threadNames[MaxRings];
+
+    QThread *m_thread = nullptr;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+};
+
+Writer *writer = nullptr;
+
+} // namespace
+
+quint16 registerFormat(Level level, const char *file, int line, const char *format)
+{
+    QMutexLocker locker(&formatMutex);
+    std::vector<Format> &list = formats();
+    list.push_back({ level, QByteArray(file), line, QByteArray(format) });
+    return quint16(list.size() - 1);
+}
+
+Record *beginRecord()
+{
+    RingOwner &owner = ringOwner;
+    if (!owner.ring) {
+        if (owner.unavailable)
+            return nullptr;
+        owner.ring = claimRing();
+        if (!owner.ring) {
+            owner.unavailable = true;
+            return nullptr;
+        }
+        write(ThreadStartedFormat, currentThreadName());
+    }
+
+    Record *record = owner.ring->records.beginWrite();
+    if (!record) {
+        owner.ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    record->thread = owner.ring->index;
+    return record;
+}
+
+void commitRecord()
+{
+    ringOwner.ring->records.commitWrite();
+}
+
+namespace detail {
+
+void Encoder::addString(const char *text)
+{
+    if (m_used >= PayloadSize) {
+        setType(Missing);
+        return;
+    }
+    const int length = int(std::min<size_t>(std::strlen(text), size_t(PayloadSize - m_used - 1)));
+    m_record->payload[m_used] = quint8(length);
+    std::memcpy(m_record->payload + m_used + 1, text, length);
+    m_used += 1 + length;
+    setType(String);
+}
+
+void Encoder::addString(const QString &text)
+{
+    if (m_used >= PayloadSize) {
+        setType(Missing);
+        return;
+    }
+
+    // UTF-8 straight into the payload; no allocation, and no character split at the end
+    quint8 *out = m_record->payload + m_used + 1;
+    const int capacity = PayloadSize - m_used - 1;
+    int length = 0;
+    const QChar *chars = text.constData();
+    for (qsizetype i = 0; i < text.size(); i++) {
+        char32_t c = chars[i].unicode();
+        if (QChar::isHighSurrogate(c) && i + 1 < text.size() && chars[i + 1].isLowSurrogate())
+            c = QChar::surrogateToUcs4(chars[i], chars[++i]);
+        const int bytes = c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+        if (length + bytes > capacity)
+            break;
+        switch (bytes) {
+        case 1:
+            out[length++] = quint8(c);
+            break;
+        case 2:
+            out[length++] = quint8(0xc0 | (c >> 6));
+            out[length++] = quint8(0x80 | (c & 0x3f));
+            break;
+        case 3:
+            out[length++] = quint8(0xe0 | (c >> 12));
+            out[length++] = quint8(0x80 | ((c >> 6) & 0x3f));
+            out[length++] = quint8(0x80 | (c & 0x3f));
+            break;
+        default:
+            out[length++] = quint8(0xf0 | (c >> 18));
+            out[length++] = quint8(0x80 | ((c >> 12) & 0x3f));
+            out[length++] = quint8(0x80 | ((c >> 6) & 0x3f));
+            out[length++] = quint8(0x80 | (c & 0x3f));
+            break;
+        }
+    }
+    m_record->payload[m_used] = quint8(length);
+    m_used += 1 + length;
+    setType(String);
+}
+
+} // namespace detail
+
+Session::Session(const QString &directory, bool echo)
+{
+    if (!writer)
+        writer = new Writer(directory, echo);
+}
+
+Session::~Session()
+{
+    delete writer;
+    writer = nullptr;
+}
+
+bool decodeFile(const QString &path, QStringList *lines, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    char magic[sizeof(Magic)];
+    quint32 version = 0;
+    qint64 anchorWallNs = 0;
+    qint64 anchorSteadyNs = 0;
+    if (stream.readRawData(magic, sizeof(magic)) != sizeof(magic) || std::memcmp(magic, Magic, sizeof(Magic)) != 0) {
+        if (error)
+            *error = "not a PhoneAudioLink binary log";
+        return false;
+    }
+    stream >> version >> anchorWallNs >> anchorSteadyNs;
+    if (version != FileVersion) {
+        if (error)
+            *error = QString("unsupported version %1").arg(version);
+        return false;
+    }
+
+    // Rings are drained one after the other, so records come out of order across threads
+    struct Line
+    {
+        qint64 wallNs;
+        QString text;
+    };
+    std::vector<Line> decoded;
+    QHash<quint16, Format> fileFormats;
+    QString threadNames[MaxRings];
+    qint64 lastWallNs = anchorWallNs;
+    char type = 0;
+    while (stream.readRawData(&type, 1) == 1) {
+        if (type == FormatChunk) {
+            quint16 id;
+            quint8 level;
+            qint32 line;
+            Format format;
+            stream >> id >> level >> format.file >> line >> format.text;
+            format.level = Level(level);
+            format.line = line;
+            fileFormats.insert(id, format);
+        }
+        else if (type == ThreadChunk) {
+            quint8 thread;
+            QByteArray name;
+            stream >> thread >> name;
+            if (thread < MaxRings)
+                threadNames[thread] = QString::fromUtf8(name);
+        }
+        else if (type == RecordChunk) {
+            Record record;
+            if (stream.readRawData(reinterpret_cast<char *>(&record), sizeof(record)) != sizeof(record))
+                break;
+            const auto format = fileFormats.constFind(record.format);
+            if (format == fileFormats.cend() || record.thread >= MaxRings)
+                continue;
+            lastWallNs = anchorWallNs + (record.timestampNs - anchorSteadyNs);
+            decoded.push_back({ lastWallNs, formatLine(lastWallNs, *format, threadNames[record.thread],
+                                                       formatRecord(format->text, record)) });
+        }
+        else if (type == DroppedChunk) {
+            quint8 thread;
+            quint64 dropped;
+            stream >> thread >> dropped;
+            decoded.push_back({ lastWallNs, QString("%1 records dropped on thread %2 (ring full)")
+                                                .arg(dropped)
+                                                .arg(thread < MaxRings ? threadNames[thread] : QString::number(thread)) });
+        }
+        else {
+            if (error)
+                *error = QString("corrupt chunk at offset %1").arg(file.pos() - 1);
+            break;
+        }
+        if (stream.status() != QDataStream::Ok)
+            break;  // truncated by a crash
+    }
+
+    std::stable_sort(decoded.begin(), decoded.end(), [](const Line &a, const Line &b) { return a.wallNs < b.wallNs; });
+    for (const Line &line : decoded)
+        lines->append(line.text);
+    return true;
+}
+
+int decode(const QStringList &arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    const int index = arguments.indexOf("--decode-log");
+    const QStringList files = arguments.mid(index + 1);
+    if (index < 0 || files.isEmpty()) {
+        err << "Usage: PhoneAudioLink --decode-log <file.blog>..." << Qt::endl;
+        return 1;
+    }
+
+    int status = 0;
+    for (const QString &path : files) {
+        QStringList lines;
+        QString error;
+        if (!decodeFile(path, &lines, &error)) {
+            err << path << ": " << error << Qt::endl;
+            status = 1;
+            continue;
+        }
+        if (!error.isEmpty()) {
+            err << path << ": " << error << Qt::endl;
+            status = 1;
+        }
+        for (const QString &line : std::as_const(lines))
+            out << line << '\n';
+    }
+    out.flush();
+    return status;
+}
+
+} // namespace BinaryLog
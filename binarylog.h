@@ -0,0 +1,195 @@
+#ifndef BINARYLOG_H
+#define BINARYLOG_H
+
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+#include <chrono>
+#include <cstring>
+#include <type_traits>
+
+// Calls below this level are compiled out of LOG_DEBUG / LOG_INFO / LOG_WARNING entirely,
+// arguments included
+#ifndef BINARYLOG_MIN_LEVEL
+#  ifdef DEBUG_BUILD
+#    define BINARYLOG_MIN_LEVEL 0
+#  else
+#    define BINARYLOG_MIN_LEVEL 1
+#  endif
+#endif
+
+// Structured binary log for hot paths: device discovery, state changes, media keys, audio
+// session enumeration, and anything on the audio or WinRT callback threads.
+//
+//     LOG_INFO("Connection state: %1 (+%2 ms)", connectionStateName(state), elapsedUs / 1000.0);
+//
+// A call copies a format ID and its raw arguments into a fixed-size record in the calling
+// thread's own ring; nothing is formatted, locked or allocated. A writer thread drains the rings
+// into rotating files under logs/ (see Session), and `PhoneAudioLink --decode-log <file>` turns
+// them back into text. Format strings use QString::arg placeholders. A full ring drops records
+// and the file says how many.
+namespace BinaryLog {
+
+enum Level : quint8 { Debug = 0, Info = 1, Warning = 2 };
+
+enum ArgumentType : quint8 { Missing = 0, Int, UInt, Double, Bool, String };
+
+constexpr int MaxArguments = 8;
+constexpr int PayloadSize = 48;
+
+// One log call, written in place into the calling thread's ring. Numbers take 8 bytes of the
+// payload, strings a length byte and their UTF-8, truncated to what is left.
+struct Record
+{
+    qint64 timestampNs;                 // steady clock
+    quint16 format;                     // from registerFormat()
+    quint8 thread;                      // ring index; the file names the thread
+    quint8 argumentCount;
+    quint8 types[MaxArguments / 2];     // ArgumentType, 4 bits per argument
+    quint8 payload[PayloadSize];
+};
+static_assert(sizeof(Record) == 64, "Records are one cache line");
+
+// Once per call site (the macros keep the ID in a function-local static)
+quint16 registerFormat(Level level, const char *file, int line, const char *format);
+
+// The calling thread's next free record, or nullptr if its ring is full (counted as dropped)
+Record *beginRecord();
+void commitRecord();
+
+namespace detail {
+
+class Encoder
+{
+public:
+    explicit Encoder(Record *record)
+        : m_record(record)
+    {
+        std::memset(m_record->types, 0, sizeof(m_record->types));
+    }
+
+    template<typename T>
+    void add(const T &value)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+            addNumber(Bool, value ? 1 : 0);
+        else if constexpr (std::is_enum_v<T>)
+            addNumber(Int, quint64(qint64(value)));
+        else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+            addNumber(Int, quint64(qint64(value)));
+        else if constexpr (std::is_integral_v<T>)
+            addNumber(UInt, quint64(value));
+        else if constexpr (std::is_floating_point_v<T>) {
+            const double number = double(value);
+            quint64 bits;
+            std::memcpy(&bits, &number, sizeof(bits));
+            addNumber(Double, bits);
+        }
+        else if constexpr (std::is_same_v<T, QString>)
+            addString(value);
+        else if constexpr (std::is_convertible_v<const T &, const char *>)
+            addString(static_cast<const char *>(value));
+        else if constexpr (std::is_pointer_v<T>)
+            addNumber(UInt, quint64(quintptr(value)));
+        else
+            static_assert(std::is_void_v<T>, "Unsupported log argument type");
+    }
+
+private:
+    void setType(ArgumentType type)
+    {
+        m_record->types[m_index / 2] |= quint8(type << (4 * (m_index % 2)));
+        m_index++;
+    }
+
+    void addNumber(ArgumentType type, quint64 bits)
+    {
+        if (m_used + int(sizeof(bits)) > PayloadSize) {
+            setType(Missing);
+            return;
+        }
+        std::memcpy(m_record->payload + m_used, &bits, sizeof(bits));
+        m_used += sizeof(bits);
+        setType(type);
+    }
+
+    void addString(const char *text);
+    void addString(const QString &text);
+
+    Record *m_record;
+    int m_index = 0;
+    int m_used = 0;
+};
+
+} // namespace detail
+
+inline qint64 steadyNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename... Args>
+void write(quint16 format, const Args &...arguments)
+{
+    static_assert(sizeof...(Args) <= MaxArguments, "Too many log arguments");
+    Record *record = beginRecord();
+    if (!record)
+        return;
+    record->timestampNs = steadyNanoseconds();
+    record->format = format;
+    record->argumentCount = quint8(sizeof...(Args));
+    detail::Encoder encoder(record);
+    (encoder.add(arguments), ...);
+    commitRecord();
+}
+
+// Runs the writer thread for its lifetime: rings are drained every few milliseconds into
+// <directory>/phoneaudiolink.blog, rotated at startup and at 4 MB with the last three files kept.
+// Records logged before a Session exists wait in the rings. With echo (the default in debug
+// builds) every record is also printed to stderr, formatted on the writer thread.
+class Session
+{
+public:
+#ifdef DEBUG_BUILD
+    explicit Session(const QString &directory, bool echo = true);
+#else
+    explicit Session(const QString &directory, bool echo = false);
+#endif
+    ~Session();
+
+    Session(const Session &) = delete;
+    Session &operator=(const Session &) = delete;
+};
+
+// The records of one log file as text lines, oldest first. A file cut short by a crash decodes
+// up to the cut; false (with *error set) if it is not a log file or cannot be read.
+bool decodeFile(const QString &path, QStringList *lines, QString *error = nullptr);
+
+// `--decode-log <file>...`: prints the records of binary log files as text
+int decode(const QStringList &arguments);
+
+} // namespace BinaryLog
+
+#define BINARYLOG_WRITE(level, format, ...) \
+    do { \
+        static const quint16 binaryLogFormat = BinaryLog::registerFormat(level, __FILE__, __LINE__, format); \
+        BinaryLog::write(binaryLogFormat, ##__VA_ARGS__); \
+    } while (false)
+
+#if BINARYLOG_MIN_LEVEL <= 0
+#  define LOG_DEBUG(format, ...) BINARYLOG_WRITE(BinaryLog::Debug, format, ##__VA_ARGS__)
+#else
+#  define LOG_DEBUG(format, ...) do {} while (false)
+#endif
+
+#if BINARYLOG_MIN_LEVEL <= 1
+#  define LOG_INFO(format, ...) BINARYLOG_WRITE(BinaryLog::Info, format, ##__VA_ARGS__)
+#else
+#  define LOG_INFO(format, ...) do {} while (false)
+#endif
+
+#define LOG_WARNING(format, ...) BINARYLOG_WRITE(BinaryLog::Warning, format, ##__VA_ARGS__)
+
+#endif // BINARYLOG_H
@@ -1,489 +1,388 @@
 #include "bluetootha2dpsink.h"
-#include <QMetaObject>
+#include "binarylog.h"
+#include "flightrecorder.h"
+#include "jitterbuffer.h"
+#include "simulatedsinkbackend.h"
+#include "spantrace.h"
+#include "winrtsinkbackend.h"
 
-#ifdef Q_OS_WIN
-    using namespace winrt;
-    using namespace winrt::Windows::Foundation;
-    using namespace winrt::Windows::Media::Audio;
-    using namespace winrt::Windows::Devices::Enumeration;
-#endif
+#include <QCoreApplication>
+
+namespace {
+
+// Between enableSink() and the stream opening (or the attempt failing or being released)
+bool isConnecting(BluetoothA2DPSink::ConnectionState state)
+{
+    return state == BluetoothA2DPSink::ConnectionState::Enabling
+           || state == BluetoothA2DPSink::ConnectionState::Enabled
+           || state == BluetoothA2DPSink::ConnectionState::Opening;
+}
+
+} // namespace
 
 BluetoothA2DPSink::BluetoothA2DPSink(QObject *parent)
+    : BluetoothA2DPSink(createDefaultBackend(), parent)
+{
+}
+
+BluetoothA2DPSink::BluetoothA2DPSink(A2DPSinkBackend *backend, QObject *parent)
     : QObject(parent)
-    , m_winrtInitialized(false)
-    , m_ownsApartment(false)
-    , m_isStreaming(false)
+    , m_backend(backend)
+    , m_renderer(new AudioRenderer(this))
+    , m_statisticsTimer(new QTimer(this))
+    , m_reportedPacketsLost(0)
+    , m_reportedFramesConcealed(0)
+    , m_connectionState(ConnectionState::Idle)
+    , m_openWhenEnabled(false)
+    , m_connectStats(QCoreApplication::applicationDirPath() + "/connectstats.json")
 {
-    qDebug() << "Initializing BluetoothA2DPSink...";
-    initializeWinRT();
+    qDebug() << "Initializing BluetoothA2DPSink with" << m_backend->name() << "backend...";
+
+    // Decode the raw media stream in-process when the backend provides one
+    m_mediaPipeline.setPcmSink(m_renderer);
+    attachBackend(m_backend);
+
+    m_statisticsTimer->setInterval(1000);
+    connect(m_statisticsTimer, &QTimer::timeout, this, &BluetoothA2DPSink::reportMediaStatistics);
 }
 
 BluetoothA2DPSink::~BluetoothA2DPSink()
 {
-    cleanupWinRT();
+    // Stop the backends (and any media threads) while this object is still alive
+    qDeleteAll(m_backends);
+    m_backends.clear();
+    m_backend = nullptr;
 }
 
-void BluetoothA2DPSink::initializeWinRT()
+void BluetoothA2DPSink::addBackend(A2DPSinkBackend *backend)
 {
-#ifdef Q_OS_WIN
-    try {
-        // Try to initialize as Single-Threaded Apartment
-        winrt::init_apartment(winrt::apartment_type::single_threaded);
-        m_winrtInitialized = true;
-        m_ownsApartment = true;
-        qDebug() << "WinRT initialized successfully (STA)";
-    }
-    catch (const winrt::hresult_error &ex) {
-        HRESULT hr = ex.code();
-
-        // RPC_E_CHANGED_MODE means COM already initialized - that's fine
-        if (hr == RPC_E_CHANGED_MODE) {
-            qDebug() << "COM already initialized, using existing apartment";
-            m_winrtInitialized = true;
-            m_ownsApartment = false;
-        }
-        else {
-            qWarning() << "Failed to initialize WinRT:"
-                       << QString::fromWCharArray(ex.message().c_str())
-                       << "HRESULT:" << QString::number(hr, 16);
-            m_winrtInitialized = false;
-            m_ownsApartment = false;
-        }
-    }
-#else
-    qWarning() << "A2DP Sink is only supported on Windows 10 2004+";
-#endif
+    qDebug() << "Adding" << backend->name() << "backend";
+    attachBackend(backend);
 }
 
-void BluetoothA2DPSink::cleanupWinRT()
+void BluetoothA2DPSink::attachBackend(A2DPSinkBackend *backend)
 {
-#ifdef Q_OS_WIN
-    try {
-        // Stop device watcher if running
-        if (m_deviceWatcher) {
-            if (m_deviceAddedToken.value != 0) {
-                m_deviceWatcher.Added(m_deviceAddedToken);
-                m_deviceAddedToken = {};
-            }
-            if (m_enumerationCompletedToken.value != 0) {
-                m_deviceWatcher.EnumerationCompleted(m_enumerationCompletedToken);
-                m_enumerationCompletedToken = {};
-            }
-
-            if (m_deviceWatcher.Status() == DeviceWatcherStatus::Started ||
-                m_deviceWatcher.Status() == DeviceWatcherStatus::EnumerationCompleted) {
-                m_deviceWatcher.Stop();
-            }
-            m_deviceWatcher = nullptr;
+    backend->setParent(this);
+    m_backends.append(backend);
+
+    // The state machine follows the active backend; connected first so the state is current by
+    // the time the forwarded signals arrive
+    connect(backend, &A2DPSinkBackend::sinkEnabled, this, [this, backend]() {
+        if (backend != m_backend || m_connectionState != ConnectionState::Enabling)
+            return;
+        setConnectionState(ConnectionState::Enabled);
+        if (m_openWhenEnabled) {
+            m_openWhenEnabled = false;
+            openConnection();
         }
-
-        if (m_connection) {
-            if (m_stateChangedToken.value != 0) {
-                m_connection.StateChanged(m_stateChangedToken);
-                m_stateChangedToken = {};
-            }
-
-            // Close and dispose
-            if (m_connection.State() == AudioPlaybackConnectionState::Opened) {
-                m_connection.Close();
-            }
-            m_connection = nullptr;
+    });
+    connect(backend, &A2DPSinkBackend::connectionOpened, this, [this, backend]() {
+        if (backend == m_backend)
+            setConnectionState(ConnectionState::Streaming);
+    });
+    connect(backend, &A2DPSinkBackend::connectionClosed, this, [this, backend]() {
+        if (backend != m_backend)
+            return;
+        // A connect that opened but never saw StateChanged(Opened) still counts
+        if (m_connectionState == ConnectionState::Streaming)
+            finishConnectTiming();
+        if (m_connectionState != ConnectionState::Failed)
+            setConnectionState(ConnectionState::Idle);
+    });
+    connect(backend, &A2DPSinkBackend::connectMilestone, this, [this, backend](ConnectMilestone milestone, qint64 steadyUs) {
+        if (backend != m_backend)
+            return;
+        if (m_attemptTimer.isValid()) {
+            const qint64 elapsedUs = m_attemptTimer.nsecsElapsed() / 1000 - (JitterBuffer::steadyMicros() - steadyUs);
+            FlightRecorder::record(FlightRecorder::Milestone, ConnectionStats::milestoneName(milestone), int(milestone), elapsedUs);
         }
-
-        if (m_winrtInitialized && m_ownsApartment) {
-            winrt::uninit_apartment();
-            qDebug() << "WinRT apartment uninitialized";
+        if (m_connectStats.mark(milestone, steadyUs))
+            emit connectTimeMeasured(m_currentDeviceId, m_connectStats.lastConnectMs(m_currentDeviceId));
+    });
+    connect(backend, &A2DPSinkBackend::connectionError, this, [this, backend](const QString &error) {
+        if (backend != m_backend)
+            return;
+        FlightRecorder::record(FlightRecorder::ConnectionError, error);
+        if (m_connectionState == ConnectionState::Enabling || m_connectionState == ConnectionState::Opening) {
+            m_openWhenEnabled = false;
+            setConnectionState(ConnectionState::Failed);
         }
-
-        m_winrtInitialized = false;
-        m_ownsApartment = false;
-    }
-    catch (const winrt::hresult_error &ex) {
-        qWarning() << "Error during cleanup:"
-                   << QString::fromWCharArray(ex.message().c_str());
-    }
-#endif
+        FlightRecorder::dump("connection error");
+    });
+    connect(backend, &A2DPSinkBackend::devicesDiscovered, this, [](const QList<A2DPDevice> &devices) {
+        if (!devices.isEmpty())
+            FlightRecorder::record(FlightRecorder::DevicesDiscovered, devices.first().name, devices.size());
+    });
+    connect(backend, &A2DPSinkBackend::discoveryCompleted, this, []() {
+        FlightRecorder::record(FlightRecorder::DiscoveryCompleted);
+    });
+
+    // Forward backend signals unchanged
+    connect(backend, &A2DPSinkBackend::devicesDiscovered, this, &BluetoothA2DPSink::devicesDiscovered);
+    connect(backend, &A2DPSinkBackend::discoveryCompleted, this, &BluetoothA2DPSink::discoveryCompleted);
+    connect(backend, &A2DPSinkBackend::sinkEnabled, this, &BluetoothA2DPSink::sinkEnabled);
+    connect(backend, &A2DPSinkBackend::connectionOpened, this, &BluetoothA2DPSink::connectionOpened);
+    connect(backend, &A2DPSinkBackend::connectionClosed, this, &BluetoothA2DPSink::connectionClosed);
+    connect(backend, &A2DPSinkBackend::connectionError, this, &BluetoothA2DPSink::connectionError);
+    connect(backend, &A2DPSinkBackend::stateChanged, this, &BluetoothA2DPSink::stateChanged);
+
+    backend->setMediaSink(&m_mediaPipeline);
+    connect(backend, &A2DPSinkBackend::connectionOpened, this, [this, backend]() {
+        if (backend->providesMediaStream()) {
+            m_renderer->start();
+            m_mediaPipeline.start();
+
+            m_statisticsBase = m_mediaPipeline.statistics();
+            m_reportedPacketsLost = 0;
+            m_reportedFramesConcealed = 0;
+            m_statisticsTimer->start();
+        }
+    });
+    connect(backend, &A2DPSinkBackend::connectionClosed, this, [this]() {
+        m_mediaPipeline.stop();
+        m_renderer->stop();
+        m_mediaPipeline.reset();
+
+        if (m_statisticsTimer->isActive()) {
+            m_statisticsTimer->stop();
+            reportMediaStatistics();
+        }
+    });
 }
 
-void BluetoothA2DPSink::startDeviceDiscovery()
+A2DPSinkBackend *BluetoothA2DPSink::backendFor(const QString &deviceId) const
 {
-#ifdef Q_OS_WIN
-    if (!m_winrtInitialized) {
-        emit connectionError("WinRT not initialized");
-        return;
+    // Added backends claim their own IDs; the primary one takes everything else
+    for (qsizetype i = m_backends.size() - 1; i > 0; i--) {
+        if (m_backends.at(i)->handlesDeviceId(deviceId))
+            return m_backends.at(i);
     }
+    return m_backends.first();
+}
 
-    try {
-        qDebug() << "Starting device discovery for A2DP-capable devices...";
-
-        // Get selector for devices that support AudioPlaybackConnection
-        auto selector = AudioPlaybackConnection::GetDeviceSelector();
-        qDebug() << "Device selector:" << QString::fromWCharArray(selector.c_str());
-
-        // Create device watcher
-        m_deviceWatcher = DeviceInformation::CreateWatcher(selector);
-
-        // Register for device added events
-        m_deviceAddedToken = m_deviceWatcher.Added(
-            [this](DeviceWatcher sender, DeviceInformation device) {
-                onDeviceAdded(sender, device);
-            }
-            );
-
-        // Register for enumeration completed
-        m_enumerationCompletedToken = m_deviceWatcher.EnumerationCompleted(
-            [this](DeviceWatcher sender, winrt::IInspectable args) {
-                onDeviceEnumerationCompleted(sender, args);
-            }
-            );
-
-        // Start watching
-        m_deviceWatcher.Start();
-        qDebug() << "Device watcher started";
-    }
-    catch (const winrt::hresult_error &ex) {
-        QString error = QString::fromWCharArray(ex.message().c_str());
-        qWarning() << "Error starting device discovery:" << error;
-        emit connectionError(error);
+A2DPSinkBackend *BluetoothA2DPSink::createDefaultBackend()
+{
+    if (qEnvironmentVariableIsSet(SimulatedSinkBackend::EnvironmentVariable)) {
+        const QString spec = qEnvironmentVariable(SimulatedSinkBackend::EnvironmentVariable);
+        return new SimulatedSinkBackend(SimulatedSinkBackend::Config::fromString(spec));
     }
-#else
-    emit connectionError("Device discovery only supported on Windows 10 2004+");
-#endif
+    return new WinRTSinkBackend();
 }
 
-void BluetoothA2DPSink::stopDeviceDiscovery()
+A2DPSinkBackend *BluetoothA2DPSink::backend() const
 {
-#ifdef Q_OS_WIN
-    if (m_deviceWatcher) {
-        try {
-            if (m_deviceWatcher.Status() == DeviceWatcherStatus::Started ||
-                m_deviceWatcher.Status() == DeviceWatcherStatus::EnumerationCompleted) {
-                m_deviceWatcher.Stop();
-                qDebug() << "Device watcher stopped";
-            }
-        }
-        catch (const winrt::hresult_error &ex) {
-            qWarning() << "Error stopping device watcher:"
-                       << QString::fromWCharArray(ex.message().c_str());
-        }
-    }
-#endif
+    return m_backend;
 }
 
-#ifdef Q_OS_WIN
-void BluetoothA2DPSink::onDeviceAdded(winrt::DeviceWatcher sender, winrt::DeviceInformation device)
+A2DPMediaPipeline *BluetoothA2DPSink::mediaPipeline()
 {
-    Q_UNUSED(sender);
+    return &m_mediaPipeline;
+}
 
-    QString deviceId = QString::fromWCharArray(device.Id().c_str());
-    QString deviceName = QString::fromWCharArray(device.Name().c_str());
+void BluetoothA2DPSink::reportMediaStatistics()
+{
+    TRACE_SCOPE("sink", "reportMediaStatistics");
+    const JitterBuffer::Statistics jitter = m_mediaPipeline.jitterStatistics();
+    const AudioRenderer::Statistics rendered = m_renderer->statistics();
+    FlightRecorder::record(FlightRecorder::Buffers, nullptr, qint64(jitter.bufferedPackets), jitter.targetDepthUs,
+                           qint64(rendered.bufferedBlocks));
+
+    const A2DPMediaPipeline::Statistics stats = m_mediaPipeline.statistics();
+    const quint64 packetsLost = stats.packetsLost - m_statisticsBase.packetsLost;
+    const quint64 framesConcealed = stats.framesConcealed - m_statisticsBase.framesConcealed;
+    if (packetsLost == m_reportedPacketsLost && framesConcealed == m_reportedFramesConcealed)
+        return;
 
-    qDebug() << "Found A2DP device:" << deviceName << "ID:" << deviceId;
+    FlightRecorder::record(FlightRecorder::Loss, nullptr, qint64(packetsLost), qint64(framesConcealed),
+                           qint64(rendered.underruns), qint64(rendered.overruns));
 
-    // Emit on Qt thread
-    QMetaObject::invokeMethod(this, [this, deviceId, deviceName]() {
-        emit deviceDiscovered(deviceId, deviceName);
-    }, Qt::QueuedConnection);
+    m_reportedPacketsLost = packetsLost;
+    m_reportedFramesConcealed = framesConcealed;
+    emit packetLossUpdated(packetsLost, framesConcealed);
 }
 
-void BluetoothA2DPSink::onDeviceEnumerationCompleted(winrt::DeviceWatcher sender, winrt::IInspectable args)
+AudioRenderer *BluetoothA2DPSink::renderer() const
 {
-    Q_UNUSED(sender);
-    Q_UNUSED(args);
+    return m_renderer;
+}
 
-    qDebug() << "Device enumeration completed";
+void BluetoothA2DPSink::startDeviceDiscovery()
+{
+    TRACE_SCOPE("sink", "startDeviceDiscovery");
+    for (A2DPSinkBackend *backend : std::as_const(m_backends))
+        backend->startDeviceDiscovery();
+}
 
-    QMetaObject::invokeMethod(this, [this]() {
-        emit discoveryCompleted();
-    }, Qt::QueuedConnection);
+void BluetoothA2DPSink::stopDeviceDiscovery()
+{
+    for (A2DPSinkBackend *backend : std::as_const(m_backends))
+        backend->stopDeviceDiscovery();
 }
-#endif
 
 bool BluetoothA2DPSink::enableSink(const QString &deviceId)
 {
-#ifdef Q_OS_WIN
-    if (!m_winrtInitialized) {
-        emit connectionError("WinRT not initialized");
-        return false;
-    }
+    TRACE_SCOPE("sink", "enableSink");
+    finishConnectTiming();
 
-    // Release any existing connection first
+    // Release through Closing first. Backends also release inside their own enableSink(), and
+    // the connectionClosed that reports would otherwise move Enabling back to Idle. Only one
+    // backend holds a connection at a time.
     releaseConnection();
+    m_backend = backendFor(deviceId);
 
     m_currentDeviceId = deviceId;
-
-    qDebug() << "Enabling A2DP sink for device:" << deviceId;
-
-    // Convert QString to std::wstring
-    std::wstring wDeviceId = deviceId.toStdWString();
-
-    // Start async operation
-    enableSinkAsync(wDeviceId);
-
+    m_openWhenEnabled = false;
+    m_transitions.clear();
+    m_attemptTimer.start();
+    m_connectStats.begin(deviceId, JitterBuffer::steadyMicros());
+    if (!isConnecting(m_connectionState))
+        TRACE_ASYNC_BEGIN("sink", "connect", this);
+    setConnectionState(ConnectionState::Enabling);
+
+    if (!m_backend->enableSink(deviceId)) {
+        if (m_connectionState == ConnectionState::Enabling)
+            setConnectionState(ConnectionState::Failed);
+        return false;
+    }
     return true;
-#else
-    emit connectionError("A2DP Sink only supported on Windows 10 2004+");
-    return false;
-#endif
 }
 
-#ifdef Q_OS_WIN
-winrt::fire_and_forget BluetoothA2DPSink::enableSinkAsync(std::wstring deviceId)
+bool BluetoothA2DPSink::connectDevice(const QString &deviceId)
 {
-    try {
-        qDebug() << "Creating AudioPlaybackConnection...";
-
-        // Create the AudioPlaybackConnection for this device
-        m_connection = AudioPlaybackConnection::TryCreateFromId(deviceId);
-
-        if (!m_connection) {
-            QMetaObject::invokeMethod(this, [this]() {
-                emit connectionError("Failed to create AudioPlaybackConnection");
-            }, Qt::QueuedConnection);
-            co_return;
-        }
-
-        qDebug() << "AudioPlaybackConnection created successfully";
-
-        // Register for state change events
-        m_stateChangedToken = m_connection.StateChanged(
-            [this](AudioPlaybackConnection sender, winrt::IInspectable args) {
-                onConnectionStateChanged(sender, args);
-            }
-            );
-
-        // Start the connection (enables incoming audio)
-        qDebug() << "Starting AudioPlaybackConnection...";
-        co_await m_connection.StartAsync();
-
-        qDebug() << "AudioPlaybackConnection started successfully";
-
-        // Notify on Qt thread
-        QMetaObject::invokeMethod(this, [this]() {
-            emit sinkEnabled();
-            emit stateChanged("Sink Enabled - Ready to Connect");
-        }, Qt::QueuedConnection);
-    }
-    catch (const winrt::hresult_error &ex) {
-        QString error = QString::fromWCharArray(ex.message().c_str());
-        qWarning() << "Error enabling sink:" << error;
+    if (!enableSink(deviceId))
+        return false;
 
-        QMetaObject::invokeMethod(this, [this, error]() {
-            emit connectionError(error);
-        }, Qt::QueuedConnection);
-    }
+    // The backend may have completed synchronously
+    if (m_connectionState == ConnectionState::Enabled)
+        return openConnection();
+    m_openWhenEnabled = m_connectionState == ConnectionState::Enabling;
+    return m_openWhenEnabled;
 }
 
-winrt::fire_and_forget BluetoothA2DPSink::openConnectionAsync()
+QString BluetoothA2DPSink::currentDeviceId() const
 {
-    try {
-        if (!m_connection) {
-            QMetaObject::invokeMethod(this, [this]() {
-                emit connectionError("No connection to open");
-            }, Qt::QueuedConnection);
-            co_return;
-        }
-
-        qDebug() << "Opening audio connection...";
-
-        // Open the connection (audio starts flowing)
-        auto result = co_await m_connection.OpenAsync();
+    return m_currentDeviceId;
+}
 
-        if (result.Status() == AudioPlaybackConnectionOpenResultStatus::Success) {
-            qDebug() << "Audio connection opened successfully";
-            m_isStreaming = true;
+BluetoothA2DPSink::ConnectionState BluetoothA2DPSink::connectionState() const
+{
+    return m_connectionState;
+}
 
-            QMetaObject::invokeMethod(this, [this]() {
-                emit connectionOpened();
-                emit stateChanged("Connected - Audio Streaming");
-            }, Qt::QueuedConnection);
-        }
-        else {
-            QString error = "Failed to open connection: ";
-            switch (result.Status()) {
-            case AudioPlaybackConnectionOpenResultStatus::RequestTimedOut:
-                error += "Request timed out";
-                break;
-            case AudioPlaybackConnectionOpenResultStatus::DeniedBySystem:
-                error += "Denied by system";
-                break;
-            case AudioPlaybackConnectionOpenResultStatus::UnknownFailure:
-                error += "Unknown failure";
-                break;
-            default:
-                error += "Unknown status";
-                break;
-            }
-
-            qWarning() << error;
-
-            QMetaObject::invokeMethod(this, [this, error]() {
-                emit connectionError(error);
-            }, Qt::QueuedConnection);
-        }
-    }
-    catch (const winrt::hresult_error &ex) {
-        QString error = QString::fromWCharArray(ex.message().c_str());
-        qWarning() << "Error opening connection:" << error;
+const QList<BluetoothA2DPSink::StateTransition> &BluetoothA2DPSink::connectionTransitions() const
+{
+    return m_transitions;
+}
 
-        QMetaObject::invokeMethod(this, [this, error]() {
-            emit connectionError(error);
-        }, Qt::QueuedConnection);
+const char *BluetoothA2DPSink::connectionStateName(ConnectionState state)
+{
+    switch (state) {
+    case ConnectionState::Idle:      return "Idle";
+    case ConnectionState::Enabling:  return "Enabling";
+    case ConnectionState::Enabled:   return "Enabled";
+    case ConnectionState::Opening:   return "Opening";
+    case ConnectionState::Streaming: return "Streaming";
+    case ConnectionState::Closing:   return "Closing";
+    case ConnectionState::Failed:    return "Failed";
     }
+    return "?";
 }
 
-void BluetoothA2DPSink::onConnectionStateChanged(
-    winrt::AudioPlaybackConnection sender,
-    winrt::IInspectable args)
+void BluetoothA2DPSink::setConnectionState(ConnectionState state)
 {
-    Q_UNUSED(args);
-
-    auto state = sender.State();
-
-    QMetaObject::invokeMethod(this, [this, state]() {
-        QString stateStr;
-
-        switch (state) {
-        case AudioPlaybackConnectionState::Closed:
-            stateStr = "Closed";
-            m_isStreaming = false;
-            emit connectionClosed();
-            break;
+    if (state == m_connectionState)
+        return;
 
-        case AudioPlaybackConnectionState::Opened:
-            stateStr = "Opened";
-            m_isStreaming = true;
-            emit connectionOpened();
-            break;
+    const qint64 elapsedUs = m_attemptTimer.isValid() ? m_attemptTimer.nsecsElapsed() / 1000 : 0;
+    const ConnectionState previous = m_connectionState;
+    m_connectionState = state;
+    m_transitions.append({ state, elapsedUs });
+    LOG_INFO("Connection state: %1 (+%2 ms)", connectionStateName(state), elapsedUs / 1000.0);
+    FlightRecorder::record(FlightRecorder::StateChanged, connectionStateName(state), int(state), elapsedUs);
+    TRACE_INSTANT("sink", connectionStateName(state));
+    if (isConnecting(previous) && !isConnecting(state))
+        TRACE_ASYNC_END("sink", "connect", this);
+
+    if (state == ConnectionState::Streaming)
+        LOG_INFO("Time to audio: %1 ms", elapsedUs / 1000);
+
+    // A release goes through Closing; straight from Streaming to Idle means the phone or Windows
+    // dropped the stream
+    if (previous == ConnectionState::Streaming && state == ConnectionState::Idle)
+        FlightRecorder::dump("stream lost");
+
+    emit connectionStateChanged(state);
+}
 
-        default:
-            stateStr = "Unknown";
-            break;
-        }
+const ConnectionStats &BluetoothA2DPSink::connectionStats() const
+{
+    return m_connectStats;
+}
 
-        qDebug() << "Connection state changed:" << stateStr;
-        emit stateChanged(stateStr);
+ConnectionStats &BluetoothA2DPSink::connectionStats()
+{
+    return m_connectStats;
+}
 
-    }, Qt::QueuedConnection);
+void BluetoothA2DPSink::finishConnectTiming()
+{
+    if (m_connectStats.finish())
+        emit connectTimeMeasured(m_currentDeviceId, m_connectStats.lastConnectMs(m_currentDeviceId));
 }
-#endif
 
 bool BluetoothA2DPSink::openConnection()
 {
-#ifdef Q_OS_WIN
-    if (!m_winrtInitialized) {
-        emit connectionError("WinRT not initialized");
-        return false;
-    }
+    TRACE_SCOPE("sink", "openConnection");
+    if (m_connectionState == ConnectionState::Enabled)
+        setConnectionState(ConnectionState::Opening);
 
-    if (!m_connection) {
-        emit connectionError("Sink not enabled - call enableSink() first");
+    if (!m_backend->openConnection()) {
+        if (m_connectionState == ConnectionState::Opening)
+            setConnectionState(ConnectionState::Failed);
         return false;
     }
-
-    qDebug() << "Requesting to open connection...";
-
-    // Start async operation
-    openConnectionAsync();
-
     return true;
-#else
-    emit connectionError("A2DP Sink only supported on Windows 10 2004+");
-    return false;
-#endif
 }
 
 void BluetoothA2DPSink::releaseConnection()
 {
-#ifdef Q_OS_WIN
-    if (m_connection) {
-        try {
-            qDebug() << "Releasing A2DP connection...";
-
-            // Unregister state changed event
-            if (m_stateChangedToken.value != 0) {
-                m_connection.StateChanged(m_stateChangedToken);
-                m_stateChangedToken = {};
-            }
-
-            // Close if open
-            if (m_connection.State() == AudioPlaybackConnectionState::Opened) {
-                m_connection.Close();
-            }
+    TRACE_SCOPE("sink", "releaseConnection");
+    m_openWhenEnabled = false;
+    if (m_connectionState != ConnectionState::Idle)
+        setConnectionState(ConnectionState::Closing);
 
-            m_connection = nullptr;
-            m_isStreaming = false;
+    m_backend->releaseConnection();
 
-            emit connectionClosed();
-            emit stateChanged("Disconnected");
-
-            qDebug() << "Connection released successfully";
-        }
-        catch (const winrt::hresult_error &ex) {
-            qWarning() << "Error releasing connection:"
-                       << QString::fromWCharArray(ex.message().c_str());
-        }
-    }
-#endif
+    // Backends with nothing open do not report a close
+    if (m_connectionState == ConnectionState::Closing)
+        setConnectionState(ConnectionState::Idle);
 }
 
 bool BluetoothA2DPSink::isStreaming() const
 {
-    return m_isStreaming;
+    return m_backend->isStreaming();
 }
 
-// Media control functions using SendInput
 void BluetoothA2DPSink::sendPlayPause()
 {
-#ifdef Q_OS_WIN
-    sendMediaKey(VK_MEDIA_PLAY_PAUSE);
-    qDebug() << "Sent Play/Pause command";
-#endif
+    FlightRecorder::record(FlightRecorder::MediaKey, "Play/Pause");
+    m_backend->sendPlayPause();
 }
 
 void BluetoothA2DPSink::sendNext()
 {
-#ifdef Q_OS_WIN
-    sendMediaKey(VK_MEDIA_NEXT_TRACK);
-    qDebug() << "Sent Next Track command";
-#endif
+    FlightRecorder::record(FlightRecorder::MediaKey, "Next");
+    m_backend->sendNext();
 }
 
 void BluetoothA2DPSink::sendPrevious()
 {
-#ifdef Q_OS_WIN
-    sendMediaKey(VK_MEDIA_PREV_TRACK);
-    qDebug() << "Sent Previous Track command";
-#endif
+    FlightRecorder::record(FlightRecorder::MediaKey, "Previous");
+    m_backend->sendPrevious();
 }
 
 void BluetoothA2DPSink::sendStop()
 {
-#ifdef Q_OS_WIN
-    sendMediaKey(VK_MEDIA_STOP);
-    qDebug() << "Sent Stop command";
-#endif
-}
-
-#ifdef Q_OS_WIN
-void BluetoothA2DPSink::sendMediaKey(DWORD vkCode)
-{
-    INPUT inputs[2] = {};
-
-    // Key down
-    inputs[0].type = INPUT_KEYBOARD;
-    inputs[0].ki.wVk = vkCode;
-
-    // Key up
-    inputs[1].type = INPUT_KEYBOARD;
-    inputs[1].ki.wVk = vkCode;
-    inputs[1].ki.dwFlags = KEYEVENTF_KEYUP;
-
-    UINT sent = SendInput(2, inputs, sizeof(INPUT));
-
-    if (sent != 2) {
-        qWarning() << "Failed to send media key:" << vkCode
-                   << "Error:" << GetLastError();
-    }
+    FlightRecorder::record(FlightRecorder::MediaKey, "Stop");
+    m_backend->sendStop();
 }
-#endif
@@ -1,31 +1,63 @@
 #ifndef BLUETOOTHA2DPSINK_H
 #define BLUETOOTHA2DPSINK_H
 
+#include "a2dpmediapipeline.h"
+#include "a2dpsinkbackend.h"
+#include "audiorenderer.h"
+#include "connectionstats.h"
+
 #include <QObject>
+#include <QList>
 #include <QString>
+#include <QElapsedTimer>
+#include <QTimer>
 #include <QDebug>
 
-#ifdef Q_OS_WIN
-    #include <windows.h>
-    #include <wrl/client.h>
-    #include <winrt/Windows.Foundation.h>
-    #include <winrt/Windows.Media.Audio.h>
-    #include <winrt/Windows.Devices.Enumeration.h>
-
-    namespace winrt {
-        using namespace Windows::Foundation;
-        using namespace Windows::Media::Audio;
-        using namespace Windows::Devices::Enumeration;
-    }
-#endif
-
 class BluetoothA2DPSink : public QObject
 {
     Q_OBJECT
 public:
+    // Connection lifecycle. Transitions are driven by calls on this object and by the backend's
+    // completion signals, never by timers.
+    enum class ConnectionState {
+        Idle,
+        Enabling,       // enableSink() issued, waiting for sinkEnabled
+        Enabled,
+        Opening,        // openConnection() issued, waiting for connectionOpened
+        Streaming,
+        Closing,        // releaseConnection() issued, waiting for connectionClosed
+        Failed          // enable or open reported an error; the next enableSink() starts over
+    };
+    Q_ENUM(ConnectionState)
+
+    struct StateTransition {
+        ConnectionState state;
+        qint64 elapsedUs;       // since the connection attempt started
+    };
+
+    // Uses the backend picked by createDefaultBackend()
     explicit BluetoothA2DPSink(QObject *parent = nullptr);
+
+    // Uses the given backend and takes ownership of it
+    explicit BluetoothA2DPSink(A2DPSinkBackend *backend, QObject *parent = nullptr);
     ~BluetoothA2DPSink() override;
 
+    // WinRT AudioPlaybackConnection, or the phone simulator when PHONEAUDIOLINK_SIMULATOR is set
+    static A2DPSinkBackend *createDefaultBackend();
+
+    // Backend of the current (or last) connection
+    A2DPSinkBackend *backend() const;
+
+    // Adds a backend for the device IDs it claims (see A2DPSinkBackend::handlesDeviceId) next to
+    // the primary one and takes ownership of it. Discovery runs on all backends.
+    void addBackend(A2DPSinkBackend *backend);
+
+    // In-process media path fed by backends that expose the raw stream
+    A2DPMediaPipeline *mediaPipeline();
+
+    // Plays the decoded stream on a realtime thread while connected
+    AudioRenderer *renderer() const;
+
     // Start discovering A2DP-capable devices
     void startDeviceDiscovery();
 
@@ -35,6 +67,23 @@ public:
     // Enable A2DP sink for a specific device
     bool enableSink(const QString &deviceId);
 
+    // Enables the sink and opens the connection as soon as the enable completes
+    bool connectDevice(const QString &deviceId);
+
+    // Device of the current (or last) connection attempt
+    QString currentDeviceId() const;
+
+    ConnectionState connectionState() const;
+
+    // Transitions of the current (or last) connection attempt, starting with Enabling
+    const QList<StateTransition> &connectionTransitions() const;
+
+    static const char *connectionStateName(ConnectionState state);
+
+    // Per-device connect latency, kept in connectstats.json next to init.json
+    const ConnectionStats &connectionStats() const;
+    ConnectionStats &connectionStats();
+
     // Open the audio connection (starts audio streaming)
     bool openConnection();
 
@@ -51,37 +100,44 @@ public:
     void sendStop();
 
 signals:
-    void deviceDiscovered(const QString &deviceId, const QString &deviceName);
+    void devicesDiscovered(const QList<A2DPDevice> &devices);
     void discoveryCompleted();
     void sinkEnabled();
     void connectionOpened();
     void connectionClosed();
     void connectionError(const QString &error);
     void stateChanged(const QString &state);
+    void connectionStateChanged(BluetoothA2DPSink::ConnectionState state);
+
+    // A connect reached audio; ms is the time from enableSink()
+    void connectTimeMeasured(const QString &deviceId, qint64 ms);
+
+    // In-process media path loss counters since the connection opened, emitted at most once
+    // a second and only when they change
+    void packetLossUpdated(quint64 packetsLost, quint64 framesConcealed);
 
 private:
-    void initializeWinRT();
-    void cleanupWinRT();
-
-#ifdef Q_OS_WIN
-    winrt::fire_and_forget enableSinkAsync(std::wstring deviceId);
-    winrt::fire_and_forget openConnectionAsync();
-    void onConnectionStateChanged(winrt::AudioPlaybackConnection sender, winrt::IInspectable args);
-    void sendMediaKey(DWORD vkCode);
-    void onDeviceAdded(winrt::DeviceWatcher sender, winrt::DeviceInformation device);
-    void onDeviceEnumerationCompleted(winrt::DeviceWatcher sender, winrt::IInspectable args);
-
-    winrt::AudioPlaybackConnection m_connection{nullptr};
-    winrt::DeviceWatcher m_deviceWatcher{nullptr};
-    winrt::event_token m_stateChangedToken;
-    winrt::event_token m_deviceAddedToken;
-    winrt::event_token m_enumerationCompletedToken;
-#endif
-
-    bool m_winrtInitialized;
-    bool m_ownsApartment;
-    bool m_isStreaming;
+    void attachBackend(A2DPSinkBackend *backend);
+    A2DPSinkBackend *backendFor(const QString &deviceId) const;
+    void setConnectionState(ConnectionState state);
+    void reportMediaStatistics();
+    void finishConnectTiming();
+
+    A2DPMediaPipeline m_mediaPipeline;
+    QList<A2DPSinkBackend*> m_backends;     // primary first
+    A2DPSinkBackend *m_backend;
+    AudioRenderer *m_renderer;
+    QTimer *m_statisticsTimer;
+    A2DPMediaPipeline::Statistics m_statisticsBase;
+    quint64 m_reportedPacketsLost;
+    quint64 m_reportedFramesConcealed;
     QString m_currentDeviceId;
+
+    ConnectionState m_connectionState;
+    bool m_openWhenEnabled;
+    QElapsedTimer m_attemptTimer;
+    QList<StateTransition> m_transitions;
+    ConnectionStats m_connectStats;
 };
 
 #endif // BLUETOOTHA2DPSINK_H
@@ -0,0 +1,268 @@
+#include "btsnoopcapture.h"
+#include "jitterbuffer.h"
+#include "mediapacket.h"
+
+#include <QHash>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+constexpr char Magic[8] = { 'b', 't', 's', 'n', 'o', 'o', 'p', '\0' };
+constexpr size_t FileHeaderSize = 16;
+constexpr size_t RecordHeaderSize = 24;
+
+// Datalink types: un-encapsulated HCI (no packet type byte) and HCI UART/H4
+constexpr uint32_t DatalinkH1 = 1001;
+constexpr uint32_t DatalinkH4 = 1002;
+
+constexpr uint8_t H4AclPacket = 0x02;
+constexpr uint32_t FlagReceived = 0x01;
+constexpr uint32_t FlagCommandOrEvent = 0x02;
+
+constexpr size_t AclHeaderSize = 4;
+constexpr size_t L2capHeaderSize = 4;
+constexpr uint16_t FirstDynamicChannel = 0x0040;
+
+// A channel counts as media if nearly all of its frames parse as A2DP SBC packets
+constexpr double MediaFraction = 0.9;
+
+// Longest single sleep during paced replay, so stopping stays responsive
+constexpr int64_t MaxSleepUs = 50000;
+
+uint16_t readLittleEndian16(const uint8_t *data)
+{
+    return uint16_t(data[0] | (data[1] << 8));
+}
+
+uint32_t readBigEndian32(const uint8_t *data)
+{
+    return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | data[3];
+}
+
+int64_t readBigEndian64(const uint8_t *data)
+{
+    return int64_t((uint64_t(readBigEndian32(data)) << 32) | readBigEndian32(data + 4));
+}
+
+// L2CAP frame being reassembled from ACL fragments
+struct PendingFrame
+{
+    std::vector<uint8_t> data;
+    size_t expected = 0;
+    int64_t timestampUs = 0;
+};
+
+// Every dynamic channel seen, before deciding which ones carry media
+struct Channel
+{
+    BtsnoopCapture::Stream stream;
+    std::vector<BtsnoopCapture::Packet> packets;
+    size_t mediaPackets = 0;
+};
+
+} // namespace
+
+BtsnoopCapture::~BtsnoopCapture()
+{
+    close();
+}
+
+bool BtsnoopCapture::open(const QString &path)
+{
+    close();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return fail(m_file.errorString());
+
+    const qint64 size = m_file.size();
+    m_map = size > 0 ? m_file.map(0, size) : nullptr;
+    if (!m_map)
+        return fail("Cannot map " + path);
+
+    if (size_t(size) < FileHeaderSize || std::memcmp(m_map, Magic, sizeof(Magic)) != 0)
+        return fail("Not a btsnoop file: " + path);
+    const uint32_t datalink = readBigEndian32(m_map + 12);
+    if (readBigEndian32(m_map + 8) != 1 || (datalink != DatalinkH1 && datalink != DatalinkH4))
+        return fail(QString("Unsupported btsnoop version or datalink %1").arg(datalink));
+
+    QHash<quint32, PendingFrame> pending;
+    QHash<quint32, int> channelIndex;
+    std::vector<Channel> channels;
+    int64_t firstTimestampUs = 0;
+    bool haveFirst = false;
+
+    // Hands a complete L2CAP frame (basic header included) to its channel
+    auto addFrame = [&](quint16 handle, bool received, const uint8_t *frame, size_t length, int64_t timestampUs) {
+        const uint16_t channelId = readLittleEndian16(frame + 2);
+        if (channelId < FirstDynamicChannel)
+            return;
+
+        const quint32 key = (quint32(handle) << 17) | (quint32(received) << 16) | channelId;
+        auto found = channelIndex.constFind(key);
+        if (found == channelIndex.constEnd()) {
+            found = channelIndex.insert(key, int(channels.size()));
+            Channel channel;
+            channel.stream.handle = handle;
+            channel.stream.channelId = channelId;
+            channel.stream.received = received;
+            channels.push_back(std::move(channel));
+        }
+
+        Channel &channel = channels[size_t(*found)];
+        const Packet packet{ timestampUs, frame + L2capHeaderSize, uint32_t(length - L2capHeaderSize) };
+        MediaPacket media;
+        if (media.parse({ packet.data, packet.size }, false) == MediaPacket::Status::Ok) {
+            if (channel.mediaPackets++ == 0)
+                channel.stream.sampleRate = media.frames().front().header.sampleRate;
+        }
+        channel.stream.bytes += packet.size;
+        channel.packets.push_back(packet);
+    };
+
+    size_t offset = FileHeaderSize;
+    while (offset + RecordHeaderSize <= size_t(size)) {
+        const uint8_t *record = m_map + offset;
+        const uint32_t originalLength = readBigEndian32(record);
+        const uint32_t includedLength = readBigEndian32(record + 4);
+        const uint32_t flags = readBigEndian32(record + 8);
+        const int64_t timestampUs = readBigEndian64(record + 16);
+        offset += RecordHeaderSize;
+        if (includedLength > size_t(size) - offset)
+            break;
+
+        const uint8_t *data = m_map + offset;
+        size_t length = includedLength;
+        offset += includedLength;
+
+        if (!haveFirst) {
+            firstTimestampUs = timestampUs;
+            haveFirst = true;
+        }
+
+        // ACL data only
+        if (flags & FlagCommandOrEvent)
+            continue;
+        if (datalink == DatalinkH4) {
+            if (length < 1 || data[0] != H4AclPacket)
+                continue;
+            data++;
+            length--;
+        }
+        if (includedLength < originalLength || length < AclHeaderSize) {
+            m_recordsSkipped++;
+            continue;
+        }
+
+        const uint16_t handleFlags = readLittleEndian16(data);
+        const quint16 handle = handleFlags & 0x0fff;
+        const bool continuation = ((handleFlags >> 12) & 0x03) == 0x01;
+        const bool received = flags & FlagReceived;
+        const size_t aclLength = std::min<size_t>(readLittleEndian16(data + 2), length - AclHeaderSize);
+        const uint8_t *payload = data + AclHeaderSize;
+        const int64_t relativeUs = timestampUs - firstTimestampUs;
+        const quint32 pendingKey = (quint32(handle) << 1) | quint32(received);
+
+        if (continuation) {
+            auto it = pending.find(pendingKey);
+            if (it == pending.end()) {
+                m_recordsSkipped++;
+                continue;
+            }
+            it->data.insert(it->data.end(), payload, payload + aclLength);
+            if (it->data.size() >= it->expected) {
+                m_reassembled.push_back(std::move(it->data));
+                const std::vector<uint8_t> &frame = m_reassembled.back();
+                addFrame(handle, received, frame.data(), it->expected, it->timestampUs);
+                pending.erase(it);
+            }
+            continue;
+        }
+
+        // Start of an L2CAP frame; a previous incomplete one on this link is lost
+        if (pending.remove(pendingKey))
+            m_recordsSkipped++;
+        if (aclLength < L2capHeaderSize) {
+            m_recordsSkipped++;
+            continue;
+        }
+        const size_t frameLength = L2capHeaderSize + readLittleEndian16(payload);
+        if (aclLength >= frameLength) {
+            addFrame(handle, received, payload, frameLength, relativeUs);
+        }
+        else {
+            PendingFrame &frame = pending[pendingKey];
+            frame.data.reserve(frameLength);
+            frame.data.assign(payload, payload + aclLength);
+            frame.expected = frameLength;
+            frame.timestampUs = relativeUs;
+        }
+    }
+
+    for (Channel &channel : channels) {
+        if (channel.mediaPackets == 0 || channel.mediaPackets < MediaFraction * channel.packets.size())
+            continue;
+        m_streams.append(channel.stream);
+        m_packets.push_back(std::move(channel.packets));
+    }
+
+    if (m_streams.isEmpty())
+        return fail("No A2DP media stream in " + path);
+    return true;
+}
+
+void BtsnoopCapture::close()
+{
+    m_streams.clear();
+    m_packets.clear();
+    m_reassembled.clear();
+    m_recordsSkipped = 0;
+    m_error.clear();
+    if (m_map) {
+        m_file.unmap(const_cast<uint8_t *>(m_map));
+        m_map = nullptr;
+    }
+    m_file.close();
+}
+
+bool BtsnoopCapture::fail(const QString &error)
+{
+    close();
+    m_error = error;
+    return false;
+}
+
+quint64 BtsnoopCapture::replay(int stream, A2DPMediaSink *sink, Pacing pacing, const std::atomic<bool> &running) const
+{
+    if (stream < 0 || stream >= m_streams.size() || !sink)
+        return 0;
+
+    const std::vector<Packet> &streamPackets = m_packets[size_t(stream)];
+    if (streamPackets.empty())
+        return 0;
+
+    const int64_t startUs = JitterBuffer::steadyMicros();
+    const int64_t firstPacketUs = streamPackets.front().timestampUs;
+    quint64 delivered = 0;
+    for (const Packet &packet : streamPackets) {
+        if (pacing == Pacing::Original) {
+            const int64_t dueUs = startUs + (packet.timestampUs - firstPacketUs);
+            for (int64_t waitUs = dueUs - JitterBuffer::steadyMicros(); waitUs > 0;
+                 waitUs = dueUs - JitterBuffer::steadyMicros()) {
+                if (!running.load(std::memory_order_acquire))
+                    return delivered;
+                std::this_thread::sleep_for(std::chrono::microseconds(std::min(waitUs, MaxSleepUs)));
+            }
+        }
+        if (!running.load(std::memory_order_acquire))
+            break;
+
+        sink->mediaPacketReceived(packet.data, packet.size, JitterBuffer::steadyMicros());
+        delivered++;
+    }
+    return delivered;
+}
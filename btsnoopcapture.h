@@ -0,0 +1,80 @@
+#ifndef BTSNOOPCAPTURE_H
+#define BTSNOOPCAPTURE_H
+
+#include "a2dpsinkbackend.h"
+
+#include <QFile>
+#include <QList>
+#include <QString>
+
+#include <cstdint>
+#include <atomic>
+#include <deque>
+#include <vector>
+
+// A btsnoop HCI capture (as written by Android's "Bluetooth HCI snoop log") opened for replay.
+//
+// The file is memory-mapped and walked once: ACL data is reassembled into L2CAP frames per
+// connection handle and direction, and every dynamic L2CAP channel whose frames parse as A2DP SBC
+// media packets becomes a stream. Packets that arrived in a single ACL fragment point straight
+// into the mapping; only fragmented ones are copied. Replay then hands the packets to an
+// A2DPMediaSink with their original spacing or as fast as possible.
+class BtsnoopCapture
+{
+public:
+    struct Stream {
+        quint16 handle = 0;         // ACL connection handle
+        quint16 channelId = 0;      // L2CAP destination CID
+        bool received = false;      // controller to host (the capturing device was the sink)
+        int sampleRate = 0;         // from the first SBC frame
+        quint64 bytes = 0;
+    };
+
+    struct Packet {
+        int64_t timestampUs;        // since the first record of the capture
+        const uint8_t *data;
+        uint32_t size;
+    };
+
+    enum class Pacing {
+        Original,           // sleep to reproduce the captured inter-packet timing
+        AsFastAsPossible
+    };
+
+    BtsnoopCapture() = default;
+    ~BtsnoopCapture();
+
+    BtsnoopCapture(const BtsnoopCapture &) = delete;
+    BtsnoopCapture &operator=(const BtsnoopCapture &) = delete;
+
+    // Maps and indexes the file. On failure errorString() says why.
+    bool open(const QString &path);
+    void close();
+
+    QString fileName() const { return m_file.fileName(); }
+    QString errorString() const { return m_error; }
+
+    // Media streams found, in order of their first packet
+    const QList<Stream> &streams() const { return m_streams; }
+    const std::vector<Packet> &packets(int stream) const { return m_packets.at(size_t(stream)); }
+
+    // Records that could not be used (truncated by the capture, or broken ACL reassembly)
+    quint64 recordsSkipped() const { return m_recordsSkipped; }
+
+    // Feeds one stream to sink on the calling thread until it ends or running turns false.
+    // arrivalUs is the steady clock at delivery. Returns the number of packets delivered.
+    quint64 replay(int stream, A2DPMediaSink *sink, Pacing pacing, const std::atomic<bool> &running) const;
+
+private:
+    bool fail(const QString &error);
+
+    QFile m_file;
+    const uint8_t *m_map = nullptr;
+    QString m_error;
+    QList<Stream> m_streams;
+    std::vector<std::vector<Packet>> m_packets;
+    std::deque<std::vector<uint8_t>> m_reassembled;     // stable storage for fragmented frames
+    quint64 m_recordsSkipped = 0;
+};
+
+#endif // BTSNOOPCAPTURE_H
@@ -0,0 +1,204 @@
+#include "btsnoopreplaybackend.h"
+#include "binarylog.h"
+#include "jitterbuffer.h"
+
+#include <QFileInfo>
+#include <QTimer>
+#include <QDebug>
+
+BtsnoopReplayBackend::BtsnoopReplayBackend(const QStringList &files, QObject *parent)
+    : A2DPSinkBackend(parent)
+    , m_files(files)
+    , m_captures(size_t(files.size()))
+    , m_current(nullptr)
+    , m_currentStream(-1)
+    , m_enabled(false)
+    , m_replayThread(nullptr)
+    , m_replayGeneration(0)
+{
+    qDebug() << "Initializing btsnoop replay backend with" << m_files.size() << "capture(s)";
+}
+
+BtsnoopReplayBackend::~BtsnoopReplayBackend()
+{
+    stopReplay();
+}
+
+bool BtsnoopReplayBackend::handlesDeviceId(const QString &deviceId) const
+{
+    return deviceId.startsWith(QLatin1String(DeviceIdPrefix));
+}
+
+BtsnoopCapture *BtsnoopReplayBackend::capture(const QString &file, bool reportErrors)
+{
+    const int index = m_files.indexOf(file);
+    if (index < 0)
+        return nullptr;
+
+    std::unique_ptr<BtsnoopCapture> &capture = m_captures[size_t(index)];
+    if (!capture) {
+        capture = std::make_unique<BtsnoopCapture>();
+        if (!capture->open(file)) {
+            qWarning() << "btsnoop replay:" << capture->errorString();
+            if (reportErrors)
+                emit connectionError(capture->errorString());
+            capture.reset();
+            return nullptr;
+        }
+        qDebug() << "btsnoop replay:" << file << "has" << capture->streams().size() << "media stream(s),"
+                 << capture->recordsSkipped() << "records skipped";
+    }
+    return capture.get();
+}
+
+void BtsnoopReplayBackend::startDeviceDiscovery()
+{
+    // Asynchronous like the other backends, so callers can reset their device lists first
+    QTimer::singleShot(0, this, [this]() {
+        QList<A2DPDevice> devices;
+        for (const QString &file : std::as_const(m_files)) {
+            BtsnoopCapture *replay = capture(file, false);
+            if (!replay)
+                continue;
+            for (int i = 0; i < replay->streams().size(); i++) {
+                const BtsnoopCapture::Stream &stream = replay->streams().at(i);
+                devices.append({ QLatin1String(DeviceIdPrefix) + file + '#' + QString::number(i),
+                                 QString("Replay %1 #%2 (%3 Hz, %4 packets)")
+                                     .arg(QFileInfo(file).fileName())
+                                     .arg(i + 1)
+                                     .arg(stream.sampleRate)
+                                     .arg(replay->packets(i).size()) });
+            }
+        }
+        if (!devices.isEmpty())
+            emit devicesDiscovered(devices);
+        emit discoveryCompleted();
+    });
+}
+
+void BtsnoopReplayBackend::stopDeviceDiscovery()
+{
+}
+
+bool BtsnoopReplayBackend::enableSink(const QString &deviceId)
+{
+    if (!handlesDeviceId(deviceId)) {
+        emit connectionError("Unknown replay device: " + deviceId);
+        return false;
+    }
+
+    const QString location = deviceId.mid(int(qstrlen(DeviceIdPrefix)));
+    const QString file = location.section('#', 0, -2);
+    bool ok = false;
+    const int stream = location.section('#', -1).toInt(&ok);
+    BtsnoopCapture *replay = capture(file, true);
+    if (!replay)
+        return false;
+    if (!ok || stream < 0 || stream >= replay->streams().size()) {
+        emit connectionError("No such stream in capture: " + deviceId);
+        return false;
+    }
+
+    releaseConnection();
+
+    m_current = replay;
+    m_currentStream = stream;
+    m_enabled = true;
+    emit connectMilestone(ConnectMilestone::ConnectionCreated, JitterBuffer::steadyMicros());
+    QTimer::singleShot(0, this, [this]() {
+        if (!m_enabled)
+            return;
+        emit connectMilestone(ConnectMilestone::SinkStarted, JitterBuffer::steadyMicros());
+        emit sinkEnabled();
+        emit stateChanged("Sink Enabled - Ready to Connect");
+    });
+    return true;
+}
+
+bool BtsnoopReplayBackend::openConnection()
+{
+    if (!m_enabled || !m_current) {
+        emit connectionError("Sink not enabled - call enableSink() first");
+        return false;
+    }
+    if (m_replayThread)
+        return true;
+
+    // Capture order, captured timing; the pipeline behind the sink does the rest
+    const int generation = ++m_replayGeneration;
+    BtsnoopCapture *replay = m_current;
+    const int stream = m_currentStream;
+    m_replayRunning.store(true, std::memory_order_release);
+    m_replayThread = QThread::create([this, replay, stream, generation]() {
+        const quint64 delivered = replay->replay(stream, m_mediaSink.load(std::memory_order_acquire),
+                                                 BtsnoopCapture::Pacing::Original, m_replayRunning);
+
+        // End of capture looks like the phone closing the link
+        QMetaObject::invokeMethod(this, [this, generation, delivered]() {
+            if (generation != m_replayGeneration || !m_replayRunning.load(std::memory_order_acquire))
+                return;
+            qDebug() << "btsnoop replay finished after" << delivered << "packets";
+            stopReplay();
+            m_enabled = false;
+            emit connectionClosed();
+            emit stateChanged("Closed");
+        }, Qt::QueuedConnection);
+    });
+    m_replayThread->setObjectName("BtsnoopReplay");
+    m_replayThread->start(QThread::HighPriority);
+
+    const qint64 openedUs = JitterBuffer::steadyMicros();
+    emit connectMilestone(ConnectMilestone::ConnectionOpened, openedUs);
+    emit connectMilestone(ConnectMilestone::StreamOpened, openedUs);
+    emit connectionOpened();
+    emit stateChanged("Connected - Replaying Capture");
+    return true;
+}
+
+void BtsnoopReplayBackend::releaseConnection()
+{
+    if (!m_enabled && !m_replayThread)
+        return;
+
+    stopReplay();
+    m_enabled = false;
+
+    emit connectionClosed();
+    emit stateChanged("Disconnected");
+}
+
+bool BtsnoopReplayBackend::isStreaming() const
+{
+    return m_replayThread != nullptr;
+}
+
+void BtsnoopReplayBackend::sendPlayPause()
+{
+    LOG_DEBUG("btsnoop replay ignores Play/Pause");
+}
+
+void BtsnoopReplayBackend::sendNext()
+{
+    LOG_DEBUG("btsnoop replay ignores Next Track");
+}
+
+void BtsnoopReplayBackend::sendPrevious()
+{
+    LOG_DEBUG("btsnoop replay ignores Previous Track");
+}
+
+void BtsnoopReplayBackend::sendStop()
+{
+    LOG_DEBUG("btsnoop replay ignores Stop");
+}
+
+void BtsnoopReplayBackend::stopReplay()
+{
+    if (!m_replayThread)
+        return;
+
+    m_replayRunning.store(false, std::memory_order_release);
+    m_replayThread->wait();
+    delete m_replayThread;
+    m_replayThread = nullptr;
+}
@@ -0,0 +1,64 @@
+#ifndef BTSNOOPREPLAYBACKEND_H
+#define BTSNOOPREPLAYBACKEND_H
+
+#include "a2dpsinkbackend.h"
+#include "btsnoopcapture.h"
+
+#include <QStringList>
+#include <QThread>
+#include <QString>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Replays A2DP media streams from btsnoop captures taken on problem phones. Each media stream
+// in each capture is offered as a device; connecting plays it through the in-process media path
+// with the captured packet timing, so field timing bugs reproduce deterministically. The
+// connection closes by itself when the capture ends.
+class BtsnoopReplayBackend : public A2DPSinkBackend
+{
+    Q_OBJECT
+public:
+    explicit BtsnoopReplayBackend(const QStringList &files, QObject *parent = nullptr);
+    ~BtsnoopReplayBackend() override;
+
+    // Device IDs are "btsnoop:<file>#<stream index>"
+    static constexpr const char *DeviceIdPrefix = "btsnoop:";
+
+    // Capture files to offer, separated by the platform's path list separator
+    static constexpr const char *EnvironmentVariable = "PHONEAUDIOLINK_BTSNOOP";
+
+    QString name() const override { return "btsnoop replay"; }
+    bool handlesDeviceId(const QString &deviceId) const override;
+    bool providesMediaStream() const override { return true; }
+
+    void startDeviceDiscovery() override;
+    void stopDeviceDiscovery() override;
+    bool enableSink(const QString &deviceId) override;
+    bool openConnection() override;
+    void releaseConnection() override;
+    bool isStreaming() const override;
+
+    void sendPlayPause() override;
+    void sendNext() override;
+    void sendPrevious() override;
+    void sendStop() override;
+
+private:
+    // Capture for a file, opened on first use; nullptr (with a connectionError) if unusable
+    BtsnoopCapture *capture(const QString &file, bool reportErrors);
+    void stopReplay();
+
+    QStringList m_files;
+    std::vector<std::unique_ptr<BtsnoopCapture>> m_captures;
+    BtsnoopCapture *m_current;
+    int m_currentStream;
+    bool m_enabled;
+
+    QThread *m_replayThread;
+    int m_replayGeneration;     // tells a finished replay from one that was restarted since
+    std::atomic<bool> m_replayRunning{false};
+};
+
+#endif // BTSNOOPREPLAYBACKEND_H
@@ -0,0 +1,79 @@
+#include "configstore.h"
+#include "asyncfilewriter.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QDebug>
+
+ConfigStore::ConfigStore(const QString &path, AsyncFileWriter *writer, QObject *parent)
+    : QObject(parent)
+    , m_path(path)
+    , m_writer(writer)
+{
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SaveDelayMs);
+    connect(&m_saveTimer, &QTimer::timeout, this, &ConfigStore::save);
+}
+
+bool ConfigStore::load(QString *error)
+{
+    m_values = QJsonObject();
+
+    QFile file(m_path);
+    if (!file.exists())
+        return true;
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject()) {
+        if (error)
+            *error = parseError.error != QJsonParseError::NoError ? parseError.errorString() : "not a JSON object";
+        return false;
+    }
+
+    m_values = document.object();
+    const int version = m_values.value("version").toInt(0);
+    if (version < SchemaVersion) {
+        migrate(m_values, version);
+        m_saveTimer.start();    // write the migrated file back
+    }
+    else if (version > SchemaVersion) {
+        qWarning() << m_path << "has schema version" << version << "- newer than this build's" << SchemaVersion;
+    }
+    return true;
+}
+
+void ConfigStore::setValue(const QString &key, const QJsonValue &value)
+{
+    if (m_values.value(key) == value)
+        return;
+    m_values.insert(key, value);
+    m_saveTimer.start();
+}
+
+void ConfigStore::save()
+{
+    m_saveTimer.stop();
+    QJsonObject values = m_values;
+    values["version"] = SchemaVersion;
+    m_writer->write(m_path, QJsonDocument(values).toJson());
+}
+
+void ConfigStore::migrate(QJsonObject &values, int fromVersion)
+{
+    // Each step brings the values up one version
+    switch (fromVersion) {
+    case 0:
+        // Version 0 had the same keys, only without "version"
+        [[fallthrough]];
+    default:
+        break;
+    }
+    values["version"] = SchemaVersion;
+}
@@ -0,0 +1,54 @@
+#ifndef CONFIGSTORE_H
+#define CONFIGSTORE_H
+
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+class AsyncFileWriter;
+
+// init.json: a flat JSON object with a schema version. Changes are coalesced and written a
+// moment later through an AsyncFileWriter, never on the caller's thread. Loading is per field:
+// a missing or mistyped value falls back to the default its reader passes, and an unreadable
+// file leaves every value at its default instead of failing as a whole.
+class ConfigStore : public QObject
+{
+    Q_OBJECT
+public:
+    // Version 1 added "version" itself; files without it are version 0 and read unchanged
+    static constexpr int SchemaVersion = 1;
+
+    // Changes within this window are written together
+    static constexpr int SaveDelayMs = 500;
+
+    ConfigStore(const QString &path, AsyncFileWriter *writer, QObject *parent = nullptr);
+
+    // Reads the file (synchronously; startup needs the values). Returns false if it exists but
+    // cannot be read or parsed, with an explanation in *error; all values are defaults then.
+    bool load(QString *error = nullptr);
+
+    QJsonValue value(const QString &key) const { return m_values.value(key); }
+
+    // Schedules a save if the value changed
+    void setValue(const QString &key, const QJsonValue &value);
+
+    // Queues the current values for writing now (still off this thread)
+    void save();
+
+    // A change is waiting for the save delay to pass
+    bool hasUnsavedChanges() const { return m_saveTimer.isActive(); }
+
+    QString path() const { return m_path; }
+
+private:
+    static void migrate(QJsonObject &values, int fromVersion);
+
+    QString m_path;
+    AsyncFileWriter *m_writer;
+    QJsonObject m_values;
+    QTimer m_saveTimer;
+};
+
+#endif // CONFIGSTORE_H
@@ -0,0 +1,172 @@
+#include "connectionstats.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+
+ConnectionStats::ConnectionStats(const QString &path)
+    : m_path(path)
+    , m_dirty(false)
+    , m_timing(false)
+{
+    std::fill(std::begin(m_attemptUs), std::end(m_attemptUs), qint64(-1));
+    if (!m_path.isEmpty())
+        load();
+}
+
+void ConnectionStats::begin(const QString &deviceId, qint64 steadyUs)
+{
+    finish();
+
+    std::fill(std::begin(m_attemptUs), std::end(m_attemptUs), qint64(-1));
+    m_attemptDevice = deviceId;
+    m_attemptUs[int(ConnectMilestone::EnableCalled)] = steadyUs;
+    m_timing = true;
+}
+
+bool ConnectionStats::mark(ConnectMilestone milestone, qint64 steadyUs)
+{
+    const int index = int(milestone);
+    if (!m_timing || index < 0 || index >= MilestoneCount)
+        return false;
+
+    // First report of a step counts; StateChanged can repeat Opened
+    if (m_attemptUs[index] < 0)
+        m_attemptUs[index] = steadyUs;
+
+    return milestone == ConnectMilestone::StreamOpened && finish();
+}
+
+bool ConnectionStats::finish()
+{
+    if (!m_timing)
+        return false;
+    m_timing = false;
+
+    const qint64 startUs = m_attemptUs[int(ConnectMilestone::EnableCalled)];
+    qint64 audioUs = m_attemptUs[int(ConnectMilestone::StreamOpened)];
+    if (audioUs < 0)
+        audioUs = m_attemptUs[int(ConnectMilestone::ConnectionOpened)];
+    if (audioUs < 0)
+        return false;
+
+    DeviceHistory &history = m_devices[m_attemptDevice];
+    for (int i = 0; i < MilestoneCount; i++) {
+        if (m_attemptUs[i] < 0)
+            continue;
+        QList<qint64> &samples = history.samplesMs[i];
+        samples.append((m_attemptUs[i] - startUs) / 1000);
+        if (samples.size() > MaxSamples)
+            samples.removeFirst();
+    }
+    history.lastConnectMs = (audioUs - startUs) / 1000;
+    m_lastDevice = m_attemptDevice;
+
+    const Percentiles total = percentiles(m_attemptDevice, ConnectMilestone::StreamOpened);
+    qDebug() << "Connect to" << m_attemptDevice << "took" << history.lastConnectMs << "ms"
+             << QString("(p50 %1 / p95 %2 / p99 %3 ms over %4 connects)")
+                    .arg(total.p50Ms).arg(total.p95Ms).arg(total.p99Ms).arg(total.samples);
+
+    m_dirty = true;
+    return true;
+}
+
+qint64 ConnectionStats::lastConnectMs(const QString &deviceId) const
+{
+    const auto it = m_devices.constFind(deviceId.isEmpty() ? m_lastDevice : deviceId);
+    return it == m_devices.constEnd() ? -1 : it->lastConnectMs;
+}
+
+ConnectionStats::Percentiles ConnectionStats::percentiles(const QString &deviceId, ConnectMilestone milestone) const
+{
+    Percentiles result;
+    const int index = int(milestone);
+    const auto it = m_devices.constFind(deviceId);
+    if (it == m_devices.constEnd() || index < 0 || index >= MilestoneCount)
+        return result;
+
+    QList<qint64> sorted = it->samplesMs[index];
+    if (sorted.isEmpty())
+        return result;
+    std::sort(sorted.begin(), sorted.end());
+
+    // Nearest rank
+    auto rank = [&sorted](double p) {
+        const qsizetype n = qsizetype(std::ceil(p * sorted.size()));
+        return sorted.at(std::clamp<qsizetype>(n - 1, 0, sorted.size() - 1));
+    };
+    result.p50Ms = rank(0.50);
+    result.p95Ms = rank(0.95);
+    result.p99Ms = rank(0.99);
+    result.samples = int(sorted.size());
+    return result;
+}
+
+bool ConnectionStats::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    const QJsonObject devices = root["devices"].toObject();
+    m_devices.clear();
+    for (auto device = devices.constBegin(); device != devices.constEnd(); ++device) {
+        const QJsonObject entry = device.value().toObject();
+        DeviceHistory &history = m_devices[device.key()];
+        history.lastConnectMs = entry["lastConnectMs"].toInteger(-1);
+        for (int i = 0; i < MilestoneCount; i++) {
+            const QJsonArray samples = entry[milestoneName(ConnectMilestone(i))].toArray();
+            for (const QJsonValue &sample : samples)
+                history.samplesMs[i].append(sample.toInteger());
+            while (history.samplesMs[i].size() > MaxSamples)
+                history.samplesMs[i].removeFirst();
+        }
+    }
+    m_lastDevice = root["lastDevice"].toString();
+    m_dirty = false;
+    return true;
+}
+
+QByteArray ConnectionStats::takeChanges()
+{
+    if (!m_dirty || m_path.isEmpty())
+        return QByteArray();
+
+    QJsonObject devices;
+    for (auto it = m_devices.constBegin(); it != m_devices.constEnd(); ++it) {
+        QJsonObject entry;
+        entry["lastConnectMs"] = it->lastConnectMs;
+        for (int i = 0; i < MilestoneCount; i++) {
+            QJsonArray samples;
+            for (qint64 sample : it->samplesMs[i])
+                samples.append(sample);
+            entry[milestoneName(ConnectMilestone(i))] = samples;
+        }
+        devices[it.key()] = entry;
+    }
+
+    QJsonObject root;
+    root["devices"] = devices;
+    root["lastDevice"] = m_lastDevice;
+    m_dirty = false;
+    return QJsonDocument(root).toJson();
+}
+
+const char *ConnectionStats::milestoneName(ConnectMilestone milestone)
+{
+    switch (milestone) {
+    case ConnectMilestone::EnableCalled: return "enableCalled";
+    case ConnectMilestone::ConnectionCreated: return "connectionCreated";
+    case ConnectMilestone::SinkStarted: return "sinkStarted";
+    case ConnectMilestone::ConnectionOpened: return "connectionOpened";
+    case ConnectMilestone::StreamOpened: return "streamOpened";
+    case ConnectMilestone::Count: break;
+    }
+    return "unknown";
+}
@@ -0,0 +1,83 @@
+#ifndef CONNECTIONSTATS_H
+#define CONNECTIONSTATS_H
+
+#include "a2dpsinkbackend.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// Connect latency bookkeeping. One attempt at a time is timed from enableSink() through each
+// ConnectMilestone; when it reaches audio the per-milestone times are added to rolling
+// per-device histograms, which are persisted as JSON (next to init.json).
+// Writing the file is up to the owner: takeChanges() returns its contents after a recorded
+// connect, and LinkController writes them off the GUI thread.
+class ConnectionStats
+{
+public:
+    // Connects remembered per device and milestone
+    static constexpr int MaxSamples = 100;
+
+    struct Percentiles {
+        qint64 p50Ms = 0;
+        qint64 p95Ms = 0;
+        qint64 p99Ms = 0;
+        int samples = 0;
+    };
+
+    // An empty path keeps the statistics in memory only
+    explicit ConnectionStats(const QString &path = QString());
+
+    // Starts timing a connect (the EnableCalled milestone); an attempt still open is finished first
+    void begin(const QString &deviceId, qint64 steadyUs);
+
+    // Records a milestone of the current attempt. Reaching StreamOpened finishes it; returns
+    // true if that recorded the attempt.
+    bool mark(ConnectMilestone milestone, qint64 steadyUs);
+
+    // Ends the current attempt. It is recorded if the connection opened; time to
+    // audio is taken at StreamOpened, or at ConnectionOpened for backends without state events.
+    // Returns true if it was recorded.
+    bool finish();
+
+    bool isTiming() const { return m_timing; }
+
+    // Time to audio of the most recent recorded connect to deviceId (any device if empty), or -1
+    qint64 lastConnectMs(const QString &deviceId = QString()) const;
+
+    // Milliseconds from enableSink() to the milestone over the remembered connects
+    Percentiles percentiles(const QString &deviceId, ConnectMilestone milestone) const;
+
+    QStringList devices() const { return m_devices.keys(); }
+
+    bool load();
+
+    // The file contents to write if a connect was recorded since the last load or call,
+    // otherwise empty
+    QByteArray takeChanges();
+
+    QString path() const { return m_path; }
+
+    static const char *milestoneName(ConnectMilestone milestone);
+
+private:
+    static constexpr int MilestoneCount = int(ConnectMilestone::Count);
+
+    struct DeviceHistory {
+        QList<qint64> samplesMs[MilestoneCount];
+        qint64 lastConnectMs = -1;
+    };
+
+    QString m_path;
+    QHash<QString, DeviceHistory> m_devices;
+    QString m_lastDevice;
+    bool m_dirty;
+
+    bool m_timing;
+    QString m_attemptDevice;
+    qint64 m_attemptUs[MilestoneCount];
+};
+
+#endif // CONNECTIONSTATS_H
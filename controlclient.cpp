@@ -0,0 +1,108 @@
+#include "controlclient.h"
+#include "controlserver.h"
+
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QTextStream>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+QTextStream &out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+QByteArray readLine(QLocalSocket &socket, int timeoutMs)
+{
+    while (!socket.canReadLine()) {
+        if (!socket.waitForReadyRead(timeoutMs))
+            return QByteArray();
+    }
+    return socket.readLine().trimmed();
+}
+
+} // namespace
+
+namespace ControlClient {
+
+int run(const QStringList &arguments)
+{
+    const int index = arguments.indexOf("--control");
+    const QString method = arguments.value(index + 1);
+    if (method.isEmpty() || method.startsWith("--")) {
+        out() << "Usage: PhoneAudioLink --control <method> [address] [--repeat N]" << Qt::endl;
+        return 1;
+    }
+
+    QJsonObject params;
+    if (method == "connect")
+        params["address"] = arguments.value(index + 2);
+
+    const int repeatIndex = arguments.indexOf("--repeat");
+    const int repeat = repeatIndex < 0 ? 1 : std::max(1, arguments.value(repeatIndex + 1).toInt());
+
+    QLocalSocket socket;
+    socket.connectToServer(ControlServer::serverName());
+    if (!socket.waitForConnected(1000)) {
+        out() << "PhoneAudioLink is not running (" << socket.errorString() << ")" << Qt::endl;
+        return 1;
+    }
+
+    std::vector<qint64> roundTripsNs;
+    roundTripsNs.reserve(size_t(repeat));
+    QJsonObject response;
+    for (int id = 1; id <= repeat; id++) {
+        const QJsonObject request{ { "jsonrpc", "2.0" }, { "id", id }, { "method", method }, { "params", params } };
+
+        QElapsedTimer timer;
+        timer.start();
+        socket.write(QJsonDocument(request).toJson(QJsonDocument::Compact) + '\n');
+        socket.flush();
+        const QByteArray line = readLine(socket, 5000);
+        roundTripsNs.push_back(timer.nsecsElapsed());
+
+        if (line.isEmpty()) {
+            out() << "No response (" << socket.errorString() << ")" << Qt::endl;
+            return 1;
+        }
+        response = QJsonDocument::fromJson(line).object();
+        if (repeat == 1 || response.contains("error"))
+            out() << line << Qt::endl;
+        if (response.contains("error"))
+            return 1;
+    }
+
+    if (repeat > 1) {
+        std::sort(roundTripsNs.begin(), roundTripsNs.end());
+        const auto percentileUs = [&](double percentile) {
+            const size_t rank = size_t(percentile * double(roundTripsNs.size() - 1) + 0.5);
+            return roundTripsNs[rank] / 1000.0;
+        };
+        out() << QString("%1 x%2 round trip: min %3 us  p50 %4 us  p99 %5 us  max %6 us")
+                     .arg(method)
+                     .arg(repeat)
+                     .arg(percentileUs(0.0), 0, 'f', 1)
+                     .arg(percentileUs(0.5), 0, 'f', 1)
+                     .arg(percentileUs(0.99), 0, 'f', 1)
+                     .arg(percentileUs(1.0), 0, 'f', 1)
+              << Qt::endl;
+    }
+
+    // Notifications keep coming until the instance exits or the client is interrupted
+    if (method == "subscribe") {
+        while (socket.state() == QLocalSocket::ConnectedState) {
+            const QByteArray line = readLine(socket, -1);
+            if (!line.isEmpty())
+                out() << line << Qt::endl;
+        }
+    }
+    return 0;
+}
+
+} // namespace ControlClient
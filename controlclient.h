@@ -0,0 +1,21 @@
+#ifndef CONTROLCLIENT_H
+#define CONTROLCLIENT_H
+
+#include <QStringList>
+
+// Command line client of the control API (see ControlServer):
+//
+//   PhoneAudioLink --control status|listDevices|disconnect|playPause|next|previous|quit|ping
+//   PhoneAudioLink --control connect AA:BB:CC:DD:EE:FF
+//   PhoneAudioLink --control subscribe          (prints notifications until interrupted)
+//   PhoneAudioLink --control ping --repeat 1000 (round-trip latency percentiles)
+//
+// Responses are printed as JSON lines on stdout.
+namespace ControlClient {
+
+// Returns the process exit code: 0 on a result, 1 on an error response or no running instance
+int run(const QStringList &arguments);
+
+} // namespace ControlClient
+
+#endif // CONTROLCLIENT_H
@@ -0,0 +1,238 @@
+#include "controlserver.h"
+#include "linkcontroller.h"
+#include "processstats.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDebug>
+
+namespace {
+
+QJsonObject result(const QJsonValue &id, const QJsonValue &value)
+{
+    return QJsonObject{ { "jsonrpc", "2.0" }, { "id", id }, { "result", value } };
+}
+
+QJsonObject error(const QJsonValue &id, int code, const QString &message)
+{
+    return QJsonObject{ { "jsonrpc", "2.0" }, { "id", id },
+                        { "error", QJsonObject{ { "code", code }, { "message", message } } } };
+}
+
+} // namespace
+
+ControlServer::ControlServer(LinkController *link, QObject *parent)
+    : QObject(parent)
+    , m_link(link)
+    , m_server(new QLocalServer(this))
+{
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(m_server, &QLocalServer::newConnection, this, &ControlServer::acceptConnections);
+
+    if (BluetoothA2DPSink *sink = m_link->sink()) {
+        connect(sink, &BluetoothA2DPSink::stateChanged, this, [this](const QString &state) {
+            BluetoothA2DPSink *current = m_link->sink();
+            notify("stateChanged", QJsonObject{
+                { "state", state },
+                { "connectionState", current ? BluetoothA2DPSink::connectionStateName(current->connectionState()) : "Idle" } });
+        });
+        connect(sink, &BluetoothA2DPSink::connectionError, this, [this](const QString &message) {
+            notify("connectionError", QJsonObject{ { "message", message } });
+        });
+    }
+}
+
+ControlServer::~ControlServer()
+{
+    m_server->close();
+}
+
+QString ControlServer::serverName()
+{
+    QString user = qEnvironmentVariable("USERNAME");
+    if (user.isEmpty())
+        user = qEnvironmentVariable("USER");
+    return "PhoneAudioLink-control-" + user;
+}
+
+bool ControlServer::listen()
+{
+    bool listening = m_server->listen(serverName());
+    if (!listening && m_server->serverError() == QAbstractSocket::AddressInUseError) {
+        // A crashed instance can leave its socket file behind (not an issue with Windows pipes)
+        QLocalSocket probe;
+        probe.connectToServer(serverName());
+        if (!probe.waitForConnected(100)) {
+            QLocalServer::removeServer(serverName());
+            listening = m_server->listen(serverName());
+        }
+    }
+    if (!listening) {
+        qWarning() << "Control API unavailable:" << m_server->errorString();
+        return false;
+    }
+    qDebug() << "Control API listening on" << m_server->fullServerName();
+    return true;
+}
+
+void ControlServer::acceptConnections()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { readRequests(socket); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            m_subscribers.removeOne(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void ControlServer::readRequests(QLocalSocket *socket)
+{
+    // Dropped for an overlong request, only waiting for the error to go out
+    if (socket->state() != QLocalSocket::ConnectedState)
+        return;
+
+    while (socket->canReadLine()) {
+        const QByteArray line = socket->readLine().trimmed();
+        if (line.isEmpty())
+            continue;
+
+        QJsonParseError parseError;
+        const QJsonDocument document = QJsonDocument::fromJson(line, &parseError);
+        if (parseError.error != QJsonParseError::NoError) {
+            send(socket, error(QJsonValue::Null, ParseError, parseError.errorString()));
+            continue;
+        }
+        if (!document.isObject()) {
+            send(socket, error(QJsonValue::Null, InvalidRequest, "Expected a JSON-RPC request object"));
+            continue;
+        }
+
+        const QJsonObject request = document.object();
+        const QJsonObject response = handleRequest(request, socket);
+        // Requests without an id are notifications and get no response
+        if (request.contains("id"))
+            send(socket, response);
+    }
+
+    // Whatever is left has no newline yet; without a limit it would grow the buffer forever
+    if (socket->bytesAvailable() > MaxRequestBytes) {
+        qWarning() << "Control API: dropping a client whose request exceeds" << MaxRequestBytes << "bytes";
+        m_subscribers.removeOne(socket);
+        send(socket, error(QJsonValue::Null, InvalidRequest,
+                           QString("Request longer than %1 bytes").arg(MaxRequestBytes)));
+        socket->disconnectFromServer();
+    }
+}
+
+QJsonObject ControlServer::handleRequest(const QJsonObject &request, QLocalSocket *socket)
+{
+    const QJsonValue id = request.value("id");
+    const QString method = request.value("method").toString();
+    const QJsonObject params = request.value("params").toObject();
+
+    if (method.isEmpty())
+        return error(id, InvalidRequest, "Missing method");
+    if (method == "ping")
+        return result(id, "pong");
+    if (method == "status")
+        return result(id, status());
+    if (method == "listDevices")
+        return result(id, deviceList());
+    if (method == "subscribe") {
+        if (!m_subscribers.contains(socket))
+            m_subscribers.append(socket);
+        return result(id, true);
+    }
+    if (method == "show") {
+        emit showRequested();
+        return result(id, true);
+    }
+    if (method == "quit") {
+        emit quitRequested();
+        return result(id, true);
+    }
+
+    if (!m_link->sink())
+        return error(id, Unavailable, "Shutting down");
+
+    if (method == "connect") {
+        const QBluetoothAddress address(params.value("address").toString());
+        if (address.isNull())
+            return error(id, InvalidParams, "connect needs a Bluetooth address, e.g. {\"address\": \"AA:BB:CC:DD:EE:FF\"}");
+        // Like --connect at launch: a device discovery has not found (or made connectable) yet is
+        // connected once it has, e.g. when a login script forwards --connect during startup
+        const DeviceRegistry::Device *device = m_link->devices().find(address);
+        if (!device || device->deviceId.isEmpty()) {
+            m_link->connectWhenAvailable(address);
+            return result(id, "pending");
+        }
+        if (!m_link->connectDevice(device->key))
+            return error(id, Unavailable, "The connection to " + device->name() + " could not be started");
+        return result(id, true);
+    }
+    if (method == "disconnect") {
+        m_link->disconnectDevice();
+        return result(id, true);
+    }
+    if (method == "playPause") {
+        m_link->playPause();
+        return result(id, true);
+    }
+    if (method == "next") {
+        m_link->next();
+        return result(id, true);
+    }
+    if (method == "previous") {
+        m_link->previous();
+        return result(id, true);
+    }
+    return error(id, MethodNotFound, "Unknown method " + method);
+}
+
+QJsonValue ControlServer::status() const
+{
+    QJsonObject status;
+    BluetoothA2DPSink *sink = m_link->sink();
+    status["connectionState"] = sink ? BluetoothA2DPSink::connectionStateName(sink->connectionState()) : "Idle";
+    status["streaming"] = m_link->isStreaming();
+    if (const DeviceRegistry::Device *device = m_link->devices().find(m_link->connectedDevice())) {
+        status["device"] = QJsonObject{ { "address", device->info.address().toString() }, { "name", device->name() } };
+        if (sink)
+            status["lastConnectMs"] = sink->connectionStats().lastConnectMs(device->deviceId);
+    }
+    status["connectAutomatically"] = m_link->connectAutomatically();
+    status["savedDevice"] = m_link->savedDeviceAddress().toString();
+    status["residentMemoryBytes"] = ProcessStats::residentMemoryBytes();
+    return status;
+}
+
+QJsonValue ControlServer::deviceList() const
+{
+    QJsonArray devices;
+    for (const DeviceRegistry::Device &device : m_link->devices().devices()) {
+        if (device.isVirtual())
+            continue;
+        devices.append(QJsonObject{
+            { "address", device.info.address().toString() },
+            { "name", device.name() },
+            { "connectable", !device.deviceId.isEmpty() },
+            { "connected", m_link->isStreaming() && device.key == m_link->connectedDevice() } });
+    }
+    return devices;
+}
+
+void ControlServer::notify(const QString &method, const QJsonObject &params)
+{
+    const QJsonObject message{ { "jsonrpc", "2.0" }, { "method", method }, { "params", params } };
+    for (QLocalSocket *socket : std::as_const(m_subscribers))
+        send(socket, message);
+}
+
+void ControlServer::send(QLocalSocket *socket, const QJsonObject &message)
+{
+    socket->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n');
+    socket->flush();
+}
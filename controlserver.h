@@ -0,0 +1,66 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+class LinkController;
+class QLocalServer;
+class QLocalSocket;
+
+// Local control API: JSON-RPC 2.0 over a QLocalServer (a named pipe on Windows), one compact JSON
+// message per line. Requests are answered straight from LinkController on the thread it lives
+// on, without going near any widget.
+//
+// Methods: ping, status, listDevices, connect {address}, disconnect, playPause, next, previous,
+// show, subscribe, quit. After subscribe the connection also receives notifications:
+// stateChanged {state, connectionState} and connectionError {message}.
+class ControlServer : public QObject
+{
+    Q_OBJECT
+public:
+    // JSON-RPC error codes; the negative range below -32000 is the standard one
+    enum ErrorCode {
+        ParseError = -32700,
+        InvalidRequest = -32600,
+        MethodNotFound = -32601,
+        InvalidParams = -32602,
+        Unavailable = -32000        // the request is valid but cannot be carried out now
+    };
+
+    // Longest request line accepted; a client that sends more without a newline is dropped
+    static constexpr qint64 MaxRequestBytes = 64 * 1024;
+
+    explicit ControlServer(LinkController *link, QObject *parent = nullptr);
+    ~ControlServer() override;
+
+    // Per user, so two logged in users each control their own instance
+    static QString serverName();
+
+    bool listen();
+
+signals:
+    // A client asked the application to exit
+    void quitRequested();
+
+    // A client (usually a second launch, see SingleInstance) asked for the window
+    void showRequested();
+
+private:
+    void acceptConnections();
+    void readRequests(QLocalSocket *socket);
+    QJsonObject handleRequest(const QJsonObject &request, QLocalSocket *socket);
+    QJsonValue status() const;
+    QJsonValue deviceList() const;
+    void notify(const QString &method, const QJsonObject &params);
+    static void send(QLocalSocket *socket, const QJsonObject &message);
+
+    LinkController *m_link;
+    QLocalServer *m_server;
+    QList<QLocalSocket *> m_subscribers;
+};
+
+#endif // CONTROLSERVER_H
@@ -0,0 +1,138 @@
+#include "devicecache.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+namespace {
+
+// Class of Device as Qt decodes it: minor in bits 2-7, major in 8-12, service classes from 13
+quint32 classOfDevice(const QBluetoothDeviceInfo &device)
+{
+    return (quint32(device.serviceClasses()) << 13)
+           | (quint32(device.majorDeviceClass()) << 8)
+           | (quint32(device.minorDeviceClass()) << 2);
+}
+
+} // namespace
+
+DeviceCache::DeviceCache(const QString &path)
+    : m_path(path)
+    , m_dirty(false)
+{
+    if (!m_path.isEmpty())
+        load();
+}
+
+DeviceCache::Entry *DeviceCache::entry(const QBluetoothAddress &address)
+{
+    const int index = m_index.value(address.toUInt64(), -1);
+    return index < 0 ? nullptr : &m_entries[index];
+}
+
+const DeviceCache::Entry *DeviceCache::find(const QBluetoothAddress &address) const
+{
+    return const_cast<DeviceCache *>(this)->entry(address);
+}
+
+void DeviceCache::update(const QBluetoothDeviceInfo &device)
+{
+    if (device.address().isNull())
+        return;
+
+    Entry *cached = entry(device.address());
+    if (!cached) {
+        m_index.insert(device.address().toUInt64(), int(m_entries.size()));
+        m_entries.append(Entry());
+        cached = &m_entries.last();
+        cached->address = device.address();
+    }
+
+    cached->name = device.name();
+    cached->classOfDevice = classOfDevice(device);
+    cached->lastSeen = QDateTime::currentMSecsSinceEpoch();
+    m_dirty = true;
+}
+
+void DeviceCache::setDeviceId(const QBluetoothAddress &address, const QString &deviceId)
+{
+    Entry *cached = entry(address);
+    if (cached && cached->deviceId != deviceId) {
+        cached->deviceId = deviceId;
+        m_dirty = true;
+    }
+}
+
+void DeviceCache::markConnected(const QString &deviceId, qint64 connectMs)
+{
+    for (Entry &entry : m_entries) {
+        if (entry.deviceId == deviceId) {
+            entry.lastConnected = QDateTime::currentMSecsSinceEpoch();
+            entry.lastConnectMs = connectMs;
+            m_dirty = true;
+        }
+    }
+}
+
+QBluetoothDeviceInfo DeviceCache::deviceInfo(const Entry &entry)
+{
+    return QBluetoothDeviceInfo(entry.address, entry.name, entry.classOfDevice);
+}
+
+bool DeviceCache::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const QJsonArray devices = QJsonDocument::fromJson(file.readAll()).object()["devices"].toArray();
+    const qint64 oldest = QDateTime::currentMSecsSinceEpoch() - qint64(MaxAgeDays) * 24 * 3600 * 1000;
+    m_entries.clear();
+    m_index.clear();
+    for (const QJsonValue &value : devices) {
+        const QJsonObject device = value.toObject();
+        Entry entry;
+        entry.address = QBluetoothAddress(device["address"].toString());
+        entry.name = device["name"].toString();
+        entry.deviceId = device["deviceId"].toString();
+        entry.classOfDevice = quint32(device["classOfDevice"].toInteger());
+        entry.lastSeen = device["lastSeen"].toInteger();
+        entry.lastConnected = device["lastConnected"].toInteger();
+        entry.lastConnectMs = device["lastConnectMs"].toInteger(-1);
+        if (entry.address.isNull() || entry.lastSeen < oldest || m_index.contains(entry.address.toUInt64()))
+            continue;
+        m_index.insert(entry.address.toUInt64(), int(m_entries.size()));
+        m_entries.append(entry);
+    }
+    m_dirty = false;
+
+    qDebug() << "Loaded" << m_entries.size() << "cached device(s)";
+    return true;
+}
+
+QByteArray DeviceCache::takeChanges()
+{
+    if (!m_dirty || m_path.isEmpty())
+        return QByteArray();
+
+    QJsonArray devices;
+    for (const Entry &entry : std::as_const(m_entries)) {
+        QJsonObject device;
+        device["address"] = entry.address.toString();
+        device["name"] = entry.name;
+        device["deviceId"] = entry.deviceId;
+        device["classOfDevice"] = qint64(entry.classOfDevice);
+        device["lastSeen"] = entry.lastSeen;
+        device["lastConnected"] = entry.lastConnected;
+        device["lastConnectMs"] = entry.lastConnectMs;
+        devices.append(device);
+    }
+
+    QJsonObject root;
+    root["devices"] = devices;
+    m_dirty = false;
+    return QJsonDocument(root).toJson();
+}
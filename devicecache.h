@@ -0,0 +1,64 @@
+#ifndef DEVICECACHE_H
+#define DEVICECACHE_H
+
+#include <QBluetoothAddress>
+#include <QBluetoothDeviceInfo>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// Devices seen on earlier runs, persisted as JSON (next to init.json) so the device list can be
+// shown and the saved device connected at startup without waiting for discovery. Live discovery
+// keeps the entries up to date.
+class DeviceCache
+{
+public:
+    // Devices not seen by discovery for this long are dropped on load
+    static constexpr int MaxAgeDays = 60;
+
+    struct Entry {
+        QBluetoothAddress address;
+        QString name;
+        QString deviceId;           // WinRT AudioPlaybackConnection ID, empty until DeviceWatcher reports it
+        quint32 classOfDevice = 0;
+        qint64 lastSeen = 0;        // ms since epoch
+        qint64 lastConnected = 0;   // ms since epoch, 0 if never
+        qint64 lastConnectMs = -1;  // time to audio of that connect
+    };
+
+    // An empty path keeps the cache in memory only
+    explicit DeviceCache(const QString &path = QString());
+
+    const QList<Entry> &entries() const { return m_entries; }
+    const Entry *find(const QBluetoothAddress &address) const;
+
+    // Adds or refreshes a device from Qt discovery
+    void update(const QBluetoothDeviceInfo &device);
+
+    // Records the WinRT device ID DeviceRegistry matched to the device
+    void setDeviceId(const QBluetoothAddress &address, const QString &deviceId);
+
+    // Records a connect to the device with the given WinRT device ID
+    void markConnected(const QString &deviceId, qint64 connectMs);
+
+    static QBluetoothDeviceInfo deviceInfo(const Entry &entry);
+
+    bool load();
+
+    // The file contents to write if anything changed since the last load or call, otherwise
+    // empty. The caller writes it (LinkController does so off the GUI thread).
+    QByteArray takeChanges();
+
+    QString path() const { return m_path; }
+
+private:
+    Entry *entry(const QBluetoothAddress &address);
+
+    QString m_path;
+    QList<Entry> m_entries;
+    QHash<quint64, int> m_index;    // address -> entry
+    bool m_dirty;
+};
+
+#endif // DEVICECACHE_H
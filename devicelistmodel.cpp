@@ -0,0 +1,85 @@
+#include "devicelistmodel.h"
+
+DeviceListModel::DeviceListModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_connectedKey(0)
+    , m_autoConnectKey(0)
+{
+}
+
+int DeviceListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(m_devices.size());
+}
+
+QVariant DeviceListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_devices.size())
+        return QVariant();
+
+    const Device &device = m_devices.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return device.text;
+    case KeyRole:
+        return QVariant::fromValue(device.key);
+    case ConnectedRole:
+        return m_connectedKey != 0 && device.key == m_connectedKey;
+    case AutoConnectRole:
+        return m_autoConnectKey != 0 && device.key == m_autoConnectKey;
+    default:
+        return QVariant();
+    }
+}
+
+int DeviceListModel::setDevice(quint64 key, const QString &text)
+{
+    int existing = row(key);
+    if (existing >= 0) {
+        if (m_devices.at(existing).text != text) {
+            m_devices[existing].text = text;
+            const QModelIndex changed = index(existing);
+            emit dataChanged(changed, changed, { Qt::DisplayRole });
+        }
+        return existing;
+    }
+
+    const int appended = int(m_devices.size());
+    beginInsertRows(QModelIndex(), appended, appended);
+    m_devices.append({ key, text });
+    m_rows.insert(key, appended);
+    endInsertRows();
+    return appended;
+}
+
+void DeviceListModel::setConnectedKey(quint64 key)
+{
+    setFlagKey(m_connectedKey, key, ConnectedRole);
+}
+
+void DeviceListModel::setAutoConnectKey(quint64 key)
+{
+    setFlagKey(m_autoConnectKey, key, AutoConnectRole);
+}
+
+void DeviceListModel::setFlagKey(quint64 &current, quint64 key, int role)
+{
+    if (current == key)
+        return;
+
+    const int before = row(current);
+    current = key;
+    const int after = row(key);
+    for (int changed : { before, after }) {
+        if (changed >= 0)
+            emit dataChanged(index(changed), index(changed), { role });
+    }
+}
+
+void DeviceListModel::clear()
+{
+    beginResetModel();
+    m_devices.clear();
+    m_rows.clear();
+    endResetModel();
+}
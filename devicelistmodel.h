@@ -0,0 +1,54 @@
+#ifndef DEVICELISTMODEL_H
+#define DEVICELISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// The devices offered for connecting, one row per DeviceRegistry key, shared by the device combo
+// box and the device menus. Rows are only appended or updated in place (until clear()), and
+// every change is reported as a row-level model signal so views can apply it as a diff.
+class DeviceListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Role {
+        KeyRole = Qt::UserRole,     // quint64 DeviceRegistry key; what QComboBox::itemData() returns
+        ConnectedRole,              // bool, the device currently streaming
+        AutoConnectRole             // bool, the device connected on launch
+    };
+
+    explicit DeviceListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    // Appends the device, or updates its text if it is listed already. Returns its row.
+    int setDevice(quint64 key, const QString &text);
+
+    int row(quint64 key) const { return m_rows.value(key, -1); }
+    quint64 key(int row) const { return m_devices.at(row).key; }
+
+    // 0 for none
+    void setConnectedKey(quint64 key);
+    void setAutoConnectKey(quint64 key);
+
+    void clear();
+
+private:
+    struct Device {
+        quint64 key;
+        QString text;
+    };
+
+    // Changes a flag key and reports the rows that gained or lost it
+    void setFlagKey(quint64 &current, quint64 key, int role);
+
+    QList<Device> m_devices;
+    QHash<quint64, int> m_rows;
+    quint64 m_connectedKey;
+    quint64 m_autoConnectKey;
+};
+
+#endif // DEVICELISTMODEL_H
@@ -0,0 +1,67 @@
+#include "devicemenu.h"
+
+DeviceMenu::DeviceMenu(QMenu *menu, DeviceListModel *model, int checkedRole)
+    : QObject(menu)
+    , m_menu(menu)
+    , m_model(model)
+    , m_checkedRole(checkedRole)
+{
+    connect(m_model, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex &, int first, int last) {
+        insertActions(first, last);
+    });
+    connect(m_model, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex &, int first, int last) {
+        removeActions(first, last);
+    });
+    connect(m_model, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+        updateActions(topLeft.row(), bottomRight.row());
+    });
+    connect(m_model, &QAbstractItemModel::modelReset, this, &DeviceMenu::resetActions);
+
+    resetActions();
+}
+
+void DeviceMenu::insertActions(int first, int last)
+{
+    QAction *before = m_actions.value(first, nullptr);
+    for (int row = first; row <= last; row++) {
+        QAction *action = new QAction(m_menu);
+        action->setCheckable(true);
+        connect(action, &QAction::triggered, this, [this, action]() {
+            // Rows can move after insertions and removals; look the action up when triggered
+            const int current = int(m_actions.indexOf(action));
+            if (current < 0)
+                return;
+            emit deviceTriggered(current);
+            // The check mark follows the model, not the click
+            updateActions(current, current);
+        });
+        m_menu->insertAction(before, action);
+        m_actions.insert(row, action);
+    }
+    updateActions(first, last);
+}
+
+void DeviceMenu::removeActions(int first, int last)
+{
+    for (int row = last; row >= first; row--)
+        delete m_actions.takeAt(row);
+}
+
+void DeviceMenu::updateActions(int first, int last)
+{
+    for (int row = first; row <= last && row < m_actions.size(); row++) {
+        const QModelIndex index = m_model->index(row);
+        QAction *action = m_actions.at(row);
+        action->setText(index.data(Qt::DisplayRole).toString());
+        action->setChecked(index.data(m_checkedRole).toBool());
+    }
+}
+
+void DeviceMenu::resetActions()
+{
+    qDeleteAll(m_actions);
+    m_actions.clear();
+    m_menu->clear();
+    if (m_model->rowCount() > 0)
+        insertActions(0, m_model->rowCount() - 1);
+}
@@ -0,0 +1,36 @@
+#ifndef DEVICEMENU_H
+#define DEVICEMENU_H
+
+#include "devicelistmodel.h"
+
+#include <QAction>
+#include <QList>
+#include <QMenu>
+#include <QObject>
+
+// Keeps one checkable action per DeviceListModel row in a menu. Inserted, removed and changed
+// rows are applied to the existing actions, so the menu is never rebuilt while it is in use and
+// nothing is left behind. The actions belong to the menu; the menu should hold nothing else.
+class DeviceMenu : public QObject
+{
+    Q_OBJECT
+public:
+    // checkedRole is the model role shown as the check mark
+    DeviceMenu(QMenu *menu, DeviceListModel *model, int checkedRole);
+
+signals:
+    void deviceTriggered(int row);
+
+private:
+    void insertActions(int first, int last);
+    void removeActions(int first, int last);
+    void updateActions(int first, int last);
+    void resetActions();
+
+    QMenu *m_menu;
+    DeviceListModel *m_model;
+    int m_checkedRole;
+    QList<QAction*> m_actions;  // by row
+};
+
+#endif // DEVICEMENU_H
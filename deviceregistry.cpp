@@ -0,0 +1,153 @@
+#include "deviceregistry.h"
+
+#include <QRegularExpression>
+#include <QDebug>
+
+int DeviceRegistry::addDevice(const QBluetoothDeviceInfo &info, bool *added)
+{
+    const quint64 deviceKey = key(info.address());
+    int index = m_index.value(deviceKey, -1);
+    if (added)
+        *added = index < 0;
+
+    if (index >= 0) {
+        Device &device = m_devices[index];
+        if (device.info.name() != info.name()) {
+            m_byName.remove(device.info.name(), index);
+            m_byName.insert(info.name(), index);
+        }
+        device.info = info;
+    }
+    else {
+        index = int(m_devices.size());
+        Device device;
+        device.key = deviceKey;
+        device.info = info;
+        m_devices.append(device);
+        m_index.insert(deviceKey, index);
+        m_byName.insert(info.name(), index);
+    }
+
+    // DeviceWatcher may have reported this device first
+    if (m_devices.at(index).deviceId.isEmpty()) {
+        QString pending = m_pendingByAddress.take(deviceKey);
+        if (pending.isEmpty() && m_byName.count(info.name()) == 1 && m_pendingByName.count(info.name()) == 1)
+            pending = m_pendingByName.take(info.name());
+        if (!pending.isEmpty())
+            assignDeviceId(index, pending);
+    }
+    return index;
+}
+
+int DeviceRegistry::addDeviceId(const QString &deviceId, const QString &name)
+{
+    int index = m_byDeviceId.value(deviceId, -1);
+    if (index >= 0)
+        return index;
+
+    const QBluetoothAddress address = addressFromDeviceId(deviceId);
+    if (!address.isNull()) {
+        index = indexOf(key(address));
+    }
+    else {
+        // Only an unambiguous name is good enough; two phones called "iPhone" must not collide
+        const QList<int> named = m_byName.values(name);
+        if (named.size() == 1 && m_devices.at(named.first()).deviceId.isEmpty())
+            index = named.first();
+        else if (named.size() > 1)
+            qDebug() << "Device ID" << deviceId << "matches" << named.size() << "devices named" << name;
+    }
+
+    if (index < 0) {
+        if (!address.isNull())
+            m_pendingByAddress.insert(key(address), deviceId);
+        else if (!m_pendingByName.contains(name, deviceId))
+            m_pendingByName.insert(name, deviceId);
+        return -1;
+    }
+    assignDeviceId(index, deviceId);
+    return index;
+}
+
+void DeviceRegistry::setDeviceId(quint64 key, const QString &deviceId)
+{
+    const int index = indexOf(key);
+    if (index >= 0 && !deviceId.isEmpty())
+        assignDeviceId(index, deviceId);
+}
+
+int DeviceRegistry::addVirtualDevice(const QString &deviceId, const QString &name)
+{
+    int index = m_byDeviceId.value(deviceId, -1);
+    if (index >= 0)
+        return index;
+
+    index = int(m_devices.size());
+    Device device;
+    device.key = m_nextVirtualKey++;
+    device.info = QBluetoothDeviceInfo(QBluetoothAddress(), name, 0);
+    m_devices.append(device);
+    m_index.insert(device.key, index);
+    assignDeviceId(index, deviceId);
+    return index;
+}
+
+const DeviceRegistry::Device *DeviceRegistry::find(quint64 key) const
+{
+    const int index = indexOf(key);
+    return index < 0 ? nullptr : &m_devices.at(index);
+}
+
+const DeviceRegistry::Device *DeviceRegistry::findByDeviceId(const QString &deviceId) const
+{
+    const int index = m_byDeviceId.value(deviceId, -1);
+    return index < 0 ? nullptr : &m_devices.at(index);
+}
+
+void DeviceRegistry::clear()
+{
+    m_devices.clear();
+    m_index.clear();
+    m_byDeviceId.clear();
+    m_byName.clear();
+    m_pendingByAddress.clear();
+    m_pendingByName.clear();
+}
+
+void DeviceRegistry::assignDeviceId(int index, const QString &deviceId)
+{
+    Device &device = m_devices[index];
+    if (device.deviceId == deviceId)
+        return;
+
+    // An ID belongs to one device; a device has one ID
+    const int previous = m_byDeviceId.value(deviceId, -1);
+    if (previous >= 0)
+        m_devices[previous].deviceId.clear();
+    if (!device.deviceId.isEmpty())
+        m_byDeviceId.remove(device.deviceId);
+
+    device.deviceId = deviceId;
+    m_byDeviceId.insert(deviceId, index);
+}
+
+QBluetoothAddress DeviceRegistry::addressFromDeviceId(const QString &deviceId)
+{
+    // "Bluetooth#Bluetooth<local>-<remote>" with colon separated addresses, or a BTHENUM interface
+    // path with the remote address as 12 hex digits: "...&0&AABBCCDDEEFF_C00000000#{...}"
+    static const QRegularExpression colonAddress("([0-9A-Fa-f]{2}(?::[0-9A-Fa-f]{2}){5})$");
+    static const QRegularExpression bthenumAddress("&([0-9A-Fa-f]{12})_");
+
+    QRegularExpressionMatch match = colonAddress.match(deviceId);
+    if (match.hasMatch())
+        return QBluetoothAddress(match.captured(1));
+
+    match = bthenumAddress.match(deviceId);
+    if (match.hasMatch()) {
+        bool ok = false;
+        const quint64 address = match.captured(1).toULongLong(&ok, 16);
+        if (ok && address != 0)
+            return QBluetoothAddress(address);
+    }
+    return QBluetoothAddress();
+}
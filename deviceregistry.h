@@ -0,0 +1,76 @@
+#ifndef DEVICEREGISTRY_H
+#define DEVICEREGISTRY_H
+
+#include <QBluetoothAddress>
+#include <QBluetoothDeviceInfo>
+#include <QHash>
+#include <QList>
+#include <QMultiHash>
+#include <QString>
+
+// Every known device, keyed by Bluetooth address, joining what QBluetoothDeviceDiscoveryAgent
+// reports (name, class) with what the WinRT DeviceWatcher reports (the device ID used to connect).
+//
+// DeviceWatcher results are matched by the address embedded in the device ID, falling back to
+// the name only when exactly one device has it. Results that cannot be matched yet wait until Qt
+// discovery reports their device. Devices are only ever added or updated, never reordered, so an
+// index stays valid until clear().
+class DeviceRegistry
+{
+public:
+    // Keys above this are not Bluetooth addresses (see addVirtualDevice)
+    static constexpr quint64 MaxAddress = 0xffffffffffffULL;
+
+    struct Device {
+        quint64 key = 0;
+        QBluetoothDeviceInfo info;  // from Qt discovery or the device cache
+        QString deviceId;           // Windows device ID, empty until DeviceWatcher reports it
+
+        QString name() const { return info.name(); }
+        bool isVirtual() const { return key > MaxAddress; }
+    };
+
+    static quint64 key(const QBluetoothAddress &address) { return address.toUInt64(); }
+
+    // Adds or refreshes a device from Qt discovery (or the cache). Returns its index; *added
+    // tells whether it is new.
+    int addDevice(const QBluetoothDeviceInfo &info, bool *added = nullptr);
+
+    // Joins a DeviceWatcher result. Returns the index of the matched device, or -1 if it is kept
+    // until Qt discovery reports a device it can be matched to.
+    int addDeviceId(const QString &deviceId, const QString &name);
+
+    // Sets the device ID of a known device (from the cache, which is keyed by address)
+    void setDeviceId(quint64 key, const QString &deviceId);
+
+    // Adds a device only DeviceWatcher knows about (replayed captures); its key is above MaxAddress
+    int addVirtualDevice(const QString &deviceId, const QString &name);
+
+    int size() const { return int(m_devices.size()); }
+    const Device &at(int index) const { return m_devices.at(index); }
+    const QList<Device> &devices() const { return m_devices; }
+
+    int indexOf(quint64 key) const { return m_index.value(key, -1); }
+    const Device *find(quint64 key) const;
+    const Device *find(const QBluetoothAddress &address) const { return find(key(address)); }
+    const Device *findByDeviceId(const QString &deviceId) const;
+
+    void clear();
+
+    // The remote address in a Windows Bluetooth device ID, or a null address if there is none
+    static QBluetoothAddress addressFromDeviceId(const QString &deviceId);
+
+private:
+    void assignDeviceId(int index, const QString &deviceId);
+
+    QList<Device> m_devices;
+    QHash<quint64, int> m_index;
+    QHash<QString, int> m_byDeviceId;
+    QMultiHash<QString, int> m_byName;
+    // Device IDs not matched to a device yet, by the address they contain or else by name
+    QHash<quint64, QString> m_pendingByAddress;
+    QMultiHash<QString, QString> m_pendingByName;
+    quint64 m_nextVirtualKey = MaxAddress + 1;
+};
+
+#endif // DEVICEREGISTRY_H
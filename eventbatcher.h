@@ -0,0 +1,105 @@
+#ifndef EVENTBATCHER_H
+#define EVENTBATCHER_H
+
+#include "jitterbuffer.h"
+#include "mpscqueue.h"
+
+#include <QList>
+#include <QMetaObject>
+#include <QObject>
+#include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+// Hands items pushed from any thread to the owner's thread in batches. The first item after a
+// flush posts one event that arms a timer; everything pushed before it fires (one display frame
+// by default) is delivered in a single call. Callbacks from platform threads that arrive in
+// storms (DeviceWatcher during enumeration) cost the owner's thread one event per frame instead
+// of one per item.
+template<typename T>
+class EventBatcher
+{
+public:
+    static constexpr int DefaultIntervalMs = 16;
+
+    // Owner's thread only
+    struct Stats
+    {
+        quint64 items = 0;
+        quint64 batches = 0;
+        int lastBatch = 0;
+        int maxBatch = 0;
+        qint64 lastLatencyUs = 0;   // oldest item of the last batch: pushed to delivered
+        qint64 maxLatencyUs = 0;
+    };
+
+    using Deliver = std::function<void(const QList<T> &items)>;
+
+    EventBatcher(QObject *owner, Deliver deliver, int intervalMs = DefaultIntervalMs)
+        : m_timer(new QTimer(owner))
+        , m_deliver(std::move(deliver))
+    {
+        m_timer->setSingleShot(true);
+        m_timer->setInterval(intervalMs);
+        QObject::connect(m_timer, &QTimer::timeout, owner, [this]() { flush(); });
+    }
+
+    // Any thread
+    void push(T item)
+    {
+        m_queue.push({ std::move(item), JitterBuffer::steadyMicros() });
+        if (!m_flushPending.exchange(true, std::memory_order_acq_rel)) {
+            QTimer *timer = m_timer;
+            QMetaObject::invokeMethod(timer, [timer]() { timer->start(); }, Qt::QueuedConnection);
+        }
+    }
+
+    // Owner's thread: delivers everything queued so far
+    void flush()
+    {
+        // Cleared first, so an item pushed during the drain schedules the next flush. An exchange,
+        // not a store: a store could be reordered after the drain's loads, and a producer that
+        // linked its item and then still saw the flag set would leave it queued with no flush.
+        m_flushPending.exchange(false, std::memory_order_acq_rel);
+
+        QList<T> items;
+        qint64 oldestUs = 0;
+        while (std::optional<Queued> queued = m_queue.pop()) {
+            if (items.isEmpty())
+                oldestUs = queued->queuedUs;
+            items.append(std::move(queued->item));
+        }
+        if (items.isEmpty())
+            return;
+
+        m_stats.items += items.size();
+        m_stats.batches++;
+        m_stats.lastBatch = int(items.size());
+        m_stats.maxBatch = std::max(m_stats.maxBatch, m_stats.lastBatch);
+        m_stats.lastLatencyUs = JitterBuffer::steadyMicros() - oldestUs;
+        m_stats.maxLatencyUs = std::max(m_stats.maxLatencyUs, m_stats.lastLatencyUs);
+        m_deliver(items);
+    }
+
+    // Items waiting for the next flush (approximate from other threads)
+    size_t depth() const { return m_queue.size(); }
+
+    const Stats &stats() const { return m_stats; }
+
+private:
+    struct Queued
+    {
+        T item;
+        qint64 queuedUs;
+    };
+
+    MpscQueue<Queued> m_queue;
+    std::atomic<bool> m_flushPending{false};
+    QTimer *m_timer;
+    Deliver m_deliver;
+    Stats m_stats;
+};
+
+#endif // EVENTBATCHER_H
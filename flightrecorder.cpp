@@ -0,0 +1,459 @@
+#include "flightrecorder.h"
+#include "asyncfilewriter.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QDebug>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#ifdef Q_OS_WIN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace FlightRecorder {
+namespace {
+
+constexpr char Magic[8] = { 'P', 'A', 'L', 'F', 'L', 'G', 'H', 'T' };
+constexpr quint32 FileVersion = 1;
+constexpr int KeptDumps = 10;
+constexpr qint64 MinDumpIntervalNs = 5000000000LL;
+
+// Set in Entry::sequence while the entry is being written
+constexpr quint64 Writing = quint64(1) << 63;
+
+Entry entries[Capacity];
+std::atomic<quint64> nextSequence{ 0 };
+
+qint64 steadyNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+qint32 saturate(qint64 value)
+{
+    return qint32(std::clamp<qint64>(value, std::numeric_limits<qint32>::min(), std::numeric_limits<qint32>::max()));
+}
+
+void copyText(char *out, size_t size, const char *text)
+{
+    std::memset(out, 0, size);
+    if (!text)
+        return;
+    size_t length = 0;
+    while (length < size && text[length])
+        length++;
+    // Cut before a UTF-8 sequence that does not fit, not in the middle of it
+    if (length == size && text[length]) {
+        while (length > 0 && (quint8(text[length]) & 0xc0) == 0x80)
+            length--;
+    }
+    std::memcpy(out, text, length);
+}
+
+// What the crash handler writes is prepared when the Session starts, so the handler itself only
+// calls the steady clock and the raw file API
+Header crashHeader;
+#ifdef Q_OS_WIN
+wchar_t crashPath[1024];
+LPTOP_LEVEL_EXCEPTION_FILTER previousFilter = nullptr;
+#else
+char crashPath[1024];
+constexpr int FatalSignals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+struct sigaction previousActions[std::size(FatalSignals)];
+#endif
+std::atomic<bool> crashDumped{ false };
+
+void writeCrashDump(const char *reason)
+{
+    if (!crashPath[0] || crashDumped.exchange(true))
+        return;
+
+    Header header = crashHeader;
+    header.dumpSteadyNs = steadyNanoseconds();
+    copyText(header.reason, sizeof(header.reason), reason);
+
+#ifdef Q_OS_WIN
+    const HANDLE file = CreateFileW(crashPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+    DWORD written = 0;
+    WriteFile(file, &header, sizeof(header), &written, nullptr);
+    WriteFile(file, entries, sizeof(entries), &written, nullptr);
+    CloseHandle(file);
+#else
+    const int file = ::open(crashPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file < 0)
+        return;
+    auto writeAll = [file](const void *data, size_t size) {
+        const char *bytes = static_cast<const char *>(data);
+        while (size > 0) {
+            const ssize_t written = ::write(file, bytes, size);
+            if (written <= 0)
+                return;
+            bytes += written;
+            size -= size_t(written);
+        }
+    };
+    writeAll(&header, sizeof(header));
+    writeAll(entries, sizeof(entries));
+    ::close(file);
+#endif
+}
+
+#ifdef Q_OS_WIN
+LONG WINAPI onUnhandledException(EXCEPTION_POINTERS *exception)
+{
+    static const char digits[] = "0123456789abcdef";
+    char reason[] = "exception 0x00000000";
+    const DWORD code = exception->ExceptionRecord->ExceptionCode;
+    for (int i = 0; i < 8; i++)
+        reason[sizeof(reason) - 2 - i] = digits[(code >> (4 * i)) & 0xf];
+    writeCrashDump(reason);
+    return previousFilter ? previousFilter(exception) : EXCEPTION_CONTINUE_SEARCH;
+}
+
+// abort() returns to the CRT after this, which terminates the process
+void onAbort(int)
+{
+    writeCrashDump("abort");
+}
+#else
+const char *signalName(int signal)
+{
+    switch (signal) {
+    case SIGSEGV: return "crash SIGSEGV";
+    case SIGBUS:  return "crash SIGBUS";
+    case SIGFPE:  return "crash SIGFPE";
+    case SIGILL:  return "crash SIGILL";
+    case SIGABRT: return "abort";
+    }
+    return "crash";
+}
+
+void onFatalSignal(int signal)
+{
+    writeCrashDump(signalName(signal));
+
+    // The previous handler (usually the default action: core dump, crash reporter) takes it from here
+    for (size_t i = 0; i < std::size(FatalSignals); i++) {
+        if (FatalSignals[i] == signal)
+            sigaction(signal, &previousActions[i], nullptr);
+    }
+    raise(signal);
+}
+#endif
+
+void installCrashHandler()
+{
+#ifdef Q_OS_WIN
+    previousFilter = SetUnhandledExceptionFilter(onUnhandledException);
+    std::signal(SIGABRT, onAbort);
+#else
+    struct sigaction action = {};
+    action.sa_handler = onFatalSignal;
+    sigemptyset(&action.sa_mask);
+    for (size_t i = 0; i < std::size(FatalSignals); i++)
+        sigaction(FatalSignals[i], &action, &previousActions[i]);
+#endif
+}
+
+void removeCrashHandler()
+{
+#ifdef Q_OS_WIN
+    SetUnhandledExceptionFilter(previousFilter);
+    std::signal(SIGABRT, SIG_DFL);
+#else
+    for (size_t i = 0; i < std::size(FatalSignals); i++)
+        sigaction(FatalSignals[i], &previousActions[i], nullptr);
+#endif
+    crashPath[0] = 0;
+}
+
+struct State
+{
+    explicit State(const QString &path) : directory(path) {}
+
+    QString directory;
+    AsyncFileWriter writer;
+    std::atomic<qint64> lastDumpNs{ std::numeric_limits<qint64>::min() / 2 };
+};
+
+State *session = nullptr;
+
+// Oldest first; names sort by time
+void pruneDumps(const QString &directory, int keep)
+{
+    QDir dir(directory);
+    const QStringList dumps = dir.entryList({ "flight-*.flight" }, QDir::Files, QDir::Name);
+    for (qsizetype i = 0; i < dumps.size() - keep; i++)
+        dir.remove(dumps.at(i));
+}
+
+// The ring as a dump file; entries overwritten while being copied are left out
+QByteArray snapshot(const char *reason)
+{
+    Header header = crashHeader;
+    header.anchorWallNs = QDateTime::currentMSecsSinceEpoch() * 1000000;
+    header.anchorSteadyNs = steadyNanoseconds();
+    header.dumpSteadyNs = header.anchorSteadyNs;
+    copyText(header.reason, sizeof(header.reason), reason);
+
+    QByteArray data(sizeof(Header) + sizeof(entries), Qt::Uninitialized);
+    std::memcpy(data.data(), &header, sizeof(header));
+    Entry *out = reinterpret_cast<Entry *>(data.data() + sizeof(Header));
+    for (int i = 0; i < Capacity; i++) {
+        std::atomic_ref<quint64> published(entries[i].sequence);
+        const quint64 sequence = published.load(std::memory_order_acquire);
+        std::memcpy(&out[i], &entries[i], sizeof(Entry));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const bool stable = !(sequence & Writing) && published.load(std::memory_order_relaxed) == sequence;
+        out[i].sequence = stable ? sequence : 0;
+    }
+    return data;
+}
+
+const char *eventName(quint16 event)
+{
+    switch (event) {
+    case StateChanged:       return "State";
+    case ConnectionError:    return "Error";
+    case HResult:            return "HRESULT";
+    case DevicesDiscovered:  return "Discovered";
+    case DiscoveryCompleted: return "Discovery done";
+    case Milestone:          return "Milestone";
+    case Buffers:            return "Buffers";
+    case Loss:               return "Loss";
+    case MediaKey:           return "Media key";
+    }
+    return "?";
+}
+
+QString describe(const Entry &entry)
+{
+    const QString text = QString::fromUtf8(entry.text, qstrnlen(entry.text, TextSize));
+    const qint32 *values = entry.values;
+    switch (entry.event) {
+    case StateChanged:
+    case Milestone:
+        return QString("%1 (+%2 ms)").arg(text).arg(values[1] / 1000.0, 0, 'f', 1);
+    case HResult:
+        return QString("%1 0x%2%3")
+            .arg(text)
+            .arg(quint32(values[0]), 8, 16, QChar('0'))
+            .arg(values[1] ? QString(" (status %1)").arg(values[1]) : QString());
+    case DevicesDiscovered:
+        return QString("%1 device(s), first %2").arg(values[0]).arg(text);
+    case Buffers:
+        return QString("jitter buffer %1 packets (target %2 ms), renderer %3 blocks")
+            .arg(values[0])
+            .arg(values[1] / 1000.0, 0, 'f', 1)
+            .arg(values[2]);
+    case Loss:
+        return QString("%1 packets lost, %2 frames concealed, %3 underruns, %4 overruns")
+            .arg(values[0])
+            .arg(values[1])
+            .arg(values[2])
+            .arg(values[3]);
+    default:
+        return text;
+    }
+}
+
+} // namespace
+
+void record(Event event, const char *text, qint64 a, qint64 b, qint64 c, qint64 d)
+{
+    const quint64 sequence = nextSequence.fetch_add(1, std::memory_order_relaxed) + 1;
+    Entry &entry = entries[(sequence - 1) % Capacity];
+
+    // Readers skip the entry until it is complete. A writer stalled for a whole lap of the ring
+    // still owns the entry; the newer event is dropped rather than mixed into it.
+    std::atomic_ref<quint64> published(entry.sequence);
+    quint64 previous = published.load(std::memory_order_relaxed);
+    do {
+        if (previous & Writing)
+            return;
+    } while (!published.compare_exchange_weak(previous, sequence | Writing, std::memory_order_relaxed));
+    std::atomic_thread_fence(std::memory_order_release);
+
+    entry.timestampNs = steadyNanoseconds();
+    entry.values[0] = saturate(a);
+    entry.values[1] = saturate(b);
+    entry.values[2] = saturate(c);
+    entry.values[3] = saturate(d);
+    entry.event = event;
+    copyText(entry.text, TextSize, text);
+    published.store(sequence, std::memory_order_release);
+}
+
+void record(Event event, const QString &text, qint64 a, qint64 b, qint64 c, qint64 d)
+{
+    record(event, text.toUtf8().constData(), a, b, c, d);
+}
+
+bool dump(const char *reason)
+{
+    if (!session)
+        return false;
+
+    const qint64 now = steadyNanoseconds();
+    qint64 last = session->lastDumpNs.load(std::memory_order_relaxed);
+    do {
+        if (now - last < MinDumpIntervalNs)
+            return false;
+    } while (!session->lastDumpNs.compare_exchange_weak(last, now, std::memory_order_relaxed));
+
+    const QString path = session->directory + "/flight-"
+                         + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss-zzz") + ".flight";
+    pruneDumps(session->directory, KeptDumps - 1);
+    session->writer.write(path, snapshot(reason));
+    qInfo().noquote() << "Flight recorder:" << reason << "- dumped to" << QDir::toNativeSeparators(path);
+    return true;
+}
+
+Session::Session(const QString &directory)
+{
+    if (session)
+        return;
+    QDir().mkpath(directory);
+    session = new State(directory);
+    QObject::connect(&session->writer, &AsyncFileWriter::writeFailed, [](const QString &path, const QString &error) {
+        qWarning().noquote() << "Flight recorder dump not written to" << path << "-" << error;
+    });
+    pruneDumps(directory, KeptDumps);
+
+    std::memcpy(crashHeader.magic, Magic, sizeof(Magic));
+    crashHeader.version = FileVersion;
+    crashHeader.entrySize = sizeof(Entry);
+    crashHeader.capacity = Capacity;
+    crashHeader.reserved = 0;
+    crashHeader.anchorWallNs = QDateTime::currentMSecsSinceEpoch() * 1000000;
+    crashHeader.anchorSteadyNs = steadyNanoseconds();
+
+    // One crash dump name per run, fixed now
+    const QString crash = QDir::toNativeSeparators(
+        directory + "/flight-" + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss") + "-crash.flight");
+#ifdef Q_OS_WIN
+    if (crash.size() < qsizetype(std::size(crashPath)))
+        crashPath[crash.toWCharArray(crashPath)] = 0;
+#else
+    const QByteArray encoded = QFile::encodeName(crash);
+    if (encoded.size() < qsizetype(sizeof(crashPath)))
+        std::memcpy(crashPath, encoded.constData(), encoded.size() + 1);
+#endif
+    installCrashHandler();
+}
+
+Session::~Session()
+{
+    if (!session)
+        return;
+    removeCrashHandler();
+    delete session;     // flushes queued dumps
+    session = nullptr;
+}
+
+bool viewFile(const QString &path, QStringList *lines, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    const qint64 size = file.size();
+    uchar *data = size >= qint64(sizeof(Header)) ? file.map(0, size) : nullptr;
+    if (!data) {
+        if (error)
+            *error = size < qint64(sizeof(Header)) ? QString("too short for a flight recorder dump") : file.errorString();
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != FileVersion
+        || header.entrySize != sizeof(Entry)
+        || size < qint64(sizeof(Header)) + qint64(header.capacity) * header.entrySize) {
+        if (error)
+            *error = "not a flight recorder dump, or from another version";
+        return false;
+    }
+
+    std::vector<Entry> list;
+    list.reserve(header.capacity);
+    for (quint32 i = 0; i < header.capacity; i++) {
+        Entry entry;
+        std::memcpy(&entry, data + sizeof(Header) + i * sizeof(Entry), sizeof(Entry));
+        if (entry.sequence != 0 && !(entry.sequence & Writing))
+            list.push_back(entry);
+    }
+    std::sort(list.begin(), list.end(), [](const Entry &a, const Entry &b) { return a.sequence < b.sequence; });
+
+    auto wallTime = [&header](qint64 steadyNs) {
+        const qint64 wallNs = header.anchorWallNs + (steadyNs - header.anchorSteadyNs);
+        return QDateTime::fromMSecsSinceEpoch(wallNs / 1000000).toString("yyyy-MM-dd HH:mm:ss.zzz");
+    };
+    const QString reason = QString::fromUtf8(header.reason, qstrnlen(header.reason, sizeof(header.reason)));
+    lines->append(QString("Flight recorder dump: %1 at %2, %3 events%4")
+                      .arg(reason)
+                      .arg(wallTime(header.dumpSteadyNs))
+                      .arg(list.size())
+                      .arg(!list.empty() && list.front().sequence > 1
+                               ? QString(" (%1 older ones overwritten)").arg(list.front().sequence - 1)
+                               : QString()));
+    for (const Entry &entry : list) {
+        lines->append(QString("%1 %2 s  %3  %4")
+                          .arg(wallTime(entry.timestampNs))
+                          .arg((entry.timestampNs - header.dumpSteadyNs) / 1e9, 9, 'f', 3)
+                          .arg(QString(eventName(entry.event)), -14)
+                          .arg(describe(entry)));
+    }
+    file.unmap(data);
+    return true;
+}
+
+int view(const QStringList &arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    const int index = arguments.indexOf("--view-flight");
+    const QStringList files = arguments.mid(index + 1);
+    if (index < 0 || files.isEmpty()) {
+        err << "Usage: PhoneAudioLink --view-flight <file.flight>..." << Qt::endl;
+        return 1;
+    }
+
+    int status = 0;
+    for (const QString &path : files) {
+        QStringList lines;
+        QString error;
+        if (!viewFile(path, &lines, &error)) {
+            err << path << ": " << error << Qt::endl;
+            status = 1;
+            continue;
+        }
+        if (files.size() > 1)
+            out << "== " << path << '\n';
+        for (const QString &line : std::as_const(lines))
+            out << line << '\n';
+    }
+    out.flush();
+    return status;
+}
+
+} // namespace FlightRecorder
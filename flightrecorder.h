@@ -0,0 +1,88 @@
+#ifndef FLIGHTRECORDER_H
+#define FLIGHTRECORDER_H
+
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+// The last few hundred connection events, kept in memory so a report of "it disconnected randomly"
+// comes with what led up to it:
+//
+//     FlightRecorder::record(FlightRecorder::StateChanged, connectionStateName(state), int(state), elapsedUs);
+//
+// Recording copies the values into a fixed ring of 64-byte entries; it never allocates (except
+// for the QString overload), locks or touches the disk. dump() writes the ring to a file in the
+// background, and a crash handler writes it synchronously; both produce the same layout, a header
+// followed by the raw ring, which `PhoneAudioLink --view-flight <file>` maps and prints.
+namespace FlightRecorder {
+
+// What an entry records; the comments list its text and values
+enum Event : quint16 {
+    StateChanged = 1,       // state; state, µs since enableSink()
+    ConnectionError,        // message
+    HResult,                // operation; HRESULT, status where there is one
+    DevicesDiscovered,      // first name; devices in the batch
+    DiscoveryCompleted,
+    Milestone,              // milestone; µs since enableSink()
+    Buffers,                // -; jitter buffer packets, target depth µs, renderer blocks
+    Loss,                   // -; packets lost, frames concealed, renderer underruns, overruns
+    MediaKey                // key
+};
+
+constexpr int Capacity = 512;   // 32 KB
+constexpr int TextSize = 30;
+
+struct Entry
+{
+    quint64 sequence;           // 1-based record number; 0 while empty, top bit set while written
+    qint64 timestampNs;         // steady clock
+    qint32 values[4];           // saturated to the qint32 range
+    quint16 event;
+    char text[TextSize];        // UTF-8, NUL padded, truncated
+};
+static_assert(sizeof(Entry) == 64, "Entries are one cache line");
+
+// Dump file layout: a Header, then Capacity entries in ring order (not sorted)
+struct Header
+{
+    char magic[8];              // "PALFLGHT"
+    quint32 version;
+    quint32 entrySize;
+    quint32 capacity;
+    quint32 reserved;
+    qint64 anchorWallNs;        // wall clock and steady clock read together
+    qint64 anchorSteadyNs;
+    qint64 dumpSteadyNs;
+    char reason[32];            // NUL padded
+};
+static_assert(sizeof(Header) == 80, "Header layout is part of the file format");
+
+// Thread-safe; callable before a Session exists
+void record(Event event, const char *text = nullptr, qint64 a = 0, qint64 b = 0, qint64 c = 0, qint64 d = 0);
+void record(Event event, const QString &text, qint64 a = 0, qint64 b = 0, qint64 c = 0, qint64 d = 0);
+
+// Queues the ring to <directory>/flight-<time>.flight, unless there is no Session or another dump
+// was written in the last few seconds (one failure often reports itself several ways)
+bool dump(const char *reason);
+
+// Sets the dump directory, installs the crash handler (fatal signals, and unhandled SEH exceptions
+// on Windows) and writes dumps on a worker thread for its lifetime. The ten newest dumps are kept.
+class Session
+{
+public:
+    explicit Session(const QString &directory);
+    ~Session();
+
+    Session(const Session &) = delete;
+    Session &operator=(const Session &) = delete;
+};
+
+// The entries of a dump as text lines, oldest first; false (with *error set) if it is not a dump
+bool viewFile(const QString &path, QStringList *lines, QString *error = nullptr);
+
+// `--view-flight <file>...`
+int view(const QStringList &arguments);
+
+} // namespace FlightRecorder
+
+#endif // FLIGHTRECORDER_H
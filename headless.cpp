@@ -0,0 +1,76 @@
+#include "headless.h"
+#include "binarylog.h"
+#include "controlserver.h"
+#include "flightrecorder.h"
+#include "linkcontroller.h"
+#include "processstats.h"
+#include "spantrace.h"
+#include "startuptrace.h"
+
+#include <QCoreApplication>
+#include <QTimer>
+#include <QDebug>
+
+namespace Headless {
+
+int run(int &argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    StartupTrace::mark("application created");
+    BinaryLog::Session log(QCoreApplication::applicationDirPath() + "/logs");
+    FlightRecorder::Session flightRecorder(QCoreApplication::applicationDirPath() + "/logs");
+#ifdef PHONEAUDIOLINK_TRACING
+    if (SpanTrace::isEnabled())
+        SpanTrace::saveWhenQuitting();
+#endif
+
+    LinkController link;
+    BluetoothA2DPSink *sink = link.sink();
+
+    QObject::connect(sink, &BluetoothA2DPSink::stateChanged, &link, [](const QString &state) {
+        qInfo() << "Sink state:" << state;
+    });
+    QObject::connect(sink, &BluetoothA2DPSink::connectionOpened, &link, [&link]() {
+        if (const DeviceRegistry::Device *device = link.devices().find(link.connectedDevice()))
+            qInfo() << "Streaming from" << device->name();
+    });
+    QObject::connect(sink, &BluetoothA2DPSink::connectionError, &link, [](const QString &error) {
+        qWarning() << "Connection error:" << error;
+    });
+    QObject::connect(&link, &LinkController::discoveryError, &link, [](QBluetoothDeviceDiscoveryAgent::Error error) {
+        qWarning() << "Bluetooth error:" << error;
+    });
+    QObject::connect(&link, &LinkController::configError, &link, [](const QString &title, const QString &message) {
+        qWarning().noquote() << title << "-" << message;
+    });
+    QObject::connect(&link, &LinkController::saveFailed, &link, [](const QString &path, const QString &error) {
+        qWarning().noquote() << "Settings not saved to" << path << "-" << error;
+    });
+
+    // Release the connection before the sink goes away
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, &link, [&link]() {
+        link.saveConfig();
+        link.shutdown();
+    });
+
+    ControlServer controlServer(&link);
+    QObject::connect(&controlServer, &ControlServer::quitRequested, &app, &QCoreApplication::quit, Qt::QueuedConnection);
+    controlServer.listen();
+    StartupTrace::mark("control API listening");
+
+    link.loadConfig();
+    StartupTrace::mark("config loaded");
+    link.start();
+    StartupTrace::mark("discovery started");
+    if (!link.connectAutomatically())
+        qInfo() << "Auto-connect is off in init.json; waiting for `PhoneAudioLink --control connect <address>`";
+
+    QTimer::singleShot(0, &link, []() {
+        StartupTrace::mark("event loop running");
+        StartupTrace::dump();
+        ProcessStats::logStartup("headless event loop running");
+    });
+    return app.exec();
+}
+
+} // namespace Headless
@@ -0,0 +1,15 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// The daemon mode, `PhoneAudioLink --headless`: runs LinkController on a QCoreApplication,
+// without constructing any widgets, for boxes where nobody looks at the window. It uses the
+// same init.json and device cache as the window, logs to the console, and is driven through the
+// control API (see ControlServer).
+namespace Headless {
+
+// Runs the event loop; returns the process exit code
+int run(int &argc, char **argv);
+
+} // namespace Headless
+
+#endif // HEADLESS_H
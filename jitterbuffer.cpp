@@ -0,0 +1,192 @@
+#include "jitterbuffer.h"
+#include "mediapacket.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// Window samples needed before the learned target replaces initialDepthUs
+constexpr size_t MinimumSamples = 32;
+
+} // namespace
+
+JitterEstimator::JitterEstimator()
+{
+    setConfig(Config());
+}
+
+JitterEstimator::JitterEstimator(const Config &config)
+{
+    setConfig(config);
+}
+
+void JitterEstimator::setConfig(const Config &config)
+{
+    m_config = config;
+    m_config.windowPackets = std::max(int(MinimumSamples), m_config.windowPackets);
+    m_config.updateInterval = std::max(1, m_config.updateInterval);
+    m_config.underrunBudget = std::clamp(m_config.underrunBudget, 0.0, 1.0);
+    m_config.maxDepthUs = std::max(m_config.minDepthUs, m_config.maxDepthUs);
+
+    m_transits.assign(size_t(m_config.windowPackets), 0);
+    m_scratch.reserve(size_t(m_config.windowPackets));
+    reset();
+}
+
+void JitterEstimator::reset()
+{
+    m_next = 0;
+    m_filled = 0;
+    m_baselineUs = 0;
+    m_targetDepthUs = std::clamp(m_config.initialDepthUs, m_config.minDepthUs, m_config.maxDepthUs);
+    m_p50Us = m_p95Us = m_p99Us = 0;
+}
+
+int64_t JitterEstimator::addPacket(int64_t arrivalUs, int64_t mediaUs)
+{
+    const int64_t transitUs = arrivalUs - mediaUs;
+
+    // A jump far beyond any plausible jitter is a stream discontinuity (pause, clock reset)
+    if (m_filled > 0) {
+        const int64_t previousUs = m_transits[(m_next + m_transits.size() - 1) % m_transits.size()];
+        if (std::abs(transitUs - previousUs) > 2 * m_config.maxDepthUs)
+            reset();
+    }
+
+    if (m_filled == 0 || transitUs < m_baselineUs)
+        m_baselineUs = transitUs;
+
+    m_transits[m_next] = transitUs;
+    m_next = (m_next + 1) % m_transits.size();
+    m_filled = std::min(m_filled + 1, m_transits.size());
+    m_packets++;
+
+    if (m_packets % uint64_t(m_config.updateInterval) == 0)
+        update();
+
+    const int64_t deadlineUs = mediaUs + m_baselineUs + m_targetDepthUs;
+    if (arrivalUs > deadlineUs)
+        m_latePackets++;
+    return deadlineUs;
+}
+
+void JitterEstimator::update()
+{
+    m_scratch.assign(m_transits.begin(), m_transits.begin() + std::ptrdiff_t(m_filled));
+
+    // The oldest minimum may have left the window (this also tracks clock drift)
+    m_baselineUs = *std::min_element(m_scratch.begin(), m_scratch.end());
+    for (int64_t &transit : m_scratch)
+        transit -= m_baselineUs;
+
+    auto quantile = [this](double q) {
+        const auto position = m_scratch.begin() + std::ptrdiff_t(q * double(m_scratch.size() - 1) + 0.5);
+        std::nth_element(m_scratch.begin(), position, m_scratch.end());
+        return *position;
+    };
+
+    m_p50Us = quantile(0.50);
+    m_p95Us = quantile(0.95);
+    m_p99Us = quantile(0.99);
+
+    if (m_filled < MinimumSamples)
+        return;
+
+    // Smallest depth that keeps the late fraction within budget; grow at once, shrink slowly
+    const int64_t desiredUs = std::clamp(quantile(1.0 - m_config.underrunBudget),
+                                         m_config.minDepthUs, m_config.maxDepthUs);
+    if (desiredUs >= m_targetDepthUs)
+        m_targetDepthUs = desiredUs;
+    else
+        m_targetDepthUs = std::max(desiredUs, m_targetDepthUs - m_config.maxDecreaseUs);
+}
+
+void JitterBuffer::setConfig(const JitterEstimator::Config &config)
+{
+    m_estimator.setConfig(config);
+    m_resetRequested.store(true, std::memory_order_release);
+}
+
+bool JitterBuffer::push(const uint8_t *data, size_t size, int64_t arrivalUs)
+{
+    if (m_resetRequested.exchange(false, std::memory_order_acq_rel)) {
+        m_estimator.reset();
+        m_sampleRate = 0;
+    }
+
+    Packet *slot = size <= MaxPacketSize ? m_ring.beginWrite() : nullptr;
+    if (!slot) {
+        m_packetsDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Packets without a readable media time go straight to the decoder, which rejects them
+    int64_t deadlineUs = arrivalUs;
+    // Only the RTP timestamp and the first frame's sample rate are needed here
+    MediaPacket packet;
+    packet.parse({ data, size }, false);
+    if (!packet.frames().empty()) {
+        const uint32_t timestamp = packet.timestamp();
+        const int sampleRate = packet.frames().front().header.sampleRate;
+        if (sampleRate != m_sampleRate) {
+            m_estimator.reset();
+            m_sampleRate = sampleRate;
+            m_mediaSamples = 0;
+        }
+        else {
+            m_mediaSamples += int32_t(timestamp - m_lastTimestamp);
+        }
+        m_lastTimestamp = timestamp;
+
+        const uint64_t lateBefore = m_estimator.latePackets();
+        deadlineUs = m_estimator.addPacket(arrivalUs, m_mediaSamples * 1000000 / m_sampleRate);
+        if (m_estimator.latePackets() != lateBefore)
+            m_packetsLate.fetch_add(1, std::memory_order_relaxed);
+
+        m_targetDepthUs.store(m_estimator.targetDepthUs(), std::memory_order_relaxed);
+        m_jitterP50Us.store(m_estimator.jitterP50Us(), std::memory_order_relaxed);
+        m_jitterP95Us.store(m_estimator.jitterP95Us(), std::memory_order_relaxed);
+        m_jitterP99Us.store(m_estimator.jitterP99Us(), std::memory_order_relaxed);
+    }
+
+    std::memcpy(slot->data, data, size);
+    slot->size = uint32_t(size);
+    slot->deadlineUs = deadlineUs;
+    m_ring.commitWrite();
+    m_packetsQueued.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void JitterBuffer::clear()
+{
+    while (m_ring.front())
+        m_ring.pop();
+}
+
+void JitterBuffer::reset()
+{
+    m_resetRequested.store(true, std::memory_order_release);
+}
+
+JitterBuffer::Statistics JitterBuffer::statistics() const
+{
+    Statistics stats;
+    stats.targetDepthUs = m_targetDepthUs.load(std::memory_order_relaxed);
+    stats.jitterP50Us = m_jitterP50Us.load(std::memory_order_relaxed);
+    stats.jitterP95Us = m_jitterP95Us.load(std::memory_order_relaxed);
+    stats.jitterP99Us = m_jitterP99Us.load(std::memory_order_relaxed);
+    stats.packetsQueued = m_packetsQueued.load(std::memory_order_relaxed);
+    stats.packetsLate = m_packetsLate.load(std::memory_order_relaxed);
+    stats.packetsDropped = m_packetsDropped.load(std::memory_order_relaxed);
+    stats.bufferedPackets = m_ring.size();
+    return stats;
+}
+
+int64_t JitterBuffer::steadyMicros()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
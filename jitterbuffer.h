@@ -0,0 +1,136 @@
+#ifndef JITTERBUFFER_H
+#define JITTERBUFFER_H
+
+#include "spscring.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <vector>
+
+// Learns packet arrival jitter and picks a playout delay for it.
+//
+// Each packet's transit time (arrival minus media time) is compared with the smallest transit in
+// a sliding window; the difference is its jitter. The target depth is the jitter quantile that
+// leaves `underrunBudget` of packets late, so clean links get a shallow buffer and bursty ones a
+// deeper one. Pure bookkeeping with caller-supplied timestamps, so recorded traces replay exactly.
+class JitterEstimator
+{
+public:
+    struct Config {
+        double underrunBudget = 0.01;   // tolerated fraction of late packets
+        int64_t initialDepthUs = 40000; // used until the window has enough samples
+        int64_t minDepthUs = 5000;
+        int64_t maxDepthUs = 250000;
+        int windowPackets = 512;        // arrival history the statistics are computed over
+        int updateInterval = 8;         // packets between target recomputations
+        int64_t maxDecreaseUs = 500;    // per update; increases apply immediately
+    };
+
+    JitterEstimator();
+    explicit JitterEstimator(const Config &config);
+
+    void setConfig(const Config &config);
+    const Config &config() const { return m_config; }
+
+    void reset();
+
+    // Records one packet and returns its playout deadline on the arrival clock.
+    // The packet is late if it arrived after that deadline.
+    int64_t addPacket(int64_t arrivalUs, int64_t mediaUs);
+
+    int64_t targetDepthUs() const { return m_targetDepthUs; }
+
+    // Jitter percentiles over the current window, as of the last update
+    int64_t jitterP50Us() const { return m_p50Us; }
+    int64_t jitterP95Us() const { return m_p95Us; }
+    int64_t jitterP99Us() const { return m_p99Us; }
+
+    uint64_t packets() const { return m_packets; }
+    uint64_t latePackets() const { return m_latePackets; }
+
+private:
+    void update();
+
+    Config m_config;
+    std::vector<int64_t> m_transits;    // ring of the last windowPackets transit times
+    std::vector<int64_t> m_scratch;
+    size_t m_next = 0;
+    size_t m_filled = 0;
+    int64_t m_baselineUs = 0;
+    int64_t m_targetDepthUs = 0;
+    int64_t m_p50Us = 0;
+    int64_t m_p95Us = 0;
+    int64_t m_p99Us = 0;
+    uint64_t m_packets = 0;
+    uint64_t m_latePackets = 0;
+};
+
+// Jitter buffer between packet reception (transport thread) and decoding (decode thread).
+// push() stamps each media packet with a playout deadline from a JitterEstimator and copies it
+// into a wait-free ring; the consumer takes packets once their deadline has passed.
+class JitterBuffer
+{
+public:
+    static constexpr size_t MaxPacketSize = 1024;
+
+    struct Packet {
+        int64_t deadlineUs;
+        uint32_t size;
+        uint8_t data[MaxPacketSize];
+    };
+
+    struct Statistics {
+        int64_t targetDepthUs = 0;
+        int64_t jitterP50Us = 0;
+        int64_t jitterP95Us = 0;
+        int64_t jitterP99Us = 0;
+        uint64_t packetsQueued = 0;
+        uint64_t packetsLate = 0;       // arrived after their playout deadline
+        uint64_t packetsDropped = 0;    // oversized, or the ring was full
+        size_t bufferedPackets = 0;
+    };
+
+    JitterBuffer() = default;
+
+    // Only while neither side is running
+    void setConfig(const JitterEstimator::Config &config);
+
+    // Producer: queues a copy of an RTP media packet. Returns false if it was dropped.
+    bool push(const uint8_t *data, size_t size, int64_t arrivalUs);
+
+    // Consumer: oldest packet, or nullptr if empty (check deadlineUs before using it)
+    const Packet *front() { return m_ring.front(); }
+    void pop() { m_ring.pop(); }
+
+    // Consumer: drops every queued packet
+    void clear();
+
+    // Forgets the learned statistics before the next push (safe to call from any thread)
+    void reset();
+
+    Statistics statistics() const;
+
+    // Clock the arrival timestamps are expected on
+    static int64_t steadyMicros();
+
+private:
+    SpscRing<Packet, 128> m_ring;
+
+    // Producer side
+    JitterEstimator m_estimator;
+    uint32_t m_lastTimestamp = 0;
+    int64_t m_mediaSamples = 0;
+    int m_sampleRate = 0;
+    std::atomic<bool> m_resetRequested{true};
+
+    std::atomic<int64_t> m_targetDepthUs{0};
+    std::atomic<int64_t> m_jitterP50Us{0};
+    std::atomic<int64_t> m_jitterP95Us{0};
+    std::atomic<int64_t> m_jitterP99Us{0};
+    std::atomic<uint64_t> m_packetsQueued{0};
+    std::atomic<uint64_t> m_packetsLate{0};
+    std::atomic<uint64_t> m_packetsDropped{0};
+};
+
+#endif // JITTERBUFFER_H
@@ -0,0 +1,306 @@
+#include "linkcontroller.h"
+#include "binarylog.h"
+#include "spantrace.h"
+
+#ifdef DEBUG_BUILD
+#include "btsnoopreplaybackend.h"
+#endif
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QTimer>
+#include <QDebug>
+
+LinkController::LinkController(QObject *parent)
+    : LinkController(QCoreApplication::applicationDirPath(), parent)
+{
+}
+
+LinkController::LinkController(const QString &directory, QObject *parent)
+    : QObject(parent)
+    , m_sink(new BluetoothA2DPSink(this))
+    , m_discoveryAgent(new QBluetoothDeviceDiscoveryAgent(this))
+    , m_audioSessionManager(nullptr)
+    , m_cache(directory + "/devicecache.json")
+    , m_connectedDevice(0)
+    , m_config(directory + "/init.json", &m_writer)
+{
+#ifdef DEBUG_BUILD
+    // Captures from problem phones show up as extra devices that replay their media stream
+    if (qEnvironmentVariableIsSet(BtsnoopReplayBackend::EnvironmentVariable)) {
+        const QStringList captures = qEnvironmentVariable(BtsnoopReplayBackend::EnvironmentVariable)
+                                         .split(QDir::listSeparator(), Qt::SkipEmptyParts);
+        m_sink->addBackend(new BtsnoopReplayBackend(captures));
+    }
+#endif
+
+    connect(m_sink, &BluetoothA2DPSink::devicesDiscovered, this, &LinkController::onDevicesDiscovered);
+    connect(m_sink, &BluetoothA2DPSink::discoveryCompleted, this, &LinkController::onDiscoveryCompleted);
+
+    connect(m_sink, &BluetoothA2DPSink::connectionOpened, this, [this]() {
+        // The device of the attempt that actually opened, not whatever was requested last
+        const QString deviceId = m_sink->currentDeviceId();
+        if (const DeviceRegistry::Device *device = m_devices.findByDeviceId(deviceId))
+            m_connectedDevice = device->key;
+        m_cache.markConnected(deviceId, m_sink->connectionStats().lastConnectMs(deviceId));
+        saveCache();
+    });
+
+    // Released, dropped by the phone or superseded by another connect
+    connect(m_sink, &BluetoothA2DPSink::connectionStateChanged, this, [this](BluetoothA2DPSink::ConnectionState state) {
+        if (state != BluetoothA2DPSink::ConnectionState::Streaming)
+            m_connectedDevice = 0;
+    });
+
+    // Written after every recorded connect, including one the release in shutdown() finishes
+    connect(m_sink, &BluetoothA2DPSink::connectTimeMeasured, this, &LinkController::saveConnectStats);
+
+    connect(m_discoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered, this, &LinkController::appendDevice);
+    connect(m_discoveryAgent, &QBluetoothDeviceDiscoveryAgent::errorOccurred, this,
+            [this](QBluetoothDeviceDiscoveryAgent::Error error) {
+        qDebug() << "Discovery error:" << error;
+        if (error != QBluetoothDeviceDiscoveryAgent::NoError)
+            emit discoveryError(error);
+    });
+
+    connect(&m_writer, &AsyncFileWriter::writeFailed, this, &LinkController::saveFailed);
+}
+
+LinkController::~LinkController()
+{
+    shutdown();
+}
+
+void LinkController::loadConfig()
+{
+    QString error;
+    if (!m_config.load(&error)) {
+        emit configError(tr("Settings Not Loaded"),
+                         tr("\'init.json\' could not be read (%1). The default settings are used, and the file is "
+                            "replaced when a setting changes.").arg(error));
+    }
+}
+
+void LinkController::saveConfig()
+{
+    m_config.save();
+    saveCache();
+}
+
+void LinkController::start()
+{
+    populateFromCache();    // devices from earlier runs are usable right away
+    startDiscovery();       // discovery refreshes them and looks for new ones
+
+    const QStringList arguments = QCoreApplication::arguments();
+    const int connectIndex = arguments.indexOf("--connect");
+    if (connectIndex >= 0)
+        connectWhenAvailable(QBluetoothAddress(arguments.value(connectIndex + 1)));
+    else if (connectAutomatically())
+        connectWhenAvailable(savedDeviceAddress());
+}
+
+void LinkController::shutdown()
+{
+    if (!m_sink)
+        return;
+
+    if (m_audioSessionManager) {
+        qDebug() << "Cleaning up AudioSessionManager";
+        m_audioSessionManager->cleanup();
+        m_audioSessionManager->deleteLater();
+        m_audioSessionManager = nullptr;
+    }
+
+    m_sink->releaseConnection();
+
+    qDebug() << "Stopping discovery";
+    m_discoveryAgent->stop();
+    m_discoveryAgent->deleteLater();
+    m_discoveryAgent = nullptr;
+    m_sink->stopDeviceDiscovery();
+    m_sink->deleteLater();
+    m_sink = nullptr;
+
+    if (m_config.hasUnsavedChanges())
+        m_config.save();
+    saveCache();
+    m_writer.flush();
+}
+
+void LinkController::startDiscovery()
+{
+    if (!m_sink)
+        return;
+
+    // Known devices stay listed; discovery adds new ones and refreshes the rest in place.
+    // Qt discovery provides names and classes, DeviceWatcher the IDs used to connect.
+    TRACE_SCOPE("discovery", "startDiscovery");
+    TRACE_ASYNC_BEGIN("discovery", "discovery", this);
+    m_discoveryAgent->stop();
+    m_discoveryAgent->start();
+    m_sink->startDeviceDiscovery();
+}
+
+void LinkController::connectWhenAvailable(const QBluetoothAddress &address)
+{
+    m_pendingConnect = address;
+    tryAutoConnect();
+}
+
+bool LinkController::connectDevice(quint64 key)
+{
+    TRACE_SCOPE("link", "connectDevice");
+    const DeviceRegistry::Device *device = m_devices.find(key);
+    if (!m_sink || !device || device->deviceId.isEmpty()) {
+        qWarning() << "Device not found in A2DP device map:" << (device ? device->name() : QString::number(key, 16));
+        return false;
+    }
+
+    qDebug() << "Connecting to" << device->name() << "with Windows device ID" << device->deviceId;
+
+    // Enables the sink and opens it as soon as that completes; m_connectedDevice is set when it opens.
+    // A refused attempt has already been reported through the sink's connectionError.
+    if (!m_sink->connectDevice(device->deviceId))
+        return false;
+    emit connecting(key);
+
+    // Set our name and icon in the volume mixer once the session exists; retry since it shows up late
+    if (!m_audioSessionManager)
+        m_audioSessionManager = new AudioSessionManager(this);
+    const QString displayName = QString("Phone Audio Link (%1)").arg(device->name());
+    const QString exePath = QCoreApplication::applicationFilePath();
+    TRACE_ASYNC_BEGIN("session", "volume mixer retries", this);
+    for (int delayMs : { 500, 2000, 7000 }) {
+        QTimer::singleShot(delayMs, this, [this, displayName, exePath, last = delayMs == 7000]() {
+            TRACE_SCOPE("session", "volume mixer retry");
+            if (m_audioSessionManager)
+                m_audioSessionManager->setSessionProperties(displayName, exePath);
+            if (last)
+                TRACE_ASYNC_END("session", "volume mixer retries", this);
+        });
+    }
+    return true;
+}
+
+void LinkController::disconnectDevice()
+{
+    if (m_sink)
+        m_sink->releaseConnection();
+}
+
+void LinkController::playPause()
+{
+    if (m_sink)
+        m_sink->sendPlayPause();
+}
+
+void LinkController::next()
+{
+    if (m_sink)
+        m_sink->sendNext();
+}
+
+void LinkController::previous()
+{
+    if (m_sink)
+        m_sink->sendPrevious();
+}
+
+bool LinkController::isStreaming() const
+{
+    return m_sink && m_sink->connectionState() == BluetoothA2DPSink::ConnectionState::Streaming;
+}
+
+void LinkController::appendDevice(const QBluetoothDeviceInfo &info)
+{
+    // Unnamed devices are listed by Qt under their address
+    if (info.name().startsWith("Bluetooth") && info.name().contains(":"))
+        return;
+
+    m_cache.update(info);
+
+    const DeviceRegistry::Device &device = m_devices.at(m_devices.addDevice(info));
+    if (!device.deviceId.isEmpty())
+        m_cache.setDeviceId(info.address(), device.deviceId);
+
+    emit deviceUpdated(device);
+    tryAutoConnect();
+}
+
+void LinkController::onDevicesDiscovered(const QList<A2DPDevice> &devices)
+{
+    TRACE_SCOPE("discovery", "onDevicesDiscovered");
+    for (const A2DPDevice &device : devices) {
+        LOG_DEBUG("A2DP device discovered: %1 with ID: %2", device.name, device.deviceId);
+
+#ifdef DEBUG_BUILD
+        // Replayed captures have no Bluetooth device behind them, so Qt discovery never lists them
+        if (device.deviceId.startsWith(QLatin1String(BtsnoopReplayBackend::DeviceIdPrefix))) {
+            emit deviceUpdated(m_devices.at(m_devices.addVirtualDevice(device.deviceId, device.name)));
+            continue;
+        }
+#endif
+
+        const int index = m_devices.addDeviceId(device.deviceId, device.name);
+        if (index != -1)
+            m_cache.setDeviceId(m_devices.at(index).info.address(), device.deviceId);
+    }
+
+    // Once per batch; the saved device may be among them
+    tryAutoConnect();
+}
+
+void LinkController::onDiscoveryCompleted()
+{
+    TRACE_SCOPE("discovery", "onDiscoveryCompleted");
+    TRACE_ASYNC_END("discovery", "discovery", this);
+    int connectable = 0;
+    for (const DeviceRegistry::Device &device : m_devices.devices()) {
+        if (!device.deviceId.isEmpty())
+            connectable++;
+    }
+    qDebug() << "A2DP discovery completed." << connectable << "of" << m_devices.size() << "devices can be connected";
+    saveCache();
+}
+
+void LinkController::populateFromCache()
+{
+    for (const DeviceCache::Entry &entry : m_cache.entries()) {
+        const int index = m_devices.addDevice(DeviceCache::deviceInfo(entry));
+        m_devices.setDeviceId(m_devices.at(index).key, entry.deviceId);
+        emit deviceUpdated(m_devices.at(index));
+    }
+}
+
+void LinkController::tryAutoConnect()
+{
+    if (m_pendingConnect.isNull())
+        return;
+
+    // Needs the device and its Windows device ID
+    const DeviceRegistry::Device *device = m_devices.find(m_pendingConnect);
+    if (!device || device->deviceId.isEmpty())
+        return;
+
+    m_pendingConnect.clear();
+    qDebug() << "Auto-connecting to" << device->name();
+    connectDevice(device->key);
+}
+
+void LinkController::saveCache()
+{
+    const QByteArray changes = m_cache.takeChanges();
+    if (!changes.isEmpty())
+        m_writer.write(m_cache.path(), changes);
+}
+
+void LinkController::saveConnectStats()
+{
+    if (!m_sink)
+        return;
+    ConnectionStats &stats = m_sink->connectionStats();
+    const QByteArray changes = stats.takeChanges();
+    if (!changes.isEmpty())
+        m_writer.write(stats.path(), changes);
+}
@@ -0,0 +1,118 @@
+#ifndef LINKCONTROLLER_H
+#define LINKCONTROLLER_H
+
+#include "asyncfilewriter.h"
+#include "audiosessionmanager.h"
+#include "bluetootha2dpsink.h"
+#include "configstore.h"
+#include "devicecache.h"
+#include "deviceregistry.h"
+
+#include <QBluetoothAddress>
+#include <QBluetoothDeviceDiscoveryAgent>
+#include <QBluetoothDeviceInfo>
+#include <QObject>
+#include <QString>
+
+// Everything PhoneAudioLink does without a window: the A2DP sink, both discovery paths, the
+// device registry and cache, the init.json settings and auto-connect. The main window and the
+// headless daemon (--headless) are front ends to it; it never touches widgets, and reports
+// problems through signals for the front end to show or log.
+class LinkController : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LinkController(QObject *parent = nullptr);
+
+    // Keeps init.json and the device cache in directory instead of the application directory
+    explicit LinkController(const QString &directory, QObject *parent = nullptr);
+    ~LinkController() override;
+
+    // Reads init.json. Missing or unreadable values keep their defaults; an unreadable file is
+    // reported once through configError.
+    void loadConfig();
+
+    // Queues init.json and the device cache for writing on the writer thread. Setting changes
+    // are saved on their own shortly after; this only makes it happen now.
+    void saveConfig();
+
+    // Lists the cached devices, starts discovery and auto-connects if configured. `--connect <address>`
+    // on the command line connects to that device instead.
+    void start();
+
+    // Stops discovery and the connection and waits for pending saves. Nothing works after this;
+    // sink() returns nullptr.
+    void shutdown();
+
+    void startDiscovery();
+
+    // Connects to the device with the given registry key. False if it has no Windows device ID yet
+    // or the sink refused the attempt.
+    bool connectDevice(quint64 key);
+
+    // Connects right away if the device is known and connectable, otherwise once discovery finds it
+    void connectWhenAvailable(const QBluetoothAddress &address);
+
+    void disconnectDevice();
+
+    void playPause();
+    void next();
+    void previous();
+
+    BluetoothA2DPSink *sink() const { return m_sink; }
+    const DeviceRegistry &devices() const { return m_devices; }
+    bool isStreaming() const;
+
+    // Registry key of the connected device, 0 if there is none
+    quint64 connectedDevice() const { return m_connectedDevice; }
+
+    // init.json settings; the defaults apply to values missing from the file
+    bool maximizeBluetoothCompatability() const { return m_config.value("maximizeBluetoothCompatability").toBool(false); }
+    void setMaximizeBluetoothCompatability(bool enabled) { m_config.setValue("maximizeBluetoothCompatability", enabled); }
+    bool startMinimized() const { return m_config.value("startMinimized").toBool(false); }
+    void setStartMinimized(bool enabled) { m_config.setValue("startMinimized", enabled); }
+    bool connectAutomatically() const { return m_config.value("connectAutomatically").toBool(false); }
+    void setConnectAutomatically(bool enabled) { m_config.setValue("connectAutomatically", enabled); }
+    QBluetoothAddress savedDeviceAddress() const { return QBluetoothAddress(m_config.value("device").toString()); }
+    void setSavedDeviceAddress(const QBluetoothAddress &address) { m_config.setValue("device", address.toString()); }
+    bool releaseWindowWhenHidden() const { return m_config.value("releaseWindowWhenHidden").toBool(true); }
+    void setReleaseWindowWhenHidden(bool enabled) { m_config.setValue("releaseWindowWhenHidden", enabled); }
+
+signals:
+    // A device was added to the registry or refreshed
+    void deviceUpdated(const DeviceRegistry::Device &device);
+
+    // A connect to the device started, by request or by auto-connect
+    void connecting(quint64 key);
+
+    void discoveryError(QBluetoothDeviceDiscoveryAgent::Error error);
+    void configError(const QString &title, const QString &message);
+
+    // Writing init.json or the device cache failed; the previous file is still intact
+    void saveFailed(const QString &path, const QString &error);
+
+private:
+    friend class DiscoveryBenchmark;    // drives the discovery path in benchmark.cpp
+
+    void appendDevice(const QBluetoothDeviceInfo &info);
+    void onDevicesDiscovered(const QList<A2DPDevice> &devices);
+    void onDiscoveryCompleted();
+    void populateFromCache();
+    void tryAutoConnect();
+    void saveCache();
+    void saveConnectStats();
+
+    BluetoothA2DPSink *m_sink;
+    QBluetoothDeviceDiscoveryAgent *m_discoveryAgent;
+    AudioSessionManager *m_audioSessionManager;    // names the app in the volume mixer; created on first connect
+
+    DeviceRegistry m_devices;
+    DeviceCache m_cache;
+    quint64 m_connectedDevice;
+    QBluetoothAddress m_pendingConnect;     // device to connect to once it can be resolved
+
+    AsyncFileWriter m_writer;   // before m_config, which writes through it
+    ConfigStore m_config;
+};
+
+#endif // LINKCONTROLLER_H
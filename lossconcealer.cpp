@@ -0,0 +1,146 @@
+#include "lossconcealer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+int16_t toSample(float value)
+{
+    return int16_t(std::clamp(std::lrint(value), -32768L, 32767L));
+}
+
+} // namespace
+
+PacketLossConcealer::PacketLossConcealer()
+{
+    reset();
+}
+
+void PacketLossConcealer::reset()
+{
+    std::memset(m_history, 0, sizeof(m_history));
+    m_channels = 0;
+    m_filled = 0;
+    m_concealing = false;
+    m_period = MinPeriod;
+    m_concealedFrames = 0;
+}
+
+void PacketLossConcealer::decoded(int16_t *pcm, int frames, int channels)
+{
+    channels = std::clamp(channels, 1, MaxChannels);
+    if (channels != m_channels) {
+        reset();
+        m_channels = channels;
+    }
+
+    // Blend the substitute into the returning signal to hide the decoder's restart
+    if (m_concealing) {
+        int16_t substitute[CrossfadeFrames * MaxChannels];
+        const int fade = std::min(CrossfadeFrames, frames);
+        synthesize(substitute, fade);
+        for (int i = 0; i < fade; i++) {
+            const float weight = float(i + 1) / float(fade + 1);
+            const float gain = (1.0f - weight) * substituteGain(m_concealedFrames + i);
+            for (int c = 0; c < channels; c++) {
+                int16_t &sample = pcm[i * channels + c];
+                sample = toSample(weight * sample + gain * substitute[i * channels + c]);
+            }
+        }
+        m_concealing = false;
+    }
+
+    appendHistory(pcm, frames);
+}
+
+void PacketLossConcealer::conceal(int16_t *pcm, int frames, int channels)
+{
+    channels = std::clamp(channels, 1, MaxChannels);
+    if (channels != m_channels) {
+        reset();
+        m_channels = channels;
+    }
+
+    if (!m_concealing) {
+        m_period = findPeriod();
+        m_concealedFrames = 0;
+        m_concealing = true;
+    }
+
+    // The unfaded continuation goes into the history so the next call (and the next loss
+    // event) carries on from a seamless signal; only the output is faded
+    for (int done = 0; done < frames;) {
+        const int chunk = std::min(frames - done, HistoryFrames);
+        int16_t *out = pcm + done * channels;
+        synthesize(out, chunk);
+        appendHistory(out, chunk);
+        for (int i = 0; i < chunk; i++) {
+            const float gain = substituteGain(m_concealedFrames++);
+            for (int c = 0; c < channels; c++)
+                out[i * channels + c] = toSample(gain * out[i * channels + c]);
+        }
+        done += chunk;
+    }
+}
+
+// Lag whose preceding window best matches the most recent MatchWindow frames (normalized
+// cross-correlation with the channels treated as one vector, so a period has to fit all of them)
+int PacketLossConcealer::findPeriod() const
+{
+    const int maxLag = std::min(MaxPeriod, m_filled - MatchWindow);
+    if (maxLag < MinPeriod)
+        return MinPeriod;
+
+    const int samples = MatchWindow * m_channels;
+    const int16_t *target = m_history + (HistoryFrames - MatchWindow) * m_channels;
+    float targetEnergy = 0.0f;
+    for (int i = 0; i < samples; i++)
+        targetEnergy += float(target[i]) * float(target[i]);
+
+    int bestLag = MinPeriod;
+    float bestScore = -2.0f;
+    for (int lag = MinPeriod; lag <= maxLag; lag++) {
+        const int16_t *candidate = target - lag * m_channels;
+        float correlation = 0.0f;
+        float energy = 0.0f;
+        for (int i = 0; i < samples; i++) {
+            correlation += float(target[i]) * float(candidate[i]);
+            energy += float(candidate[i]) * float(candidate[i]);
+        }
+        const float denominator = std::sqrt(energy * targetEnergy);
+        const float score = denominator > 0.0f ? correlation / denominator : 0.0f;
+        if (score > bestScore) {
+            bestScore = score;
+            bestLag = lag;
+        }
+    }
+    return bestLag;
+}
+
+// Periodic continuation of the history: each frame repeats the one a period earlier
+void PacketLossConcealer::synthesize(int16_t *out, int frames) const
+{
+    const int16_t *source = m_history + (HistoryFrames - m_period) * m_channels;
+    for (int i = 0; i < frames * m_channels; i++) {
+        const int back = i - m_period * m_channels;
+        out[i] = back < 0 ? source[i] : out[back];
+    }
+}
+
+void PacketLossConcealer::appendHistory(const int16_t *pcm, int frames)
+{
+    const int kept = std::max(0, HistoryFrames - frames);
+    const int copied = std::min(frames, HistoryFrames);
+    std::memmove(m_history, m_history + (HistoryFrames - kept) * m_channels, size_t(kept) * m_channels * sizeof(int16_t));
+    std::memcpy(m_history + kept * m_channels, pcm + (frames - copied) * m_channels, size_t(copied) * m_channels * sizeof(int16_t));
+    m_filled = std::min(HistoryFrames, m_filled + frames);
+}
+
+// Full level for HoldFrames, then a linear ramp to silence
+float PacketLossConcealer::substituteGain(int concealedFrames)
+{
+    const int faded = concealedFrames - HoldFrames;
+    return faded <= 0 ? 1.0f : std::max(0.0f, 1.0f - float(faded) / float(FadeFrames));
+}
@@ -0,0 +1,51 @@
+#ifndef LOSSCONCEALER_H
+#define LOSSCONCEALER_H
+
+#include <cstdint>
+
+// Packet loss concealment for decoded PCM by pitch-synchronous waveform substitution.
+//
+// Keeps a short history of the decoded output. When frames are missing, the strongest pitch
+// period in that history is found once per loss event and repeated, holding level briefly and
+// then fading to silence; the first good frame afterwards is crossfaded in. Every call does a
+// bounded amount of work (the period search is capped at MaxPeriod x MatchWindow multiplies),
+// and nothing allocates.
+class PacketLossConcealer
+{
+public:
+    static constexpr int MaxChannels = 2;
+    static constexpr int HistoryFrames = 1024;
+    static constexpr int MinPeriod = 32;        // ~1.4 kHz at 44.1 kHz
+    static constexpr int MaxPeriod = 640;       // ~70 Hz
+    static constexpr int MatchWindow = 128;     // frames compared per candidate period
+    static constexpr int CrossfadeFrames = 64;
+    static constexpr int HoldFrames = 512;      // full-level substitution before the fade
+    static constexpr int FadeFrames = 2048;     // ramp down to silence
+
+    PacketLossConcealer();
+
+    void reset();
+
+    // Records a good frame; crossfades its start if it ends a concealed gap
+    void decoded(int16_t *pcm, int frames, int channels);
+
+    // Fills frames of interleaved PCM in place of missing audio
+    void conceal(int16_t *pcm, int frames, int channels);
+
+    bool isConcealing() const { return m_concealing; }
+
+private:
+    int findPeriod() const;
+    void synthesize(int16_t *out, int frames) const;
+    void appendHistory(const int16_t *pcm, int frames);
+    static float substituteGain(int concealedFrames);
+
+    int16_t m_history[HistoryFrames * MaxChannels];
+    int m_channels;
+    int m_filled;
+    bool m_concealing;
+    int m_period;
+    int m_concealedFrames;
+};
+
+#endif // LOSSCONCEALER_H
@@ -1,7 +1,17 @@
 #include "phoneaudiolink.h"
+#include "benchmark.h"
+#include "binarylog.h"
+#include "controlclient.h"
+#include "flightrecorder.h"
+#include "headless.h"
+#include "processstats.h"
+#include "singleinstance.h"
+#include "spantrace.h"
+#include "startuptrace.h"
 
 #include <QApplication>
 #include <QLocale>
+#include <QTimer>
 #include <QTranslator>
 
 #include <iomanip>
@@ -17,9 +27,69 @@
 
 int main(int argc, char *argv[])
 {
+    StartupTrace::mark("main");
     qputenv("QT_LOGGING_RULES", "qt.qpa.fonts=false");
 
+    // Benchmarks run headless; the ones that drive widgets get a QApplication but show no windows
+    for (int i = 1; i < argc; i++) {
+        if (qstrcmp(argv[i], "--benchmark") == 0) {
+            if (i + 1 < argc && Benchmark::needsWidgets(QString::fromLocal8Bit(argv[i + 1]))) {
+                QApplication app(argc, argv);
+                return Benchmark::run(app.arguments());
+            }
+            QCoreApplication app(argc, argv);
+            return Benchmark::run(app.arguments());
+        }
+    }
+
+    // Binary log files and flight recorder dumps back to text
+    for (int i = 1; i < argc; i++) {
+        if (qstrcmp(argv[i], "--decode-log") == 0) {
+            QCoreApplication app(argc, argv);
+            return BinaryLog::decode(app.arguments());
+        }
+        if (qstrcmp(argv[i], "--view-flight") == 0) {
+            QCoreApplication app(argc, argv);
+            return FlightRecorder::view(app.arguments());
+        }
+    }
+
+    // A client of the running instance
+    for (int i = 1; i < argc; i++) {
+        if (qstrcmp(argv[i], "--control") == 0) {
+            QCoreApplication app(argc, argv);
+            return ControlClient::run(app.arguments());
+        }
+    }
+
+    // A second launch hands its command line to the running instance and exits before creating anything
+    QStringList arguments;
+    for (int i = 0; i < argc; i++)
+        arguments.append(QString::fromLocal8Bit(argv[i]));
+    SingleInstance instance;
+    if (!instance.tryAcquire())
+        return SingleInstance::forward(arguments) ? 0 : 1;
+    StartupTrace::mark("single instance lock taken");
+    StartupTrace::setEnabled(arguments.contains("--trace-startup"));
+#ifdef PHONEAUDIOLINK_TRACING
+    SpanTrace::setEnabled(arguments.contains("--trace-spans"));
+#else
+    if (arguments.contains("--trace-spans"))
+        qWarning() << "--trace-spans needs a build with span tracing (qmake CONFIG+=tracing)";
+#endif
+
+    // No window at all; LinkController on a QCoreApplication
+    if (arguments.contains("--headless"))
+        return Headless::run(argc, argv);
+
     QApplication a(argc, argv);
+    StartupTrace::mark("application created");
+    BinaryLog::Session log(QCoreApplication::applicationDirPath() + "/logs");
+    FlightRecorder::Session flightRecorder(QCoreApplication::applicationDirPath() + "/logs");
+#ifdef PHONEAUDIOLINK_TRACING
+    if (SpanTrace::isEnabled())
+        SpanTrace::saveWhenQuitting();
+#endif
 
     QTranslator translator;
     const QStringList uiLanguages = QLocale::system().uiLanguages();
@@ -30,7 +100,9 @@ int main(int argc, char *argv[])
             break;
         }
     }
+    StartupTrace::mark("translations loaded");
     PhoneAudioLink w;
+    w.start();
     w.setWindowTitle("Phone Audio Link v"+VERSION_STR());
     w.setWindowFlags(Qt::CustomizeWindowHint        |
                      Qt::WindowTitleHint            |
@@ -38,5 +110,11 @@ int main(int argc, char *argv[])
                      Qt::WindowCloseButtonHint      |
                      Qt::MSWindowsFixedSizeDialogHint);
     if(!w.getStartMinimized())w.show();
+    StartupTrace::mark(w.getStartMinimized() ? "window constructed (minimized)" : "window shown");
+    QTimer::singleShot(0, &w, [](){
+        StartupTrace::mark("event loop running");
+        StartupTrace::dump();
+        ProcessStats::logStartup("window event loop running");
+    });
     return a.exec();
 }
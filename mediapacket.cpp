@@ -0,0 +1,107 @@
+#include "mediapacket.h"
+
+namespace {
+
+uint32_t readBigEndian32(const uint8_t *data)
+{
+    return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | data[3];
+}
+
+} // namespace
+
+MediaPacket::Status MediaPacket::parse(std::span<const uint8_t> packet, bool checkCrc)
+{
+    m_frameCount = 0;
+    m_corruptFrames = 0;
+    m_rtpValid = false;
+    m_fragmented = false;
+    m_firstFragment = false;
+    m_lastFragment = false;
+    m_declaredFrames = 0;
+
+    // RTP header: V=2, P, X, CSRC count / M, PT / sequence / timestamp / SSRC
+    if (packet.size() < RtpHeaderSize)
+        return fail(Status::Truncated);
+    const uint8_t *data = packet.data();
+    if ((data[0] >> 6) != 2)
+        return fail(Status::BadVersion);
+
+    m_marker = data[1] & 0x80;
+    m_payloadType = data[1] & 0x7f;
+    m_sequence = uint16_t((data[2] << 8) | data[3]);
+    m_timestamp = readBigEndian32(data + 4);
+    m_ssrc = readBigEndian32(data + 8);
+
+    size_t offset = RtpHeaderSize + 4 * size_t(data[0] & 0x0f);
+    size_t end = packet.size();
+    if (offset > end)
+        return fail(Status::Truncated);
+    if (data[0] & 0x10) {
+        if (offset + 4 > end)
+            return fail(Status::BadExtension);
+        offset += 4 + 4 * size_t((data[offset + 2] << 8) | data[offset + 3]);
+        if (offset > end)
+            return fail(Status::BadExtension);
+    }
+    if (data[0] & 0x20) {
+        const size_t padding = data[end - 1];
+        if (padding == 0 || padding > end - offset)
+            return fail(Status::BadPadding);
+        end -= padding;
+    }
+    m_rtpValid = true;
+
+    // A2DP SBC media payload header: F, S, L, RFA, then the frame (or fragment) count
+    if (offset >= end)
+        return fail(Status::Truncated);
+    const uint8_t payloadHeader = data[offset++];
+    m_fragmented = payloadHeader & 0x80;
+    m_firstFragment = payloadHeader & 0x40;
+    m_lastFragment = payloadHeader & 0x20;
+    m_declaredFrames = payloadHeader & 0x0f;
+    if (m_fragmented)
+        return fail(Status::Fragmented);
+    if (m_declaredFrames == 0)
+        return fail(Status::NoFrames);
+
+    for (int i = 0; i < m_declaredFrames; i++) {
+        SbcFrameView &frame = m_frames[m_frameCount];
+        if (!Sbc::parseHeader(data + offset, end - offset, frame.header))
+            return fail(end - offset < size_t(Sbc::HeaderSize) ? Status::Truncated : Status::BadFrameHeader);
+
+        const size_t length = size_t(frame.header.frameLength());
+        if (length > end - offset)
+            return fail(Status::Truncated);
+
+        frame.data = packet.subspan(offset, length);
+        frame.crcValid = !checkCrc || Sbc::frameCrc(data + offset, frame.header) == frame.header.crc;
+        if (!frame.crcValid)
+            m_corruptFrames++;
+        m_frameCount++;
+        offset += length;
+    }
+
+    m_status = Status::Ok;
+    return m_status;
+}
+
+MediaPacket::Status MediaPacket::fail(Status status)
+{
+    m_status = status;
+    return status;
+}
+
+const char *MediaPacket::statusName(Status status)
+{
+    switch (status) {
+    case Status::Ok:             return "ok";
+    case Status::Truncated:      return "truncated";
+    case Status::BadVersion:     return "bad-version";
+    case Status::BadExtension:   return "bad-extension";
+    case Status::BadPadding:     return "bad-padding";
+    case Status::Fragmented:     return "fragmented";
+    case Status::NoFrames:       return "no-frames";
+    case Status::BadFrameHeader: return "bad-frame-header";
+    }
+    return "?";
+}
@@ -0,0 +1,82 @@
+#ifndef MEDIAPACKET_H
+#define MEDIAPACKET_H
+
+#include "sbcframe.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+
+// In-place parser for A2DP media packets: RTP header (with CSRCs, extension and padding), the
+// A2DP SBC media payload header, and the header and CRC of every SBC frame it carries.
+//
+// parse() copies nothing and never allocates; the frame views stay valid as long as the packet
+// buffer does. Problems are reported through status() rather than by throwing, and a packet
+// whose frames are only partly usable still exposes the frames that were found before the error.
+class MediaPacket
+{
+public:
+    enum class Status {
+        Ok,
+        Truncated,          // shorter than its headers, or a frame runs past the payload
+        BadVersion,         // RTP version other than 2
+        BadExtension,       // RTP header extension runs past the packet
+        BadPadding,         // padding count larger than the payload
+        Fragmented,         // one frame split across packets, which this path does not reassemble
+        NoFrames,           // payload header announces zero frames
+        BadFrameHeader      // sync word or frame parameters invalid
+    };
+
+    static constexpr size_t RtpHeaderSize = 12;
+
+    // The frame count field is four bits wide
+    static constexpr int MaxFrames = 15;
+
+    // Set checkCrc to false when only the header fields are needed (e.g. to schedule the packet)
+    Status parse(std::span<const uint8_t> packet, bool checkCrc = true);
+
+    Status status() const { return m_status; }
+    bool isValid() const { return m_status == Status::Ok; }
+
+    // Whether the RTP header parsed, so the fields below are meaningful even if the payload is not
+    bool hasRtpHeader() const { return m_rtpValid; }
+
+    // RTP header fields
+    uint8_t payloadType() const { return m_payloadType; }
+    bool marker() const { return m_marker; }
+    uint16_t sequence() const { return m_sequence; }
+    uint32_t timestamp() const { return m_timestamp; }
+    uint32_t ssrc() const { return m_ssrc; }
+
+    // A2DP SBC media payload header
+    bool isFragmented() const { return m_fragmented; }
+    bool isFirstFragment() const { return m_firstFragment; }
+    bool isLastFragment() const { return m_lastFragment; }
+    int declaredFrames() const { return m_declaredFrames; }
+
+    // Frames found before the first error, CRC failures included
+    std::span<const SbcFrameView> frames() const { return { m_frames, size_t(m_frameCount) }; }
+    int corruptFrames() const { return m_corruptFrames; }
+
+    static const char *statusName(Status status);
+
+private:
+    Status fail(Status status);
+
+    Status m_status = Status::Truncated;
+    bool m_rtpValid = false;
+    uint8_t m_payloadType = 0;
+    bool m_marker = false;
+    uint16_t m_sequence = 0;
+    uint32_t m_timestamp = 0;
+    uint32_t m_ssrc = 0;
+    bool m_fragmented = false;
+    bool m_firstFragment = false;
+    bool m_lastFragment = false;
+    int m_declaredFrames = 0;
+    int m_frameCount = 0;
+    int m_corruptFrames = 0;
+    SbcFrameView m_frames[MaxFrames];
+};
+
+#endif // MEDIAPACKET_H
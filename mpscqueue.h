@@ -0,0 +1,81 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <cstddef>
+#include <atomic>
+#include <optional>
+#include <utility>
+
+// Unbounded multi-producer/single-consumer queue (Vyukov's intrusive linked list).
+//
+// push() is wait-free: one allocation and one atomic exchange, callable from any number of
+// threads. pop() is for one consumer thread only. Items from one producer come out in the order
+// that producer pushed them. The producer end and the consumer end sit on separate cache lines.
+template<typename T>
+class MpscQueue
+{
+public:
+    static constexpr size_t CacheLine = 64;
+
+    MpscQueue()
+        : m_head(new Node)
+    {
+        m_tail.store(m_head, std::memory_order_relaxed);
+    }
+
+    ~MpscQueue()
+    {
+        while (pop()) {}
+        delete m_head;
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    // Producers
+    void push(T value)
+    {
+        Node *node = new Node;
+        node->value.emplace(std::move(value));
+        m_size.fetch_add(1, std::memory_order_relaxed);
+        Node *previous = m_tail.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // Consumer: oldest item, or nothing if the queue is empty. A producer that is between the
+    // exchange and the link in push() makes its item (and later ones) visible only to a later pop.
+    std::optional<T> pop()
+    {
+        Node *next = m_head->next.load(std::memory_order_acquire);
+        if (!next)
+            return std::nullopt;
+
+        // next becomes the new empty head node
+        std::optional<T> value = std::move(next->value);
+        next->value.reset();
+        delete m_head;
+        m_head = next;
+        m_size.fetch_sub(1, std::memory_order_relaxed);
+        return value;
+    }
+
+    // Approximate number of queued items
+    size_t size() const { return m_size.load(std::memory_order_relaxed); }
+
+private:
+    struct Node
+    {
+        std::atomic<Node *> next{nullptr};
+        std::optional<T> value;
+    };
+
+    // Consumer side
+    alignas(CacheLine) Node *m_head;
+
+    // Producer side
+    alignas(CacheLine) std::atomic<Node *> m_tail;
+
+    alignas(CacheLine) std::atomic<size_t> m_size{0};
+};
+
+#endif // MPSCQUEUE_H
@@ -1,7 +1,13 @@
 #include "phoneaudiolink.h"
 #include "ui_phoneaudiolink.h"
-
-#include <QRegularExpression>
+#include "processstats.h"
+#include "spantrace.h"
+#include "startuptrace.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QPixmapCache>
 #include <QProcess>
 #include <QTimer>
 
@@ -17,83 +23,25 @@
 })()
 
 PhoneAudioLink::PhoneAudioLink(QWidget *parent)
-    : QMainWindow(parent)
-    , ui(new Ui::PhoneAudioLink)
-    , audioSessionManager(nullptr)
-    , audioSink(nullptr)
-    , updateChecker(new UpdateChecker(this))
+    : PhoneAudioLink(QCoreApplication::applicationDirPath(), parent)
 {
-    ui->setupUi(this);
-
-    // Create update notification bar and add to bottom of window
-    updateNotificationBar = new UpdateNotificationBar(this);
-
-    // Add notification bar to the main window layout
-    ui->updateBarLayout->addWidget(updateNotificationBar);
-
-    // Connect update checker signals
-    connect(updateChecker, &UpdateChecker::updateAvailable,
-            this, &PhoneAudioLink::onUpdateAvailable);
-    connect(updateChecker, &UpdateChecker::checkFailed, this, [](const QString &error) {
-            qDebug() << "Update check failed:" << error;
-    });
-    connect(updateChecker, &UpdateChecker::noUpdateAvailable, this, [this](){
-        if(this->manuallyChecked)
-            QMessageBox::information(this, "Updater", "No update available!");
-    });
-
-    // Connect notification bar signals
-    connect(updateNotificationBar, &UpdateNotificationBar::seeDetailsClicked,
-            this, &PhoneAudioLink::showReleaseNotes);
-    connect(updateNotificationBar, &UpdateNotificationBar::updateClicked,
-            this, &PhoneAudioLink::launchMaintenanceTool);
-    connect(updateNotificationBar, &UpdateNotificationBar::closeClicked,
-            updateNotificationBar, &UpdateNotificationBar::hideBar);
-    connect(updateNotificationBar, &UpdateNotificationBar::closeClicked,
-            this, [this](){this->resize(this->width(), 316);});
-
-    // Check for updates after a short delay (let the UI load first)
-    QTimer::singleShot(2000, this, [this]() {
-        updateChecker->checkForUpdates(VERSION_STR());
-    });
-
-    connect(ui->actionCheckUpdate, &QAction::triggered, this, [this](){
-        updateChecker->checkForUpdates(VERSION_STR());
-        manuallyChecked = true;
-    });
-
-    ui->dcLabel->setStyleSheet("QLabel { color : red; }");
-    ui->menuAdvanced->setToolTipsVisible(true);
-
-    // Set icons based on color scheme
-    if(QGuiApplication::styleHints()->colorScheme() == Qt::ColorScheme::Light) {
-        ui->forward->setIcon(QPixmap(":/icons/Iconparts/forward-512.png"));
-        ui->back->setIcon(QPixmap(":/icons/Iconparts/back-512.png"));
-    }
-    else if(QGuiApplication::styleHints()->colorScheme() == Qt::ColorScheme::Dark) {
-        ui->forward->setIcon(QPixmap(":/icons/Iconparts/forward-512-white.png"));
-        ui->back->setIcon(QPixmap(":/icons/Iconparts/back-512-white.png"));
-    }
+}
 
-    // Create A2DP Sink manager
-    audioSink = new BluetoothA2DPSink(this);
+PhoneAudioLink::PhoneAudioLink(const QString &directory, QWidget *parent)
+    : QMainWindow(parent)
+    , ui(nullptr)
+    , link(new LinkController(directory, this))
+{
+    // Only what the tray icon and auto-connect need runs here and in start(), before the event loop starts.
+    // The update checker, update bar, StartupHelp and button pixmaps are created on first use.
+    StartupTrace::mark("window constructor");
 
-    // Connect A2DP device discovery signals
-    connect(audioSink, &BluetoothA2DPSink::deviceDiscovered, this,
-            &PhoneAudioLink::onA2DPDeviceDiscovered);
-    connect(audioSink, &BluetoothA2DPSink::discoveryCompleted, this,
-            &PhoneAudioLink::onA2DPDiscoveryCompleted);
+    BluetoothA2DPSink *audioSink = link->sink();
 
     // Connect sink signals to UI updates
     connect(audioSink, &BluetoothA2DPSink::sinkEnabled, this, [this]() {
-        ui->dcLabel->setText("Sink Enabled");
-        ui->dcLabel->setStyleSheet("QLabel { color : orange; }");
-        qDebug() << "A2DP Sink enabled, now open connection";
-
-        // Automatically open the connection after enabling
-        QTimer::singleShot(500, this, [this]() {
-            audioSink->openConnection();
-        });
+        setStatus("Sink Enabled", "orange");
+        qDebug() << "A2DP Sink enabled, opening connection";
     });
 
     connect(audioSink, &BluetoothA2DPSink::connectionOpened, this, [this]() {
@@ -111,27 +59,26 @@ PhoneAudioLink::PhoneAudioLink(QWidget *parent)
             }
         }
 
-        ui->dcLabel->setText("Connected");
-        ui->dcLabel->setStyleSheet("QLabel { color : green; }");
-        ui->connect->setEnabled(false);
-        ui->disconnect->setEnabled(true);
+        connectedUi = true;
+        setStatus("Connected", "green");
+        updateTrayContext();
     });
 
     connect(audioSink, &BluetoothA2DPSink::connectionClosed, this, [this]() {
         // Reset notification flag so it shows again on next connection
         connectionNotificationShown = false;
 
-        ui->dcLabel->setText("Disconnected!");
-        ui->dcLabel->setStyleSheet("QLabel { color : red; }");
-        ui->connect->setEnabled(true);
-        ui->disconnect->setEnabled(false);
+        connectedUi = false;
+        setStatus("Disconnected!", "red");
+        updateTrayContext();
         qDebug() << "Audio streaming stopped";
     });
 
     connect(audioSink, &BluetoothA2DPSink::connectionError, this, [this](const QString &error) {
+        //refresh the status and tray before the message box blocks this handler
+        setStatus("Error", "red");
+        updateTrayContext();
         QMessageBox::warning(this, tr("Connection Error"), error);
-        ui->dcLabel->setText("Error");
-        ui->dcLabel->setStyleSheet("QLabel { color : red; }");
         qWarning() << "Connection error:" << error;
     });
 
@@ -139,38 +86,49 @@ PhoneAudioLink::PhoneAudioLink(QWidget *parent)
         qDebug() << "Sink state:" << state;
     });
 
-    //create and connect the bluetooth discovery agent
-    discoveryAgent = new QBluetoothDeviceDiscoveryAgent(this);
-    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered,
-            this, &PhoneAudioLink::appendDevice);
-
-    //error catching
-    connect(discoveryAgent, &QBluetoothDeviceDiscoveryAgent::errorOccurred,
-            this, [this](QBluetoothDeviceDiscoveryAgent::Error e){
-        qDebug()<<e;
-        if(e == QBluetoothDeviceDiscoveryAgent::NoError) return;
-        else if(e == 2)
+    connect(audioSink, &BluetoothA2DPSink::packetLossUpdated, this, [](quint64 packetsLost, quint64 framesConcealed) {
+        qDebug() << "Media packets lost:" << packetsLost << "- frames concealed:" << framesConcealed;
+    });
+
+    //discovery error catching
+    connect(link, &LinkController::discoveryError, this, [this](QBluetoothDeviceDiscoveryAgent::Error e){
+        if(e == QBluetoothDeviceDiscoveryAgent::PoweredOffError)
             QMessageBox::critical(this, tr("Bluetooth Error"), tr("PoweredOffError: Make sure that bluetooth is turned on."));
         else
             QMessageBox::critical(this, tr("Bluetooth Error"), tr("Unknown: Open a bug report with this info: %1").arg(e));
     });
 
-    startDiscovery(); //automatically look for devices
+    //the device list shared by the combo box and the device menus
+    deviceModel = new DeviceListModel(this);
 
-    //load initialization data from "init.json" if it exists
-    loadInitData();
+    //every device the controller learns about, from the cache or from discovery
+    connect(link, &LinkController::deviceUpdated, this, &PhoneAudioLink::showDevice);
 
-    if(maximizeBluetoothCompatability)
-        ui->info->setToolTip("Showing all devices for compatability's sake.\nNot all of these devices are guaranteed to be supported.");
-    else
-        ui->info->setToolTip("Filtering for only phone devices.\nUse Advanced->Maximize Bluetooth compatability to show more devices.");
+    //select the device being connected to, also when auto-connect picked it
+    connect(link, &LinkController::connecting, this, [this](quint64 key){
+        selectDevice(key);
+        setStatus("Connecting...", "orange");
+        updateTrayContext();
+    });
+
+    //load initialization data from "init.json" if it exists; settings it lacks keep their defaults
+    connect(link, &LinkController::configError, this, &PhoneAudioLink::showError);
+    connect(link, &LinkController::saveFailed, this, [this](const QString &path, const QString &error){
+        showError(tr("Settings Not Saved"), tr("Failed to write \'%1\': %2").arg(QFileInfo(path).fileName(), error));
+    });
+    link->loadConfig();
+    StartupTrace::mark("config loaded");
+
+    //the window's widgets; released again while the app sits in the tray (see releaseWindow)
+    buildUi();
+    StartupTrace::mark("window ui built");
 
     //create a system tray icon
     trayIcon = new QSystemTrayIcon(QIcon(":/icons/icon.ico"), this);
 
-    //create the tray context menu
-    trayMenu = new QMenu(this);
-    QTimer::singleShot(2000, this, &PhoneAudioLink::updateTrayContext);
+    //create the tray context menu; start() shows the icon
+    createTrayMenu();
+    updateTrayContext();
 
     //connect tray icon clicked signal to showFromTray
     connect(trayIcon, &QSystemTrayIcon::activated, this, [this](QSystemTrayIcon::ActivationReason r){
@@ -184,60 +142,115 @@ PhoneAudioLink::PhoneAudioLink(QWidget *parent)
         }
     });
 
-    // Connect UI buttons to A2DP sink
-    connect(ui->playPause, &QPushButton::pressed, this, &PhoneAudioLink::playPause);
-    connect(ui->forward, &QPushButton::pressed, this, [this]() {
-        if (audioSink) audioSink->sendNext();
+    //hidden in the tray for this long: the widgets are released
+    releaseWindowTimer = new QTimer(this);
+    releaseWindowTimer->setSingleShot(true);
+    releaseWindowTimer->setInterval(ReleaseWindowDelayMs);
+    connect(releaseWindowTimer, &QTimer::timeout, this, &PhoneAudioLink::releaseWindow);
+
+    // Scripts control the app through the controller, so the window doesn't need to be shown
+    controlServer = new ControlServer(link, this);
+    connect(controlServer, &ControlServer::quitRequested, this, &PhoneAudioLink::exitApp, Qt::QueuedConnection);
+    connect(controlServer, &ControlServer::showRequested, this, &PhoneAudioLink::showFromTray);
+}
+
+void PhoneAudioLink::start() {
+    //show the icon right away rather than on the first tray refresh
+    trayIcon->show();
+    StartupTrace::mark("tray icon shown");
+
+    controlServer->listen();
+    StartupTrace::mark("control API listening");
+
+    // List cached devices, start discovery, and auto-connect if enabled and a device was saved
+    link->start();
+    StartupTrace::mark("discovery started");
+
+    // Check for updates after a short delay (let the UI load first)
+    QTimer::singleShot(2000, this, [this]() {
+        checkForUpdates(false);
     });
-    connect(ui->back, &QPushButton::pressed, this, [this]() {
-        if (audioSink) audioSink->sendPrevious();
+}
+
+//create the widgets from the .ui form and bring them up to date; at startup and whenever the window comes back from the tray
+void PhoneAudioLink::buildUi() {
+    TRACE_SCOPE("ui", "buildUi");
+    const QString title = windowTitle(); //setupUi would reset it
+    ui = new Ui::PhoneAudioLink;
+    ui->setupUi(this);
+    if(!title.isEmpty()) setWindowTitle(title);
+
+    connect(ui->actionCheckUpdate, &QAction::triggered, this, [this](){
+        checkForUpdates(true);
     });
+
+    ui->menuAdvanced->setToolTipsVisible(true);
+    ui->deviceComboBox->setModel(deviceModel);
+    applyStatus();
+    updateInfoTooltip();
+
+    // Connect UI buttons to A2DP sink
+    connect(ui->playPause, &QPushButton::pressed, this, &PhoneAudioLink::playPause);
+    connect(ui->forward, &QPushButton::pressed, link, &LinkController::next);
+    connect(ui->back, &QPushButton::pressed, link, &LinkController::previous);
     connect(ui->refresh, &QPushButton::pressed, this, &PhoneAudioLink::startDiscovery);
     connect(ui->connect, &QPushButton::pressed, this, &PhoneAudioLink::connectSelectedDevice);
     connect(ui->disconnect, &QPushButton::pressed, this, &PhoneAudioLink::disconnect);
     connect(ui->deviceComboBox, &QComboBox::currentIndexChanged, this,
             &PhoneAudioLink::deviceComboChanged);
+    selectDevice(selectedDevice);
+    if(deviceModel->row(selectedDevice) == -1 && ui->deviceComboBox->currentIndex() >= 0)
+        selectedDevice = deviceModel->key(ui->deviceComboBox->currentIndex());
 
     // Setup Menu Actions
-    ui->compatAction->setChecked(maximizeBluetoothCompatability);
-    ui->startMinimizedAction->setChecked(startMinimized);
+    ui->compatAction->setChecked(link->maximizeBluetoothCompatability());
+    ui->startMinimizedAction->setChecked(link->startMinimized());
 
     connect(ui->compatAction, &QAction::triggered, this, [this](bool checked){
-        maximizeBluetoothCompatability=checked;
+        link->setMaximizeBluetoothCompatability(checked);
 
         //change the info tooltip
-        if(maximizeBluetoothCompatability)
-            ui->info->setToolTip("Showing all devices for compatability's sake.\nNot all of these devices are guaranteed to support A2DP.");
-        else
-            ui->info->setToolTip("Filtering for only phone devices.\nUse Advanced->Maximize Bluetooth compatability to show more devices.");
+        updateInfoTooltip();
 
         //refresh devices
+        rebuildDeviceList();
         startDiscovery();
     });
 
-    connect(ui->menuConnectOnLaunch, &QMenu::hovered, this, [this](){
-        static int c;
-        if(c == 50){
-            this->updateAutoConnectMenu();
-            this->updateTrayContext();
-            c = 0;
-        }
-        c++;
-    });
+    //the menu bar's "Connect on Launch" follows the device list too
+    DeviceMenu *autoConnectMenu = new DeviceMenu(ui->menuConnectOnLaunch, deviceModel, DeviceListModel::AutoConnectRole);
+    connect(autoConnectMenu, &DeviceMenu::deviceTriggered, this, &PhoneAudioLink::toggleAutoConnect);
 
-    QTimer::singleShot(2000, this, &PhoneAudioLink::updateAutoConnectMenu);
+    connect(ui->startMinimizedAction, &QAction::triggered, this, &PhoneAudioLink::setStartMinimized);
 
-    connect(ui->startMinimizedAction, &QAction::triggered, this, [this](bool checked){
-        this->startMinimized=checked;
-        this->updateTrayContext();
-        this->updateAutoConnectMenu();
+    //free the window's memory while it sits in the tray
+    QAction *releaseWindowAction = new QAction("Free Memory While in Tray", ui->menuAdvanced);
+    releaseWindowAction->setCheckable(true);
+    releaseWindowAction->setChecked(link->releaseWindowWhenHidden());
+    releaseWindowAction->setToolTip("Closes the window's widgets after it has been in the tray for a while.\nThey are rebuilt when it is shown again.");
+    ui->menuAdvanced->addAction(releaseWindowAction);
+    connect(releaseWindowAction, &QAction::triggered, this, [this](bool checked){
+        link->setReleaseWindowWhenHidden(checked);
     });
 
-    startupHelp = new StartupHelp(this);
-
-    connect(ui->startOnLoginAction, &QAction::triggered, this, [this](){
-        this->startupHelp->exec();
+#ifdef PHONEAUDIOLINK_TRACING
+    //record spans until unchecked, then save them for chrome://tracing or ui.perfetto.dev
+    QAction *traceAction = new QAction("Record Trace", ui->menuAdvanced);
+    traceAction->setCheckable(true);
+    traceAction->setChecked(SpanTrace::isEnabled());
+    traceAction->setToolTip("Records where time goes across threads until unchecked,\nthen saves it as a Chrome trace in the logs folder.");
+    ui->menuAdvanced->addAction(traceAction);
+    connect(traceAction, &QAction::triggered, this, [this](bool checked){
+        SpanTrace::setEnabled(checked);
+        if(checked) return;
+        const QString path = SpanTrace::defaultPath();
+        QString error;
+        if(SpanTrace::save(path, &error)) trayIcon->showMessage("Trace Saved", QDir::toNativeSeparators(path));
+        else showError("Trace Not Saved", error);
     });
+#endif
+
+    connect(ui->startOnLoginAction, &QAction::triggered, this, &PhoneAudioLink::showStartupHelp);
 
     connect(ui->versionAction, &QAction::triggered, this, [this](){
         QMessageBox::information(this, tr("Program Version"), tr("Version %1\t").arg(GLOBAL_PROGRAM_VERSION));
@@ -248,59 +261,69 @@ PhoneAudioLink::PhoneAudioLink(QWidget *parent)
     });
 
     connect(ui->debug, &QAction::triggered, this, [this](){
-        qDebug()<<"name: "<<ui->deviceComboBox->currentData().value<QBluetoothDeviceInfo>().name();
-        QBluetoothLocalDevice localDevice;
-        qDebug()<<"state: "<<localDevice.pairingStatus(ui->deviceComboBox->currentData().value<QBluetoothDeviceInfo>().address());
-        qDebug()<<"address:"<<ui->deviceComboBox->currentData().value<QBluetoothDeviceInfo>().address();
+        const DeviceRegistry::Device *device = link->devices().find(selectedDevice);
+        if(device){
+            qDebug()<<"name: "<<device->name();
+            QBluetoothLocalDevice localDevice;
+            qDebug()<<"state: "<<localDevice.pairingStatus(device->info.address());
+            qDebug()<<"address:"<<device->info.address();
+            qDebug()<<"windows id:"<<device->deviceId;
+        }
 
         this->updateTrayContext();
-        this->updateAutoConnectMenu();
     });
 
 #ifdef RELEASE_BUILD
     ui->debug->setVisible(false);
 #endif
 
-    // Initial button states
-    ui->connect->setEnabled(true);
-    ui->disconnect->setEnabled(false);
-
-    // Auto-connect if enabled and device was saved
-    if (connectAutomatically) {
-        QTimer::singleShot(2000, this, [this](){
-            QString name = this->findDeviceName(savedDeviceAddress);
-            int index = this->ui->deviceComboBox->findText(name);
-            if(this->ui->deviceComboBox->count() > 0 && index != -1){
-                this->ui->deviceComboBox->setCurrentIndex(index);
-                this->connectSelectedDevice();
-                this->updateTrayContext();
-                this->updateAutoConnectMenu();
-            }
-        });
+    //an update found while the window was released is shown again
+    buttonIconsLoaded = false;
+    if(!pendingVersion.isEmpty() && !updateBarDismissed) {
+        updateBar()->showUpdate(pendingVersion, pendingReleaseNotesUrl);
+        this->resize(this->width(), 351);
     }
 }
 
+//drop the widgets, the .ui form and their pixmaps; the sink, registry and tray stay
+void PhoneAudioLink::releaseWindow() {
+    TRACE_SCOPE("ui", "releaseWindow");
+    if(!ui || isVisible() || !link->releaseWindowWhenHidden() || !link->sink())
+        return;
+
+    const qint64 before = ProcessStats::residentMemoryBytes();
+
+    if(startupHelp && !startupHelp->isVisible()) {
+        delete startupHelp;
+        startupHelp = nullptr;
+    }
+    updateNotificationBar = nullptr; //lives in the central widget
+    delete takeCentralWidget();
+    setMenuWidget(nullptr); //deletes the menu bar
+    delete ui;
+    ui = nullptr;
+    destroy(); //and the native window; show() creates a new one
+    QPixmapCache::clear();
+
+    //the menu bar goes with deferred deletion, so measure once that has run
+    QTimer::singleShot(0, this, [before](){
+        const qint64 after = ProcessStats::residentMemoryBytes();
+        qInfo().noquote() << QString("Released the hidden window: %1 MB -> %2 MB resident")
+                                 .arg(before / 1048576.0, 0, 'f', 1)
+                                 .arg(after / 1048576.0, 0, 'f', 1);
+    });
+}
+
 //destructor
 PhoneAudioLink::~PhoneAudioLink() {
-    // Stop device watchers
-    if (audioSink) {
-        audioSink->stopDeviceDiscovery();
-        audioSink->deleteLater();
-        audioSink = nullptr;
-    }
-    if(discoveryAgent){
-        discoveryAgent->stop();//stop bluetooth discovery
-        discoveryAgent->deleteLater();
-        discoveryAgent = nullptr;
-    }
-    if(ui->dcLabel->text() == "Connected")
-        ui->disconnect->click();
+    // Stops the connection and both discovery paths
+    link->shutdown();
     delete ui;
 }
 
 //public function that returns if the program should start in a minimized state
 bool PhoneAudioLink::getStartMinimized(){
-    return this->startMinimized;
+    return link->startMinimized();
 }
 
 //detect window minimize event
@@ -315,19 +338,47 @@ void PhoneAudioLink::changeEvent(QEvent *event) {
 }
 
 void PhoneAudioLink::showEvent(QShowEvent *event) {
+    if(!ui) buildUi(); //shown by something other than showFromTray
+    loadButtonIcons();
     QMainWindow::showEvent(event);
     windowShown = true;
+    releaseWindowTimer->stop();
     updateTrayContext();
 }
 
 void PhoneAudioLink::hideEvent(QHideEvent *event) {
     QMainWindow::hideEvent(event);
     windowShown = false;
+    if(link->releaseWindowWhenHidden() && link->sink()) releaseWindowTimer->start();
     updateTrayContext();
 }
 
+//set the 512px forward/back icons for the color scheme; decoded on first show, not at startup
+void PhoneAudioLink::loadButtonIcons() {
+    if(buttonIconsLoaded)
+        return;
+    buttonIconsLoaded = true;
+
+    if(QGuiApplication::styleHints()->colorScheme() == Qt::ColorScheme::Light) {
+        ui->forward->setIcon(QPixmap(":/icons/Iconparts/forward-512.png"));
+        ui->back->setIcon(QPixmap(":/icons/Iconparts/back-512.png"));
+    }
+    else if(QGuiApplication::styleHints()->colorScheme() == Qt::ColorScheme::Dark) {
+        ui->forward->setIcon(QPixmap(":/icons/Iconparts/forward-512-white.png"));
+        ui->back->setIcon(QPixmap(":/icons/Iconparts/back-512-white.png"));
+    }
+}
+
 //show the window from tray
 void PhoneAudioLink::showFromTray() {
+    //the widgets were released while the window sat in the tray; rebuild them first
+    if(!ui){
+        QElapsedTimer timer;
+        timer.start();
+        buildUi();
+        qInfo() << "Rebuilt the window in" << timer.nsecsElapsed() / 1000 << "us";
+    }
+
     // show();
     // setWindowState((windowState() & ~Qt::WindowMinimized) | Qt::WindowActive);
     // raise();
@@ -338,163 +389,118 @@ void PhoneAudioLink::showFromTray() {
 
 }
 
-void PhoneAudioLink::updateTrayContext(){
-    trayMenu->clear();
-    for(auto* i:std::as_const(trayDeviceActions))
-        delete i;
-    trayDeviceActions.clear();
-    for(auto * i:std::as_const(trayDeviceStartupActions))
-        delete i;
-    trayDeviceStartupActions.clear();
-
-    QMenu *devicesMenu = new QMenu("Connect");
-    for (int i = 0; i < ui->deviceComboBox->count(); i++) {
-        trayDeviceActions.append(new QAction(ui->deviceComboBox->itemText(i)));
-        trayDeviceActions.last()->setCheckable(true);
-        if(ui->dcLabel->text() == "Connected" && trayDeviceActions.last()->text() == connectedDevice) trayDeviceActions.last()->setChecked(true);
-        else trayDeviceActions.last()->setChecked(false);
-        connect(trayDeviceActions.last(), &QAction::triggered, this, [this, i](){
-            ui->deviceComboBox->setCurrentIndex(i);
-            connectSelectedDevice();
-        });
-        devicesMenu->addAction(trayDeviceActions.last());
-    }
+//build the tray context menu once; the device submenus follow the device model from then on
+void PhoneAudioLink::createTrayMenu(){
+    trayMenu = new QMenu(this);
 
-    QAction *disconnectAction = new QAction("Disconnect", this);
-    disconnectAction->setCheckable(false);
-    if(ui->dcLabel->text() == "Disconnected!") disconnectAction->setDisabled(true);
-    else disconnectAction->setDisabled(false);
-
-    QMenu *settingsMenu = new QMenu("Settings");
-
-    QAction *startMinimized = new QAction("Start Minimized", this);
-    QMenu *autoConnect = new QMenu("Connect on Launch", this);
-    for (int i = 0; i < ui->deviceComboBox->count(); i++) {
-        trayDeviceStartupActions.append(new QAction(ui->deviceComboBox->itemText(i)));
-        trayDeviceStartupActions.last()->setCheckable(true);
-        if(connectAutomatically && [this](){
-                for (const QBluetoothDeviceInfo &info : std::as_const(this->discoveredDevices))
-                    if (info.address() == this->savedDeviceAddress && info.name() == this->trayDeviceStartupActions.last()->text())
-                        return true;
-                return false;
-            }()) trayDeviceStartupActions.last()->setChecked(true);
-        else trayDeviceStartupActions.last()->setChecked(false);
-        connect(trayDeviceStartupActions.last(), &QAction::triggered, this, [this, i](){
-            if(!this->connectAutomatically){
-                connectAutomatically = true;
-                this->savedDeviceAddress = ui->deviceComboBox->itemData(i).value<QBluetoothDeviceInfo>().address();
-            }
-            else connectAutomatically = false;
-            this->updateAutoConnectMenu();
-        });
-        autoConnect->addAction(trayDeviceStartupActions.last());
-    }
+    QMenu *devicesMenu = new QMenu("Connect", trayMenu);
+    DeviceMenu *connectMenu = new DeviceMenu(devicesMenu, deviceModel, DeviceListModel::ConnectedRole);
+    connect(connectMenu, &DeviceMenu::deviceTriggered, this, [this](int row){
+        selectDevice(deviceModel->key(row));
+        connectSelectedDevice();
+    });
 
-    QAction *autoStart = new QAction("Start on Login", this);
+    trayDisconnectAction = new QAction("Disconnect", trayMenu);
+    trayDisconnectAction->setCheckable(false);
 
-    startMinimized->setCheckable(true);
-    // autoConnect->setCheckable(true);
-    autoStart->setCheckable(false);
+    QMenu *settingsMenu = new QMenu("Settings", trayMenu);
 
-    startMinimized->setChecked(this->startMinimized);
-    // autoConnect->setChecked(connectAutomatically);
+    trayStartMinimizedAction = new QAction("Start Minimized", settingsMenu);
+    trayStartMinimizedAction->setCheckable(true);
+
+    QMenu *autoConnect = new QMenu("Connect on Launch", settingsMenu);
+    DeviceMenu *autoConnectMenu = new DeviceMenu(autoConnect, deviceModel, DeviceListModel::AutoConnectRole);
+    connect(autoConnectMenu, &DeviceMenu::deviceTriggered, this, &PhoneAudioLink::toggleAutoConnect);
+
+    QAction *autoStart = new QAction("Start on Login", settingsMenu);
+    autoStart->setCheckable(false);
 
-    settingsMenu->addAction(startMinimized);
+    settingsMenu->addAction(trayStartMinimizedAction);
     settingsMenu->addMenu(autoConnect);
     settingsMenu->addAction(autoStart);
 
-    QAction *restoreAction = new QAction("Show", this);
-    if(windowShown) restoreAction->setDisabled(true);
-    else restoreAction->setDisabled(false);
-
-    QAction *quitAction = new QAction("Exit", this);
+    trayRestoreAction = new QAction("Show", trayMenu);
 
+    QAction *quitAction = new QAction("Exit", trayMenu);
     quitAction->setCheckable(false);
 
     //connect the tray context menu buttons to their respective actions
-    connect(startMinimized, &QAction::triggered, ui->startMinimizedAction, &QAction::trigger);
-    // connect(autoConnect, &QAction::triggered, ui->connectStartupAction, &QAction::trigger);
-    connect(disconnectAction, &QAction::triggered, ui->disconnect, &QPushButton::click);
-    connect(autoStart, &QAction::triggered, ui->startOnLoginAction, &QAction::trigger);
-    connect(restoreAction, &QAction::triggered, this, &PhoneAudioLink::showFromTray);
+    connect(trayStartMinimizedAction, &QAction::triggered, this, &PhoneAudioLink::setStartMinimized);
+    connect(trayDisconnectAction, &QAction::triggered, this, &PhoneAudioLink::disconnect);
+    connect(autoStart, &QAction::triggered, this, &PhoneAudioLink::showStartupHelp);
+    connect(trayRestoreAction, &QAction::triggered, this, &PhoneAudioLink::showFromTray);
     connect(quitAction, &QAction::triggered, this, &PhoneAudioLink::exitApp);
 
     //add the actions
     trayMenu->addMenu(devicesMenu);
     trayMenu->addSeparator();
-    trayMenu->addAction(disconnectAction);
+    trayMenu->addAction(trayDisconnectAction);
     trayMenu->addSeparator();
-    // trayMenu->addAction(startMinimized);
-    // trayMenu->addAction(autoConnect);
-    // trayMenu->addAction(autoStart);
     trayMenu->addMenu(settingsMenu);
     trayMenu->addSeparator();
-    trayMenu->addAction(restoreAction);
+    trayMenu->addAction(trayRestoreAction);
     trayMenu->addAction(quitAction);
 
     //configure the tray icon
     trayIcon->setContextMenu(trayMenu);
+}
+
+//request a tray refresh; any number of requests in one event loop turn cost a single update
+void PhoneAudioLink::updateTrayContext(){
+    if(trayUpdatePending)
+        return;
+    trayUpdatePending = true;
+    QTimer::singleShot(0, this, &PhoneAudioLink::applyTrayContext);
+}
+
+void PhoneAudioLink::applyTrayContext(){
+    TRACE_SCOPE("ui", "applyTrayContext");
+    trayUpdatePending = false;
+    BluetoothA2DPSink *audioSink = link->sink();
+    if(!audioSink) //exiting
+        return;
+
+    //check marks of the device menus
+    const bool streaming = link->isStreaming();
+    deviceModel->setConnectedKey(streaming ? link->connectedDevice() : 0);
+    deviceModel->setAutoConnectKey(link->connectAutomatically() ? DeviceRegistry::key(link->savedDeviceAddress()) : 0);
+
+    trayDisconnectAction->setDisabled(statusText == "Disconnected!");
+    trayStartMinimizedAction->setChecked(link->startMinimized());
+    trayRestoreAction->setDisabled(windowShown);
 
     // Update tray tooltip
-    if(ui->dcLabel->text() == "Disconnected!")  trayIcon->setToolTip("Disconnected!");
-    else if(ui->dcLabel->text() == "Connected") trayIcon->setToolTip("Connected to:\n"+connectedDevice);
+    QString lastConnect;
+    const qint64 lastConnectMs = audioSink->connectionStats().lastConnectMs(audioSink->currentDeviceId());
+    if(lastConnectMs >= 0) lastConnect = QString("\nLast connect: %1 s").arg(lastConnectMs / 1000.0, 0, 'f', 1);
+    if(statusText == "Disconnected!")  trayIcon->setToolTip("Disconnected!"+lastConnect);
+    else if(streaming){
+        const DeviceRegistry::Device *device = link->devices().find(link->connectedDevice());
+        trayIcon->setToolTip("Connected to:\n"+(device ? device->name() : QString())+lastConnect);
+    }
     else trayIcon->setToolTip("Connecting...");
 
     // show the tray icon
     trayIcon->show();
 }
 
-void PhoneAudioLink::updateAutoConnectMenu() {
-    ui->menuConnectOnLaunch->clear();
-    for (int i = 0; i < ui->deviceComboBox->count(); i++) {
-        autoConnectMenuActions.append(new QAction(ui->deviceComboBox->itemText(i)));
-        autoConnectMenuActions.last()->setCheckable(true);
-        if(connectAutomatically && [this](){
-                for (const QBluetoothDeviceInfo &info : std::as_const(this->discoveredDevices))
-                    if (info.address() == this->savedDeviceAddress && info.name() == this->autoConnectMenuActions.last()->text())
-                        return true;
-                return false;
-            }()) autoConnectMenuActions.last()->setChecked(true);
-        else autoConnectMenuActions.last()->setChecked(false);
-        connect(autoConnectMenuActions.last(), &QAction::triggered, this, [this, i](){
-            if(!this->connectAutomatically){
-                connectAutomatically = true;
-                this->savedDeviceAddress = ui->deviceComboBox->itemData(i).value<QBluetoothDeviceInfo>().address();
-            }
-            else connectAutomatically = false;
-            this->updateTrayContext();
-        });
-        ui->menuConnectOnLaunch->addAction(autoConnectMenuActions.last());
+//"Connect on Launch" picked a device: turns auto-connect on for it, or off again
+void PhoneAudioLink::toggleAutoConnect(int row){
+    if(!link->connectAutomatically()){
+        link->setConnectAutomatically(true);
+        if(const DeviceRegistry::Device *device = link->devices().find(deviceModel->key(row)))
+            link->setSavedDeviceAddress(device->info.address());
     }
+    else link->setConnectAutomatically(false);
+    this->updateTrayContext();
 }
 
 //exit the application
 void PhoneAudioLink::exitApp() {
     saveInitData();
 
-    // Cleanup audio session manager first (COM cleanup)
-    if (audioSessionManager) {
-        qDebug() << "Cleaning up AudioSessionManager";
-        audioSessionManager->cleanup();
-        audioSessionManager->deleteLater();
-        audioSessionManager = nullptr;
-    }
-
-    disconnect();
-
-    // Stop discovery
-    if (discoveryAgent) {
-        qDebug() << "Stopping discovery agent";
-        discoveryAgent->stop();
-        discoveryAgent->deleteLater();
-        discoveryAgent = nullptr;
-    }
-    if (audioSink) {
-        qDebug() << "Stopping A2DP sink device discovery";
-        audioSink->stopDeviceDiscovery();
-        audioSink->deleteLater();
-        audioSink = nullptr;
-    }
+    // Release the connection, stop discovery and clean up the audio session (COM)
+    link->shutdown();
 
     // hide the tray icon
     trayIcon->hide();
@@ -517,151 +523,62 @@ void PhoneAudioLink::closeEvent(QCloseEvent *event) {
 }
 
 void PhoneAudioLink::playPause() {
-    ui->playPause->toggleState();
+    if(ui) ui->playPause->toggleState();
 //TODO: change this to toggled so I know if we're paused or playing
 
 
     // Send play/pause command via A2DP sink
-    if (audioSink)
-        audioSink->sendPlayPause();
+    link->playPause();
 }
 
 void PhoneAudioLink::startDiscovery() {
-
-    // Reset current
-    ui->deviceComboBox->clear();
-    discoveredDevices.clear();
-    deviceIdMap.clear();
-
-    // Start Qt Bluetooth discovery (for display/pairing info)
-    discoveryAgent->stop();
-    discoveryAgent->start();
-
-    // Also start Windows device discovery for A2DP connection
-    if (audioSink) {
-        audioSink->startDeviceDiscovery();
-    }
-
-    // Update context menu after giving time for bluetooth discovery
-    QTimer::singleShot(3000, this, &PhoneAudioLink::updateTrayContext);
-}
-
-void PhoneAudioLink::onA2DPDeviceDiscovered(const QString &deviceId, const QString &deviceName) {
-    qDebug() << "A2DP device discovered:" << deviceName << "with ID:" << deviceId;
-
-    // Store the Windows device ID
-    deviceIdMap[deviceName] = deviceId;
+    link->startDiscovery();
 }
 
-void PhoneAudioLink::onA2DPDiscoveryCompleted() {
-    qDebug() << "A2DP discovery completed. Found" << deviceIdMap.size() << "devices!";
-}
-
-void PhoneAudioLink::appendDevice(const QBluetoothDeviceInfo &device) {
-    //filter devices
-    if(device.name().startsWith("Bluetooth") && device.name().contains(":")) {
-        return;
-    }
+void PhoneAudioLink::showDevice(const DeviceRegistry::Device &device) {
+    TRACE_SCOPE("ui", "showDevice");
     // qDebug()<<"discovered device";
     // qDebug()<<"\tName: "               <<device.name();
-    // qDebug()<<"\tMajor, Minor Device Classes: " <<device.majorDeviceClass()<<device.minorDeviceClass();
-    // qDebug()<<"\tDevice address: "<<device.address();
+    // qDebug()<<"\tMajor, Minor Device Classes: " <<device.info.majorDeviceClass()<<device.info.minorDeviceClass();
+    // qDebug()<<"\tDevice address: "<<device.info.address();
 
     QString tag = "";
-    bool isPhone = device.majorDeviceClass() == QBluetoothDeviceInfo::PhoneDevice;
-    bool isAv = device.majorDeviceClass() == QBluetoothDeviceInfo::AudioVideoDevice;
+    bool isPhone = device.info.majorDeviceClass() == QBluetoothDeviceInfo::PhoneDevice;
+    bool isAv = device.info.majorDeviceClass() == QBluetoothDeviceInfo::AudioVideoDevice;
 
-    if(maximizeBluetoothCompatability){
+    if(device.isVirtual()) tag=" [Replay]";
+    else if(link->maximizeBluetoothCompatability()){
         //set tag based off of device type
         if(isPhone) tag=" [Phone Device]";
         else if(isAv) tag=" [AV Device]";
         else tag=" [UNKNOWN]";
-
-        //add the device
-        ui->deviceComboBox->addItem(device.name()+tag, QVariant::fromValue(device));
-        discoveredDevices.append(device);
-
-        //if it matches the saved device, set that to the current index
-        if(device.address() == savedDeviceAddress)
-            ui->deviceComboBox->setCurrentIndex(ui->deviceComboBox->findData(QVariant::fromValue(device)));
-        return;
     }
+    else if(!isPhone) return;
 
-    if(isPhone){
-        //add the device
-        ui->deviceComboBox->addItem(device.name(), QVariant::fromValue(device));
-        discoveredDevices.append(device);
+    //add the device, or refresh it in place if it is already listed
+    const bool listed = deviceModel->row(device.key) != -1;
+    const int row = deviceModel->setDevice(device.key, device.name()+tag);
 
-        //if it matches the saved device, set that to the current index
-        if(device.address() == savedDeviceAddress)
-            ui->deviceComboBox->setCurrentIndex(ui->deviceComboBox->findData(QVariant::fromValue(device)));
-        return;
-    }
+    //if it matches the saved device, set that to the current index
+    if(!listed && !device.isVirtual() && device.info.address() == link->savedDeviceAddress())
+        selectDevice(deviceModel->key(row));
+}
+
+void PhoneAudioLink::rebuildDeviceList() {
+    TRACE_SCOPE("ui", "rebuildDeviceList");
+    deviceModel->clear();
+    for (const DeviceRegistry::Device &device : link->devices().devices())
+        showDevice(device);
 }
 
 //connect to the device in the combo box
 void PhoneAudioLink::connectSelectedDevice() {
+    TRACE_SCOPE("ui", "connectSelectedDevice");
+    const DeviceRegistry::Device *device = link->devices().find(selectedDevice);
+    qDebug() << "Attempting to connect to:" << (device ? device->name() : QString());
 
-    updateTrayContext();
-
-    QString selectedText = ui->deviceComboBox->currentText();
-
-    // Remove any tags like [A2DP], [Phone Device], etc.
-    QString deviceName = selectedText;
-    deviceName.remove(QRegularExpression("\\s*\\[.*\\]\\s*"));
-
-    qDebug() << "Attempting to connect to:" << deviceName;
-
-    if (audioSink && deviceIdMap.contains(deviceName)) {
-        // Use the Windows device ID we got from DeviceWatcher
-        QString windowsDeviceId = deviceIdMap[deviceName];
-
-        qDebug() << "Using Windows device ID:" << windowsDeviceId;
-
-        ui->dcLabel->setText("Connecting...");
-        ui->dcLabel->setStyleSheet("QLabel { color : orange; }");
-
-        updateTrayContext();
-
-        // Enable the A2DP sink for this device
-        audioSink->enableSink(windowsDeviceId);
-
-        // wait a bit, then update the connected device
-        QTimer::singleShot(3000, this, [this, deviceName](){
-            if(ui->dcLabel->text() == "Connected")
-                this->connectedDevice = deviceName;
-            else //wait another 3 seconds if not connected yet
-                QTimer::singleShot(3000, this, [this, deviceName](){
-                    if(ui->dcLabel->text() == "Connected") //if still not connected, then it will fail out before this happens
-                        this->connectedDevice = deviceName;
-                    this->updateTrayContext();
-                });
-            this->updateTrayContext();
-        });
-
-        // Create AudioSessionManager only when we actually need it
-        if (!audioSessionManager) {
-            audioSessionManager = new AudioSessionManager(this);
-        }
-
-        // Set custom name and icon in Volume Mixer
-        QString exePath = QCoreApplication::applicationFilePath();
-        QString displayName = QString("Phone Audio Link (%1)").arg(ui->deviceComboBox->currentData().value<QBluetoothDeviceInfo>().name());
-
-        // Try to set immediately, then retry after a delay, then retry again
-        QTimer::singleShot(500, this, [this, displayName, exePath]() {
-            audioSessionManager->setSessionProperties(displayName, exePath);
-        });
-
-        QTimer::singleShot(2000, this, [this, displayName, exePath]() {
-            audioSessionManager->setSessionProperties(displayName, exePath);
-        });
-
-        QTimer::singleShot(7000, this, [this, displayName, exePath]() {
-            audioSessionManager->setSessionProperties(displayName, exePath);
-        });
-    } else {
-        qWarning() << "Device not found in A2DP device map:" << deviceName;
+    // The controller reports the attempt through connecting(); connectedDevice is set when it opens
+    if (!link->connectDevice(selectedDevice)) {
         QMessageBox::warning(this, tr("Connection Error"),
                              tr("Device not found. Please make sure the device supports A2DP and try refreshing the device list."));
     }
@@ -670,110 +587,70 @@ void PhoneAudioLink::connectSelectedDevice() {
 }
 
 void PhoneAudioLink::disconnect() {
-    if (audioSink) {
-        audioSink->releaseConnection();
-    }
+    link->disconnectDevice();
 
     updateTrayContext();
 }
 
 //triggers when the index of the device combo box is changed
 void PhoneAudioLink::deviceComboChanged(int i){
-    Q_UNUSED(i);
     //qDebug()<<"changed index: "<<i;
-    updateAutoConnectMenu();
+    if(i >= 0) selectedDevice = deviceModel->key(i);
     updateTrayContext();
 }
 
-//save initialization data
-void PhoneAudioLink::saveInitData() {
-    //initialize the file object
-    QString fileName = QCoreApplication::applicationDirPath()+"/init.json";
-    QJsonObject config;
-
-    config["maximizeBluetoothCompatability"] = maximizeBluetoothCompatability;
-    config["connectAutomatically"] = connectAutomatically;
-    config["startMinimized"] = startMinimized;
-    config["device"] = savedDeviceAddress.toString();//ui->deviceComboBox->currentData().value<QBluetoothDeviceInfo>().address().toString();
-
-    //write the file
-    QFile file(fileName);
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(QJsonDocument(config).toJson());
-        file.close();
-    }
-    else {
-        //alert the user of errors
-        QMessageBox::critical(this, tr("Error"), tr("Failed to save initialization configuration file."));
-    }
+//the device the connect button acts on; kept here so it survives the widgets being released
+void PhoneAudioLink::selectDevice(quint64 key){
+    selectedDevice = key;
+    const int row = deviceModel->row(key);
+    if(ui && row != -1) ui->deviceComboBox->setCurrentIndex(row);
+}
 
-    updateTrayContext();
+//connection status text and color, shown by dcLabel and the tray
+void PhoneAudioLink::setStatus(const QString &text, const QString &color){
+    statusText = text;
+    statusColor = color;
+    applyStatus();
+}
 
+void PhoneAudioLink::applyStatus(){
+    if(!ui) return;
+    ui->dcLabel->setText(statusText);
+    ui->dcLabel->setStyleSheet("QLabel { color : "+statusColor+"; }");
+    ui->connect->setEnabled(!connectedUi);
+    ui->disconnect->setEnabled(connectedUi);
 }
 
-//load initialization data
-void PhoneAudioLink::loadInitData(){
-    //initialize file object
-    QString initFilePath = QCoreApplication::applicationDirPath()+"/init.json";
-    QFile initFile(initFilePath);
-    bool err = false;
+void PhoneAudioLink::updateInfoTooltip(){
+    if(!ui) return;
+    if(link->maximizeBluetoothCompatability())
+        ui->info->setToolTip("Showing all devices for compatability's sake.\nNot all of these devices are guaranteed to support A2DP.");
+    else
+        ui->info->setToolTip("Filtering for only phone devices.\nUse Advanced->Maximize Bluetooth compatability to show more devices.");
+}
 
-    //check if init.json exists
-    if(initFile.exists()){
-        //read the file
-        if(!initFile.open(QIODevice::ReadOnly)){
-            QMessageBox::critical(this, tr("Error: FileReadError"), tr("Failed to open configuration file \'init.config\'"));
-            err = true;
-        }
-        QJsonDocument doc = QJsonDocument::fromJson(initFile.readAll());
-        initFile.close();
-        QJsonObject initConfig = doc.object();
-
-        //grab bluetooth compatability state
-        if (initConfig.contains("maximizeBluetoothCompatability"))
-            maximizeBluetoothCompatability = initConfig["maximizeBluetoothCompatability"].toBool();
-        else {
-            //alert user of incorrectly formatted configuration
-            QMessageBox::critical(this, tr("Error: NoBoolBluetoothError"), tr("Failed to parse configuration file \'init.config\'"));
-            err = true;
-        }
+void PhoneAudioLink::setStartMinimized(bool checked){
+    link->setStartMinimized(checked);
+    if(ui) ui->startMinimizedAction->setChecked(checked);
+    this->updateTrayContext();
+}
 
-        //grab automatic connection state
-        if(initConfig.contains("connectAutomatically"))
-            connectAutomatically = initConfig["connectAutomatically"].toBool();
-        else {
-            //alert user of incorrectly formatted configuration
-            QMessageBox::critical(this, tr("Error: NoBoolConnectError"), tr("Failed to parse configuration file \'init.config\'"));
-            err = true;
-        }
+void PhoneAudioLink::showStartupHelp(){
+    if(!startupHelp) startupHelp = new StartupHelp(this);
+    this->startupHelp->exec();
+}
 
-        //grab start minimized state
-        if(initConfig.contains("startMinimized"))
-            startMinimized = initConfig["startMinimized"].toBool();
-        else {
-            //alert user of incorrectly formatted configuration
-            QMessageBox::critical(this, tr("Error: NoStartupMinimizedError"), tr("Failed to parse configuration file \'init.config\'"));
-            err = true;
-        }
+//save initialization data; written on a worker thread, failures come back through saveFailed
+void PhoneAudioLink::saveInitData() {
+    link->saveConfig();
+    updateTrayContext();
+}
 
-        //load the device
-        if (initConfig.contains("device")) {
-            savedDeviceAddress = QBluetoothAddress(initConfig["device"].toString());
-        }
-        else {
-            //alert user of incorrectly formatted configuration
-            QMessageBox::critical(this, tr("Error: NoDeviceError"), tr("Failed to parse configuration file \'init.config\'"));
-            err = true;
-        }
-    }
-    else{
-        //if the initialization configuration doesn't exist, set initialization info to defaults
-        maximizeBluetoothCompatability = false;
-        connectAutomatically = false;
-        startMinimized = false;
-    }
-    if(err)
-        QMessageBox::critical(this, tr("Error: Initialization Configuration File Corrupted"), tr("Try deleting the file \'init.config\' and restarting the program. \nYour Initialization settings will be cleared."));
+//an error box that doesn't block the caller (or the event loop) until it is closed
+void PhoneAudioLink::showError(const QString &title, const QString &message){
+    QMessageBox *box = new QMessageBox(QMessageBox::Critical, title, message, QMessageBox::Ok, this);
+    box->setAttribute(Qt::WA_DeleteOnClose);
+    box->open();
 }
 
 //for debugging purposes
@@ -785,15 +662,47 @@ QString PhoneAudioLink::stringifyUuids(QList<QBluetoothUuid> l){
     return result;
 }
 
-QString PhoneAudioLink::findDeviceName(const QBluetoothAddress& address){
-    for (const QBluetoothDeviceInfo &info : discoveredDevices) {
-        if (info.address() == address) {
-            return info.name();
-        }
+//the update checker is only created when the first check runs
+void PhoneAudioLink::checkForUpdates(bool manual)
+{
+    if (!updateChecker) {
+        updateChecker = new UpdateChecker(this);
+
+        // Connect update checker signals
+        connect(updateChecker, &UpdateChecker::updateAvailable,
+                this, &PhoneAudioLink::onUpdateAvailable);
+        connect(updateChecker, &UpdateChecker::checkFailed, this, [](const QString &error) {
+                qDebug() << "Update check failed:" << error;
+        });
+        connect(updateChecker, &UpdateChecker::noUpdateAvailable, this, [this](){
+            if(this->manuallyChecked)
+                QMessageBox::information(this, "Updater", "No update available!");
+        });
     }
 
-    // Not found
-    return QString();
+    updateChecker->checkForUpdates(VERSION_STR());
+    if (manual)
+        manuallyChecked = true;
+}
+
+//the notification bar at the bottom of the window, created when there first is an update to show
+UpdateNotificationBar *PhoneAudioLink::updateBar()
+{
+    if (!updateNotificationBar) {
+        updateNotificationBar = new UpdateNotificationBar(this);
+        ui->updateBarLayout->addWidget(updateNotificationBar);
+
+        // Connect notification bar signals
+        connect(updateNotificationBar, &UpdateNotificationBar::seeDetailsClicked,
+                this, &PhoneAudioLink::showReleaseNotes);
+        connect(updateNotificationBar, &UpdateNotificationBar::updateClicked,
+                this, &PhoneAudioLink::launchMaintenanceTool);
+        connect(updateNotificationBar, &UpdateNotificationBar::closeClicked,
+                updateNotificationBar, &UpdateNotificationBar::hideBar);
+        connect(updateNotificationBar, &UpdateNotificationBar::closeClicked,
+                this, [this](){this->resize(this->width(), 316); updateBarDismissed = true;});
+    }
+    return updateNotificationBar;
 }
 
 void PhoneAudioLink::onUpdateAvailable(const QString &newVersion, const QString &releaseNotesUrl)
@@ -801,7 +710,9 @@ void PhoneAudioLink::onUpdateAvailable(const QString &newVersion, const QString
     qDebug() << "Update available:" << newVersion;
     pendingVersion = newVersion;
     pendingReleaseNotesUrl = releaseNotesUrl;
-    updateNotificationBar->showUpdate(newVersion, releaseNotesUrl);
+    updateBarDismissed = false;
+    if (!ui) return; //shown when the window is rebuilt
+    updateBar()->showUpdate(newVersion, releaseNotesUrl);
 
     // Resize the main window to accomodate the update bar
     this->resize(this->width(), 351);
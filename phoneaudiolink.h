@@ -2,13 +2,14 @@
 #define PHONEAUDIOLINK_H
 
 #include "updatenotificationbar.h"
-#include "audiosessionmanager.h"
 #include "releasenotesdialog.h"
-#include "bluetootha2dpsink.h"
+#include "controlserver.h"
+#include "devicelistmodel.h"
+#include "devicemenu.h"
+#include "linkcontroller.h"
 #include "updatechecker.h"
 #include "startuphelp.h"
 
-#include <QBluetoothDeviceDiscoveryAgent>
 #include <QBluetoothLocalDevice>
 #include <QSystemTrayIcon>
 #include <QJsonDocument>
@@ -33,8 +34,12 @@ class PhoneAudioLink : public QMainWindow
 
 public:
     PhoneAudioLink(QWidget *parent = nullptr);
+    PhoneAudioLink(const QString &directory, QWidget *parent = nullptr); //init.json and the device cache in directory
     ~PhoneAudioLink();
 
+    // Shows the tray icon, serves the control API, starts discovery and auto-connect and schedules the update check
+    void start();
+
     // Returns whether or not the program should be starting minimized
     bool getStartMinimized();
 
@@ -47,50 +52,66 @@ protected:
 private slots:
     void playPause();//is triggered when the play/pause button is pressed
     void startDiscovery();//starts the automatic discovery of bluetooth devices.
-    void appendDevice(const QBluetoothDeviceInfo &);//is connected to the bluetooth discovery agent's deviceDiscovered slot
-    void onA2DPDeviceDiscovered(const QString &deviceId, const QString &deviceName);
-    void onA2DPDiscoveryCompleted();
+    void showDevice(const DeviceRegistry::Device &);//adds a device to the combo box, or refreshes it if it's already listed
+    void rebuildDeviceList();//relists the known devices, e.g. after the filter changed
     void connectSelectedDevice(); //triggers when the "connect" button is pressed
     void disconnect();
     void deviceComboChanged(int); //triggers when the deviceComboBox's index changes
 
     void saveInitData();//saves the json initialization configuration
-    void loadInitData();//loads the json initialization configuration
     void showFromTray();//show the app from tray
-    void updateTrayContext();
-    void updateAutoConnectMenu();
+    void buildUi();//creates the window's widgets, at startup and again after releaseWindow
+    void releaseWindow();//deletes the widgets of the hidden window, keeping the sink, registry and tray
+    void selectDevice(quint64 key);//the device the connect button acts on
+    void setStatus(const QString &text, const QString &color);//the connection status shown by dcLabel and the tray
+    void applyStatus();
+    void updateInfoTooltip();
+    void setStartMinimized(bool);
+    void showStartupHelp();
+    void showError(const QString &title, const QString &message);
+    void createTrayMenu();//builds the tray context menu
+    void updateTrayContext();//schedules a tray refresh, at most one per event loop turn
+    void applyTrayContext();
+    void toggleAutoConnect(int row);//a "Connect on Launch" menu entry was picked
     void exitApp();//saves init data, then exits the app
 
 private:
-    StartupHelp *startupHelp; //declare startup help dialog (instructs user on how to add the program to startup)
+    friend class DiscoveryBenchmark; //drives the discovery path in benchmark.cpp
+
+    StartupHelp *startupHelp = nullptr; //startup help dialog (instructs user on how to add the program to startup), created on first use
     Ui::PhoneAudioLink *ui; //the ui
-    QBluetoothDeviceDiscoveryAgent *discoveryAgent; //the discovety agent
-    AudioSessionManager *audioSessionManager; // for setting the app icon and name in windows volume mixer
-    QBluetoothAddress savedDeviceAddress; //the address of the device from our json initialization configuration file
     QSystemTrayIcon *trayIcon; //the tray icon
     QMenu *trayMenu; //the tray context menu
-    bool maximizeBluetoothCompatability, startMinimized, connectAutomatically;//these are loaded from our json initialization configuration file
-
-    QString stringifyUuids(QList<QBluetoothUuid>); //for debugging purposes
-    QString findDeviceName(const QBluetoothAddress&);
+    QAction *trayDisconnectAction, *trayStartMinimizedAction, *trayRestoreAction;
+    bool trayUpdatePending = false;
 
-    QString connectedDevice; // keep track of the currently connected device
+    // Widget independent window state, so the widgets can be released while in the tray
+    static constexpr int ReleaseWindowDelayMs = 60000; //how long the window sits in the tray before it is released
+    QTimer *releaseWindowTimer;
+    QString statusText = "Disconnected!", statusColor = "red";
+    bool connectedUi = false; //connect button disabled, disconnect enabled
+    quint64 selectedDevice = 0; //registry key of the device selected in the combo box
 
-    BluetoothA2DPSink *audioSink;
-    QList<QBluetoothDeviceInfo> discoveredDevices; //list of discovered devices
-    QList<QAction*> trayDeviceActions, trayDeviceStartupActions, autoConnectMenuActions;
+    QString stringifyUuids(QList<QBluetoothUuid>); //for debugging purposes
 
-    // Map device names to Windows device IDs for A2DP
-    QMap<QString, QString> deviceIdMap;
+    // The sink, discovery, known devices and settings; everything that works without this window
+    LinkController *link;
+    ControlServer *controlServer; // the local control API, served from the controller
+    DeviceListModel *deviceModel; // the listed devices, shared by the combo box and the device menus
 
     // Track if we've shown connection notification (prevent duplicates), and whether or not the window is visible
-    bool connectionNotificationShown, windowShown;
-
-    // Version checking stuff
-    UpdateChecker *updateChecker;
-    UpdateNotificationBar *updateNotificationBar;
+    bool connectionNotificationShown = false, windowShown = false;
+
+    // Version checking stuff, created on first use
+    UpdateChecker *updateChecker = nullptr;
+    UpdateNotificationBar *updateNotificationBar = nullptr;
+    void checkForUpdates(bool manual);
+    UpdateNotificationBar *updateBar();
+    bool buttonIconsLoaded = false;
+    void loadButtonIcons();
     QString pendingReleaseNotesUrl;
     QString pendingVersion;
+    bool updateBarDismissed = false;
     bool manuallyChecked = false;
 
 private slots:
@@ -0,0 +1,70 @@
+#include "processstats.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Started during static initialization, before main()
+const QElapsedTimer startTimer = []() {
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+}();
+
+} // namespace
+
+namespace ProcessStats {
+
+qint64 usSinceStart()
+{
+#ifdef Q_OS_WIN
+    FILETIME created, exited, kernel, user, now;
+    if (GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) {
+        GetSystemTimePreciseAsFileTime(&now);
+        const auto ticks = [](const FILETIME &time) {
+            return (quint64(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+        };
+        return qint64(ticks(now) - ticks(created)) / 10;    // 100 ns ticks
+    }
+#endif
+    return startTimer.nsecsElapsed() / 1000;
+}
+
+qint64 residentMemoryBytes()
+{
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return qint64(counters.WorkingSetSize);
+    return -1;
+#else
+    // Second field of statm: resident pages
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly))
+        return -1;
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.size() < 2)
+        return -1;
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+void logStartup(const char *label)
+{
+    const qint64 resident = residentMemoryBytes();
+    qInfo().noquote() << QString("Startup: %1 after %2 ms, %3 MB resident")
+                             .arg(label)
+                             .arg(msSinceStart())
+                             .arg(resident < 0 ? QString("?") : QString::number(resident / 1048576.0, 'f', 1));
+}
+
+} // namespace ProcessStats
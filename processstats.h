@@ -0,0 +1,22 @@
+#ifndef PROCESSSTATS_H
+#define PROCESSSTATS_H
+
+#include <QtGlobal>
+
+// Cold start and memory figures of this process, logged at startup by both the window and the
+// headless daemon so the two can be compared
+namespace ProcessStats {
+
+// Time since the process was created (since static initialization where that is unknown)
+qint64 usSinceStart();
+inline qint64 msSinceStart() { return usSinceStart() / 1000; }
+
+// Resident set (working set on Windows) in bytes, or -1 if unknown
+qint64 residentMemoryBytes();
+
+// "Startup: <label> after X ms, Y MB resident" at info level
+void logStartup(const char *label);
+
+} // namespace ProcessStats
+
+#endif // PROCESSSTATS_H
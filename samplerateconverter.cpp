@@ -0,0 +1,302 @@
+#include "samplerateconverter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define ASRC_HAVE_X86 1
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #define ASRC_TARGET_AVX2
+    #else
+        #define ASRC_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
+namespace {
+
+struct QualityParameters
+{
+    int taps;
+    int phases;
+    double beta;        // Kaiser window shape
+    double passband;    // cutoff as a fraction of the lower Nyquist frequency
+};
+
+QualityParameters parameters(ResamplerQuality quality)
+{
+    switch (quality) {
+    case ResamplerQuality::Low:    return { 16, 64, 6.0, 0.85 };
+    case ResamplerQuality::Medium: return { 32, 128, 8.0, 0.91 };
+    case ResamplerQuality::High:   return { 64, 256, 10.0, 0.95 };
+    }
+    return { 32, 128, 8.0, 0.91 };
+}
+
+// Zeroth order modified Bessel function of the first kind
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+int16_t toSample(float value)
+{
+    const float scaled = value * 32768.0f;
+    if (scaled >= 32767.0f)
+        return 32767;
+    if (scaled <= -32768.0f)
+        return -32768;
+    return int16_t(std::lrint(scaled));
+}
+
+void firScalar(const float *phase0, const float *phase1, float fraction,
+               const float *left, const float *right, int taps, float *outLeft, float *outRight)
+{
+    float sumLeft = 0.0f;
+    float sumRight = 0.0f;
+    for (int k = 0; k < taps; k++) {
+        const float c = phase0[k] + fraction * (phase1[k] - phase0[k]);
+        sumLeft = sumLeft + left[k] * c;
+        sumRight = sumRight + right[k] * c;
+    }
+    *outLeft = sumLeft;
+    *outRight = sumRight;
+}
+
+#ifdef ASRC_HAVE_X86
+
+float horizontalSum(__m128 v)
+{
+    const __m128 high = _mm_movehl_ps(v, v);
+    const __m128 pair = _mm_add_ps(v, high);
+    return _mm_cvtss_f32(_mm_add_ss(pair, _mm_shuffle_ps(pair, pair, 1)));
+}
+
+void firSse2(const float *phase0, const float *phase1, float fraction,
+             const float *left, const float *right, int taps, float *outLeft, float *outRight)
+{
+    const __m128 t = _mm_set1_ps(fraction);
+    __m128 sumLeft = _mm_setzero_ps();
+    __m128 sumRight = _mm_setzero_ps();
+    for (int k = 0; k < taps; k += 4) {
+        const __m128 h0 = _mm_loadu_ps(phase0 + k);
+        const __m128 c = _mm_add_ps(h0, _mm_mul_ps(t, _mm_sub_ps(_mm_loadu_ps(phase1 + k), h0)));
+        sumLeft = _mm_add_ps(sumLeft, _mm_mul_ps(_mm_loadu_ps(left + k), c));
+        sumRight = _mm_add_ps(sumRight, _mm_mul_ps(_mm_loadu_ps(right + k), c));
+    }
+    *outLeft = horizontalSum(sumLeft);
+    *outRight = horizontalSum(sumRight);
+}
+
+ASRC_TARGET_AVX2 void firAvx2(const float *phase0, const float *phase1, float fraction,
+                              const float *left, const float *right, int taps, float *outLeft, float *outRight)
+{
+    const __m256 t = _mm256_set1_ps(fraction);
+    __m256 sumLeft = _mm256_setzero_ps();
+    __m256 sumRight = _mm256_setzero_ps();
+    for (int k = 0; k < taps; k += 8) {
+        const __m256 h0 = _mm256_loadu_ps(phase0 + k);
+        const __m256 c = _mm256_add_ps(h0, _mm256_mul_ps(t, _mm256_sub_ps(_mm256_loadu_ps(phase1 + k), h0)));
+        sumLeft = _mm256_add_ps(sumLeft, _mm256_mul_ps(_mm256_loadu_ps(left + k), c));
+        sumRight = _mm256_add_ps(sumRight, _mm256_mul_ps(_mm256_loadu_ps(right + k), c));
+    }
+    *outLeft = horizontalSum(_mm_add_ps(_mm256_castps256_ps128(sumLeft), _mm256_extractf128_ps(sumLeft, 1)));
+    *outRight = horizontalSum(_mm_add_ps(_mm256_castps256_ps128(sumRight), _mm256_extractf128_ps(sumRight, 1)));
+}
+
+#endif // ASRC_HAVE_X86
+
+SampleRateConverter::FirFunction selectFir(SbcKernel kernel)
+{
+    switch (kernel) {
+#ifdef ASRC_HAVE_X86
+    case SbcKernel::Sse2:
+        return &firSse2;
+    case SbcKernel::Avx2:
+        return &firAvx2;
+#endif
+    default:
+        return &firScalar;
+    }
+}
+
+} // namespace
+
+SampleRateConverter::SampleRateConverter(ResamplerQuality quality, SbcKernel kernel)
+    : m_quality(quality)
+    , m_kernel(SbcSynthesis::isSupported(kernel) ? kernel : SbcKernel::Scalar)
+    , m_fir(selectFir(m_kernel))
+{
+}
+
+void SampleRateConverter::configure(int inputRate, int outputRate)
+{
+    const QualityParameters p = parameters(m_quality);
+    m_inputRate = inputRate;
+    m_outputRate = outputRate;
+    m_taps = p.taps;
+    m_phases = p.phases;
+    m_nominalStep = double(inputRate) / double(outputRate);
+
+    // Row r holds the filter for an output falling r/phases of an input frame past the
+    // window's centre tap; the extra last row lets every phase interpolate towards the next
+    const double cutoff = p.passband * std::min(1.0, double(outputRate) / double(inputRate));
+    const double pi = 3.14159265358979323846;
+    const double centre = m_taps / 2 - 1;
+    const double halfLength = m_taps / 2;
+    const double i0Beta = besselI0(p.beta);
+
+    m_coefficients.assign(size_t(m_phases + 1) * m_taps, 0.0f);
+    for (int row = 0; row <= m_phases; row++) {
+        const double fraction = double(row) / m_phases;
+        std::vector<double> h(static_cast<size_t>(m_taps));
+        double sum = 0.0;
+        for (int k = 0; k < m_taps; k++) {
+            const double x = k - centre - fraction;
+            const double sinc = x == 0.0 ? 1.0 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+            const double u = x / halfLength;
+            const double window = std::abs(u) < 1.0 ? besselI0(p.beta * std::sqrt(1.0 - u * u)) / i0Beta : 0.0;
+            h[size_t(k)] = sinc * window;
+            sum += h[size_t(k)];
+        }
+        // Unity gain at DC for every phase
+        for (int k = 0; k < m_taps; k++)
+            m_coefficients[size_t(row) * m_taps + k] = float(h[size_t(k)] / sum);
+    }
+
+    m_left.assign(size_t(m_taps + MaxInputFrames), 0.0f);
+    m_right.assign(size_t(m_taps + MaxInputFrames), 0.0f);
+    setDriftCorrection(0.0);
+    reset();
+}
+
+void SampleRateConverter::reset()
+{
+    // Start with half a window of silence so the first input frame lands near the centre tap
+    std::fill(m_left.begin(), m_left.end(), 0.0f);
+    std::fill(m_right.begin(), m_right.end(), 0.0f);
+    m_filled = m_taps / 2;
+    m_position = 0.0;
+}
+
+void SampleRateConverter::setDriftCorrection(double ppm)
+{
+    m_step = m_nominalStep * (1.0 + ppm * 1e-6);
+}
+
+int SampleRateConverter::maxOutputFrames(int inputFrames) const
+{
+    return int(std::ceil((inputFrames + m_taps) / m_step)) + 1;
+}
+
+int SampleRateConverter::process(const int16_t *input, int inputFrames, int16_t *output, int maxOutputFrames)
+{
+    inputFrames = std::min(inputFrames, MaxInputFrames);
+    if (m_taps == 0 || m_filled + inputFrames > int(m_left.size()))
+        return 0;
+
+    constexpr float Scale = 1.0f / 32768.0f;
+    for (int i = 0; i < inputFrames; i++) {
+        m_left[size_t(m_filled + i)] = input[2 * i] * Scale;
+        m_right[size_t(m_filled + i)] = input[2 * i + 1] * Scale;
+    }
+    m_filled += inputFrames;
+
+    int produced = 0;
+    while (produced < maxOutputFrames) {
+        const int start = int(m_position);
+        if (start + m_taps > m_filled)
+            break;
+
+        const double phase = (m_position - start) * m_phases;
+        const int row = std::min(int(phase), m_phases - 1);
+        const float *phase0 = m_coefficients.data() + size_t(row) * m_taps;
+
+        float left = 0.0f;
+        float right = 0.0f;
+        m_fir(phase0, phase0 + m_taps, float(phase - row), m_left.data() + start, m_right.data() + start,
+              m_taps, &left, &right);
+        output[2 * produced] = toSample(left);
+        output[2 * produced + 1] = toSample(right);
+        produced++;
+        m_position += m_step;
+    }
+
+    // Keep only the history the next output still needs
+    const int consumed = std::min(int(m_position), m_filled);
+    if (consumed > 0) {
+        std::memmove(m_left.data(), m_left.data() + consumed, size_t(m_filled - consumed) * sizeof(float));
+        std::memmove(m_right.data(), m_right.data() + consumed, size_t(m_filled - consumed) * sizeof(float));
+        m_filled -= consumed;
+        m_position -= consumed;
+    }
+    return produced;
+}
+
+const char *SampleRateConverter::qualityName(ResamplerQuality quality)
+{
+    switch (quality) {
+    case ResamplerQuality::Low:    return "low";
+    case ResamplerQuality::Medium: return "medium";
+    case ResamplerQuality::High:   return "high";
+    }
+    return "unknown";
+}
+
+ClockDriftController::ClockDriftController()
+{
+}
+
+ClockDriftController::ClockDriftController(const Config &config)
+    : m_config(config)
+{
+}
+
+void ClockDriftController::reset()
+{
+    m_smoothedFill = 0.0;
+    m_setpoint = 0.0;
+    m_integral = 0.0;
+    m_elapsed = 0.0;
+    m_correctionPpm = 0.0;
+    m_started = false;
+    m_locked = false;
+}
+
+double ClockDriftController::update(double fillFrames, double elapsedSeconds)
+{
+    if (!m_started) {
+        m_smoothedFill = fillFrames;
+        m_started = true;
+    }
+    const double alpha = 1.0 - std::exp(-elapsedSeconds / m_config.smoothingSeconds);
+    m_smoothedFill += alpha * (fillFrames - m_smoothedFill);
+
+    if (!m_locked) {
+        m_elapsed += elapsedSeconds;
+        if (m_elapsed < m_config.settleSeconds)
+            return m_correctionPpm;
+        m_setpoint = m_smoothedFill;
+        m_locked = true;
+    }
+
+    // A fuller buffer means the phone is ahead: consume its samples faster
+    const double error = m_smoothedFill - m_setpoint;
+    const double integral = m_integral + error * elapsedSeconds;
+    const double correction = m_config.proportionalGain * error + m_config.integralGain * integral;
+
+    // Stop integrating while saturated so the controller recovers promptly
+    m_correctionPpm = std::clamp(correction, -m_config.maxCorrectionPpm, m_config.maxCorrectionPpm);
+    if (correction == m_correctionPpm)
+        m_integral = integral;
+    return m_correctionPpm;
+}
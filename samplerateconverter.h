@@ -0,0 +1,115 @@
+#ifndef SAMPLERATECONVERTER_H
+#define SAMPLERATECONVERTER_H
+
+#include "sbcsynthesis.h"
+
+#include <cstdint>
+#include <vector>
+
+// Filter length, phase count and stopband of SampleRateConverter
+enum class ResamplerQuality {
+    Low,        // 16 taps, 64 phases
+    Medium,     // 32 taps, 128 phases
+    High        // 64 taps, 256 phases
+};
+
+// Asynchronous polyphase sample-rate converter for interleaved stereo int16.
+//
+// A Kaiser-windowed sinc is tabulated at a fixed number of phases and interpolated linearly
+// between them, so any ratio works (44.1 kHz to 48 kHz as well as the few ppm of drift
+// correction on top). The FIR kernels use the same SSE2/AVX2 selection as the SBC decoder;
+// unlike the decoder they are not bit-exact with each other because lanes sum in a different
+// order. Nothing allocates after configure().
+class SampleRateConverter
+{
+public:
+    static constexpr int Channels = 2;
+
+    // Largest input block process() accepts
+    static constexpr int MaxInputFrames = 1024;
+
+    explicit SampleRateConverter(ResamplerQuality quality = ResamplerQuality::Medium,
+                                 SbcKernel kernel = SbcSynthesis::bestKernel());
+
+    // Builds the filter for a conversion and resets the stream
+    void configure(int inputRate, int outputRate);
+    void reset();
+
+    // Positive values consume input faster (produce fewer output frames)
+    void setDriftCorrection(double ppm);
+
+    // Converts inputFrames frames and returns the number of frames written to output.
+    // maxOutputFrames(inputFrames) frames of output space are always enough.
+    int process(const int16_t *input, int inputFrames, int16_t *output, int maxOutputFrames);
+    int maxOutputFrames(int inputFrames) const;
+
+    int inputRate() const { return m_inputRate; }
+    int outputRate() const { return m_outputRate; }
+    int taps() const { return m_taps; }
+    ResamplerQuality quality() const { return m_quality; }
+    SbcKernel kernel() const { return m_kernel; }
+
+    static const char *qualityName(ResamplerQuality quality);
+
+    // Dot product of one stereo window with coefficients interpolated between two phases
+    using FirFunction = void (*)(const float *phase0, const float *phase1, float fraction,
+                                 const float *left, const float *right, int taps,
+                                 float *outLeft, float *outRight);
+
+private:
+    ResamplerQuality m_quality;
+    SbcKernel m_kernel;
+    FirFunction m_fir;
+
+    int m_inputRate = 0;
+    int m_outputRate = 0;
+    int m_taps = 0;
+    int m_phases = 0;
+    std::vector<float> m_coefficients;  // m_phases + 1 rows of m_taps
+    std::vector<float> m_left;          // input history, one channel each
+    std::vector<float> m_right;
+    int m_filled = 0;
+    double m_position = 0.0;            // input frame the next output's window starts at
+    double m_nominalStep = 1.0;         // input frames per output frame
+    double m_step = 1.0;
+};
+
+// PI controller that turns the render buffer fill level into a drift correction for
+// SampleRateConverter. Once the smoothed fill has settled after a (re)start it becomes the
+// setpoint, so correcting the phone/PC clock difference never adds latency.
+class ClockDriftController
+{
+public:
+    struct Config {
+        double proportionalGain = 1.0;      // ppm per frame of fill error
+        double integralGain = 0.03;         // ppm per frame-second of fill error
+        double maxCorrectionPpm = 1000.0;
+        double smoothingSeconds = 1.0;      // fill level low-pass time constant
+        double settleSeconds = 2.0;         // before the setpoint is taken
+    };
+
+    ClockDriftController();
+    explicit ClockDriftController(const Config &config);
+
+    void reset();
+
+    // fillFrames: output frames buffered ahead of the device; elapsedSeconds: audio time since
+    // the previous update. Returns the correction in ppm.
+    double update(double fillFrames, double elapsedSeconds);
+
+    double correctionPpm() const { return m_correctionPpm; }
+    double setpointFrames() const { return m_setpoint; }
+    bool isLocked() const { return m_locked; }
+
+private:
+    Config m_config;
+    double m_smoothedFill = 0.0;
+    double m_setpoint = 0.0;
+    double m_integral = 0.0;
+    double m_elapsed = 0.0;
+    double m_correctionPpm = 0.0;
+    bool m_started = false;
+    bool m_locked = false;
+};
+
+#endif // SAMPLERATECONVERTER_H
@@ -0,0 +1,298 @@
+#include "sbcdecoder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Loudness allocation offsets (A2DP spec tables 12.17 and 12.18), indexed by sample rate
+constexpr int Offset4[4][4] = {
+    { -1, 0, 0, 0 }, { -2, 0, 0, 1 }, { -2, 0, 0, 1 }, { -2, 0, 0, 1 }
+};
+
+constexpr int Offset8[4][8] = {
+    { -2, 0, 0, 0, 0, 0, 0, 1 }, { -3, 0, 0, 0, 0, 0, 1, 2 },
+    { -4, 0, 0, 0, 0, 0, 1, 2 }, { -4, 0, 0, 0, 0, 0, 1, 2 }
+};
+
+// MSB-first reader over a frame that has already been length checked
+struct BitReader
+{
+    const uint8_t *data;
+    int position = 0;
+
+    uint32_t read(int bits)
+    {
+        uint32_t value = 0;
+        while (bits > 0) {
+            const int available = 8 - (position & 7);
+            const int take = std::min(bits, available);
+            const uint32_t chunk = (data[position >> 3] >> (available - take)) & ((1u << take) - 1);
+            value = (value << take) | chunk;
+            position += take;
+            bits -= take;
+        }
+        return value;
+    }
+};
+
+template<int M>
+int bitneedFor(int scaleFactor, SbcAllocation allocation, int sampleRateIndex, int sb)
+{
+    if (allocation == SbcAllocation::Snr)
+        return scaleFactor;
+    if (scaleFactor == 0)
+        return -5;
+
+    const int offset = M == 4 ? Offset4[sampleRateIndex][sb] : Offset8[sampleRateIndex][sb];
+    const int loudness = scaleFactor - offset;
+    return loudness > 0 ? loudness / 2 : loudness;
+}
+
+// Bit allocation (A2DP spec 12.6.3). For mono and dual channel it runs once per channel over
+// Channels = 1; for stereo and joint stereo it runs once over both channels together.
+template<int M, int Channels>
+void allocateBits(const int (*scaleFactors)[M], const SbcFrameHeader &header, int (*bits)[M])
+{
+    int bitneed[Channels][M];
+    int maxBitneed = 0;
+    for (int ch = 0; ch < Channels; ch++) {
+        for (int sb = 0; sb < M; sb++) {
+            bitneed[ch][sb] = bitneedFor<M>(scaleFactors[ch][sb], header.allocation, header.sampleRateIndex(), sb);
+            maxBitneed = std::max(maxBitneed, bitneed[ch][sb]);
+        }
+    }
+
+    const int bitpool = header.bitpool;
+    int bitcount = 0;
+    int slicecount = 0;
+    int bitslice = maxBitneed + 1;
+    do {
+        bitslice--;
+        bitcount += slicecount;
+        slicecount = 0;
+        for (int ch = 0; ch < Channels; ch++) {
+            for (int sb = 0; sb < M; sb++) {
+                if (bitneed[ch][sb] > bitslice + 1 && bitneed[ch][sb] < bitslice + 16)
+                    slicecount++;
+                else if (bitneed[ch][sb] == bitslice + 1)
+                    slicecount += 2;
+            }
+        }
+    } while (bitcount + slicecount < bitpool && bitslice > -32);
+
+    if (bitcount + slicecount == bitpool) {
+        bitcount += slicecount;
+        bitslice--;
+    }
+
+    for (int ch = 0; ch < Channels; ch++) {
+        for (int sb = 0; sb < M; sb++)
+            bits[ch][sb] = bitneed[ch][sb] < bitslice + 2 ? 0 : std::min(bitneed[ch][sb] - bitslice, 16);
+    }
+
+    // Hand out the remaining bits, alternating channels within each subband
+    int ch = 0;
+    int sb = 0;
+    while (bitcount < bitpool && sb < M) {
+        if (bits[ch][sb] >= 2 && bits[ch][sb] < 16) {
+            bits[ch][sb]++;
+            bitcount++;
+        }
+        else if (bitneed[ch][sb] == bitslice + 1 && bitpool > bitcount + 1) {
+            bits[ch][sb] = 2;
+            bitcount += 2;
+        }
+        if (++ch == Channels) {
+            ch = 0;
+            sb++;
+        }
+    }
+
+    ch = 0;
+    sb = 0;
+    while (bitcount < bitpool && sb < M) {
+        if (bits[ch][sb] < 16) {
+            bits[ch][sb]++;
+            bitcount++;
+        }
+        if (++ch == Channels) {
+            ch = 0;
+            sb++;
+        }
+    }
+}
+
+inline int16_t toPcm(float value)
+{
+    const long rounded = std::lrint(value);
+    return int16_t(std::clamp<long>(rounded, -32768, 32767));
+}
+
+} // namespace
+
+SbcDecoder::SbcDecoder(SbcKernel kernel)
+    : m_kernel(SbcSynthesis::isSupported(kernel) ? kernel : SbcKernel::Scalar)
+    , m_synthesize4(SbcSynthesis::select<4>(m_kernel))
+    , m_synthesize8(SbcSynthesis::select<8>(m_kernel))
+    , m_hasHeader(false)
+    , m_framesDecoded(0)
+{
+}
+
+void SbcDecoder::reset()
+{
+    for (int ch = 0; ch < Sbc::MaxChannels; ch++) {
+        m_state4[ch].reset();
+        m_state8[ch].reset();
+    }
+    m_hasHeader = false;
+}
+
+SbcDecoder::Result SbcDecoder::decode(const uint8_t *data, size_t size, int16_t *pcm, size_t *consumed)
+{
+    SbcFrameHeader header;
+    if (!Sbc::parseHeader(data, size, header))
+        return size < size_t(Sbc::HeaderSize) ? Result::NeedMoreData : Result::InvalidHeader;
+
+    const int length = header.frameLength();
+    if (size < size_t(length))
+        return Result::NeedMoreData;
+
+    if (Sbc::frameCrc(data, header) != header.crc)
+        return Result::CrcMismatch;
+
+    decodeChecked(data, header, pcm);
+    if (consumed)
+        *consumed = size_t(length);
+    return Result::Ok;
+}
+
+SbcDecoder::Result SbcDecoder::decode(const SbcFrameView &frame, int16_t *pcm)
+{
+    if (frame.data.size() < size_t(Sbc::HeaderSize) || frame.data.size() < size_t(frame.header.frameLength()))
+        return Result::NeedMoreData;
+    if (!frame.crcValid)
+        return Result::CrcMismatch;
+
+    decodeChecked(frame.data.data(), frame.header, pcm);
+    return Result::Ok;
+}
+
+void SbcDecoder::decodeChecked(const uint8_t *data, const SbcFrameHeader &header, int16_t *pcm)
+{
+    // A parameter change is a new stream as far as the filterbank is concerned
+    if (m_hasHeader && (header.subbands != m_header.subbands || header.channelMode != m_header.channelMode))
+        reset();
+    m_header = header;
+    m_hasHeader = true;
+
+    if (header.subbands == 4) {
+        switch (header.channelMode) {
+        case SbcChannelMode::Mono:        decodeFrame<4, SbcChannelMode::Mono>(data, pcm); break;
+        case SbcChannelMode::DualChannel: decodeFrame<4, SbcChannelMode::DualChannel>(data, pcm); break;
+        case SbcChannelMode::Stereo:      decodeFrame<4, SbcChannelMode::Stereo>(data, pcm); break;
+        case SbcChannelMode::JointStereo: decodeFrame<4, SbcChannelMode::JointStereo>(data, pcm); break;
+        }
+    }
+    else {
+        switch (header.channelMode) {
+        case SbcChannelMode::Mono:        decodeFrame<8, SbcChannelMode::Mono>(data, pcm); break;
+        case SbcChannelMode::DualChannel: decodeFrame<8, SbcChannelMode::DualChannel>(data, pcm); break;
+        case SbcChannelMode::Stereo:      decodeFrame<8, SbcChannelMode::Stereo>(data, pcm); break;
+        case SbcChannelMode::JointStereo: decodeFrame<8, SbcChannelMode::JointStereo>(data, pcm); break;
+        }
+    }
+
+    m_framesDecoded++;
+}
+
+template<int M, SbcChannelMode Mode>
+void SbcDecoder::decodeFrame(const uint8_t *frame, int16_t *pcm)
+{
+    constexpr int Channels = Mode == SbcChannelMode::Mono ? 1 : 2;
+    constexpr bool Joint = Mode == SbcChannelMode::JointStereo;
+    constexpr bool SharedBitpool = Mode == SbcChannelMode::Stereo || Mode == SbcChannelMode::JointStereo;
+
+    const int blocks = m_header.blocks;
+    BitReader reader{frame + Sbc::HeaderSize};
+
+    // The join flag of the last subband is reserved and always ignored
+    uint32_t join = 0;
+    if constexpr (Joint) {
+        for (int sb = 0; sb < M; sb++)
+            join |= reader.read(1) << sb;
+        join &= (1u << (M - 1)) - 1;
+    }
+
+    int scaleFactors[Channels][M];
+    for (int ch = 0; ch < Channels; ch++) {
+        for (int sb = 0; sb < M; sb++)
+            scaleFactors[ch][sb] = int(reader.read(4));
+    }
+
+    int bits[Channels][M];
+    if constexpr (SharedBitpool) {
+        allocateBits<M, 2>(scaleFactors, m_header, bits);
+    }
+    else {
+        for (int ch = 0; ch < Channels; ch++)
+            allocateBits<M, 1>(&scaleFactors[ch], m_header, &bits[ch]);
+    }
+
+    // Dequantisation: sample = 2^(sf+1) * ((2q + 1) / levels - 1)
+    float factor[Channels][M];
+    float offset[Channels][M];
+    for (int ch = 0; ch < Channels; ch++) {
+        for (int sb = 0; sb < M; sb++) {
+            const float scale = float(1 << (scaleFactors[ch][sb] + 1));
+            const int levels = (1 << bits[ch][sb]) - 1;
+            factor[ch][sb] = bits[ch][sb] ? scale / float(levels) : 0.0f;
+            offset[ch][sb] = bits[ch][sb] ? scale : 0.0f;
+        }
+    }
+
+    SbcSynthesisState<M> *states;
+    SbcSynthesis::Function<M> synthesize;
+    if constexpr (M == 4) {
+        states = m_state4;
+        synthesize = m_synthesize4;
+    }
+    else {
+        states = m_state8;
+        synthesize = m_synthesize8;
+    }
+
+    for (int blk = 0; blk < blocks; blk++) {
+        float subbands[Channels][M];
+        for (int ch = 0; ch < Channels; ch++) {
+            for (int sb = 0; sb < M; sb++) {
+                if (bits[ch][sb]) {
+                    const uint32_t q = reader.read(bits[ch][sb]);
+                    subbands[ch][sb] = float((q << 1) | 1) * factor[ch][sb] - offset[ch][sb];
+                }
+                else {
+                    subbands[ch][sb] = 0.0f;
+                }
+            }
+        }
+
+        if constexpr (Joint) {
+            for (int sb = 0; sb < M - 1; sb++) {
+                if (join & (1u << sb)) {
+                    const float mid = subbands[0][sb];
+                    const float side = subbands[1][sb];
+                    subbands[0][sb] = mid + side;
+                    subbands[1][sb] = mid - side;
+                }
+            }
+        }
+
+        for (int ch = 0; ch < Channels; ch++) {
+            float out[M];
+            synthesize(states[ch], subbands[ch], out);
+            for (int i = 0; i < M; i++)
+                pcm[(blk * M + i) * Channels + ch] = toPcm(out[i]);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef SBCDECODER_H
+#define SBCDECODER_H
+
+#include "sbcsynthesis.h"
+#include "sbcframe.h"
+
+#include <cstdint>
+#include <cstddef>
+
+// Software SBC decoder. Frame decoding is specialised per subband count and channel mode, the
+// synthesis filterbank runs on the fastest available SIMD kernel. Not thread safe; one instance
+// per stream. Decoding never allocates.
+class SbcDecoder
+{
+public:
+    enum class Result {
+        Ok,
+        NeedMoreData,   // buffer shorter than the frame length
+        InvalidHeader,  // bad sync word or parameters
+        CrcMismatch
+    };
+
+    explicit SbcDecoder(SbcKernel kernel = SbcSynthesis::bestKernel());
+
+    // Decodes the frame at the start of data. On success, writes samplesPerChannel() * channels()
+    // interleaved samples to pcm (which must hold Sbc::MaxSamplesPerFrame) and sets consumed.
+    Result decode(const uint8_t *data, size_t size, int16_t *pcm, size_t *consumed = nullptr);
+
+    // Decodes a frame a packet parser has already located and CRC checked, without parsing the
+    // header or computing the CRC again
+    Result decode(const SbcFrameView &frame, int16_t *pcm);
+
+    // Header of the last successfully decoded frame
+    const SbcFrameHeader &header() const { return m_header; }
+
+    // Whether a frame has been decoded since construction or the last reset()
+    bool hasHeader() const { return m_hasHeader; }
+
+    // Clears the filterbank history (e.g. after a stream restart)
+    void reset();
+
+    SbcKernel kernel() const { return m_kernel; }
+
+    // Frames decoded by the current instance (no CRC failures included)
+    uint64_t framesDecoded() const { return m_framesDecoded; }
+
+private:
+    void decodeChecked(const uint8_t *frame, const SbcFrameHeader &header, int16_t *pcm);
+
+    template<int M, SbcChannelMode Mode>
+    void decodeFrame(const uint8_t *frame, int16_t *pcm);
+
+    SbcKernel m_kernel;
+    SbcSynthesis::Function<4> m_synthesize4;
+    SbcSynthesis::Function<8> m_synthesize8;
+    SbcSynthesisState<4> m_state4[Sbc::MaxChannels];
+    SbcSynthesisState<8> m_state8[Sbc::MaxChannels];
+    SbcFrameHeader m_header;
+    bool m_hasHeader;
+    uint64_t m_framesDecoded;
+};
+
+#endif // SBCDECODER_H
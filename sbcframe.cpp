@@ -0,0 +1,156 @@
+#include "sbcframe.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr int SampleRates[4] = { 16000, 32000, 44100, 48000 };
+
+uint32_t nextRandom(uint32_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// MSB-first bit writer used to lay out join flags and scale factors
+struct BitWriter
+{
+    uint8_t *data;
+    int position = 0;
+
+    void write(uint32_t value, int bits)
+    {
+        for (int i = bits - 1; i >= 0; i--, position++) {
+            const uint8_t mask = uint8_t(0x80 >> (position % 8));
+            if ((value >> i) & 1)
+                data[position / 8] |= mask;
+            else
+                data[position / 8] &= uint8_t(~mask);
+        }
+    }
+};
+
+} // namespace
+
+int SbcFrameHeader::sampleRateIndex() const
+{
+    for (int i = 0; i < 4; i++) {
+        if (SampleRates[i] == sampleRate)
+            return i;
+    }
+    return 2;
+}
+
+int SbcFrameHeader::frameLength() const
+{
+    const int nch = channels();
+    int length = Sbc::HeaderSize + (4 * subbands * nch) / 8;
+
+    switch (channelMode) {
+    case SbcChannelMode::Mono:
+    case SbcChannelMode::DualChannel:
+        length += (blocks * nch * bitpool + 7) / 8;
+        break;
+    case SbcChannelMode::Stereo:
+        length += (blocks * bitpool + 7) / 8;
+        break;
+    case SbcChannelMode::JointStereo:
+        length += (subbands + blocks * bitpool + 7) / 8;
+        break;
+    }
+    return length;
+}
+
+int SbcFrameHeader::crcBits() const
+{
+    return 16 + (channelMode == SbcChannelMode::JointStereo ? subbands : 0) + 4 * subbands * channels();
+}
+
+bool SbcFrameHeader::operator==(const SbcFrameHeader &other) const
+{
+    return sampleRate == other.sampleRate && blocks == other.blocks &&
+           channelMode == other.channelMode && allocation == other.allocation &&
+           subbands == other.subbands && bitpool == other.bitpool;
+}
+
+namespace Sbc {
+
+bool parseHeader(const uint8_t *data, size_t size, SbcFrameHeader &header)
+{
+    if (size < size_t(HeaderSize) || data[0] != SyncWord)
+        return false;
+
+    header.sampleRate = SampleRates[(data[1] >> 6) & 0x03];
+    header.blocks = 4 * (((data[1] >> 4) & 0x03) + 1);
+    header.channelMode = SbcChannelMode((data[1] >> 2) & 0x03);
+    header.allocation = SbcAllocation((data[1] >> 1) & 0x01);
+    header.subbands = (data[1] & 0x01) ? 8 : 4;
+    header.bitpool = data[2];
+    header.crc = data[3];
+
+    const bool twoChannelBitpool = header.channelMode == SbcChannelMode::Stereo ||
+                                   header.channelMode == SbcChannelMode::JointStereo;
+    const int maxBitpool = (twoChannelBitpool ? 32 : 16) * header.subbands;
+    return header.bitpool >= 2 && header.bitpool <= maxBitpool;
+}
+
+void writeHeader(uint8_t *data, const SbcFrameHeader &header)
+{
+    data[0] = SyncWord;
+    data[1] = uint8_t((header.sampleRateIndex() << 6) |
+                      ((header.blocks / 4 - 1) << 4) |
+                      (int(header.channelMode) << 2) |
+                      (int(header.allocation) << 1) |
+                      (header.subbands == 8 ? 1 : 0));
+    data[2] = uint8_t(header.bitpool);
+    data[3] = 0;
+}
+
+uint8_t crc8(const uint8_t *data, int bits)
+{
+    uint8_t crc = 0x0f;
+    for (int i = 0; i < bits; i++) {
+        const bool bit = (data[i / 8] >> (7 - (i % 8))) & 1;
+        const bool top = crc & 0x80;
+        crc <<= 1;
+        if (top != bit)
+            crc ^= 0x1d;
+    }
+    return crc;
+}
+
+uint8_t frameCrc(const uint8_t *frame, const SbcFrameHeader &header)
+{
+    // Header bytes 1-2 followed by the bits after the CRC byte (at most 88 bits in total)
+    uint8_t input[12];
+    const int bits = header.crcBits();
+    input[0] = frame[1];
+    input[1] = frame[2];
+    std::memcpy(input + 2, frame + HeaderSize, size_t((bits - 16 + 7) / 8));
+    return crc8(input, bits);
+}
+
+int writeNoiseFrame(uint8_t *frame, const SbcFrameHeader &header, uint32_t &rngState, int maxScaleFactor)
+{
+    const int length = header.frameLength();
+    writeHeader(frame, header);
+
+    for (int i = HeaderSize; i < length; i++)
+        frame[i] = uint8_t(nextRandom(rngState));
+
+    BitWriter writer{frame + HeaderSize};
+    if (header.channelMode == SbcChannelMode::JointStereo)
+        writer.write(nextRandom(rngState) & ~1u & ((1u << header.subbands) - 1), header.subbands);
+
+    const int scaleFactorRange = std::clamp(maxScaleFactor, 0, 15) + 1;
+    for (int i = 0; i < header.subbands * header.channels(); i++)
+        writer.write(nextRandom(rngState) % uint32_t(scaleFactorRange), 4);
+
+    frame[3] = frameCrc(frame, header);
+    return length;
+}
+
+} // namespace Sbc
@@ -0,0 +1,86 @@
+#ifndef SBCFRAME_H
+#define SBCFRAME_H
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+
+// SBC frame format as defined by the A2DP specification (appendix B)
+
+enum class SbcChannelMode : uint8_t {
+    Mono = 0,
+    DualChannel = 1,
+    Stereo = 2,
+    JointStereo = 3
+};
+
+enum class SbcAllocation : uint8_t {
+    Loudness = 0,
+    Snr = 1
+};
+
+struct SbcFrameHeader
+{
+    int sampleRate = 44100;
+    int blocks = 16;
+    SbcChannelMode channelMode = SbcChannelMode::JointStereo;
+    SbcAllocation allocation = SbcAllocation::Loudness;
+    int subbands = 8;
+    int bitpool = 53;
+    uint8_t crc = 0;
+
+    int channels() const { return channelMode == SbcChannelMode::Mono ? 1 : 2; }
+
+    // PCM samples per channel produced by one frame
+    int samplesPerChannel() const { return blocks * subbands; }
+
+    // Index used by the loudness offset tables (16k, 32k, 44.1k, 48k)
+    int sampleRateIndex() const;
+
+    // Total frame size in bytes, including the 4 byte header
+    int frameLength() const;
+
+    // Number of bits covered by the CRC (header bytes 1-2, join flags and scale factors)
+    int crcBits() const;
+
+    bool operator==(const SbcFrameHeader &other) const;
+    bool operator!=(const SbcFrameHeader &other) const { return !(*this == other); }
+};
+
+// A frame located and checked by a packet parser, pointing into the packet buffer
+struct SbcFrameView
+{
+    std::span<const uint8_t> data;  // header through the last byte of the frame
+    SbcFrameHeader header;
+    bool crcValid = false;
+};
+
+namespace Sbc {
+
+constexpr uint8_t SyncWord = 0x9c;
+constexpr int HeaderSize = 4;
+constexpr int MaxBlocks = 16;
+constexpr int MaxSubbands = 8;
+constexpr int MaxChannels = 2;
+constexpr int MaxSamplesPerFrame = MaxBlocks * MaxSubbands * MaxChannels;
+
+// Parses and validates the fixed part of a frame header. Returns false on a bad sync word,
+// short buffer or a bitpool outside the range allowed for the channel mode.
+bool parseHeader(const uint8_t *data, size_t size, SbcFrameHeader &header);
+
+// Writes the 4 header bytes (CRC byte left as zero)
+void writeHeader(uint8_t *data, const SbcFrameHeader &header);
+
+// SBC CRC-8 (x^8 + x^4 + x^3 + x^2 + 1, initial value 0x0F) over the first `bits` bits of data
+uint8_t crc8(const uint8_t *data, int bits);
+
+// Computes the CRC of a complete frame (which must be at least frameLength() bytes)
+uint8_t frameCrc(const uint8_t *frame, const SbcFrameHeader &header);
+
+// Writes a frame with a valid header and CRC but random sample bits. Scale factors are kept at or
+// below maxScaleFactor, so the frame decodes to noise of bounded level. Returns the frame length.
+int writeNoiseFrame(uint8_t *frame, const SbcFrameHeader &header, uint32_t &rngState, int maxScaleFactor = 5);
+
+} // namespace Sbc
+
+#endif // SBCFRAME_H
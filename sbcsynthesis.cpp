@@ -0,0 +1,252 @@
+#include "sbcsynthesis.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SBC_HAVE_X86 1
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define SBC_TARGET_AVX2
+    #else
+        #define SBC_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
+namespace {
+
+// Prototype filter coefficients (A2DP spec tables 12.23 and 12.24)
+constexpr double Proto4[40] = {
+     0.00000000E+00,  5.36548976E-04,  1.49188357E-03,  2.73370904E-03,
+     3.83720193E-03,  3.89205149E-03,  1.86581691E-03, -3.06012286E-03,
+     1.09137620E-02,  2.04385087E-02,  2.88757392E-02,  3.21939290E-02,
+     2.58767811E-02,  6.13245186E-03, -2.88217274E-02, -7.76463494E-02,
+     1.35593274E-01,  1.94987841E-01,  2.46636662E-01,  2.81828203E-01,
+     2.94315332E-01,  2.81828203E-01,  2.46636662E-01,  1.94987841E-01,
+    -1.35593274E-01, -7.76463494E-02, -2.88217274E-02,  6.13245186E-03,
+     2.58767811E-02,  3.21939290E-02,  2.88757392E-02,  2.04385087E-02,
+    -1.09137620E-02, -3.06012286E-03,  1.86581691E-03,  3.89205149E-03,
+     3.83720193E-03,  2.73370904E-03,  1.49188357E-03,  5.36548976E-04
+};
+
+constexpr double Proto8[80] = {
+     0.00000000E+00,  1.56575398E-04,  3.43256425E-04,  5.54620202E-04,
+     8.23919506E-04,  1.13992507E-03,  1.47640169E-03,  1.78371725E-03,
+     2.01182542E-03,  2.10371989E-03,  1.99454554E-03,  1.61656283E-03,
+     9.02154502E-04, -1.78805361E-04, -1.64973098E-03, -3.49717454E-03,
+     5.65949473E-03,  8.02941163E-03,  1.04584443E-02,  1.27472335E-02,
+     1.46525263E-02,  1.59045603E-02,  1.62208471E-02,  1.53184106E-02,
+     1.29371806E-02,  8.85757540E-03,  2.92408442E-03, -4.91578024E-03,
+    -1.46404076E-02, -2.61098752E-02, -3.90751381E-02, -5.31873032E-02,
+     6.79989431E-02,  8.29847578E-02,  9.75753918E-02,  1.11196689E-01,
+     1.23264548E-01,  1.33264415E-01,  1.40753505E-01,  1.45389847E-01,
+     1.46955068E-01,  1.45389847E-01,  1.40753505E-01,  1.33264415E-01,
+     1.23264548E-01,  1.11196689E-01,  9.75753918E-02,  8.29847578E-02,
+    -6.79989431E-02, -5.31873032E-02, -3.90751381E-02, -2.61098752E-02,
+    -1.46404076E-02, -4.91578024E-03,  2.92408442E-03,  8.85757540E-03,
+     1.29371806E-02,  1.53184106E-02,  1.62208471E-02,  1.59045603E-02,
+     1.46525263E-02,  1.27472335E-02,  1.04584443E-02,  8.02941163E-03,
+    -5.65949473E-03, -3.49717454E-03, -1.64973098E-03, -1.78805361E-04,
+     9.02154502E-04,  1.61656283E-03,  1.99454554E-03,  2.10371989E-03,
+     2.01182542E-03,  1.78371725E-03,  1.47640169E-03,  1.13992507E-03,
+     8.23919506E-04,  5.54620202E-04,  3.43256425E-04,  1.56575398E-04
+};
+
+// Matrixing and windowing coefficients, laid out so each SIMD lane reads consecutive floats
+template<int M>
+struct Tables
+{
+    alignas(32) float matrix[M][2 * M]; // N[k][i] transposed: matrix[i][k]
+    alignas(32) float window[10 * M];   // D[i]
+
+    Tables()
+    {
+        const double pi = 3.14159265358979323846;
+        for (int i = 0; i < M; i++) {
+            for (int k = 0; k < 2 * M; k++)
+                matrix[i][k] = float(std::cos((i + 0.5) * (k + M / 2) * pi / M));
+        }
+
+        const double *proto = M == 4 ? Proto4 : Proto8;
+        for (int i = 0; i < 10 * M; i++)
+            window[i] = float(-M * proto[i]);
+    }
+};
+
+template<int M>
+const Tables<M> &tables()
+{
+    static const Tables<M> instance;
+    return instance;
+}
+
+// Offset into V of window tap t (0-9): even taps read V[i*4M + j], odd taps V[i*4M + 3M + j]
+template<int M>
+constexpr int tapOffset(int t)
+{
+    return (t / 2) * 4 * M + ((t & 1) ? 3 * M : 0);
+}
+
+template<int M>
+void synthesizeScalar(SbcSynthesisState<M> &state, const float *subbandSamples, float *out)
+{
+    const Tables<M> &t = tables<M>();
+    float *v = state.advance();
+
+    for (int k = 0; k < 2 * M; k++) {
+        float acc = 0.0f;
+        for (int i = 0; i < M; i++)
+            acc = acc + t.matrix[i][k] * subbandSamples[i];
+        v[k] = acc;
+    }
+
+    for (int j = 0; j < M; j++) {
+        float acc = 0.0f;
+        for (int tap = 0; tap < 10; tap++)
+            acc = acc + v[tapOffset<M>(tap) + j] * t.window[tap * M + j];
+        out[j] = acc;
+    }
+}
+
+#ifdef SBC_HAVE_X86
+
+template<int M>
+void synthesizeSse2(SbcSynthesisState<M> &state, const float *subbandSamples, float *out)
+{
+    const Tables<M> &t = tables<M>();
+    float *v = state.advance();
+
+    for (int k = 0; k < 2 * M; k += 4) {
+        __m128 acc = _mm_setzero_ps();
+        for (int i = 0; i < M; i++)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(&t.matrix[i][k]), _mm_set1_ps(subbandSamples[i])));
+        _mm_storeu_ps(v + k, acc);
+    }
+
+    for (int j = 0; j < M; j += 4) {
+        __m128 acc = _mm_setzero_ps();
+        for (int tap = 0; tap < 10; tap++)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(v + tapOffset<M>(tap) + j),
+                                             _mm_loadu_ps(t.window + tap * M + j)));
+        _mm_storeu_ps(out + j, acc);
+    }
+}
+
+template<int M>
+SBC_TARGET_AVX2 void synthesizeAvx2(SbcSynthesisState<M> &state, const float *subbandSamples, float *out)
+{
+    const Tables<M> &t = tables<M>();
+    float *v = state.advance();
+
+    // 2M is 8 or 16, so matrixing always fills whole 256-bit lanes
+    for (int k = 0; k < 2 * M; k += 8) {
+        __m256 acc = _mm256_setzero_ps();
+        for (int i = 0; i < M; i++)
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_load_ps(&t.matrix[i][k]),
+                                                   _mm256_set1_ps(subbandSamples[i])));
+        _mm256_storeu_ps(v + k, acc);
+    }
+
+    if constexpr (M == 8) {
+        __m256 acc = _mm256_setzero_ps();
+        for (int tap = 0; tap < 10; tap++)
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(v + tapOffset<M>(tap)),
+                                                   _mm256_loadu_ps(t.window + tap * M)));
+        _mm256_storeu_ps(out, acc);
+    }
+    else {
+        __m128 acc = _mm_setzero_ps();
+        for (int tap = 0; tap < 10; tap++)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(v + tapOffset<M>(tap)),
+                                             _mm_loadu_ps(t.window + tap * M)));
+        _mm_storeu_ps(out, acc);
+    }
+}
+
+bool cpuHasAvx2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    // AVX needs OSXSAVE and the OS saving the YMM state
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // SBC_HAVE_X86
+
+} // namespace
+
+namespace SbcSynthesis {
+
+bool isSupported(SbcKernel kernel)
+{
+    switch (kernel) {
+    case SbcKernel::Scalar:
+        return true;
+#ifdef SBC_HAVE_X86
+    case SbcKernel::Sse2:
+        return true;
+    case SbcKernel::Avx2: {
+        static const bool avx2 = cpuHasAvx2();
+        return avx2;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+SbcKernel bestKernel()
+{
+    if (isSupported(SbcKernel::Avx2))
+        return SbcKernel::Avx2;
+    if (isSupported(SbcKernel::Sse2))
+        return SbcKernel::Sse2;
+    return SbcKernel::Scalar;
+}
+
+const char *kernelName(SbcKernel kernel)
+{
+    switch (kernel) {
+    case SbcKernel::Scalar: return "scalar";
+    case SbcKernel::Sse2:   return "sse2";
+    case SbcKernel::Avx2:   return "avx2";
+    }
+    return "unknown";
+}
+
+template<int M>
+Function<M> select(SbcKernel kernel)
+{
+    if (!isSupported(kernel))
+        kernel = SbcKernel::Scalar;
+
+    switch (kernel) {
+#ifdef SBC_HAVE_X86
+    case SbcKernel::Sse2:
+        return &synthesizeSse2<M>;
+    case SbcKernel::Avx2:
+        return &synthesizeAvx2<M>;
+#endif
+    default:
+        return &synthesizeScalar<M>;
+    }
+}
+
+template Function<4> select<4>(SbcKernel kernel);
+template Function<8> select<8>(SbcKernel kernel);
+
+} // namespace SbcSynthesis
@@ -0,0 +1,70 @@
+#ifndef SBCSYNTHESIS_H
+#define SBCSYNTHESIS_H
+
+#include <cstring>
+
+// Polyphase synthesis filterbank of the SBC decoder (A2DP spec 12.6.4).
+//
+// All kernels accumulate every output lane in the same order with separate multiply and add
+// steps, so the scalar, SSE2 and AVX2 variants produce bit-identical results. This relies on
+// the compiler not contracting a*b+c into FMA (see QMAKE_CXXFLAGS in PhoneAudioLink.pro).
+
+enum class SbcKernel {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+// Per-channel synthesis history for M subbands. V is kept in a sliding window over a larger
+// buffer so shifting it by 2M every block only costs a copy once every few blocks.
+template<int M>
+struct SbcSynthesisState
+{
+    static constexpr int WindowSize = 20 * M;
+    static constexpr int BufferSize = WindowSize * 4;
+
+    alignas(32) float buffer[BufferSize];
+    int offset;
+
+    SbcSynthesisState() { reset(); }
+
+    void reset()
+    {
+        std::memset(buffer, 0, sizeof(buffer));
+        offset = BufferSize - WindowSize;
+    }
+
+    // Shifts V by 2M and returns V[0]; the caller writes the new V[0..2M-1]
+    float *advance()
+    {
+        offset -= 2 * M;
+        if (offset < 0) {
+            std::memmove(buffer + BufferSize - WindowSize + 2 * M, buffer + offset + 2 * M,
+                         (WindowSize - 2 * M) * sizeof(float));
+            offset = BufferSize - WindowSize;
+        }
+        return buffer + offset;
+    }
+};
+
+namespace SbcSynthesis {
+
+// Synthesizes M PCM samples (unclipped floats) from M subband samples of one block
+template<int M>
+using Function = void (*)(SbcSynthesisState<M> &state, const float *subbandSamples, float *out);
+
+// Fastest kernel supported by this CPU
+SbcKernel bestKernel();
+
+// Whether the kernel was compiled in and is supported by this CPU
+bool isSupported(SbcKernel kernel);
+
+const char *kernelName(SbcKernel kernel);
+
+// Returns the kernel implementation, falling back to scalar if it is unsupported
+template<int M>
+Function<M> select(SbcKernel kernel);
+
+} // namespace SbcSynthesis
+
+#endif // SBCSYNTHESIS_H
@@ -0,0 +1,323 @@
+#include "simulatedsinkbackend.h"
+#include "binarylog.h"
+#include "sbcframe.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <thread>
+
+namespace {
+
+// xorshift32 - cheap and reproducible, one state per thread
+quint32 nextRandom(quint32 &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+double nextUnit(quint32 &state)
+{
+    return (nextRandom(state) >> 8) / double(1u << 24);
+}
+
+constexpr int RtpHeaderSize = 12;
+
+int64_t steadyMicros()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+SimulatedSinkBackend::Config SimulatedSinkBackend::Config::fromString(const QString &spec)
+{
+    Config config;
+    const QStringList entries = spec.split(',', Qt::SkipEmptyParts);
+    for (const QString &entry : entries) {
+        const QString key = entry.section('=', 0, 0).trimmed();
+        const QString value = entry.section('=', 1).trimmed();
+
+        if (key == "deviceCount")            config.deviceCount = value.toInt();
+        else if (key == "discoveryDelayMs")  config.discoveryDelayMs = value.toInt();
+        else if (key == "enableDelayMs")     config.enableDelayMs = value.toInt();
+        else if (key == "openDelayMs")       config.openDelayMs = value.toInt();
+        else if (key == "enableFailureRate") config.enableFailureRate = value.toDouble();
+        else if (key == "openFailureRate")   config.openFailureRate = value.toDouble();
+        else if (key == "streamDurationMs")  config.streamDurationMs = value.toInt();
+        else if (key == "sampleRate")        config.sampleRate = value.toInt();
+        else if (key == "framesPerPacket")   config.framesPerPacket = value.toInt();
+        else if (key == "bitpool")           config.bitpool = value.toInt();
+        else if (key == "jitterUs")          config.jitterUs = value.toInt();
+        else if (key == "lossRate")          config.lossRate = value.toDouble();
+        else if (key == "lossBurst")         config.lossBurst = value.toInt();
+        else if (key == "seed")              config.seed = value.toUInt();
+        else qWarning() << "Unknown simulator option:" << key;
+    }
+
+    config.deviceCount = std::max(0, config.deviceCount);
+    if (config.sampleRate != 16000 && config.sampleRate != 32000 && config.sampleRate != 48000)
+        config.sampleRate = 44100;
+    config.framesPerPacket = std::clamp(config.framesPerPacket, 1, 15);
+    config.bitpool = std::clamp(config.bitpool, 2, 250);
+    config.lossBurst = std::max(1, config.lossBurst);
+    if (config.seed == 0)
+        config.seed = 1;
+    return config;
+}
+
+SimulatedSinkBackend::SimulatedSinkBackend(const Config &config, QObject *parent)
+    : A2DPSinkBackend(parent)
+    , m_config(config)
+    , m_discoveryTimer(new QTimer(this))
+    , m_operationTimer(new QTimer(this))
+    , m_dropTimer(new QTimer(this))
+    , m_discoveryIndex(0)
+    , m_state(LinkState::Idle)
+    , m_rngState(config.seed)
+    , m_mediaThread(nullptr)
+{
+    qDebug() << "Initializing simulated sink backend with" << m_config.deviceCount << "devices";
+
+    for (int i = 0; i < m_config.deviceCount; i++) {
+        m_deviceIds.append(QLatin1String(DeviceIdPrefix)
+                           + QString::asprintf("02:50:41:4C:%02X:%02X", (i >> 8) & 0xff, i & 0xff));
+    }
+
+    m_discoveryTimer->setInterval(m_config.discoveryDelayMs);
+    connect(m_discoveryTimer, &QTimer::timeout, this, [this]() {
+        if (m_discoveryIndex >= m_deviceIds.size()) {
+            m_discoveryTimer->stop();
+            emit discoveryCompleted();
+            return;
+        }
+        const int i = m_discoveryIndex++;
+        emit devicesDiscovered({ { m_deviceIds.at(i), QString("Simulated Phone %1").arg(i + 1) } });
+    });
+
+    m_operationTimer->setSingleShot(true);
+    connect(m_operationTimer, &QTimer::timeout, this, [this]() {
+        if (m_state == LinkState::Enabling) {
+            if (roll(m_config.enableFailureRate)) {
+                m_state = LinkState::Idle;
+                emit connectionError("Simulated failure starting AudioPlaybackConnection");
+                return;
+            }
+            m_state = LinkState::Enabled;
+            emit connectMilestone(ConnectMilestone::SinkStarted, steadyMicros());
+            emit sinkEnabled();
+            emit stateChanged("Sink Enabled - Ready to Connect");
+        }
+        else if (m_state == LinkState::Opening) {
+            if (roll(m_config.openFailureRate)) {
+                m_state = LinkState::Enabled;
+                emit connectionError("Failed to open connection: Request timed out");
+                return;
+            }
+            m_state = LinkState::Streaming;
+            startMediaStream();
+            if (m_config.streamDurationMs > 0)
+                m_dropTimer->start(m_config.streamDurationMs);
+            // No separate StateChanged here: the stream is open as soon as the open completes
+            const int64_t openedUs = steadyMicros();
+            emit connectMilestone(ConnectMilestone::ConnectionOpened, openedUs);
+            emit connectMilestone(ConnectMilestone::StreamOpened, openedUs);
+            emit connectionOpened();
+            emit stateChanged("Connected - Audio Streaming");
+        }
+    });
+
+    // The simulated phone walks away: behaves like StateChanged(Closed) from WinRT
+    m_dropTimer->setSingleShot(true);
+    connect(m_dropTimer, &QTimer::timeout, this, [this]() {
+        stopMediaStream();
+        m_state = LinkState::Idle;
+        emit connectionClosed();
+        emit stateChanged("Closed");
+    });
+}
+
+SimulatedSinkBackend::~SimulatedSinkBackend()
+{
+    stopMediaStream();
+}
+
+bool SimulatedSinkBackend::handlesDeviceId(const QString &deviceId) const
+{
+    return deviceId.startsWith(QLatin1String(DeviceIdPrefix));
+}
+
+void SimulatedSinkBackend::startDeviceDiscovery()
+{
+    m_discoveryIndex = 0;
+    m_discoveryTimer->start();
+}
+
+void SimulatedSinkBackend::stopDeviceDiscovery()
+{
+    m_discoveryTimer->stop();
+}
+
+bool SimulatedSinkBackend::enableSink(const QString &deviceId)
+{
+    if (!handlesDeviceId(deviceId)) {
+        emit connectionError("Unknown simulated device: " + deviceId);
+        return false;
+    }
+
+    releaseConnection();
+
+    m_currentDeviceId = deviceId;
+    m_state = LinkState::Enabling;
+    emit connectMilestone(ConnectMilestone::ConnectionCreated, steadyMicros());
+    m_operationTimer->start(m_config.enableDelayMs);
+    return true;
+}
+
+bool SimulatedSinkBackend::openConnection()
+{
+    if (m_state != LinkState::Enabled) {
+        emit connectionError("Sink not enabled - call enableSink() first");
+        return false;
+    }
+
+    m_state = LinkState::Opening;
+    m_operationTimer->start(m_config.openDelayMs);
+    return true;
+}
+
+void SimulatedSinkBackend::releaseConnection()
+{
+    if (m_state == LinkState::Idle)
+        return;
+
+    m_operationTimer->stop();
+    m_dropTimer->stop();
+    stopMediaStream();
+    m_state = LinkState::Idle;
+
+    emit connectionClosed();
+    emit stateChanged("Disconnected");
+}
+
+bool SimulatedSinkBackend::isStreaming() const
+{
+    return m_state == LinkState::Streaming;
+}
+
+void SimulatedSinkBackend::sendPlayPause()
+{
+    LOG_DEBUG("Simulator received Play/Pause command");
+}
+
+void SimulatedSinkBackend::sendNext()
+{
+    LOG_DEBUG("Simulator received Next Track command");
+}
+
+void SimulatedSinkBackend::sendPrevious()
+{
+    LOG_DEBUG("Simulator received Previous Track command");
+}
+
+void SimulatedSinkBackend::sendStop()
+{
+    LOG_DEBUG("Simulator received Stop command");
+}
+
+bool SimulatedSinkBackend::roll(double probability)
+{
+    return probability > 0.0 && nextUnit(m_rngState) < probability;
+}
+
+void SimulatedSinkBackend::startMediaStream()
+{
+    stopMediaStream();
+    m_mediaRunning.store(true, std::memory_order_release);
+    m_mediaThread = QThread::create([this]() { mediaLoop(); });
+    m_mediaThread->setObjectName("SimulatedMediaStream");
+    m_mediaThread->start(QThread::HighPriority);
+}
+
+void SimulatedSinkBackend::stopMediaStream()
+{
+    if (!m_mediaThread)
+        return;
+
+    m_mediaRunning.store(false, std::memory_order_release);
+    m_mediaThread->wait();
+    delete m_mediaThread;
+    m_mediaThread = nullptr;
+}
+
+// Runs on the media thread: paces RTP packets at the nominal SBC rate, applies the
+// jitter and loss models and hands surviving packets to the media sink.
+void SimulatedSinkBackend::mediaLoop()
+{
+    quint32 rng = m_config.seed ^ 0x9e3779b9u;
+
+    // Generated stream: joint stereo, 16 blocks, 8 subbands, loudness allocation
+    SbcFrameHeader header;
+    header.sampleRate = m_config.sampleRate;
+    header.bitpool = m_config.bitpool;
+    const int frameLength = header.frameLength();
+    const int samplesPerPacket = header.samplesPerChannel() * m_config.framesPerPacket;
+    const double packetDurationUs = samplesPerPacket * 1e6 / m_config.sampleRate;
+
+    std::vector<quint8> packet(RtpHeaderSize + 1 + size_t(frameLength) * m_config.framesPerPacket);
+    quint16 sequence = quint16(nextRandom(rng));
+    quint32 timestamp = nextRandom(rng);
+    const quint32 ssrc = 1;
+
+    const int64_t startUs = steadyMicros();
+    int64_t lastSendUs = startUs;
+    int burstRemaining = 0;
+
+    for (quint64 index = 0; m_mediaRunning.load(std::memory_order_acquire); index++) {
+        // RTP header: V=2, PT=96 (dynamic), sequence, timestamp in samples, SSRC
+        packet[0] = 0x80;
+        packet[1] = 96;
+        packet[2] = quint8(sequence >> 8);
+        packet[3] = quint8(sequence);
+        for (int i = 0; i < 4; i++) {
+            packet[4 + i] = quint8(timestamp >> (24 - 8 * i));
+            packet[8 + i] = quint8(ssrc >> (24 - 8 * i));
+        }
+
+        // A2DP SBC media payload header: unfragmented, frame count in the low nibble
+        packet[RtpHeaderSize] = quint8(m_config.framesPerPacket);
+        for (int f = 0; f < m_config.framesPerPacket; f++)
+            Sbc::writeNoiseFrame(packet.data() + RtpHeaderSize + 1 + size_t(f) * frameLength, header, rng);
+
+        sequence++;
+        timestamp += quint32(samplesPerPacket);
+
+        const int64_t nominalUs = startUs + int64_t((index + 1) * packetDurationUs);
+        const int64_t jitterUs = m_config.jitterUs > 0 ? int64_t(nextRandom(rng) % quint32(m_config.jitterUs + 1)) : 0;
+        // L2CAP never reorders, so a late packet also delays the ones behind it
+        const int64_t sendUs = std::max(lastSendUs, nominalUs + jitterUs);
+        lastSendUs = sendUs;
+
+        std::this_thread::sleep_for(std::chrono::microseconds(std::max<int64_t>(0, sendUs - steadyMicros())));
+        if (!m_mediaRunning.load(std::memory_order_acquire))
+            break;
+
+        if (burstRemaining == 0 && m_config.lossRate > 0.0 && nextUnit(rng) < m_config.lossRate)
+            burstRemaining = m_config.lossBurst;
+
+        if (burstRemaining > 0) {
+            burstRemaining--;
+            m_packetsDropped.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        m_packetsSent.fetch_add(1, std::memory_order_relaxed);
+        if (A2DPMediaSink *sink = m_mediaSink.load(std::memory_order_acquire))
+            sink->mediaPacketReceived(packet.data(), packet.size(), steadyMicros());
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef SIMULATEDSINKBACKEND_H
+#define SIMULATEDSINKBACKEND_H
+
+#include "a2dpsinkbackend.h"
+
+#include <QStringList>
+#include <QThread>
+#include <QString>
+#include <QTimer>
+
+#include <atomic>
+
+// Synthetic phone simulator. Emits fake devices, completes enable/open after configurable
+// delays (or fails them), and streams generated SBC media packets with tunable jitter and loss.
+// Lets the connect/stream lifecycle run headless on machines without Bluetooth.
+class SimulatedSinkBackend : public A2DPSinkBackend
+{
+    Q_OBJECT
+public:
+    struct Config {
+        int deviceCount = 3;            // number of simulated phones to "discover"
+        int discoveryDelayMs = 50;      // delay between discovered devices
+        int enableDelayMs = 150;        // StartAsync equivalent
+        int openDelayMs = 300;          // OpenAsync equivalent
+        double enableFailureRate = 0.0; // probability [0,1] that enableSink fails
+        double openFailureRate = 0.0;   // probability [0,1] that openConnection fails
+        int streamDurationMs = 0;       // phone drops the link after this long (0 = never)
+
+        int sampleRate = 44100;         // 16000, 32000, 44100 or 48000
+        int framesPerPacket = 5;        // SBC frames per RTP packet
+        int bitpool = 53;
+        int jitterUs = 0;               // max extra random delay per packet
+        double lossRate = 0.0;          // probability [0,1] that a packet is dropped
+        int lossBurst = 1;              // packets dropped per loss event
+        quint32 seed = 1;               // makes runs reproducible
+
+        // Parses "key=value,key=value" (keys as the field names above)
+        static Config fromString(const QString &spec);
+    };
+
+    explicit SimulatedSinkBackend(const Config &config, QObject *parent = nullptr);
+    ~SimulatedSinkBackend() override;
+
+    // Device IDs handed out by the simulator start with this prefix
+    static constexpr const char *DeviceIdPrefix = "SIMULATOR#";
+
+    // Environment variable that selects (and configures) the simulator
+    static constexpr const char *EnvironmentVariable = "PHONEAUDIOLINK_SIMULATOR";
+
+    QString name() const override { return "Simulator"; }
+    bool handlesDeviceId(const QString &deviceId) const override;
+    bool providesMediaStream() const override { return true; }
+
+    void startDeviceDiscovery() override;
+    void stopDeviceDiscovery() override;
+    bool enableSink(const QString &deviceId) override;
+    bool openConnection() override;
+    void releaseConnection() override;
+    bool isStreaming() const override;
+
+    void sendPlayPause() override;
+    void sendNext() override;
+    void sendPrevious() override;
+    void sendStop() override;
+
+    const Config &config() const { return m_config; }
+
+    // Total packets generated / dropped by the loss model since construction
+    quint64 packetsSent() const { return m_packetsSent.load(std::memory_order_relaxed); }
+    quint64 packetsDropped() const { return m_packetsDropped.load(std::memory_order_relaxed); }
+
+private:
+    enum class LinkState { Idle, Enabling, Enabled, Opening, Streaming };
+
+    bool roll(double probability);
+    void startMediaStream();
+    void stopMediaStream();
+    void mediaLoop();
+
+    Config m_config;
+    QStringList m_deviceIds;
+    QTimer *m_discoveryTimer;
+    QTimer *m_operationTimer;
+    QTimer *m_dropTimer;
+    int m_discoveryIndex;
+    LinkState m_state;
+    QString m_currentDeviceId;
+    quint32 m_rngState;
+
+    QThread *m_mediaThread;
+    std::atomic<bool> m_mediaRunning{false};
+    std::atomic<quint64> m_packetsSent{0};
+    std::atomic<quint64> m_packetsDropped{0};
+};
+
+#endif // SIMULATEDSINKBACKEND_H
@@ -0,0 +1,76 @@
+#include "singleinstance.h"
+#include "controlserver.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QThread>
+#include <QDebug>
+
+namespace {
+
+// How long a second launch waits for the first one to start serving the control API
+constexpr int StartupWaitMs = 3000;
+
+} // namespace
+
+SingleInstance::SingleInstance()
+    : m_lock(QDir::temp().filePath(ControlServer::serverName() + ".lock"))
+{
+    // Stale only when the process that took it is gone, however long it has been running
+    m_lock.setStaleLockTime(0);
+}
+
+bool SingleInstance::tryAcquire()
+{
+    return m_lock.tryLock(0);
+}
+
+bool SingleInstance::forward(const QStringList &arguments)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QJsonObject request{ { "jsonrpc", "2.0" }, { "id", 1 }, { "method", "show" } };
+    const int connectIndex = arguments.indexOf("--connect");
+    if (connectIndex >= 0) {
+        request["method"] = "connect";
+        request["params"] = QJsonObject{ { "address", arguments.value(connectIndex + 1) } };
+    }
+    else if (arguments.contains("--disconnect")) {
+        request["method"] = "disconnect";
+    }
+
+    // The running instance may still be starting up and not listen yet
+    QLocalSocket socket;
+    for (;;) {
+        socket.connectToServer(ControlServer::serverName());
+        if (socket.waitForConnected(100))
+            break;
+        if (timer.elapsed() > StartupWaitMs) {
+            qWarning() << "PhoneAudioLink is already running but does not respond:" << socket.errorString();
+            return false;
+        }
+        QThread::msleep(20);
+    }
+
+    socket.write(QJsonDocument(request).toJson(QJsonDocument::Compact) + '\n');
+    socket.flush();
+    while (!socket.canReadLine()) {
+        if (!socket.waitForReadyRead(StartupWaitMs)) {
+            qWarning() << "No answer from the running PhoneAudioLink:" << socket.errorString();
+            return false;
+        }
+    }
+
+    const QJsonObject response = QJsonDocument::fromJson(socket.readLine()).object();
+    if (response.contains("error")) {
+        qWarning().noquote() << "The running PhoneAudioLink refused" << request["method"].toString() << "-"
+                             << response["error"].toObject()["message"].toString();
+        return false;
+    }
+    qDebug() << "Forwarded" << request["method"].toString() << "to the running instance in" << timer.elapsed() << "ms";
+    return true;
+}
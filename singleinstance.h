@@ -0,0 +1,27 @@
+#ifndef SINGLEINSTANCE_H
+#define SINGLEINSTANCE_H
+
+#include <QLockFile>
+#include <QStringList>
+
+// One PhoneAudioLink per user: a second launch would open its own AudioPlaybackConnection and
+// fight the first one for the phone. The first instance holds a lock file for its lifetime;
+// later launches find it taken and forward their command line to the running instance through
+// the control API instead, before any application object, widget or COM object exists.
+class SingleInstance
+{
+public:
+    SingleInstance();
+
+    // True if this is the only instance; it stays so until this object is destroyed
+    bool tryAcquire();
+
+    // Sends the intent of a command line to the running instance: `--connect <address>`,
+    // `--disconnect`, or else `show`. Waits briefly for an instance that is still starting.
+    static bool forward(const QStringList &arguments);
+
+private:
+    QLockFile m_lock;
+};
+
+#endif // SINGLEINSTANCE_H
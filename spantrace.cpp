@@ -0,0 +1,233 @@
+#include "spantrace.h"
+
+#ifdef PHONEAUDIOLINK_TRACING
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace SpanTrace {
+namespace {
+
+struct Event
+{
+    const char *category;
+    const char *name;
+    qint64 startNs;
+    qint64 durationNs;
+    quint64 id;
+    char phase;     // X complete, b/e async begin/end, i instant
+    bool cancelled = false;     // async end of an operation that never completed
+};
+
+// Per-thread buffers are locked only by their own thread and by save(), so recording never
+// contends with another recording thread
+constexpr size_t MaxEventsPerThread = 1 << 20;
+
+struct ThreadBuffer
+{
+    QMutex mutex;
+    std::vector<Event> events;
+    quint64 dropped = 0;
+    int tid = 0;
+    QByteArray name;
+};
+
+QMutex buffersMutex;
+std::vector<ThreadBuffer *> buffers;    // never freed; a thread that exits leaves its spans for save()
+
+ThreadBuffer *registerThread()
+{
+    ThreadBuffer *buffer = new ThreadBuffer;
+    if (QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread())
+        buffer->name = "main";
+    else if (!QThread::currentThread()->objectName().isEmpty())
+        buffer->name = QThread::currentThread()->objectName().toUtf8();
+    else
+        buffer->name = "0x" + QByteArray::number(quintptr(QThread::currentThreadId()), 16);
+
+    QMutexLocker locker(&buffersMutex);
+    buffer->tid = int(buffers.size()) + 1;
+    buffers.push_back(buffer);
+    return buffer;
+}
+
+thread_local ThreadBuffer *threadBuffer = nullptr;
+
+void add(const Event &event)
+{
+    if (!threadBuffer)
+        threadBuffer = registerThread();
+    QMutexLocker locker(&threadBuffer->mutex);
+    if (threadBuffer->events.size() >= MaxEventsPerThread) {
+        threadBuffer->dropped++;
+        return;
+    }
+    threadBuffer->events.push_back(event);
+}
+
+void appendString(QByteArray &json, const char *text)
+{
+    json += '"';
+    for (const char *c = text; *c; c++) {
+        if (*c == '"' || *c == '\\')
+            json += '\\';
+        if (quint8(*c) >= 0x20)
+            json += *c;
+    }
+    json += '"';
+}
+
+} // namespace
+
+namespace detail {
+
+qint64 now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void complete(const char *category, const char *name, qint64 startNs, qint64 durationNs)
+{
+    add({ category, name, startNs, durationNs, 0, 'X' });
+}
+
+} // namespace detail
+
+void setEnabled(bool enabled)
+{
+    detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void asyncBegin(const char *category, const char *name, quint64 id)
+{
+    if (isEnabled())
+        add({ category, name, detail::now(), 0, id, 'b' });
+}
+
+void asyncEnd(const char *category, const char *name, quint64 id, bool cancelled)
+{
+    if (isEnabled())
+        add({ category, name, detail::now(), 0, id, 'e', cancelled });
+}
+
+void instant(const char *category, const char *name)
+{
+    if (isEnabled())
+        add({ category, name, detail::now(), 0, 0, 'i' });
+}
+
+QString defaultPath()
+{
+    return QCoreApplication::applicationDirPath() + "/logs/trace-"
+           + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss") + ".json";
+}
+
+bool save(const QString &path, QString *error)
+{
+    struct Taken
+    {
+        std::vector<Event> events;
+        quint64 dropped;
+        int tid;
+        QByteArray name;
+    };
+    std::vector<Taken> taken;
+    {
+        QMutexLocker locker(&buffersMutex);
+        for (ThreadBuffer *buffer : buffers) {
+            QMutexLocker bufferLocker(&buffer->mutex);
+            taken.push_back({ std::move(buffer->events), std::exchange(buffer->dropped, 0), buffer->tid, buffer->name });
+            buffer->events.clear();
+        }
+    }
+
+    // Timestamps in microseconds from the first event, so the viewer starts at zero
+    qint64 originNs = std::numeric_limits<qint64>::max();
+    for (const Taken &thread : taken) {
+        for (const Event &event : thread.events)
+            originNs = std::min(originNs, event.startNs);
+    }
+
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QByteArray json;
+    json.reserve(4096);
+    json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&json, &first]() {
+        if (!first)
+            json += ",\n";
+        first = false;
+    };
+    for (const Taken &thread : taken) {
+        const QByteArray tid = QByteArray::number(thread.tid);
+        separator();
+        json += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"args\":{\"name\":";
+        appendString(json, thread.name.constData());
+        json += "}}";
+        if (thread.dropped) {
+            separator();
+            json += "{\"ph\":\"i\",\"s\":\"t\",\"name\":\"" + QByteArray::number(thread.dropped)
+                    + " spans dropped\",\"cat\":\"trace\",\"ts\":0,\"pid\":" + pid + ",\"tid\":" + tid + "}";
+        }
+
+        for (const Event &event : thread.events) {
+            separator();
+            json += "{\"ph\":\"";
+            json += event.phase;
+            json += "\",\"cat\":";
+            appendString(json, event.category);
+            json += ",\"name\":";
+            appendString(json, event.name);
+            json += ",\"ts\":" + QByteArray::number((event.startNs - originNs) / 1000.0, 'f', 3);
+            if (event.phase == 'X')
+                json += ",\"dur\":" + QByteArray::number(event.durationNs / 1000.0, 'f', 3);
+            else if (event.phase == 'i')
+                json += ",\"s\":\"t\"";
+            else
+                json += ",\"id\":\"0x" + QByteArray::number(event.id, 16) + "\"";
+            if (event.cancelled)
+                json += ",\"args\":{\"cancelled\":true}";
+            json += ",\"pid\":" + pid + ",\"tid\":" + tid + "}";
+        }
+    }
+    json += "\n]}\n";
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void saveWhenQuitting()
+{
+    QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, []() {
+        const QString path = defaultPath();
+        QString error;
+        if (save(path, &error))
+            qInfo().noquote() << "Trace saved to" << QDir::toNativeSeparators(path);
+        else
+            qWarning().noquote() << "Trace not saved to" << path << "-" << error;
+    });
+}
+
+} // namespace SpanTrace
+
+#endif // PHONEAUDIOLINK_TRACING
@@ -0,0 +1,135 @@
+#ifndef SPANTRACE_H
+#define SPANTRACE_H
+
+// Spans of where wall time goes across threads (WinRT callbacks, the GUI thread, timer chains),
+// exported as Chrome trace-event JSON for chrome://tracing or ui.perfetto.dev.
+//
+//     void BluetoothA2DPSink::openConnection()
+//     {
+//         TRACE_SCOPE("sink", "openConnection");
+//         ...
+//
+// Only built with `qmake CONFIG+=tracing`; otherwise the macros expand to nothing and this header
+// declares nothing. Built in, spans are recorded while enabled (`--trace-spans`, or Advanced > Record
+// Trace) into a buffer per thread, and a disabled span costs one relaxed load.
+#ifdef PHONEAUDIOLINK_TRACING
+
+#include <QString>
+#include <QtGlobal>
+
+#include <atomic>
+
+namespace SpanTrace {
+
+namespace detail {
+inline std::atomic<bool> enabled{ false };
+qint64 now();
+void complete(const char *category, const char *name, qint64 startNs, qint64 durationNs);
+} // namespace detail
+
+void setEnabled(bool enabled);
+inline bool isEnabled() { return detail::enabled.load(std::memory_order_relaxed); }
+
+// Names and categories must be string literals (or otherwise outlive the trace)
+class Scope
+{
+public:
+    Scope(const char *category, const char *name)
+        : m_category(category)
+        , m_name(name)
+        , m_startNs(isEnabled() ? detail::now() : -1)
+    {}
+
+    ~Scope()
+    {
+        if (m_startNs >= 0)
+            detail::complete(m_category, m_name, m_startNs, detail::now() - m_startNs);
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *m_category;
+    const char *m_name;
+    qint64 m_startNs;
+};
+
+// A span that starts and ends in different callbacks, possibly on different threads; begin and
+// end are paired by category, name and id
+void asyncBegin(const char *category, const char *name, quint64 id);
+void asyncEnd(const char *category, const char *name, quint64 id, bool cancelled = false);
+
+// An async span held by a coroutine across a co_await. end() closes it when the operation
+// completes; if the frame is destroyed first because the operation was cancelled, the destructor
+// closes it with a "cancelled" arg, so the begin is never left open
+class AsyncScope
+{
+public:
+    AsyncScope(const char *category, const char *name, quint64 id)
+        : m_category(category)
+        , m_name(name)
+        , m_id(id)
+        , m_open(isEnabled())
+    {
+        if (m_open)
+            asyncBegin(category, name, id);
+    }
+
+    ~AsyncScope()
+    {
+        if (m_open)
+            asyncEnd(m_category, m_name, m_id, true);
+    }
+
+    void end()
+    {
+        if (m_open)
+            asyncEnd(m_category, m_name, m_id);
+        m_open = false;
+    }
+
+    AsyncScope(const AsyncScope &) = delete;
+    AsyncScope &operator=(const AsyncScope &) = delete;
+
+private:
+    const char *m_category;
+    const char *m_name;
+    quint64 m_id;
+    bool m_open;
+};
+
+void instant(const char *category, const char *name);
+
+// logs/trace-<time>.json next to the executable
+QString defaultPath();
+
+// Writes the spans recorded so far as trace JSON and clears them
+bool save(const QString &path, QString *error = nullptr);
+
+// Saves to defaultPath() when the application quits (`--trace-spans`)
+void saveWhenQuitting();
+
+} // namespace SpanTrace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(category, name) SpanTrace::Scope TRACE_CONCAT(traceScope, __LINE__)(category, name)
+#define TRACE_ASYNC_BEGIN(category, name, id) SpanTrace::asyncBegin(category, name, quint64(id))
+#define TRACE_ASYNC_END(category, name, id) SpanTrace::asyncEnd(category, name, quint64(id))
+#define TRACE_ASYNC_SCOPE(scope, category, name, id) SpanTrace::AsyncScope scope(category, name, quint64(id))
+#define TRACE_ASYNC_SCOPE_END(scope) scope.end()
+#define TRACE_INSTANT(category, name) SpanTrace::instant(category, name)
+
+#else
+
+#define TRACE_SCOPE(category, name) do {} while (false)
+#define TRACE_ASYNC_BEGIN(category, name, id) do {} while (false)
+#define TRACE_ASYNC_END(category, name, id) do {} while (false)
+#define TRACE_ASYNC_SCOPE(scope, category, name, id) do {} while (false)
+#define TRACE_ASYNC_SCOPE_END(scope) do {} while (false)
+#define TRACE_INSTANT(category, name) do {} while (false)
+
+#endif // PHONEAUDIOLINK_TRACING
+
+#endif // SPANTRACE_H
@@ -0,0 +1,77 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <cstddef>
+#include <atomic>
+
+// Wait-free single-producer/single-consumer ring of fixed-size slots.
+//
+// Slots are written and read in place (beginWrite/commitWrite, front/pop), so nothing is
+// copied twice and nothing is allocated after construction. The producer and consumer indices
+// live on separate cache lines, and each side keeps a cached copy of the other side's index so
+// the shared lines are only touched when the cached view says the ring is full or empty.
+template<typename T, size_t Capacity>
+class SpscRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    static constexpr size_t CacheLine = 64;
+
+    // Producer: next free slot, or nullptr if the ring is full
+    T *beginWrite()
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == Capacity) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == Capacity)
+                return nullptr;
+        }
+        return &m_slots[tail & (Capacity - 1)];
+    }
+
+    // Producer: publishes the slot returned by beginWrite()
+    void commitWrite()
+    {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer: oldest filled slot, or nullptr if the ring is empty
+    T *front()
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail)
+                return nullptr;
+        }
+        return &m_slots[head & (Capacity - 1)];
+    }
+
+    // Consumer: releases the slot returned by front()
+    void pop()
+    {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Approximate number of filled slots; exact when called from the producer or consumer
+    size_t size() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    // Consumer side
+    alignas(CacheLine) std::atomic<size_t> m_head{0};
+    size_t m_cachedTail = 0;
+
+    // Producer side
+    alignas(CacheLine) std::atomic<size_t> m_tail{0};
+    size_t m_cachedHead = 0;
+
+    alignas(CacheLine) T m_slots[Capacity];
+};
+
+#endif // SPSCRING_H
@@ -0,0 +1,54 @@
+#include "startuptrace.h"
+#include "processstats.h"
+
+#include <QString>
+#include <QDebug>
+
+namespace {
+
+struct Phase
+{
+    const char *name;
+    qint64 us;
+};
+
+// Startup has a few dozen phases at most; later marks are dropped rather than allocated for
+constexpr int MaxPhases = 64;
+Phase phases[MaxPhases];
+int phaseCount = 0;
+bool enabled = false;
+bool dumped = false;
+
+} // namespace
+
+namespace StartupTrace {
+
+void mark(const char *phase)
+{
+    if (phaseCount < MaxPhases)
+        phases[phaseCount++] = Phase{ phase, ProcessStats::usSinceStart() };
+}
+
+void setEnabled(bool on)
+{
+    enabled = on;
+}
+
+void dump()
+{
+    if (!enabled || dumped)
+        return;
+    dumped = true;
+
+    qInfo() << "Startup trace (ms since process creation, + since the previous phase):";
+    qint64 previous = 0;
+    for (int i = 0; i < phaseCount; i++) {
+        qInfo().noquote() << QString("%1  +%2  %3")
+                                 .arg(phases[i].us / 1000.0, 9, 'f', 2)
+                                 .arg((phases[i].us - previous) / 1000.0, 8, 'f', 2)
+                                 .arg(phases[i].name);
+        previous = phases[i].us;
+    }
+}
+
+} // namespace StartupTrace
@@ -0,0 +1,19 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+// Timestamps of the startup critical path, in microseconds since the process was created.
+// mark() is cheap enough to stay in release builds; with `--trace-startup` the phases are
+// printed once the event loop runs.
+namespace StartupTrace {
+
+// Records a phase; phase must outlive the process (a string literal). Main thread only.
+void mark(const char *phase);
+
+void setEnabled(bool enabled);
+
+// Prints the phases recorded so far with their deltas, once, if enabled
+void dump();
+
+} // namespace StartupTrace
+
+#endif // STARTUPTRACE_H
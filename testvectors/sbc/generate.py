@@ -0,0 +1,409 @@
+#!/usr/bin/env python3
+"""Generates the SBC reference vectors checked by `PhoneAudioLink --benchmark sbc`.
+
+Each vector is a <name>.sbc stream of concatenated frames and a <name>.pcm file with the PCM
+a reference decoder produces for it (16-bit little endian, channels interleaved).
+
+Both sides are written from the A2DP specification (appendix B) alone, in double precision,
+and share nothing with the decoder in this repository: the encoder runs the analysis
+filterbank, scale factors, joint stereo decision, bit allocation, quantisation and CRC; the
+reference decoder parses the frames back and runs bit allocation, dequantisation and the
+synthesis filterbank. The script checks that the round trip reproduces the input (unity gain
+at the filterbank delay, SNR above a floor) before it writes anything, so the vectors are
+known-good independently of the code they test.
+
+    python3 testvectors/sbc/generate.py [output directory]
+"""
+
+import math
+import os
+import struct
+import sys
+
+# Prototype filter coefficients (A2DP spec tables 12.23 and 12.24)
+PROTO_4 = [
+     0.00000000E+00,  5.36548976E-04,  1.49188357E-03,  2.73370904E-03,
+     3.83720193E-03,  3.89205149E-03,  1.86581691E-03, -3.06012286E-03,
+     1.09137620E-02,  2.04385087E-02,  2.88757392E-02,  3.21939290E-02,
+     2.58767811E-02,  6.13245186E-03, -2.88217274E-02, -7.76463494E-02,
+     1.35593274E-01,  1.94987841E-01,  2.46636662E-01,  2.81828203E-01,
+     2.94315332E-01,  2.81828203E-01,  2.46636662E-01,  1.94987841E-01,
+    -1.35593274E-01, -7.76463494E-02, -2.88217274E-02,  6.13245186E-03,
+     2.58767811E-02,  3.21939290E-02,  2.88757392E-02,  2.04385087E-02,
+    -1.09137620E-02, -3.06012286E-03,  1.86581691E-03,  3.89205149E-03,
+     3.83720193E-03,  2.73370904E-03,  1.49188357E-03,  5.36548976E-04,
+]
+
+PROTO_8 = [
+     0.00000000E+00,  1.56575398E-04,  3.43256425E-04,  5.54620202E-04,
+     8.23919506E-04,  1.13992507E-03,  1.47640169E-03,  1.78371725E-03,
+     2.01182542E-03,  2.10371989E-03,  1.99454554E-03,  1.61656283E-03,
+     9.02154502E-04, -1.78805361E-04, -1.64973098E-03, -3.49717454E-03,
+     5.65949473E-03,  8.02941163E-03,  1.04584443E-02,  1.27472335E-02,
+     1.46525263E-02,  1.59045603E-02,  1.62208471E-02,  1.53184106E-02,
+     1.29371806E-02,  8.85757540E-03,  2.92408442E-03, -4.91578024E-03,
+    -1.46404076E-02, -2.61098752E-02, -3.90751381E-02, -5.31873032E-02,
+     6.79989431E-02,  8.29847578E-02,  9.75753918E-02,  1.11196689E-01,
+     1.23264548E-01,  1.33264415E-01,  1.40753505E-01,  1.45389847E-01,
+     1.46955068E-01,  1.45389847E-01,  1.40753505E-01,  1.33264415E-01,
+     1.23264548E-01,  1.11196689E-01,  9.75753918E-02,  8.29847578E-02,
+    -6.79989431E-02, -5.31873032E-02, -3.90751381E-02, -2.61098752E-02,
+    -1.46404076E-02, -4.91578024E-03,  2.92408442E-03,  8.85757540E-03,
+     1.29371806E-02,  1.53184106E-02,  1.62208471E-02,  1.59045603E-02,
+     1.46525263E-02,  1.27472335E-02,  1.04584443E-02,  8.02941163E-03,
+    -5.65949473E-03, -3.49717454E-03, -1.64973098E-03, -1.78805361E-04,
+     9.02154502E-04,  1.61656283E-03,  1.99454554E-03,  2.10371989E-03,
+     2.01182542E-03,  1.78371725E-03,  1.47640169E-03,  1.13992507E-03,
+     8.23919506E-04,  5.54620202E-04,  3.43256425E-04,  1.56575398E-04,
+]
+
+# Loudness allocation offsets (A2DP spec tables 12.17 and 12.18), by sample rate index
+OFFSET_4 = [[-1, 0, 0, 0], [-2, 0, 0, 1], [-2, 0, 0, 1], [-2, 0, 0, 1]]
+OFFSET_8 = [[-2, 0, 0, 0, 0, 0, 0, 1], [-3, 0, 0, 0, 0, 0, 1, 2],
+            [-4, 0, 0, 0, 0, 0, 1, 2], [-4, 0, 0, 0, 0, 0, 1, 2]]
+
+SAMPLE_RATES = [16000, 32000, 44100, 48000]
+BLOCKS = [4, 8, 12, 16]
+MONO, DUAL, STEREO, JOINT = range(4)
+LOUDNESS, SNR = range(2)
+MODE_NAMES = ["mono", "dual", "stereo", "joint"]
+ALLOCATION_NAMES = ["loudness", "snr"]
+
+
+class Params:
+    def __init__(self, rate, blocks, mode, allocation, subbands, bitpool):
+        self.rate, self.blocks, self.mode = rate, blocks, mode
+        self.allocation, self.subbands, self.bitpool = allocation, subbands, bitpool
+        self.channels = 1 if mode == MONO else 2
+
+    def frame_length(self):
+        length = 4 + (4 * self.subbands * self.channels) // 8
+        if self.mode in (MONO, DUAL):
+            return length + (self.blocks * self.channels * self.bitpool + 7) // 8
+        join = self.subbands if self.mode == JOINT else 0
+        return length + (join + self.blocks * self.bitpool + 7) // 8
+
+    def name(self):
+        return "%s_%dsb_%s_%dk_%dblk_bp%d" % (MODE_NAMES[self.mode], self.subbands,
+                                             ALLOCATION_NAMES[self.allocation], self.rate // 1000,
+                                             self.blocks, self.bitpool)
+
+
+class BitWriter:
+    def __init__(self):
+        self.bits = []
+
+    def write(self, value, count):
+        for i in range(count - 1, -1, -1):
+            self.bits.append((value >> i) & 1)
+
+    def to_bytes(self):
+        bits = self.bits + [0] * (-len(self.bits) % 8)
+        return bytes(int("".join(map(str, bits[i:i + 8])), 2) for i in range(0, len(bits), 8))
+
+
+class BitReader:
+    def __init__(self, data):
+        self.data, self.position = data, 0
+
+    def read(self, count):
+        value = 0
+        for _ in range(count):
+            value = (value << 1) | ((self.data[self.position >> 3] >> (7 - (self.position & 7))) & 1)
+            self.position += 1
+        return value
+
+
+def crc8(bits):
+    crc = 0x0F
+    for bit in bits:
+        feedback = ((crc >> 7) & 1) ^ bit
+        crc = (crc << 1) & 0xFF
+        if feedback:
+            crc ^= 0x1D
+    return crc
+
+
+def bits_of(data, count):
+    return [(data[i >> 3] >> (7 - (i & 7))) & 1 for i in range(count)]
+
+
+def allocate(p, scale_factors):
+    """Bits per channel and subband (spec 12.6.3)."""
+    M = p.subbands
+    rate_index = SAMPLE_RATES.index(p.rate)
+
+    def bitneed_of(sf, sb):
+        if p.allocation == SNR:
+            return sf
+        if sf == 0:
+            return -5
+        offset = (OFFSET_4 if M == 4 else OFFSET_8)[rate_index][sb]
+        loudness = sf - offset
+        return loudness // 2 if loudness > 0 else loudness
+
+    def run(channels):
+        bitneed = {(ch, sb): bitneed_of(scale_factors[ch][sb], sb) for ch in channels for sb in range(M)}
+        max_bitneed = max(bitneed.values())
+        bitcount, slicecount, bitslice = 0, 0, max_bitneed + 1
+        while True:
+            bitslice -= 1
+            bitcount += slicecount
+            slicecount = 0
+            for need in bitneed.values():
+                if bitslice + 1 < need < bitslice + 16:
+                    slicecount += 1
+                elif need == bitslice + 1:
+                    slicecount += 2
+            if bitcount + slicecount >= p.bitpool:
+                break
+        if bitcount + slicecount == p.bitpool:
+            bitcount += slicecount
+            bitslice -= 1
+
+        bits = {key: 0 if need < bitslice + 2 else min(need - bitslice, 16) for key, need in bitneed.items()}
+        order = [(ch, sb) for sb in range(M) for ch in channels]
+        for key in order:
+            if bitcount >= p.bitpool:
+                break
+            if 2 <= bits[key] < 16:
+                bits[key] += 1
+                bitcount += 1
+            elif bitneed[key] == bitslice + 1 and p.bitpool > bitcount + 1:
+                bits[key] = 2
+                bitcount += 2
+        for key in order:
+            if bitcount >= p.bitpool:
+                break
+            if bits[key] < 16:
+                bits[key] += 1
+                bitcount += 1
+        return bits
+
+    if p.mode in (MONO, DUAL):
+        merged = {}
+        for ch in range(p.channels):
+            merged.update(run([ch]))
+    else:
+        merged = run([0, 1])
+    return [[merged[(ch, sb)] for sb in range(M)] for ch in range(p.channels)]
+
+
+def scale_factor_of(peak):
+    """Smallest scale factor whose range 2^(sf+1) holds the peak."""
+    sf = 0
+    while sf < 15 and peak >= 2.0 ** (sf + 1):
+        sf += 1
+    return sf
+
+
+class Analysis:
+    """Encoder analysis filterbank (spec 12.5.1), one per channel."""
+
+    def __init__(self, M):
+        self.M = M
+        self.proto = PROTO_4 if M == 4 else PROTO_8
+        self.x = [0.0] * (10 * M)
+        self.matrix = [[math.cos((i + 0.5) * (k - M / 2) * math.pi / M) for k in range(2 * M)] for i in range(M)]
+
+    def block(self, samples):
+        M = self.M
+        self.x = list(reversed(samples)) + self.x[:9 * M]
+        z = [self.proto[i] * self.x[i] for i in range(10 * M)]
+        y = [sum(z[i + k * 2 * M] for k in range(5)) for i in range(2 * M)]
+        return [sum(self.matrix[i][k] * y[k] for k in range(2 * M)) for i in range(M)]
+
+
+class Synthesis:
+    """Decoder synthesis filterbank (spec 12.6.4), one per channel."""
+
+    def __init__(self, M):
+        self.M = M
+        proto = PROTO_4 if M == 4 else PROTO_8
+        self.window = [-M * c for c in proto]
+        self.v = [0.0] * (20 * M)
+        self.matrix = [[math.cos((i + 0.5) * (k + M / 2) * math.pi / M) for i in range(M)] for k in range(2 * M)]
+
+    def block(self, subband_samples):
+        M = self.M
+        self.v = [sum(self.matrix[k][i] * subband_samples[i] for i in range(M)) for k in range(2 * M)] + self.v[:18 * M]
+        u = [0.0] * (10 * M)
+        for i in range(5):
+            for j in range(M):
+                u[i * 2 * M + j] = self.v[i * 4 * M + j]
+                u[i * 2 * M + M + j] = self.v[i * 4 * M + 3 * M + j]
+        w = [u[i] * self.window[i] for i in range(10 * M)]
+        return [sum(w[j + M * i] for i in range(10)) for j in range(M)]
+
+
+def encode(p, pcm):
+    """pcm: per channel lists of floats in 16-bit units. Returns the frames as bytes."""
+    M, B, C = p.subbands, p.blocks, p.channels
+    analyses = [Analysis(M) for _ in range(C)]
+    stream = bytearray()
+    for start in range(0, len(pcm[0]) - B * M + 1, B * M):
+        sb = [[analyses[ch].block(pcm[ch][start + blk * M:start + (blk + 1) * M]) for ch in range(C)] for blk in range(B)]
+
+        def peaks(samples):
+            return [[max(abs(samples[blk][ch][s]) for blk in range(B)) for s in range(M)] for ch in range(C)]
+
+        scale_factors = [[scale_factor_of(v) for v in row] for row in peaks(sb)]
+        join = [0] * M
+        if p.mode == JOINT:
+            mid_side = [[[(sb[blk][0][s] + sb[blk][1][s]) / 2, (sb[blk][0][s] - sb[blk][1][s]) / 2] for s in range(M)]
+                        for blk in range(B)]
+            ms_peaks = [[max(abs(mid_side[blk][s][ch]) for blk in range(B)) for s in range(M)] for ch in range(2)]
+            for s in range(M - 1):
+                ms = scale_factor_of(ms_peaks[0][s]) + scale_factor_of(ms_peaks[1][s])
+                if ms < scale_factors[0][s] + scale_factors[1][s]:
+                    join[s] = 1
+                    for blk in range(B):
+                        sb[blk][0][s], sb[blk][1][s] = mid_side[blk][s]
+                    scale_factors[0][s] = scale_factor_of(ms_peaks[0][s])
+                    scale_factors[1][s] = scale_factor_of(ms_peaks[1][s])
+
+        bits = allocate(p, scale_factors)
+        writer = BitWriter()
+        writer.write(0x9C, 8)
+        writer.write(SAMPLE_RATES.index(p.rate), 2)
+        writer.write(BLOCKS.index(B), 2)
+        writer.write(p.mode, 2)
+        writer.write(p.allocation, 1)
+        writer.write(1 if M == 8 else 0, 1)
+        writer.write(p.bitpool, 8)
+        writer.write(0, 8)  # CRC, filled in below
+        if p.mode == JOINT:
+            for s in range(M):
+                writer.write(join[s], 1)
+        for ch in range(C):
+            for s in range(M):
+                writer.write(scale_factors[ch][s], 4)
+        crc_bits = writer.bits[8:24] + writer.bits[32:]
+        for blk in range(B):
+            for ch in range(C):
+                for s in range(M):
+                    if bits[ch][s] == 0:
+                        continue
+                    levels = (1 << bits[ch][s]) - 1
+                    scale = 2.0 ** (scale_factors[ch][s] + 1)
+                    quantized = int(math.floor((sb[blk][ch][s] / scale + 1.0) * levels / 2.0))
+                    writer.write(min(max(quantized, 0), levels - 1), bits[ch][s])
+        frame = bytearray(writer.to_bytes())
+        frame[3] = crc8(crc_bits)
+        assert len(frame) == p.frame_length(), (len(frame), p.frame_length())
+        stream += frame
+    return bytes(stream)
+
+
+def decode(data):
+    """Reference decoder. Returns (params of the first frame, per channel lists of floats)."""
+    offset, out, synthesis, first = 0, None, None, None
+    while offset < len(data):
+        reader = BitReader(data[offset:])
+        assert reader.read(8) == 0x9C
+        rate = SAMPLE_RATES[reader.read(2)]
+        blocks = BLOCKS[reader.read(2)]
+        mode = reader.read(2)
+        allocation = reader.read(1)
+        M = 8 if reader.read(1) else 4
+        p = Params(rate, blocks, mode, allocation, M, reader.read(8))
+        crc = reader.read(8)
+        if first is None:
+            first, out, synthesis = p, [[] for _ in range(p.channels)], [Synthesis(M) for _ in range(p.channels)]
+        join = [reader.read(1) for _ in range(M)] if mode == JOINT else [0] * M
+        scale_factors = [[reader.read(4) for _ in range(M)] for _ in range(p.channels)]
+        crc_count = 16 + (M if mode == JOINT else 0) + 4 * M * p.channels
+        frame_bits = bits_of(data[offset:], 32 + crc_count - 16)
+        assert crc8(frame_bits[8:24] + frame_bits[32:]) == crc, "CRC mismatch at offset %d" % offset
+
+        bits = allocate(p, scale_factors)
+        for blk in range(blocks):
+            samples = [[0.0] * M for _ in range(p.channels)]
+            for ch in range(p.channels):
+                for s in range(M):
+                    if bits[ch][s]:
+                        levels = (1 << bits[ch][s]) - 1
+                        quantized = reader.read(bits[ch][s])
+                        samples[ch][s] = 2.0 ** (scale_factors[ch][s] + 1) * ((quantized * 2.0 + 1.0) / levels - 1.0)
+            for s in range(M):
+                if join[s]:
+                    mid, side = samples[0][s], samples[1][s]
+                    samples[0][s], samples[1][s] = mid + side, mid - side
+            for ch in range(p.channels):
+                out[ch].extend(synthesis[ch].block(samples[ch]))
+        offset += p.frame_length()
+    return first, out
+
+
+def signal(p, frames):
+    """Tones, a sweep and noise at several levels, different per channel, with a silent stretch
+    (scale factor 0) and a loud one (high scale factors)."""
+    length = frames * p.blocks * p.subbands
+    state = [0x12345678]
+
+    def noise():
+        state[0] = (state[0] * 1103515245 + 12345) & 0x7FFFFFFF
+        return state[0] / 0x7FFFFFFF * 2.0 - 1.0
+
+    channels = []
+    for ch in range(p.channels):
+        samples = []
+        for n in range(length):
+            t = n / p.rate
+            envelope = 0.0 if length // 3 <= n < length // 3 + 4 * p.blocks * p.subbands else \
+                (0.85 if n >= 2 * length // 3 else 0.25)
+            tone = 0.5 * math.sin(2 * math.pi * (440 + 220 * ch) * t) + 0.3 * math.sin(2 * math.pi * (3100 - 900 * ch) * t)
+            sweep = 0.15 * math.sin(2 * math.pi * (200 * t + 0.5 * p.rate * 0.4 * t * t / (length / p.rate)))
+            samples.append(32767 * envelope * (tone + sweep + 0.05 * noise()))
+        channels.append(samples)
+    return channels
+
+
+def check_round_trip(p, pcm, decoded):
+    delay = 10 * p.subbands - p.subbands + 1
+    for ch in range(p.channels):
+        source = pcm[ch][:len(decoded[ch]) - delay]
+        output = decoded[ch][delay:]
+        signal_power = sum(v * v for v in source)
+        noise_power = sum((a - b) ** 2 for a, b in zip(source, output))
+        gain = sum(a * b for a, b in zip(source, output)) / signal_power
+        snr = 10 * math.log10(signal_power / max(noise_power, 1e-9))
+        print("  channel %d  gain %.4f  SNR %.1f dB" % (ch, gain, snr))
+        if abs(gain - 1.0) > 0.01 or snr < 15:
+            sys.exit("%s: round trip failed" % p.name())
+
+
+VECTORS = [
+    Params(32000, 8, MONO, SNR, 4, 18),
+    Params(48000, 16, MONO, LOUDNESS, 8, 32),
+    Params(16000, 12, DUAL, SNR, 8, 24),
+    Params(44100, 4, STEREO, LOUDNESS, 4, 30),
+    Params(44100, 16, STEREO, SNR, 8, 53),
+    Params(48000, 12, JOINT, SNR, 4, 35),
+    Params(44100, 16, JOINT, LOUDNESS, 8, 53),
+    Params(32000, 16, JOINT, LOUDNESS, 8, 24),
+]
+
+FRAMES = 24
+
+
+def main():
+    directory = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    for p in VECTORS:
+        print(p.name())
+        pcm = signal(p, FRAMES)
+        stream = encode(p, pcm)
+        parsed, decoded = decode(stream)
+        assert (parsed.rate, parsed.blocks, parsed.mode, parsed.allocation, parsed.subbands, parsed.bitpool) == \
+            (p.rate, p.blocks, p.mode, p.allocation, p.subbands, p.bitpool)
+        check_round_trip(p, pcm, decoded)
+
+        interleaved = [decoded[ch][n] for n in range(len(decoded[0])) for ch in range(p.channels)]
+        with open(os.path.join(directory, p.name() + ".sbc"), "wb") as f:
+            f.write(stream)
+        with open(os.path.join(directory, p.name() + ".pcm"), "wb") as f:
+            f.write(b"".join(struct.pack("<h", max(-32768, min(32767, round(v)))) for v in interleaved))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,625 @@
+#include "winrtsinkbackend.h"
+#include "binarylog.h"
+#include "flightrecorder.h"
+#include "jitterbuffer.h"
+#include "spantrace.h"
+#include <QMetaObject>
+
+#ifdef Q_OS_WIN
+    using namespace winrt;
+    using namespace winrt::Windows::Foundation;
+    using namespace winrt::Windows::Media::Audio;
+    using namespace winrt::Windows::Devices::Enumeration;
+
+namespace {
+
+// Outcomes of WinRT async operations, taken on the thread that completed them
+struct StartOutcome
+{
+    QString error;          // empty on success
+    qint64 completedUs = 0;
+};
+
+struct OpenOutcome
+{
+    AudioPlaybackConnectionOpenResult result{ nullptr };
+    QString error;
+    qint64 completedUs = 0;
+};
+
+QString errorMessage(const winrt::hresult_error &ex)
+{
+    return QString::fromWCharArray(ex.message().c_str());
+}
+
+// Any thread
+void recordHResult(const char *operation, const winrt::hresult_error &ex)
+{
+    FlightRecorder::record(FlightRecorder::HResult, operation, ex.code().value);
+}
+
+// Awaiting these resumes on the context's thread, straight from the thread WinRT completes the
+// operation on: one hop, instead of back to the apartment and again through the event loop
+AsyncCompletion<StartOutcome> completion(QObject *context, const CancellationToken &token, IAsyncAction action)
+{
+    return AsyncCompletion<StartOutcome>(context, token, [action](AsyncCompletion<StartOutcome>::Callback done) {
+        action.Completed([done](const IAsyncAction &completed, AsyncStatus) {
+            TRACE_SCOPE("winrt", "StartAsync completed");
+            StartOutcome outcome;
+            outcome.completedUs = JitterBuffer::steadyMicros();
+            try {
+                completed.GetResults();
+            }
+            catch (const winrt::hresult_error &ex) {
+                recordHResult("StartAsync", ex);
+                outcome.error = errorMessage(ex);
+            }
+            done(std::move(outcome));
+        });
+    });
+}
+
+AsyncCompletion<OpenOutcome> completion(QObject *context, const CancellationToken &token,
+                                        IAsyncOperation<AudioPlaybackConnectionOpenResult> operation)
+{
+    return AsyncCompletion<OpenOutcome>(context, token, [operation](AsyncCompletion<OpenOutcome>::Callback done) {
+        operation.Completed([done](const IAsyncOperation<AudioPlaybackConnectionOpenResult> &completed, AsyncStatus) {
+            TRACE_SCOPE("winrt", "OpenAsync completed");
+            OpenOutcome outcome;
+            outcome.completedUs = JitterBuffer::steadyMicros();
+            try {
+                outcome.result = completed.GetResults();
+            }
+            catch (const winrt::hresult_error &ex) {
+                recordHResult("OpenAsync", ex);
+                outcome.error = errorMessage(ex);
+            }
+            done(std::move(outcome));
+        });
+    });
+}
+
+} // namespace
+#endif
+
+WinRTSinkBackend::WinRTSinkBackend(QObject *parent)
+    : A2DPSinkBackend(parent)
+#ifdef Q_OS_WIN
+    , m_watcherEvents(this, [this](const QList<WatcherEvent> &events) { deliverWatcherEvents(events); })
+#endif
+    , m_winrtInitialized(false)
+    , m_ownsApartment(false)
+    , m_isStreaming(false)
+{
+    qDebug() << "Initializing WinRT sink backend...";
+    initializeWinRT();
+}
+
+WinRTSinkBackend::~WinRTSinkBackend()
+{
+    cleanupWinRT();
+}
+
+void WinRTSinkBackend::initializeWinRT()
+{
+#ifdef Q_OS_WIN
+    try {
+        // Try to initialize as Single-Threaded Apartment
+        winrt::init_apartment(winrt::apartment_type::single_threaded);
+        m_winrtInitialized = true;
+        m_ownsApartment = true;
+        qDebug() << "WinRT initialized successfully (STA)";
+    }
+    catch (const winrt::hresult_error &ex) {
+        HRESULT hr = ex.code();
+
+        // RPC_E_CHANGED_MODE means COM already initialized - that's fine
+        if (hr == RPC_E_CHANGED_MODE) {
+            qDebug() << "COM already initialized, using existing apartment";
+            m_winrtInitialized = true;
+            m_ownsApartment = false;
+        }
+        else {
+            qWarning() << "Failed to initialize WinRT:"
+                       << QString::fromWCharArray(ex.message().c_str())
+                       << "HRESULT:" << QString::number(hr, 16);
+            m_winrtInitialized = false;
+            m_ownsApartment = false;
+        }
+    }
+#else
+    qWarning() << "A2DP Sink is only supported on Windows 10 2004+";
+#endif
+}
+
+void WinRTSinkBackend::cleanupWinRT()
+{
+#ifdef Q_OS_WIN
+    try {
+        // Stop device watcher if running
+        if (m_deviceWatcher) {
+            if (m_deviceAddedToken.value != 0) {
+                m_deviceWatcher.Added(m_deviceAddedToken);
+                m_deviceAddedToken = {};
+            }
+            if (m_enumerationCompletedToken.value != 0) {
+                m_deviceWatcher.EnumerationCompleted(m_enumerationCompletedToken);
+                m_enumerationCompletedToken = {};
+            }
+
+            if (m_deviceWatcher.Status() == DeviceWatcherStatus::Started ||
+                m_deviceWatcher.Status() == DeviceWatcherStatus::EnumerationCompleted) {
+                m_deviceWatcher.Stop();
+            }
+            m_deviceWatcher = nullptr;
+        }
+
+        if (m_connection) {
+            if (m_stateChangedToken.value != 0) {
+                m_connection.StateChanged(m_stateChangedToken);
+                m_stateChangedToken = {};
+            }
+
+            // Close and dispose
+            if (m_connection.State() == AudioPlaybackConnectionState::Opened) {
+                m_connection.Close();
+            }
+            m_connection = nullptr;
+        }
+
+        if (m_winrtInitialized && m_ownsApartment) {
+            winrt::uninit_apartment();
+            qDebug() << "WinRT apartment uninitialized";
+        }
+
+        m_winrtInitialized = false;
+        m_ownsApartment = false;
+    }
+    catch (const winrt::hresult_error &ex) {
+        qWarning() << "Error during cleanup:"
+                   << QString::fromWCharArray(ex.message().c_str());
+    }
+#endif
+}
+
+void WinRTSinkBackend::startDeviceDiscovery()
+{
+#ifdef Q_OS_WIN
+    if (!m_winrtInitialized) {
+        emit connectionError("WinRT not initialized");
+        return;
+    }
+
+    try {
+        qDebug() << "Starting device discovery for A2DP-capable devices...";
+
+        // Get selector for devices that support AudioPlaybackConnection
+        auto selector = AudioPlaybackConnection::GetDeviceSelector();
+        qDebug() << "Device selector:" << QString::fromWCharArray(selector.c_str());
+
+        // Create device watcher
+        m_deviceWatcher = DeviceInformation::CreateWatcher(selector);
+
+        // Register for device added events
+        m_deviceAddedToken = m_deviceWatcher.Added(
+            [this](DeviceWatcher sender, DeviceInformation device) {
+                onDeviceAdded(sender, device);
+            }
+            );
+
+        // Register for enumeration completed
+        m_enumerationCompletedToken = m_deviceWatcher.EnumerationCompleted(
+            [this](DeviceWatcher sender, winrt::IInspectable args) {
+                onDeviceEnumerationCompleted(sender, args);
+            }
+            );
+
+        // Start watching
+        m_deviceWatcher.Start();
+        qDebug() << "Device watcher started";
+    }
+    catch (const winrt::hresult_error &ex) {
+        recordHResult("DeviceWatcher", ex);
+        QString error = QString::fromWCharArray(ex.message().c_str());
+        qWarning() << "Error starting device discovery:" << error;
+        emit connectionError(error);
+    }
+#else
+    emit connectionError("Device discovery only supported on Windows 10 2004+");
+#endif
+}
+
+void WinRTSinkBackend::stopDeviceDiscovery()
+{
+#ifdef Q_OS_WIN
+    if (m_deviceWatcher) {
+        try {
+            if (m_deviceWatcher.Status() == DeviceWatcherStatus::Started ||
+                m_deviceWatcher.Status() == DeviceWatcherStatus::EnumerationCompleted) {
+                m_deviceWatcher.Stop();
+                qDebug() << "Device watcher stopped";
+            }
+        }
+        catch (const winrt::hresult_error &ex) {
+            qWarning() << "Error stopping device watcher:"
+                       << QString::fromWCharArray(ex.message().c_str());
+        }
+    }
+#endif
+}
+
+#ifdef Q_OS_WIN
+void WinRTSinkBackend::onDeviceAdded(winrt::DeviceWatcher sender, winrt::DeviceInformation device)
+{
+    Q_UNUSED(sender);
+    TRACE_SCOPE("winrt", "DeviceWatcher Added");
+
+    // On a WinRT thread; delivered to the Qt thread with whatever else arrives in the same frame
+    m_watcherEvents.push({ { QString::fromWCharArray(device.Id().c_str()),
+                             QString::fromWCharArray(device.Name().c_str()) } });
+}
+
+void WinRTSinkBackend::onDeviceEnumerationCompleted(winrt::DeviceWatcher sender, winrt::IInspectable args)
+{
+    Q_UNUSED(sender);
+    Q_UNUSED(args);
+    TRACE_SCOPE("winrt", "DeviceWatcher EnumerationCompleted");
+
+    m_watcherEvents.push({ {}, true });
+}
+
+void WinRTSinkBackend::deliverWatcherEvents(const QList<WatcherEvent> &events)
+{
+    TRACE_SCOPE("discovery", "deliverWatcherEvents");
+    QList<A2DPDevice> devices;
+    bool enumerationCompleted = false;
+    for (const WatcherEvent &event : events) {
+        if (event.enumerationCompleted) {
+            enumerationCompleted = true;
+            continue;
+        }
+        LOG_DEBUG("Found A2DP device: %1 ID: %2", event.device.name, event.device.deviceId);
+        devices.append(event.device);
+    }
+
+    if (!devices.isEmpty())
+        emit devicesDiscovered(devices);
+
+    if (enumerationCompleted) {
+        const EventBatcher<WatcherEvent>::Stats &stats = m_watcherEvents.stats();
+        LOG_INFO("Device enumeration completed: %1 watcher events in %2 batches, largest %3 - delivery latency max %4 us",
+                 stats.items, stats.batches, stats.maxBatch, stats.maxLatencyUs);
+        emit discoveryCompleted();
+    }
+}
+#endif
+
+bool WinRTSinkBackend::enableSink(const QString &deviceId)
+{
+#ifdef Q_OS_WIN
+    if (!m_winrtInitialized) {
+        emit connectionError("WinRT not initialized");
+        return false;
+    }
+
+    // Release any existing connection first; this also drops an enable or open still in flight
+    releaseConnection();
+
+    m_currentDeviceId = deviceId;
+
+    qDebug() << "Enabling A2DP sink for device:" << deviceId;
+
+    // Start async operation
+    enableSinkAsync(deviceId.toStdWString(), m_operations.token());
+
+    return true;
+#else
+    emit connectionError("A2DP Sink only supported on Windows 10 2004+");
+    return false;
+#endif
+}
+
+#ifdef Q_OS_WIN
+AsyncTask WinRTSinkBackend::enableSinkAsync(std::wstring deviceId, CancellationToken token)
+{
+    // Up to the first co_await this runs inside enableSink(), so errors are still reported queued
+    AudioPlaybackConnection connection{ nullptr };
+    IAsyncAction start{ nullptr };
+    try {
+        qDebug() << "Creating AudioPlaybackConnection...";
+
+        // Create the AudioPlaybackConnection for this device
+        connection = AudioPlaybackConnection::TryCreateFromId(deviceId);
+        const qint64 createdUs = JitterBuffer::steadyMicros();
+
+        if (!connection) {
+            QMetaObject::invokeMethod(this, [this]() {
+                emit connectionError("Failed to create AudioPlaybackConnection");
+            }, Qt::QueuedConnection);
+            co_return;
+        }
+
+        qDebug() << "AudioPlaybackConnection created successfully";
+        m_connection = connection;
+        emit connectMilestone(ConnectMilestone::ConnectionCreated, createdUs);
+
+        // Register for state change events
+        m_stateChangedToken = connection.StateChanged(
+            [this](AudioPlaybackConnection sender, winrt::IInspectable args) {
+                onConnectionStateChanged(sender, args);
+            }
+            );
+
+        // Start the connection (enables incoming audio)
+        qDebug() << "Starting AudioPlaybackConnection...";
+        start = connection.StartAsync();
+    }
+    catch (const winrt::hresult_error &ex) {
+        recordHResult("EnableSink", ex);
+        const QString error = errorMessage(ex);
+        qWarning() << "Error enabling sink:" << error;
+
+        QMetaObject::invokeMethod(this, [this, error]() {
+            emit connectionError(error);
+        }, Qt::QueuedConnection);
+        co_return;
+    }
+
+    // Cancellation destroys this frame at the co_await, which closes the span as cancelled
+    TRACE_ASYNC_SCOPE(startSpan, "winrt", "StartAsync", this);
+    const StartOutcome outcome = co_await completion(this, token, start);
+    TRACE_ASYNC_SCOPE_END(startSpan);
+
+    // Back on the Qt thread, and only if no release or newer enable came in meanwhile
+    if (!outcome.error.isEmpty()) {
+        qWarning() << "Error enabling sink:" << outcome.error;
+        emit connectionError(outcome.error);
+        co_return;
+    }
+
+    qDebug() << "AudioPlaybackConnection started successfully";
+    emit connectMilestone(ConnectMilestone::SinkStarted, outcome.completedUs);
+    emit sinkEnabled();
+    emit stateChanged("Sink Enabled - Ready to Connect");
+}
+
+AsyncTask WinRTSinkBackend::openConnectionAsync(CancellationToken token)
+{
+    IAsyncOperation<AudioPlaybackConnectionOpenResult> open{ nullptr };
+    try {
+        qDebug() << "Opening audio connection...";
+
+        // Open the connection (audio starts flowing)
+        open = m_connection.OpenAsync();
+    }
+    catch (const winrt::hresult_error &ex) {
+        recordHResult("OpenAsync", ex);
+        const QString error = errorMessage(ex);
+        qWarning() << "Error opening connection:" << error;
+
+        QMetaObject::invokeMethod(this, [this, error]() {
+            emit connectionError(error);
+        }, Qt::QueuedConnection);
+        co_return;
+    }
+
+    TRACE_ASYNC_SCOPE(openSpan, "winrt", "OpenAsync", this);
+    const OpenOutcome outcome = co_await completion(this, token, open);
+    TRACE_ASYNC_SCOPE_END(openSpan);
+
+    if (!outcome.error.isEmpty()) {
+        qWarning() << "Error opening connection:" << outcome.error;
+        emit connectionError(outcome.error);
+        co_return;
+    }
+
+    if (outcome.result.Status() == AudioPlaybackConnectionOpenResultStatus::Success) {
+        qDebug() << "Audio connection opened successfully";
+        m_isStreaming = true;
+
+        emit connectMilestone(ConnectMilestone::ConnectionOpened, outcome.completedUs);
+        emit connectionOpened();
+        emit stateChanged("Connected - Audio Streaming");
+    }
+    else {
+        QString error = "Failed to open connection: ";
+        switch (outcome.result.Status()) {
+        case AudioPlaybackConnectionOpenResultStatus::RequestTimedOut:
+            error += "Request timed out";
+            break;
+        case AudioPlaybackConnectionOpenResultStatus::DeniedBySystem:
+            error += "Denied by system";
+            break;
+        case AudioPlaybackConnectionOpenResultStatus::UnknownFailure:
+            error += "Unknown failure";
+            break;
+        default:
+            error += "Unknown status";
+            break;
+        }
+
+        FlightRecorder::record(FlightRecorder::HResult, "OpenResult", outcome.result.ExtendedError().value,
+                               int(outcome.result.Status()));
+        qWarning() << error;
+        emit connectionError(error);
+    }
+}
+
+void WinRTSinkBackend::onConnectionStateChanged(
+    winrt::AudioPlaybackConnection sender,
+    winrt::IInspectable args)
+{
+    Q_UNUSED(args);
+    TRACE_SCOPE("winrt", "StateChanged");
+
+    auto state = sender.State();
+    const qint64 changedUs = JitterBuffer::steadyMicros();
+
+    QMetaObject::invokeMethod(this, [this, sender, state, changedUs]() {
+        // Events of a connection released in the meantime
+        if (sender != m_connection)
+            return;
+        TRACE_SCOPE("winrt", "StateChanged delivered");
+
+        QString stateStr;
+
+        switch (state) {
+        case AudioPlaybackConnectionState::Closed:
+            stateStr = "Closed";
+            m_isStreaming = false;
+
+            // The phone or Windows closed it; the next connect creates a new connection
+            try {
+                if (m_stateChangedToken.value != 0) {
+                    m_connection.StateChanged(m_stateChangedToken);
+                    m_stateChangedToken = {};
+                }
+            }
+            catch (const winrt::hresult_error &ex) {
+                recordHResult("StateChanged", ex);
+            }
+            m_connection = nullptr;
+            emit connectionClosed();
+            break;
+
+        case AudioPlaybackConnectionState::Opened:
+            stateStr = "Opened";
+            m_isStreaming = true;
+            emit connectMilestone(ConnectMilestone::StreamOpened, changedUs);
+            emit connectionOpened();
+            break;
+
+        default:
+            stateStr = "Unknown";
+            break;
+        }
+
+        LOG_INFO("Connection state changed: %1", stateStr);
+        emit stateChanged(stateStr);
+
+    }, Qt::QueuedConnection);
+}
+#endif
+
+bool WinRTSinkBackend::openConnection()
+{
+#ifdef Q_OS_WIN
+    if (!m_winrtInitialized) {
+        emit connectionError("WinRT not initialized");
+        return false;
+    }
+
+    if (!m_connection) {
+        emit connectionError("Sink not enabled - call enableSink() first");
+        return false;
+    }
+
+    qDebug() << "Requesting to open connection...";
+
+    // Start async operation
+    openConnectionAsync(m_operations.token());
+
+    return true;
+#else
+    emit connectionError("A2DP Sink only supported on Windows 10 2004+");
+    return false;
+#endif
+}
+
+void WinRTSinkBackend::releaseConnection()
+{
+#ifdef Q_OS_WIN
+    m_operations.cancel();
+
+    if (m_connection) {
+        try {
+            qDebug() << "Releasing A2DP connection...";
+
+            // Unregister state changed event
+            if (m_stateChangedToken.value != 0) {
+                m_connection.StateChanged(m_stateChangedToken);
+                m_stateChangedToken = {};
+            }
+
+            // Close if open
+            if (m_connection.State() == AudioPlaybackConnectionState::Opened) {
+                m_connection.Close();
+            }
+
+            m_connection = nullptr;
+            m_isStreaming = false;
+
+            emit connectionClosed();
+            emit stateChanged("Disconnected");
+
+            qDebug() << "Connection released successfully";
+        }
+        catch (const winrt::hresult_error &ex) {
+            recordHResult("Close", ex);
+            qWarning() << "Error releasing connection:"
+                       << QString::fromWCharArray(ex.message().c_str());
+        }
+    }
+#endif
+}
+
+bool WinRTSinkBackend::isStreaming() const
+{
+    return m_isStreaming;
+}
+
+// Media control functions using SendInput
+void WinRTSinkBackend::sendPlayPause()
+{
+#ifdef Q_OS_WIN
+    sendMediaKey(VK_MEDIA_PLAY_PAUSE);
+    LOG_DEBUG("Sent Play/Pause command");
+#endif
+}
+
+void WinRTSinkBackend::sendNext()
+{
+#ifdef Q_OS_WIN
+    sendMediaKey(VK_MEDIA_NEXT_TRACK);
+    LOG_DEBUG("Sent Next Track command");
+#endif
+}
+
+void WinRTSinkBackend::sendPrevious()
+{
+#ifdef Q_OS_WIN
+    sendMediaKey(VK_MEDIA_PREV_TRACK);
+    LOG_DEBUG("Sent Previous Track command");
+#endif
+}
+
+void WinRTSinkBackend::sendStop()
+{
+#ifdef Q_OS_WIN
+    sendMediaKey(VK_MEDIA_STOP);
+    LOG_DEBUG("Sent Stop command");
+#endif
+}
+
+#ifdef Q_OS_WIN
+void WinRTSinkBackend::sendMediaKey(DWORD vkCode)
+{
+    INPUT inputs[2] = {};
+
+    // Key down
+    inputs[0].type = INPUT_KEYBOARD;
+    inputs[0].ki.wVk = vkCode;
+
+    // Key up
+    inputs[1].type = INPUT_KEYBOARD;
+    inputs[1].ki.wVk = vkCode;
+    inputs[1].ki.dwFlags = KEYEVENTF_KEYUP;
+
+    UINT sent = SendInput(2, inputs, sizeof(INPUT));
+
+    if (sent != 2) {
+        qWarning() << "Failed to send media key:" << vkCode
+                   << "Error:" << GetLastError();
+    }
+}
+#endif
@@ -0,0 +1,86 @@
+#ifndef WINRTSINKBACKEND_H
+#define WINRTSINKBACKEND_H
+
+#include "a2dpsinkbackend.h"
+#include "asynctask.h"
+#include "eventbatcher.h"
+
+#include <QString>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+    #include <windows.h>
+    #include <wrl/client.h>
+    #include <winrt/Windows.Foundation.h>
+    #include <winrt/Windows.Media.Audio.h>
+    #include <winrt/Windows.Devices.Enumeration.h>
+
+    namespace winrt {
+        using namespace Windows::Foundation;
+        using namespace Windows::Media::Audio;
+        using namespace Windows::Devices::Enumeration;
+    }
+#endif
+
+// A2DP sink backed by WinRT AudioPlaybackConnection (Windows 10 2004+).
+// Windows decodes and renders the stream itself, so no media packets are produced.
+class WinRTSinkBackend : public A2DPSinkBackend
+{
+    Q_OBJECT
+public:
+    explicit WinRTSinkBackend(QObject *parent = nullptr);
+    ~WinRTSinkBackend() override;
+
+    QString name() const override { return "WinRT"; }
+
+    void startDeviceDiscovery() override;
+    void stopDeviceDiscovery() override;
+    bool enableSink(const QString &deviceId) override;
+    bool openConnection() override;
+    void releaseConnection() override;
+    bool isStreaming() const override;
+
+    void sendPlayPause() override;
+    void sendNext() override;
+    void sendPrevious() override;
+    void sendStop() override;
+
+private:
+    void initializeWinRT();
+    void cleanupWinRT();
+
+#ifdef Q_OS_WIN
+    // What the DeviceWatcher reported, queued on its thread and delivered in batches on ours
+    struct WatcherEvent
+    {
+        A2DPDevice device;                  // empty for enumerationCompleted
+        bool enumerationCompleted = false;
+    };
+
+    AsyncTask enableSinkAsync(std::wstring deviceId, CancellationToken token);
+    AsyncTask openConnectionAsync(CancellationToken token);
+    void onConnectionStateChanged(winrt::AudioPlaybackConnection sender, winrt::IInspectable args);
+    void sendMediaKey(DWORD vkCode);
+    void onDeviceAdded(winrt::DeviceWatcher sender, winrt::DeviceInformation device);
+    void onDeviceEnumerationCompleted(winrt::DeviceWatcher sender, winrt::IInspectable args);
+    void deliverWatcherEvents(const QList<WatcherEvent> &events);
+
+    winrt::AudioPlaybackConnection m_connection{nullptr};
+    winrt::DeviceWatcher m_deviceWatcher{nullptr};
+    winrt::event_token m_stateChangedToken;
+    winrt::event_token m_deviceAddedToken;
+    winrt::event_token m_enumerationCompletedToken;
+
+    EventBatcher<WatcherEvent> m_watcherEvents;
+
+    // Cancelled by every release, so completions of superseded enables and opens are dropped
+    CancellationSource m_operations;
+#endif
+
+    bool m_winrtInitialized;
+    bool m_ownsApartment;
+    bool m_isStreaming;
+    QString m_currentDeviceId;
+};
+
+#endif // WINRTSINKBACKEND_H